@@ -26,6 +26,7 @@ namespace OSDK {
 
 // Forward Declaration
 class Vehicle;
+class LinuxIoReactor;
 
 #pragma pack(1)
 typedef struct DataConfig
@@ -193,6 +194,32 @@ public:
    */
   void setAcmDevicePath(const char *acm_path);
 
+  /*! @brief
+   *
+   *  Read the FPV and main camera streams through one shared IO reactor
+   *  instead of one thread per camera. The decoding then runs on the
+   *  reactor workers. Call it before starting the streams.
+   *
+   *  @platforms M210V2
+   *  @param workerNum number of worker threads
+   *  @return true if the reactor is running
+   */
+  bool enableIoReactor(int workerNum = 2);
+
+  /*! @brief
+   *
+   *  Go back to one read thread per camera. Running streams are
+   *  reconnected on their own thread.
+   *
+   *  @platforms M210V2
+   */
+  void disableIoReactor();
+
+  /*! @brief Reactor shared by the advanced sensing channels, NULL if not
+   *  enabled
+   */
+  LinuxIoReactor* getIoReactor();
+
   /*! @brief
    *
    *  Stop the FPV RGB Stream
@@ -245,6 +272,49 @@ public:
    */
   bool getMainCameraImage(CameraRGBImage& copyOfImage);
 
+  /*! @brief
+   *
+   *  Add a subscriber to the decoded images of a camera. All the subscribers
+   *  of one camera share a single decoder, and each one gets its own
+   *  callback thread and frame-drop policy, so a slow subscriber never
+   *  stalls the decoder or the other subscribers.
+   *
+   *  @platforms M300
+   *  @note The camera stream is started by the first subscriber and stopped
+   *  when the last one is removed, unless it was already started by
+   *  startFPVCameraStream or startMainCameraStream.
+   *  @param pos point out which camera to subscribe
+   *  @param cb callback function that is called in the subscriber's thread
+   *  @param userData a void pointer that users can manipulate inside the callback
+   *  @param config frame-drop policy of this subscriber
+   *  @return subscriber id (>= 0) used to unsubscribe, -1 if failed
+   */
+  int subscribeCameraImage(LiveView::LiveViewCameraPosition pos,
+                           CameraImageCallback cb, void *userData,
+                           const CameraImageSubscriberConfig &config);
+
+  /*! @brief
+   *
+   *  Remove a subscriber added by subscribeCameraImage
+   *
+   *  @platforms M300
+   *  @param pos point out which camera the subscriber belongs to
+   *  @param subscriberId id returned by subscribeCameraImage
+   *  @return true if the subscriber is removed, false otherwise
+   */
+  bool unsubscribeCameraImage(LiveView::LiveViewCameraPosition pos, int subscriberId);
+
+  /*! @brief
+   *
+   *  Get the delivered and dropped frame counters of a subscriber
+   *
+   *  @platforms M300
+   *  @return true if the subscriber is found, false otherwise
+   */
+  bool getCameraImageSubscriberStats(LiveView::LiveViewCameraPosition pos,
+                                     int subscriberId, uint32_t &delivered,
+                                     uint32_t &dropped);
+
   /*! @brief
    *
    *  Start the FPV or Camera H264 Stream
@@ -274,6 +344,36 @@ public:
    */
   LiveView::LiveViewErrCode stopH264Stream(LiveView::LiveViewCameraPosition pos);
 
+  /*! @brief
+   *
+   *  Observe complete H264 access units of a camera, ref to
+   *  DJI::OSDK::LiveView::addH264AccessUnitObserver
+   *
+   *  @platforms M300
+   *  @param pos point out which camera to observe
+   *  @param cb callback function that is called when a complete access unit
+   *            is assembled
+   *  @param userData a void pointer that users can manipulate inside the callback
+   *  @return Errorcode of liveivew, ref to DJI::OSDK::LiveView::LiveViewErrCode
+   */
+  LiveView::LiveViewErrCode addH264AccessUnitObserver(LiveView::LiveViewCameraPosition pos,
+                                                      H264AccessUnitCallback cb,
+                                                      void *userData);
+
+  /*! @brief
+   *
+   *  Remove an observer added by addH264AccessUnitObserver
+   *
+   *  @platforms M300
+   *  @param pos point out which camera to observe
+   *  @param cb callback function passed to addH264AccessUnitObserver
+   *  @param userData user data passed to addH264AccessUnitObserver
+   *  @return Errorcode of liveivew, ref to DJI::OSDK::LiveView::LiveViewErrCode
+   */
+  LiveView::LiveViewErrCode removeH264AccessUnitObserver(LiveView::LiveViewCameraPosition pos,
+                                                         H264AccessUnitCallback cb,
+                                                         void *userData);
+
   /*! @brief
    *
    *  Subscribe the perception camera image stream (Only for M300 series)
@@ -287,6 +387,22 @@ public:
    */
   Perception::PerceptionErrCode subscribePerceptionImage(Perception::DirectionType direction, Perception::PerceptionImageCB cb, void* userData);
 
+  /*! @brief
+   *
+   *  Subscribe the perception camera image stream, delivered in pooled
+   *  buffers that can be kept after the callback without copying, ref to
+   *  DJI::OSDK::Perception::PerceptionImageFrame
+   *
+   *  @platforms M210V2, M300
+   *  @note For M210 V2 series, only front and down directions are supported.
+   *  @param direction point out which direction's stream need to be subscribed
+   *  @param cb callback function that is called in a callback thread when a
+   *            perception image frame is received
+   *  @param userData a void pointer that users can manipulate inside the callback
+   *  @return Errorcode of perception, ref to DJI::OSDK::Perception::PerceptionErrCode
+   */
+  Perception::PerceptionErrCode subscribePerceptionImageFrame(Perception::DirectionType direction, Perception::PerceptionImageFrameCB cb, void* userData);
+
   /*! @brief
    *
    *  Unsubscribe the perception camera image stream (Only for M300 series)
@@ -323,16 +439,22 @@ public:
 
 private:
   void sendCommonCmd(uint8_t *data, uint8_t data_len, uint8_t cmd_id);
+  /*! Stop the legacy callback of a M300 camera, the decoder and the stream
+   *  keep running while camera image subscribers remain */
+  void stopDecoderStream(LiveView::LiveViewCameraPosition pos);
 
 private:
 AdvancedSensingProtocol* advancedSensingProtocol;
 Vehicle* vehicle_ptr;
 DJICameraStream* mainCam_ptr;
 DJICameraStream* fpvCam_ptr;
+LinuxIoReactor* ioReactor;
 LiveView *liveview;
 Perception *perception;
 const char* acm_dev;
 map<LiveView::LiveViewCameraPosition, DJICameraStreamDecoder*> streamDecoder;
+map<LiveView::LiveViewCameraPosition, bool> decoderStreaming;
+map<LiveView::LiveViewCameraPosition, bool> fanoutOwnsStream;
 
 public:
 AdvancedSensingProtocol* getAdvancedSensingProtocol();
@@ -0,0 +1,118 @@
+/** @file dji_disparity_unprojector.hpp
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ *  @brief Vectorised disparity to point cloud conversion
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef ONBOARDSDK_DJI_DISPARITY_UNPROJECTOR_H
+#define ONBOARDSDK_DJI_DISPARITY_UNPROJECTOR_H
+
+#include <vector>
+#include <cstddef>
+#include "stdint.h"
+
+namespace DJI {
+namespace OSDK {
+
+/*! @brief Unproject a disparity map of a rectified stereo pair to 3D points
+ *  in the left camera frame.
+ *
+ *  Z = baselineFx / disparity, X = (u - cx) * Z / fx, Y = (v - cy) * Z / fy.
+ *  The divisions are replaced by tables built once at construction, and the
+ *  per-pixel work is vectorised with SSE2 or NEON when available.
+ */
+class DisparityUnprojector {
+ public:
+  /*! disparity maps are fixed point with 4 fractional bits, as the output
+   *  of cv::StereoBM and cv::StereoSGBM */
+  static const int DISPARITY_FRACTION_BITS = 4;
+
+  /*! @param width, height size of the disparity map
+   *  @param fx, fy, cx, cy of the rectified left camera
+   *  @param baselineFx baseline times fx, i.e. -P_right(0, 3)
+   *  @param numDisparities search range of the matcher, larger disparities
+   *  are treated as invalid
+   *  @param minDisparity points with a smaller disparity are too far away
+   *  and output as (0, 0, 0)
+   */
+  DisparityUnprojector(int width, int height, double fx, double fy, double cx,
+                       double cy, double baselineFx, int numDisparities,
+                       double minDisparity = 6.0);
+  ~DisparityUnprojector();
+
+  /*! @brief unproject a whole disparity map
+   *
+   *  @param disparity fixed point disparity map
+   *  @param disparityStride row stride of disparity, in elements
+   *  @param xyz caller-provided output of width * height * 3 floats, packed
+   *  row by row as x, y, z per pixel. Every pixel is written, invalid ones
+   *  and the ones in the border as (0, 0, 0).
+   *  @param border number of pixels cut from each side, e.g. left blank by
+   *  the rectification
+   *  @param threadNum rows are split into this many bands which are
+   *  processed in parallel, 1 to run in the calling thread only. The
+   *  threads are created per call, which only pays off on slow cores.
+   */
+  void unproject(const int16_t *disparity, size_t disparityStride, float *xyz,
+                 int border = 0, int threadNum = 1) const;
+
+  int getWidth() const { return width; }
+  int getHeight() const { return height; }
+
+ private:
+  typedef struct RowBand {
+    const DisparityUnprojector *owner;
+    const int16_t *disparity;
+    size_t disparityStride;
+    float *xyz;
+    int border;
+    int rowBegin;
+    int rowEnd;
+  } RowBand;
+
+  static void *rowBandEntry(void *p);
+
+  void unprojectRows(const int16_t *disparity, size_t disparityStride,
+                     float *xyz, int border, int rowBegin, int rowEnd) const;
+
+  inline float depthOf(int16_t d) const {
+    uint32_t i = (uint16_t) d;
+    return depthTable[i < depthTable.size() ? i : depthTable.size() - 1];
+  }
+
+  int width;
+  int height;
+  /*! Z indexed by the fixed point disparity, the last entry is 0 for all
+   *  the negative and out of range values */
+  std::vector<float> depthTable;
+  /*! (u - cx) / fx and (v - cy) / fy */
+  std::vector<float> xCoef;
+  std::vector<float> yCoef;
+};
+
+} // OSDK
+} // DJI
+
+#endif //ONBOARDSDK_DJI_DISPARITY_UNPROJECTOR_H
@@ -85,6 +85,40 @@ class LiveView {
    */
   LiveViewErrCode stopH264Stream(LiveViewCameraPosition pos);
 
+  /*! @brief
+   *
+   *  Observe complete H264 access units of a camera instead of the raw
+   *  fragments. The latest GOP is cached, so a newly added observer gets
+   *  the stream replayed from the latest keyframe immediately.
+   *
+   *  @platforms M300
+   *  @note The stream still needs to be started by startH264Stream. The
+   *  assembling is enabled by the first observer and lasts until the stream
+   *  is stopped.
+   *  @param pos point out which camera to observe
+   *  @param cb callback function that is called in the liveview thread when
+   *            a complete access unit is assembled
+   *  @param userData a void pointer that users can manipulate inside the callback
+   *  @return Errorcode of liveivew, ref to DJI::OSDK::LiveView::LiveViewErrCode
+   */
+  LiveViewErrCode addH264AccessUnitObserver(LiveViewCameraPosition pos,
+                                            H264AccessUnitCallback cb,
+                                            void *userData);
+
+  /*! @brief
+   *
+   *  Remove an observer added by addH264AccessUnitObserver
+   *
+   *  @platforms M300
+   *  @param pos point out which camera to observe
+   *  @param cb callback function passed to addH264AccessUnitObserver
+   *  @param userData user data passed to addH264AccessUnitObserver
+   *  @return Errorcode of liveivew, ref to DJI::OSDK::LiveView::LiveViewErrCode
+   */
+  LiveViewErrCode removeH264AccessUnitObserver(LiveViewCameraPosition pos,
+                                               H264AccessUnitCallback cb,
+                                               void *userData);
+
  private:
   Vehicle *vehicle;
   LiveViewImpl *impl;
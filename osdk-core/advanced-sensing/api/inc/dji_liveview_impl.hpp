@@ -34,6 +34,8 @@
 #include "dji_liveview.hpp"
 #include "dji_linker.hpp"
 
+class DJIH264AccessUnitAssembler;
+
 namespace DJI {
 namespace OSDK {
 
@@ -50,6 +52,14 @@ class LiveViewImpl {
 
   LiveView::LiveViewErrCode stopH264Stream(LiveView::LiveViewCameraPosition pos);
 
+  LiveView::LiveViewErrCode addH264AccessUnitObserver(LiveView::LiveViewCameraPosition pos,
+                                                      H264AccessUnitCallback cb,
+                                                      void *userData);
+
+  LiveView::LiveViewErrCode removeH264AccessUnitObserver(LiveView::LiveViewCameraPosition pos,
+                                                         H264AccessUnitCallback cb,
+                                                         void *userData);
+
   typedef struct H264CallbackHandler {
     H264Callback cb;
     void *userData;
@@ -193,6 +203,7 @@ class LiveViewImpl {
 
  private:
   static std::map<LiveView::LiveViewCameraPosition, H264CallbackHandler> h264CbHandlerMap;
+  static std::map<LiveView::LiveViewCameraPosition, DJIH264AccessUnitAssembler *> h264AssemblerMap;
   static T_RecvCmdItem bulkCmdList[];
   static E_OsdkStat RecordStreamHandler(struct _CommandHandle *cmdHandle,
                                         const T_CmdInfo *cmdInfo,
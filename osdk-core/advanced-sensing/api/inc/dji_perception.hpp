@@ -40,6 +40,7 @@ namespace OSDK {
 // Forward Declaration
 class Vehicle;
 class PerceptionImpl;
+class PerceptionFrameBuffer;
 
 class Perception {
  public:
@@ -127,6 +128,21 @@ class Perception {
   typedef void(*PerceptionImageCB)
       (Perception::ImageInfoType, uint8_t *imageRawBuffer, int bufferLen, void *userData);
 
+  /*! @brief one stereo camera image held in a pooled buffer. image points
+   * into buffer->data(), call buffer->retain() in the callback to keep the
+   * image after the callback returns, and buffer->release() when done.
+   */
+  typedef struct PerceptionImageFrame {
+    ImageInfoType info;
+    uint8_t *image;
+    int imageLen;
+    PerceptionFrameBuffer *buffer;
+  } PerceptionImageFrame;
+
+  /*! @bref callback type to receive stereo camera image frames */
+  typedef void(*PerceptionImageFrameCB)
+      (const Perception::PerceptionImageFrame &frame, void *userData);
+
  public:
 
   /*! @brief subscribe the raw images of both stereo cameras in the same
@@ -141,6 +157,20 @@ class Perception {
    */
   PerceptionErrCode subscribePerceptionImage(DirectionType direction, PerceptionImageCB cb, void* userData);
 
+  /*! @brief subscribe the raw images of both stereo cameras in the same
+   * direction, delivered in pooled buffers which can be kept after the
+   * callback without copying. Default frequency at 20 Hz.
+   *
+   *  @platforms M300
+   *  @param direction to specifly the direction of the subscription. Ref to
+   * DJI::OSDK::Perception::DirectionType
+   *  @param cb callback to observer the stereo camera image frames. Frames
+   * are dropped while all the pooled buffers are retained by the user.
+   *  @param userData when cb is called, used in cb.
+   *  @return error code. Ref to DJI::OSDK::Perception::PerceptionErrCode
+   */
+  PerceptionErrCode subscribePerceptionImageFrame(DirectionType direction, PerceptionImageFrameCB cb, void* userData);
+
   /*! @brief unsubscribe the raw image of both stereo cameras in the same
    * direction.
    *
@@ -177,6 +207,8 @@ class Perception {
   void cancelAllSubsciptions();
 
  private:
+  PerceptionErrCode subscribeDirection(DirectionType direction);
+
   Vehicle *vehicle;
   PerceptionImpl *impl;
 };
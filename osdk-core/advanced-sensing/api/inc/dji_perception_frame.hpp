@@ -0,0 +1,104 @@
+/** @file dji_perception_frame.hpp
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ *  @brief Pooled and refcounted buffers for the perception images
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef ONBOARDSDK_DJI_PERCEPTION_FRAME_H
+#define ONBOARDSDK_DJI_PERCEPTION_FRAME_H
+
+#include <vector>
+#include "stdint.h"
+#include "osdk_osal.h"
+
+namespace DJI {
+namespace OSDK {
+
+class PerceptionFramePool;
+
+/*! @brief A buffer of PerceptionFramePool holding one received frame.
+ *
+ *  The buffer goes back to its pool when the last reference is released, so
+ *  a consumer that needs the image after the callback returns calls retain()
+ *  in the callback and release() once done, instead of copying the image.
+ *  @note All the buffers must be released before the owner of the pool
+ *  (Perception or AdvancedSensing) is destroyed.
+ */
+class PerceptionFrameBuffer {
+ public:
+  uint8_t *data() const { return buf; }
+  size_t capacity() const { return bufSize; }
+
+  void retain();
+  void release();
+
+ private:
+  friend class PerceptionFramePool;
+
+  PerceptionFrameBuffer(PerceptionFramePool *owner, size_t size);
+  ~PerceptionFrameBuffer();
+
+  PerceptionFramePool *pool;
+  uint8_t *buf;
+  size_t bufSize;
+  int refCount;
+};
+
+/*! @brief Fixed number of preallocated frame buffers, recycled by reference
+ *  counting. Nothing is allocated after the construction.
+ */
+class PerceptionFramePool {
+ public:
+  PerceptionFramePool(int bufferNum, size_t bufferSize);
+  ~PerceptionFramePool();
+
+  /*! @brief get a free buffer with one reference held by the caller
+   *
+   *  @return the buffer, or NULL if all the buffers are still referenced
+   */
+  PerceptionFrameBuffer *acquire();
+
+  size_t getBufferSize() const { return bufferSize; }
+
+  /*! @return how many times acquire() failed since the pool was created */
+  uint32_t getExhaustedCount();
+
+ private:
+  friend class PerceptionFrameBuffer;
+
+  void retain(PerceptionFrameBuffer *buffer);
+  void release(PerceptionFrameBuffer *buffer);
+
+  T_OsdkMutexHandle mutex;
+  size_t bufferSize;
+  std::vector<PerceptionFrameBuffer *> buffers;
+  std::vector<PerceptionFrameBuffer *> freeBuffers;
+  uint32_t exhaustedCount;
+};
+
+} // OSDK
+} // DJI
+
+#endif //ONBOARDSDK_DJI_PERCEPTION_FRAME_H
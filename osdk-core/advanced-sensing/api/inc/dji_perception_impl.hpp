@@ -31,6 +31,7 @@
 
 #include <cstring>
 #include "dji_perception.hpp"
+#include "dji_perception_frame.hpp"
 #include "dji_vehicle.hpp"
 #include "dji_linker.hpp"
 
@@ -52,6 +53,11 @@ class PerceptionImpl {
     void* userData;
   } PerceptionImageHandler;
 
+  typedef struct PerceptionImageFrameHandler {
+    Perception::PerceptionImageFrameCB cb;
+    void* userData;
+  } PerceptionImageFrameHandler;
+
   typedef struct PerceptionCamParamHandler {
     Perception::PerceptionCamParamCB cb;
     void* userData;
@@ -79,9 +85,13 @@ class PerceptionImpl {
 
   void cancelAllSubsciptions();
 
+  /*! Create the buffers of the image frames at the first frame subscription */
+  bool initImageFramePool();
+
   vector<Perception::DirectionType> getUpdatingDiretcion();
  public:
   static PerceptionImageHandler imageHandler;
+  static PerceptionImageFrameHandler imageFrameHandler;
   static PerceptionCamParamHandler camParamHandler;
 
   static const char rectifyDownLeft[11];
@@ -101,6 +111,12 @@ class PerceptionImpl {
   Vehicle *vehicle;
   static uint32_t imageUpdateSysMs[IMAGE_MAX_DIRECTION_NUM];
   static uint32_t updateJudgingInMs;
+  /*! one raw image is 640x480 8bit, buffers for 4 stereo pairs in flight */
+  static const int IMAGE_FRAME_POOL_NUM = 8;
+  static const size_t IMAGE_FRAME_MAX_SIZE = 640 * 480;
+  static PerceptionFramePool *imageFramePool;
+  static void deliverImageFrame(const Perception::ImageInfoType &info,
+                                const uint8_t *image, int imageLen);
   string getSubscribeString(Perception::CamPositionType camChoice);
 };
 } // OSDK
@@ -0,0 +1,137 @@
+/** @file dji_perception_pair_assembler.hpp
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ *  @brief Pair the left and right perception images of each direction
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef ONBOARDSDK_DJI_PERCEPTION_PAIR_ASSEMBLER_H
+#define ONBOARDSDK_DJI_PERCEPTION_PAIR_ASSEMBLER_H
+
+#include "dji_perception.hpp"
+#include "dji_perception_frame.hpp"
+#include "osdk_osal.h"
+
+namespace DJI {
+namespace OSDK {
+
+/*! @brief Pairs the left and right images of up to six directions by their
+ *  sequence and time stamp, and emits them with the latest camera parameters
+ *  of the direction.
+ *
+ *  Images are kept by reference in a fixed number of slots per direction,
+ *  nothing is copied or allocated per frame. A slot that can not complete,
+ *  because an image is lost or all the slots are in use, is dropped and
+ *  counted.
+ *
+ *  Usage:
+ *  @code
+ *  PerceptionStereoPairAssembler assembler(pairCB, NULL);
+ *  perception->setStereoCamParamsObserver(
+ *      PerceptionStereoPairAssembler::camParamCallback, &assembler);
+ *  perception->subscribePerceptionImageFrame(Perception::RECTIFY_FRONT,
+ *      PerceptionStereoPairAssembler::imageFrameCallback, &assembler);
+ *  @endcode
+ */
+class PerceptionStereoPairAssembler {
+ public:
+  typedef struct StereoPair {
+    Perception::DirectionType direction;
+    /*! both buffers are released after the callback returns, call
+     *  buffer->retain() on them to keep the images */
+    Perception::PerceptionImageFrame left;
+    Perception::PerceptionImageFrame right;
+    bool hasCamParam;
+    Perception::CamParamType camParam;
+  } StereoPair;
+
+  typedef void (*StereoPairCB)(const StereoPair &pair, void *userData);
+
+  typedef struct Stats {
+    uint32_t pairCount;
+    /*! images released without a peer, lost peer or no free slot */
+    uint32_t droppedImageCount;
+    /*! images with a direction or camera position out of range */
+    uint32_t invalidImageCount;
+  } Stats;
+
+  static const int SLOT_NUM = 4;
+
+  /*! @param cb called in the thread pushing the images
+   *  @param userData passed to cb
+   *  @param maxTimeStampDiff two images with the same sequence are only
+   *  paired if their time stamps differ no more than this, 0 to disable
+   */
+  PerceptionStereoPairAssembler(StereoPairCB cb, void *userData,
+                                uint64_t maxTimeStampDiff = 0);
+  ~PerceptionStereoPairAssembler();
+
+  void pushImageFrame(const Perception::PerceptionImageFrame &frame);
+
+  void updateCamParam(const Perception::CamParamPacketType &paramPacket);
+
+  /*! @brief release all the images waiting for a peer, e.g. after
+   *  unsubscribing, the counters are kept */
+  void reset();
+
+  Stats getStats(Perception::DirectionType direction);
+
+  /*! Adapters for Perception::subscribePerceptionImageFrame and
+   *  Perception::setStereoCamParamsObserver, userData is the assembler */
+  static void imageFrameCallback(const Perception::PerceptionImageFrame &frame,
+                                 void *userData);
+  static void camParamCallback(Perception::CamParamPacketType paramPacket,
+                               void *userData);
+
+ private:
+  typedef struct Slot {
+    bool used;
+    uint16_t sequence;
+    uint64_t timeStamp;
+    uint32_t age;
+    bool hasLeft;
+    bool hasRight;
+    Perception::PerceptionImageFrame left;
+    Perception::PerceptionImageFrame right;
+  } Slot;
+
+  static bool isLeftImage(Perception::CamPositionType dataType);
+  bool isSamePair(const Slot &slot, const Perception::ImageInfoType &info);
+  void clearSlot(Slot &slot, bool dropped, Stats &stats);
+
+  T_OsdkMutexHandle mutex;
+  StereoPairCB cb;
+  void *userData;
+  uint64_t maxTimeStampDiff;
+  uint32_t slotAge;
+  Slot slots[IMAGE_MAX_DIRECTION_NUM][SLOT_NUM];
+  Stats stats[IMAGE_MAX_DIRECTION_NUM];
+  bool camParamValid[IMAGE_MAX_DIRECTION_NUM];
+  Perception::CamParamType camParams[IMAGE_MAX_DIRECTION_NUM];
+};
+
+} // OSDK
+} // DJI
+
+#endif //ONBOARDSDK_DJI_PERCEPTION_PAIR_ASSEMBLER_H
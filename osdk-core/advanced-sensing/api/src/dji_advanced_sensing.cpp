@@ -18,11 +18,14 @@
  * failure to do so.
  */
 #define ADVANCED_SENSING
+#include <atomic>
 #include <dji_vehicle.hpp>
 #include "dji_advanced_sensing.hpp"
 #include "dji_version.hpp"
 #include "dji_camera_stream_decoder.hpp"
 #include "dji_linker.hpp"
+#include "linux_io_reactor.hpp"
+#include "linux_usb_device.hpp"
 using namespace DJI;
 using namespace DJI::OSDK;
 
@@ -41,6 +44,9 @@ void parseVersion(uint8_t* ackPtr);
 Version::VersionData internal_drone_version;
 
 static pthread_t adv_pthread_handle;
+static std::atomic<bool> adv_pthread_running(false);
+//! Longest wait for USB data, bounds the time deinit() waits for the thread
+static const int ADV_READ_WAIT_MS = 100;
 
 void *adv_pthread(void *p){
   DSTATUS("adv pthread created !!!!!!!!!!!!!!!!!!!!!!!");
@@ -49,14 +55,22 @@ void *adv_pthread(void *p){
     RecvContainer container = {0};
     RecvContainer* recvContainer = &container;
     Vehicle*       vehiclePtr    = (Vehicle *)p;
-    while (true)
+    AdvancedSensingProtocol* protocol =
+      vehiclePtr->advancedSensing->getAdvancedSensingProtocol();
+    while (adv_pthread_running)
     {
-      recvContainer = vehiclePtr->advancedSensing->getAdvancedSensingProtocol()->receive();
+      /*! Block in the USB driver until data arrives instead of spinning
+       *  with a short sleep, see HardDriver::waitForData()
+       */
+      if (!protocol->waitForData(ADV_READ_WAIT_MS))
+      {
+        continue;
+      }
+      recvContainer = protocol->receive();
       if(recvContainer->recvInfo.cmd_id != 0xFF)
       {
         vehiclePtr->processAdvancedSensingImgs(recvContainer);
       }
-      usleep(10);
     }
   } else {
     DERROR("passing parameter error !");
@@ -67,12 +81,30 @@ void *adv_pthread(void *p){
 
 void AdvancedSensing::init()
 {
-  if (!vehicle_ptr->isM300())
-  pthread_create(&adv_pthread_handle, NULL, adv_pthread, vehicle_ptr);
+  if (!vehicle_ptr->isM300() && !adv_pthread_running)
+  {
+    adv_pthread_running = true;
+    if (0 != pthread_create(&adv_pthread_handle, NULL, adv_pthread, vehicle_ptr))
+    {
+      DERROR("Failed to create the advanced sensing read thread");
+      adv_pthread_running = false;
+    }
+    else
+    {
+      Platform::instance().applyTaskPolicy(&adv_pthread_handle,
+                                           OSDK_TASK_CLASS_LINK_READ,
+                                           "advSensingRead");
+    }
+  }
 }
 
 void AdvancedSensing::deinit()
 {
+  if (adv_pthread_running)
+  {
+    adv_pthread_running = false;
+    pthread_join(adv_pthread_handle, NULL);
+  }
 }
 
 AdvancedSensing::AdvancedSensing(Vehicle* vehiclePtr) :
@@ -81,7 +113,8 @@ AdvancedSensing::AdvancedSensing(Vehicle* vehiclePtr) :
   liveview(NULL),
   perception(NULL),
   fpvCam_ptr(NULL),
-  mainCam_ptr(NULL)
+  mainCam_ptr(NULL),
+  ioReactor(NULL)
 {
   stereoHandler.callback  = 0;
   stereoHandler.userData  = 0;
@@ -152,6 +185,14 @@ AdvancedSensing::AdvancedSensing(Vehicle* vehiclePtr) :
 
 AdvancedSensing::~AdvancedSensing()
 {
+  deinit();
+
+  /*! The libusb context goes with the protocol driver */
+  if (ioReactor)
+  {
+    ioReactor->removeLibusbContext();
+  }
+
   if (this->advancedSensingProtocol)
     delete this->advancedSensingProtocol;
 
@@ -165,6 +206,12 @@ AdvancedSensing::~AdvancedSensing()
     delete mainCam_ptr;
   }
 
+  /*! After the cameras, they stop reading through it when deleted */
+  if(ioReactor)
+  {
+    delete ioReactor;
+  }
+
   if(liveview)
   {
     delete liveview;
@@ -478,9 +525,15 @@ bool AdvancedSensing::startFPVCameraStream(CameraImageCallback cb,
     if ((deocderPair != streamDecoder.end()) && deocderPair->second) {
       deocderPair->second->init();
       deocderPair->second->registerCallback(cb, cbParam);
-      return (LiveView::OSDK_LIVEVIEW_PASS
-          == startH264Stream(LiveView::OSDK_CAMERA_POSITION_FPV, H264ToRGBCb,
-                             deocderPair->second));
+      if (decoderStreaming[LiveView::OSDK_CAMERA_POSITION_FPV]) {
+        fanoutOwnsStream[LiveView::OSDK_CAMERA_POSITION_FPV] = false;
+        return true;
+      }
+      decoderStreaming[LiveView::OSDK_CAMERA_POSITION_FPV] =
+          (LiveView::OSDK_LIVEVIEW_PASS
+           == startH264Stream(LiveView::OSDK_CAMERA_POSITION_FPV, H264ToRGBCb,
+                              deocderPair->second));
+      return decoderStreaming[LiveView::OSDK_CAMERA_POSITION_FPV];
     } else {
       return false;
     }
@@ -497,9 +550,15 @@ bool AdvancedSensing::startMainCameraStream(CameraImageCallback cb, void * cbPar
     if ((deocderPair != streamDecoder.end()) && deocderPair->second) {
       deocderPair->second->init();
       deocderPair->second->registerCallback(cb, cbParam);
-      return (LiveView::OSDK_LIVEVIEW_PASS
-          == startH264Stream(LiveView::OSDK_CAMERA_POSITION_NO_1, H264ToRGBCb,
-                             deocderPair->second));
+      if (decoderStreaming[LiveView::OSDK_CAMERA_POSITION_NO_1]) {
+        fanoutOwnsStream[LiveView::OSDK_CAMERA_POSITION_NO_1] = false;
+        return true;
+      }
+      decoderStreaming[LiveView::OSDK_CAMERA_POSITION_NO_1] =
+          (LiveView::OSDK_LIVEVIEW_PASS
+           == startH264Stream(LiveView::OSDK_CAMERA_POSITION_NO_1, H264ToRGBCb,
+                              deocderPair->second));
+      return decoderStreaming[LiveView::OSDK_CAMERA_POSITION_NO_1];
     } else {
       return false;
     }
@@ -511,11 +570,7 @@ bool AdvancedSensing::startMainCameraStream(CameraImageCallback cb, void * cbPar
 void AdvancedSensing::stopFPVCameraStream()
 {
   if (vehicle_ptr->isM300()) {
-    auto deocderPair = streamDecoder.find(LiveView::OSDK_CAMERA_POSITION_FPV);
-    if ((deocderPair != streamDecoder.end()) && deocderPair->second) {
-      deocderPair->second->cleanup();
-    }
-    stopH264Stream(LiveView::OSDK_CAMERA_POSITION_FPV);
+    stopDecoderStream(LiveView::OSDK_CAMERA_POSITION_FPV);
   } else {
     fpvCam_ptr->stopCameraStream();
   }
@@ -524,23 +579,104 @@ void AdvancedSensing::stopFPVCameraStream()
 void AdvancedSensing::stopMainCameraStream()
 {
   if (vehicle_ptr->isM300()) {
-    auto deocderPair = streamDecoder.find(LiveView::OSDK_CAMERA_POSITION_NO_1);
-    if ((deocderPair != streamDecoder.end()) && deocderPair->second) {
-      deocderPair->second->cleanup();
-    }
-    stopH264Stream(LiveView::OSDK_CAMERA_POSITION_NO_1);
+    stopDecoderStream(LiveView::OSDK_CAMERA_POSITION_NO_1);
   } else {
     mainCam_ptr->stopCameraStream();
   }
 }
 
+void AdvancedSensing::stopDecoderStream(LiveView::LiveViewCameraPosition pos)
+{
+  auto deocderPair = streamDecoder.find(pos);
+  if ((deocderPair != streamDecoder.end()) && deocderPair->second) {
+    DJICameraStreamDecoder *decoder = deocderPair->second;
+    if (decoderStreaming[pos] && (decoder->imageFanout.subscriberCount() > 0)) {
+      /*! the subscribers still need the decoder, the last unsubscribe stops it */
+      decoder->registerCallback(NULL, NULL);
+      fanoutOwnsStream[pos] = true;
+      return;
+    }
+    decoder->cleanup();
+  }
+  stopH264Stream(pos);
+  decoderStreaming[pos] = false;
+  fanoutOwnsStream[pos] = false;
+}
+
+int AdvancedSensing::subscribeCameraImage(
+    LiveView::LiveViewCameraPosition pos, CameraImageCallback cb,
+    void *userData, const CameraImageSubscriberConfig &config) {
+  if (!vehicle_ptr->isM300()) {
+    DERROR("Camera image subscribers are only supported on M300.");
+    return -1;
+  }
+
+  auto deocderPair = streamDecoder.find(pos);
+  if ((deocderPair == streamDecoder.end()) || !deocderPair->second) {
+    DERROR("No decoder for camera position %d", pos);
+    return -1;
+  }
+
+  DJICameraStreamDecoder *decoder = deocderPair->second;
+  int id = decoder->imageFanout.addSubscriber(cb, userData, config);
+  if (id < 0) {
+    return -1;
+  }
+
+  if (!decoderStreaming[pos]) {
+    if (!decoder->init() ||
+        (LiveView::OSDK_LIVEVIEW_PASS
+         != startH264Stream(pos, H264ToRGBCb, decoder))) {
+      DERROR("Failed to start the stream of camera position %d", pos);
+      decoder->imageFanout.removeSubscriber(id);
+      return -1;
+    }
+    decoderStreaming[pos] = true;
+    fanoutOwnsStream[pos] = true;
+  }
+  return id;
+}
+
+bool AdvancedSensing::unsubscribeCameraImage(
+    LiveView::LiveViewCameraPosition pos, int subscriberId) {
+  auto deocderPair = streamDecoder.find(pos);
+  if ((deocderPair == streamDecoder.end()) || !deocderPair->second) {
+    return false;
+  }
+
+  DJICameraStreamDecoder *decoder = deocderPair->second;
+  if (!decoder->imageFanout.removeSubscriber(subscriberId)) {
+    return false;
+  }
+
+  if (fanoutOwnsStream[pos] && (decoder->imageFanout.subscriberCount() == 0)) {
+    stopH264Stream(pos);
+    decoder->cleanup();
+    decoderStreaming[pos] = false;
+    fanoutOwnsStream[pos] = false;
+  }
+  return true;
+}
+
+bool AdvancedSensing::getCameraImageSubscriberStats(
+    LiveView::LiveViewCameraPosition pos, int subscriberId,
+    uint32_t &delivered, uint32_t &dropped) {
+  auto deocderPair = streamDecoder.find(pos);
+  if ((deocderPair == streamDecoder.end()) || !deocderPair->second) {
+    return false;
+  }
+  return deocderPair->second->imageFanout.getSubscriberStats(
+      subscriberId, delivered, dropped);
+}
+
 bool AdvancedSensing::newFPVCameraImageIsReady()
 {
   if (vehicle_ptr->isM300()) {
     auto deocderPair = streamDecoder.find(LiveView::OSDK_CAMERA_POSITION_FPV);
     if ((deocderPair != streamDecoder.end()) && deocderPair->second) {
-      deocderPair->second->decodedImageHandler.newImageIsReady();
+      return deocderPair->second->decodedImageHandler.newImageIsReady();
     }
+    return false;
   } else {
     return fpvCam_ptr->newImageIsReady();
   }
@@ -551,8 +687,9 @@ bool AdvancedSensing::newMainCameraImageReady()
   if (vehicle_ptr->isM300()) {
     auto deocderPair = streamDecoder.find(LiveView::OSDK_CAMERA_POSITION_NO_1);
     if ((deocderPair != streamDecoder.end()) && deocderPair->second) {
-      deocderPair->second->decodedImageHandler.newImageIsReady();
+      return deocderPair->second->decodedImageHandler.newImageIsReady();
     }
+    return false;
   } else {
     return mainCam_ptr->newImageIsReady();
   }
@@ -563,8 +700,9 @@ bool AdvancedSensing::getMainCameraImage(CameraRGBImage& copyOfImage)
   if (vehicle_ptr->isM300()) {
     auto deocderPair = streamDecoder.find(LiveView::OSDK_CAMERA_POSITION_NO_1);
     if ((deocderPair != streamDecoder.end()) && deocderPair->second) {
-      deocderPair->second->decodedImageHandler.getNewImageWithLock(copyOfImage, 20);
+      return deocderPair->second->decodedImageHandler.getNewImageWithLock(copyOfImage, 20);
     }
+    return false;
   } else {
     return mainCam_ptr->getCurrentImage(copyOfImage);
   }
@@ -575,8 +713,9 @@ bool AdvancedSensing::getFPVCameraImage(CameraRGBImage& copyOfImage)
   if (vehicle_ptr->isM300()) {
     auto deocderPair = streamDecoder.find(LiveView::OSDK_CAMERA_POSITION_FPV);
     if ((deocderPair != streamDecoder.end()) && deocderPair->second) {
-      deocderPair->second->decodedImageHandler.getNewImageWithLock(copyOfImage, 20);
+      return deocderPair->second->decodedImageHandler.getNewImageWithLock(copyOfImage, 20);
     }
+    return false;
   } else {
     return fpvCam_ptr->getCurrentImage(copyOfImage);
   }
@@ -586,6 +725,73 @@ void AdvancedSensing::setAcmDevicePath(const char *acm_path)
     this->acm_dev=acm_path;
 }
 
+bool AdvancedSensing::enableIoReactor(int workerNum)
+{
+  if (ioReactor)
+  {
+    return ioReactor->isRunning();
+  }
+
+  ioReactor = new LinuxIoReactor();
+  if (!ioReactor->start(workerNum))
+  {
+    DERROR("Failed to start the IO reactor, keep one thread per channel");
+    delete ioReactor;
+    ioReactor = NULL;
+    return false;
+  }
+
+  if (fpvCam_ptr)
+  {
+    fpvCam_ptr->setIoReactor(ioReactor);
+  }
+  if (mainCam_ptr)
+  {
+    mainCam_ptr->setIoReactor(ioReactor);
+  }
+
+  /*! The completions of the USB transfer ring are then handled on the
+   *  reactor as well, the reader thread finds them ready
+   */
+  LinuxUSBDevice* usbDevice =
+    advancedSensingProtocol
+      ? dynamic_cast<LinuxUSBDevice*>(advancedSensingProtocol->getDriver())
+      : NULL;
+  if (usbDevice && usbDevice->getContext())
+  {
+    ioReactor->addLibusbContext(usbDevice->getContext());
+  }
+  return true;
+}
+
+void AdvancedSensing::disableIoReactor()
+{
+  if (!ioReactor)
+  {
+    return;
+  }
+
+  /*! Streams reading through the reactor are moved back to their own
+   *  thread here, before the reactor is deleted
+   */
+  if (fpvCam_ptr)
+  {
+    fpvCam_ptr->setIoReactor(NULL);
+  }
+  if (mainCam_ptr)
+  {
+    mainCam_ptr->setIoReactor(NULL);
+  }
+  ioReactor->stop();
+  delete ioReactor;
+  ioReactor = NULL;
+}
+
+LinuxIoReactor* AdvancedSensing::getIoReactor()
+{
+  return ioReactor;
+}
+
 LiveView::LiveViewErrCode AdvancedSensing::startH264Stream(
     LiveView::LiveViewCameraPosition pos, H264Callback cb, void *userData) {
   if (vehicle_ptr->isM300())
@@ -628,6 +834,28 @@ LiveView::LiveViewErrCode AdvancedSensing::stopH264Stream(
   }
 }
 
+LiveView::LiveViewErrCode AdvancedSensing::addH264AccessUnitObserver(
+    LiveView::LiveViewCameraPosition pos, H264AccessUnitCallback cb,
+    void *userData) {
+  if (vehicle_ptr->isM300()) {
+    return liveview->addH264AccessUnitObserver(pos, cb, userData);
+  } else {
+    DERROR("H264 access unit observer is only supported on M300.");
+    return LiveView::OSDK_LIVEVIEW_UNSUPPORT_AIRCRAFT;
+  }
+}
+
+LiveView::LiveViewErrCode AdvancedSensing::removeH264AccessUnitObserver(
+    LiveView::LiveViewCameraPosition pos, H264AccessUnitCallback cb,
+    void *userData) {
+  if (vehicle_ptr->isM300()) {
+    return liveview->removeH264AccessUnitObserver(pos, cb, userData);
+  } else {
+    DERROR("H264 access unit observer is only supported on M300.");
+    return LiveView::OSDK_LIVEVIEW_UNSUPPORT_AIRCRAFT;
+  }
+}
+
 void stereoImg240pHandlerCB(Vehicle *vehiclePtr, RecvContainer recvFrame, UserData userData)
 {
   char *m210FLName = "front_left";
@@ -672,20 +900,29 @@ void stereoImg240pHandlerCB(Vehicle *vehiclePtr, RecvContainer recvFrame, UserDa
   }
 }
 
+static bool getM210ImageSelection(Perception::DirectionType direction,
+                                  AdvancedSensing::ImageSelection &image_select)
+{
+  memset(&image_select, 0, sizeof(AdvancedSensing::ImageSelection));
+  if (direction == Perception::RECTIFY_FRONT) {
+    image_select.front_left = 1;
+    image_select.front_right = 1;
+  } else if (direction == Perception::RECTIFY_DOWN) {
+    image_select.down_front = 1;
+    image_select.down_back = 1;
+  } else {
+    DERROR("The M210V2 Only support front and down stereo images subscription");
+    return false;
+  }
+  return true;
+}
+
 Perception::PerceptionErrCode AdvancedSensing::subscribePerceptionImage(
     Perception::DirectionType direction, Perception::PerceptionImageCB cb,
     void *userData) {
   if (vehicle_ptr->isM210V2()) {
     AdvancedSensing::ImageSelection image_select;
-    memset(&image_select, 0, sizeof(AdvancedSensing::ImageSelection));
-    if (direction == Perception::RECTIFY_FRONT) {
-      image_select.front_left = 1;
-      image_select.front_right = 1;
-    } else if (direction == Perception::RECTIFY_DOWN) {
-      image_select.down_front = 1;
-      image_select.down_back = 1;
-    } else {
-      DERROR("The M210V2 Only support front and down stereo images subscription");
+    if (!getM210ImageSelection(direction, image_select)) {
       return Perception::OSDK_PERCEPTION_REQ_UNSUPPORT;
     }
 
@@ -703,10 +940,31 @@ Perception::PerceptionErrCode AdvancedSensing::subscribePerceptionImage(
   }
 }
 
+Perception::PerceptionErrCode AdvancedSensing::subscribePerceptionImageFrame(
+    Perception::DirectionType direction, Perception::PerceptionImageFrameCB cb,
+    void *userData) {
+  if (vehicle_ptr->isM210V2()) {
+    AdvancedSensing::ImageSelection image_select;
+    if (!getM210ImageSelection(direction, image_select)) {
+      return Perception::OSDK_PERCEPTION_REQ_UNSUPPORT;
+    }
+
+    advancedSensingProtocol->setFrameObserver(cb, userData);
+    subscribeStereoImages(&image_select);
+    return Perception::OSDK_PERCEPTION_PASS;
+  } else if (vehicle_ptr->isM300()) {
+    return perception->subscribePerceptionImageFrame(direction, cb, userData);
+  } else {
+    DERROR("Only support M210V2 and M300");
+    return Perception::OSDK_PERCEPTION_REQ_UNSUPPORT;
+  }
+}
+
 Perception::PerceptionErrCode AdvancedSensing::unsubscribePerceptionImage(
     Perception::DirectionType direction) {
   if (vehicle_ptr->isM210V2()) {
     unsubscribeStereoImages();
+    advancedSensingProtocol->setFrameObserver(NULL, NULL);
     return Perception::OSDK_PERCEPTION_PASS;
   } else if (vehicle_ptr->isM300()) {
     return perception->unsubscribePerceptionImage(direction);
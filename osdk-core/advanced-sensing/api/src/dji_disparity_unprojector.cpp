@@ -0,0 +1,184 @@
+/** @file dji_disparity_unprojector.cpp
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ *  @brief Vectorised disparity to point cloud conversion
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <cstring>
+#include <pthread.h>
+#include "dji_disparity_unprojector.hpp"
+#include "dji_platform.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define DISPARITY_UNPROJECTOR_NEON
+#endif
+
+using namespace DJI;
+using namespace DJI::OSDK;
+
+DisparityUnprojector::DisparityUnprojector(int width, int height, double fx,
+                                           double fy, double cx, double cy,
+                                           double baselineFx,
+                                           int numDisparities,
+                                           double minDisparity)
+    : width(width), height(height) {
+  const int scale = 1 << DISPARITY_FRACTION_BITS;
+  const int maxRaw = numDisparities * scale;
+  const int minRaw = (int) (minDisparity * scale + 0.5);
+
+  depthTable.resize(maxRaw + 2, 0.0f);
+  for (int i = (minRaw > 1 ? minRaw : 1); i <= maxRaw; ++i) {
+    depthTable[i] = (float) (baselineFx * scale / i);
+  }
+
+  xCoef.resize(width + 4, 0.0f);
+  for (int u = 0; u < width; ++u) {
+    xCoef[u] = (float) ((u - cx) / fx);
+  }
+
+  yCoef.resize(height);
+  for (int v = 0; v < height; ++v) {
+    yCoef[v] = (float) ((v - cy) / fy);
+  }
+}
+
+DisparityUnprojector::~DisparityUnprojector() {}
+
+void DisparityUnprojector::unproject(const int16_t *disparity,
+                                     size_t disparityStride, float *xyz,
+                                     int border, int threadNum) const {
+  if (!disparity || !xyz) return;
+
+  if (threadNum <= 1) {
+    unprojectRows(disparity, disparityStride, xyz, border, 0, height);
+    return;
+  }
+
+  std::vector<RowBand> bands(threadNum);
+  std::vector<pthread_t> threads(threadNum);
+  std::vector<bool> started(threadNum, false);
+  const int rowsPerBand = (height + threadNum - 1) / threadNum;
+
+  for (int i = 0; i < threadNum; ++i) {
+    bands[i].owner = this;
+    bands[i].disparity = disparity;
+    bands[i].disparityStride = disparityStride;
+    bands[i].xyz = xyz;
+    bands[i].border = border;
+    bands[i].rowBegin = i * rowsPerBand < height ? i * rowsPerBand : height;
+    bands[i].rowEnd = bands[i].rowBegin + rowsPerBand < height
+                      ? bands[i].rowBegin + rowsPerBand : height;
+  }
+
+  /*! the calling thread takes the first band, a band whose thread can not
+   *  be created is also processed here */
+  for (int i = 1; i < threadNum; ++i) {
+    started[i] = (0 == pthread_create(&threads[i], NULL, rowBandEntry,
+                                      &bands[i]));
+    if (started[i]) {
+      Platform::instance().applyTaskPolicy(&threads[i],
+                                           OSDK_TASK_CLASS_PERCEPTION,
+                                           "disparityBand");
+    }
+  }
+  rowBandEntry(&bands[0]);
+  for (int i = 1; i < threadNum; ++i) {
+    if (started[i]) {
+      pthread_join(threads[i], NULL);
+    } else {
+      rowBandEntry(&bands[i]);
+    }
+  }
+}
+
+void *DisparityUnprojector::rowBandEntry(void *p) {
+  RowBand *band = (RowBand *) p;
+  band->owner->unprojectRows(band->disparity, band->disparityStride, band->xyz,
+                             band->border, band->rowBegin, band->rowEnd);
+  return NULL;
+}
+
+void DisparityUnprojector::unprojectRows(const int16_t *disparity,
+                                         size_t disparityStride, float *xyz,
+                                         int border, int rowBegin,
+                                         int rowEnd) const {
+  const int uBegin = border;
+  const int uEnd = width - border;
+
+  for (int v = rowBegin; v < rowEnd; ++v) {
+    float *out = xyz + (size_t) v * width * 3;
+
+    if (v < border || v >= height - border || uBegin >= uEnd) {
+      memset(out, 0, sizeof(float) * width * 3);
+      continue;
+    }
+    memset(out, 0, sizeof(float) * uBegin * 3);
+    memset(out + uEnd * 3, 0, sizeof(float) * (width - uEnd) * 3);
+
+    const int16_t *d = disparity + (size_t) v * disparityStride;
+    const float yc = yCoef[v];
+    int u = uBegin;
+
+#if defined(__SSE2__)
+    const __m128 vy = _mm_set1_ps(yc);
+    /*! each group writes 13 floats, the last one is overwritten by the next
+     *  pixel, so stop one pixel before the end and leave it to the tail */
+    for (; u + 4 < uEnd; u += 4) {
+      __m128 z = _mm_set_ps(depthOf(d[u + 3]), depthOf(d[u + 2]),
+                            depthOf(d[u + 1]), depthOf(d[u]));
+      __m128 x = _mm_mul_ps(_mm_loadu_ps(&xCoef[u]), z);
+      __m128 y = _mm_mul_ps(vy, z);
+      __m128 w = _mm_setzero_ps();
+      _MM_TRANSPOSE4_PS(x, y, z, w);
+      float *p = out + u * 3;
+      _mm_storeu_ps(p, x);
+      _mm_storeu_ps(p + 3, y);
+      _mm_storeu_ps(p + 6, z);
+      _mm_storeu_ps(p + 9, w);
+    }
+#elif defined(DISPARITY_UNPROJECTOR_NEON)
+    const float32x4_t vy = vdupq_n_f32(yc);
+    for (; u + 4 <= uEnd; u += 4) {
+      float depth[4] = {depthOf(d[u]), depthOf(d[u + 1]), depthOf(d[u + 2]),
+                        depthOf(d[u + 3])};
+      float32x4x3_t p;
+      p.val[2] = vld1q_f32(depth);
+      p.val[0] = vmulq_f32(vld1q_f32(&xCoef[u]), p.val[2]);
+      p.val[1] = vmulq_f32(vy, p.val[2]);
+      vst3q_f32(out + u * 3, p);
+    }
+#endif
+
+    for (; u < uEnd; ++u) {
+      const float z = depthOf(d[u]);
+      out[u * 3] = xCoef[u] * z;
+      out[u * 3 + 1] = yc * z;
+      out[u * 3 + 2] = z;
+    }
+  }
+}
@@ -61,3 +61,21 @@ LiveView::LiveViewErrCode LiveView::stopH264Stream(LiveViewCameraPosition pos) {
     return OSDK_LIVEVIEW_UNSUPPORT_AIRCRAFT;
   }
 }
+
+LiveView::LiveViewErrCode LiveView::addH264AccessUnitObserver(
+    LiveViewCameraPosition pos, H264AccessUnitCallback cb, void *userData) {
+  if (vehicle->isM300()) {
+    return impl->addH264AccessUnitObserver(pos, cb, userData);
+  } else {
+    return OSDK_LIVEVIEW_UNSUPPORT_AIRCRAFT;
+  }
+}
+
+LiveView::LiveViewErrCode LiveView::removeH264AccessUnitObserver(
+    LiveViewCameraPosition pos, H264AccessUnitCallback cb, void *userData) {
+  if (vehicle->isM300()) {
+    return impl->removeH264AccessUnitObserver(pos, cb, userData);
+  } else {
+    return OSDK_LIVEVIEW_UNSUPPORT_AIRCRAFT;
+  }
+}
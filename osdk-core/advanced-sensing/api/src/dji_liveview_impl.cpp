@@ -28,6 +28,7 @@
 
 #include <dji_vehicle.hpp>
 #include "dji_liveview_impl.hpp"
+#include "dji_h264_access_unit_assembler.hpp"
 #include "osdk_osal.h"
 
 using namespace DJI;
@@ -62,6 +63,13 @@ std::map<LiveView::LiveViewCameraPosition, LiveViewImpl::H264CallbackHandler> Li
         {LiveView::OSDK_CAMERA_POSITION_FPV,  {NULL, NULL}},
     };
 
+std::map<LiveView::LiveViewCameraPosition, DJIH264AccessUnitAssembler *> LiveViewImpl::h264AssemblerMap = {
+        {LiveView::OSDK_CAMERA_POSITION_NO_1, NULL},
+        {LiveView::OSDK_CAMERA_POSITION_NO_2, NULL},
+        {LiveView::OSDK_CAMERA_POSITION_NO_3, NULL},
+        {LiveView::OSDK_CAMERA_POSITION_FPV,  NULL},
+    };
+
 T_RecvCmdItem LiveViewImpl::bulkCmdList[] = {
     PROT_CMD_ITEM(0, 0, LIVEVIEW_TEMP_CMD_SET, LIVEVIEW_FPV_CAM_TEMP_CMD_ID,  MASK_HOST_DEVICE_SET_ID, (void *)&h264CbHandlerMap, RecordStreamHandler),
     PROT_CMD_ITEM(0, 0, LIVEVIEW_TEMP_CMD_SET, LIVEVIEW_MAIN_CAM_TEMP_CMD_ID, MASK_HOST_DEVICE_SET_ID, (void *)&h264CbHandlerMap, RecordStreamHandler),
@@ -80,10 +88,20 @@ LiveViewImpl::LiveViewImpl(Vehicle* vehiclePtr) :
   if(!vehicle->linker->registerCmdHandler(&recvCmdHandle)) {
     DERROR("register h264 cmd callback handler failed, exiting.");
   }
+
+  for (auto &pair : h264AssemblerMap) {
+    if (!pair.second) pair.second = new DJIH264AccessUnitAssembler();
+  }
 }
 
 LiveViewImpl::~LiveViewImpl()
 {
+  for (auto &pair : h264AssemblerMap) {
+    if (pair.second) {
+      delete pair.second;
+      pair.second = NULL;
+    }
+  }
 }
 
 E_OsdkStat LiveViewImpl::RecordStreamHandler(struct _CommandHandle *cmdHandle,
@@ -95,7 +113,7 @@ E_OsdkStat LiveViewImpl::RecordStreamHandler(struct _CommandHandle *cmdHandle,
     return OSDK_STAT_ERR;
   }
 
-  std::map<LiveView::LiveViewCameraPosition, H264CallbackHandler> handlerMap =
+  std::map<LiveView::LiveViewCameraPosition, H264CallbackHandler> &handlerMap =
       *(std::map<LiveView::LiveViewCameraPosition, H264CallbackHandler> *)userData;
 
   LiveView::LiveViewCameraPosition pos;
@@ -122,6 +140,11 @@ E_OsdkStat LiveViewImpl::RecordStreamHandler(struct _CommandHandle *cmdHandle,
     //DERROR("Can't find valid cb in handlerMap, pos = %d", pos);
   }
 
+  auto assembler = h264AssemblerMap.find(pos);
+  if ((assembler != h264AssemblerMap.end()) && assembler->second) {
+    assembler->second->pushBuffer(cmdData, cmdInfo->dataLen);
+  }
+
   return OSDK_STAT_OK;
 }
 
@@ -425,9 +448,15 @@ void *LiveViewImpl::heartBeatTask(void *p) {
 }
 
 E_OsdkStat LiveViewImpl::startHeartBeatTask() {
-  return OsdkOsal_TaskCreate(&h264TaskHandle, heartBeatTask,
-                             OSDK_TASK_STACK_SIZE_DEFAULT,
-                             vehicle);
+  E_OsdkStat osdkStat = OsdkOsal_TaskCreate(&h264TaskHandle, heartBeatTask,
+                                            OSDK_TASK_STACK_SIZE_DEFAULT,
+                                            vehicle);
+  if (osdkStat == OSDK_STAT_OK) {
+    Platform::instance().applyTaskPolicy(h264TaskHandle,
+                                         OSDK_TASK_CLASS_VIDEO_READ,
+                                         "liveviewHeartbeat");
+  }
+  return osdkStat;
 }
 
 E_OsdkStat LiveViewImpl::stopHeartBeatTask() {
@@ -473,6 +502,43 @@ LiveView::LiveViewErrCode LiveViewImpl::startH264Stream(LiveView::LiveViewCamera
 LiveView::LiveViewErrCode LiveViewImpl::stopH264Stream(LiveView::LiveViewCameraPosition pos) {
   unsubscribeLiveViewData(pos);
   stopHeartBeatTask();
+
+  auto assembler = h264AssemblerMap.find(pos);
+  if ((assembler != h264AssemblerMap.end()) && assembler->second) {
+    assembler->second->reset();
+  }
   return LiveView::OSDK_LIVEVIEW_PASS;
   //vehicle->linker->destroyLiveViewTask();
 }
+
+LiveView::LiveViewErrCode LiveViewImpl::addH264AccessUnitObserver(
+    LiveView::LiveViewCameraPosition pos, H264AccessUnitCallback cb,
+    void *userData) {
+  auto assembler = h264AssemblerMap.find(pos);
+  if ((assembler == h264AssemblerMap.end()) || !assembler->second) {
+    DERROR("Invalid camera position %d for access unit observer", pos);
+    return LiveView::OSDK_LIVEVIEW_INDEX_ILLEGAL;
+  }
+
+  if (!assembler->second->addObserver(cb, userData)) {
+    DERROR("Access unit observer is NULL or already added");
+    return LiveView::OSDK_LIVEVIEW_UNKNOWN;
+  }
+  return LiveView::OSDK_LIVEVIEW_PASS;
+}
+
+LiveView::LiveViewErrCode LiveViewImpl::removeH264AccessUnitObserver(
+    LiveView::LiveViewCameraPosition pos, H264AccessUnitCallback cb,
+    void *userData) {
+  auto assembler = h264AssemblerMap.find(pos);
+  if ((assembler == h264AssemblerMap.end()) || !assembler->second) {
+    DERROR("Invalid camera position %d for access unit observer", pos);
+    return LiveView::OSDK_LIVEVIEW_INDEX_ILLEGAL;
+  }
+
+  if (!assembler->second->removeObserver(cb, userData)) {
+    DERROR("Access unit observer is not found");
+    return LiveView::OSDK_LIVEVIEW_UNKNOWN;
+  }
+  return LiveView::OSDK_LIVEVIEW_PASS;
+}
@@ -48,6 +48,21 @@ Perception::~Perception() {
 Perception::PerceptionErrCode Perception::subscribePerceptionImage(DirectionType direction,
                                           PerceptionImageCB cb,
                                           void *userData) {
+  PerceptionErrCode ret = subscribeDirection(direction);
+  if (ret == OSDK_PERCEPTION_PASS) impl->imageHandler = {cb, userData};
+  return ret;
+}
+
+Perception::PerceptionErrCode Perception::subscribePerceptionImageFrame(DirectionType direction,
+                                               PerceptionImageFrameCB cb,
+                                               void *userData) {
+  if (!impl->initImageFramePool()) return OSDK_PERCEPTION_REQ_REFUSED;
+  PerceptionErrCode ret = subscribeDirection(direction);
+  if (ret == OSDK_PERCEPTION_PASS) impl->imageFrameHandler = {cb, userData};
+  return ret;
+}
+
+Perception::PerceptionErrCode Perception::subscribeDirection(DirectionType direction) {
   const char *camChoice1;
   const char *camChoice2;
 
@@ -82,7 +97,6 @@ Perception::PerceptionErrCode Perception::subscribePerceptionImage(DirectionType
     DSTATUS("Subscribe perception image %s successfully", camChoice1);
     if (impl->subscribePerceptionImage(camChoice2) == OSDK_STAT_OK) {
       DSTATUS("Subscribe perception image %s successfully", camChoice2);
-      impl->imageHandler = {cb, userData};
       return OSDK_PERCEPTION_PASS;
     } else {
       DERROR("Subscribe perception image %s failed", camChoice2);
@@ -0,0 +1,101 @@
+/** @file dji_perception_frame.cpp
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ *  @brief Pooled and refcounted buffers for the perception images
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "dji_perception_frame.hpp"
+#include "dji_log.hpp"
+
+using namespace DJI;
+using namespace DJI::OSDK;
+
+PerceptionFrameBuffer::PerceptionFrameBuffer(PerceptionFramePool *owner,
+                                             size_t size)
+    : pool(owner), buf(new uint8_t[size]), bufSize(size), refCount(0) {}
+
+PerceptionFrameBuffer::~PerceptionFrameBuffer() { delete[] buf; }
+
+void PerceptionFrameBuffer::retain() { pool->retain(this); }
+
+void PerceptionFrameBuffer::release() { pool->release(this); }
+
+PerceptionFramePool::PerceptionFramePool(int bufferNum, size_t bufferSize)
+    : bufferSize(bufferSize), exhaustedCount(0) {
+  OsdkOsal_MutexCreate(&mutex);
+  for (int i = 0; i < bufferNum; i++) {
+    PerceptionFrameBuffer *buffer = new PerceptionFrameBuffer(this, bufferSize);
+    buffers.push_back(buffer);
+    freeBuffers.push_back(buffer);
+  }
+}
+
+PerceptionFramePool::~PerceptionFramePool() {
+  if (freeBuffers.size() != buffers.size()) {
+    DERROR("%d perception frame buffers are still referenced",
+           buffers.size() - freeBuffers.size());
+  }
+  for (size_t i = 0; i < buffers.size(); i++) {
+    delete buffers[i];
+  }
+  OsdkOsal_MutexDestroy(mutex);
+}
+
+PerceptionFrameBuffer *PerceptionFramePool::acquire() {
+  PerceptionFrameBuffer *buffer = NULL;
+
+  OsdkOsal_MutexLock(mutex);
+  if (freeBuffers.size()) {
+    buffer = freeBuffers.back();
+    freeBuffers.pop_back();
+    buffer->refCount = 1;
+  } else {
+    exhaustedCount++;
+  }
+  OsdkOsal_MutexUnlock(mutex);
+
+  return buffer;
+}
+
+uint32_t PerceptionFramePool::getExhaustedCount() {
+  OsdkOsal_MutexLock(mutex);
+  uint32_t count = exhaustedCount;
+  OsdkOsal_MutexUnlock(mutex);
+  return count;
+}
+
+void PerceptionFramePool::retain(PerceptionFrameBuffer *buffer) {
+  OsdkOsal_MutexLock(mutex);
+  buffer->refCount++;
+  OsdkOsal_MutexUnlock(mutex);
+}
+
+void PerceptionFramePool::release(PerceptionFrameBuffer *buffer) {
+  OsdkOsal_MutexLock(mutex);
+  if (buffer->refCount > 0 && --buffer->refCount == 0) {
+    freeBuffers.push_back(buffer);
+  }
+  OsdkOsal_MutexUnlock(mutex);
+}
@@ -51,6 +51,8 @@ uint32_t PerceptionImpl::updateJudgingInMs = 100;
 uint32_t PerceptionImpl::imageUpdateSysMs[] = {0};
 
 PerceptionImpl::PerceptionImageHandler PerceptionImpl::imageHandler = {NULL, NULL};
+PerceptionImpl::PerceptionImageFrameHandler PerceptionImpl::imageFrameHandler = {NULL, NULL};
+PerceptionFramePool *PerceptionImpl::imageFramePool = NULL;
 PerceptionImpl::PerceptionCamParamHandler PerceptionImpl::camParamHandler = {NULL, NULL};
 
 T_RecvCmdItem s_bulkCmdList[] = {
@@ -85,6 +87,46 @@ PerceptionImpl::PerceptionImpl(Vehicle* vehiclePtr) : vehicle(vehiclePtr) {
 
 PerceptionImpl::~PerceptionImpl()
 {
+  imageFrameHandler = {NULL, NULL};
+  if (imageFramePool) {
+    delete imageFramePool;
+    imageFramePool = NULL;
+  }
+}
+
+bool PerceptionImpl::initImageFramePool() {
+  if (!imageFramePool)
+    imageFramePool = new PerceptionFramePool(IMAGE_FRAME_POOL_NUM,
+                                             IMAGE_FRAME_MAX_SIZE);
+  return imageFramePool != NULL;
+}
+
+void PerceptionImpl::deliverImageFrame(const Perception::ImageInfoType &info,
+                                       const uint8_t *image, int imageLen) {
+  PerceptionImageFrameHandler handler = imageFrameHandler;
+  if (!handler.cb || !imageFramePool) return;
+
+  if (imageLen > (int) imageFramePool->getBufferSize()) {
+    DERROR("Perception image of %d bytes exceeds the frame buffer", imageLen);
+    return;
+  }
+
+  PerceptionFrameBuffer *buffer = imageFramePool->acquire();
+  if (!buffer) {
+    /*! all the buffers are retained by the user, drop this image */
+    return;
+  }
+  /*! the linker owns the received data, this is the only copy on the way
+   *  to the user */
+  memcpy(buffer->data(), image, imageLen);
+
+  Perception::PerceptionImageFrame frame;
+  frame.info = info;
+  frame.image = buffer->data();
+  frame.imageLen = imageLen;
+  frame.buffer = buffer;
+  handler.cb(frame, handler.userData);
+  buffer->release();
 }
 
 vector<Perception::DirectionType> PerceptionImpl::getUpdatingDiretcion() {
@@ -133,6 +175,10 @@ E_OsdkStat PerceptionImpl::cameraImageHandler(struct _CommandHandle *cmdHandle,
   else {
 //    DERROR("Callback is a null value");
   }
+
+  deliverImageFrame(*header,
+                    cmdData + sizeof(Perception::ImageInfoType),
+                    cmdInfo->dataLen - sizeof(Perception::ImageInfoType));
 #if 0
   if(writePictureData(cmdData + IMAGE_INFO_LEN, cmdInfo->dataLen - IMAGE_INFO_LEN) != 0) {
      printf("write image failed!\n");
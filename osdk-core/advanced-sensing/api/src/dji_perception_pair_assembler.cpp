@@ -0,0 +1,213 @@
+/** @file dji_perception_pair_assembler.cpp
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ *  @brief Pair the left and right perception images of each direction
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "dji_perception_pair_assembler.hpp"
+#include "dji_log.hpp"
+
+using namespace DJI;
+using namespace DJI::OSDK;
+
+PerceptionStereoPairAssembler::PerceptionStereoPairAssembler(
+    StereoPairCB cb, void *userData, uint64_t maxTimeStampDiff)
+    : cb(cb), userData(userData), maxTimeStampDiff(maxTimeStampDiff),
+      slotAge(0) {
+  OsdkOsal_MutexCreate(&mutex);
+  memset(slots, 0, sizeof(slots));
+  memset(stats, 0, sizeof(stats));
+  memset(camParamValid, 0, sizeof(camParamValid));
+  memset(camParams, 0, sizeof(camParams));
+}
+
+PerceptionStereoPairAssembler::~PerceptionStereoPairAssembler() {
+  reset();
+  OsdkOsal_MutexDestroy(mutex);
+}
+
+bool PerceptionStereoPairAssembler::isLeftImage(
+    Perception::CamPositionType dataType) {
+  /*! RECTIFY_XX_LEFT are odd, RECTIFY_XX_RIGHT are even */
+  return (dataType % 2) == 1;
+}
+
+bool PerceptionStereoPairAssembler::isSamePair(
+    const Slot &slot, const Perception::ImageInfoType &info) {
+  if (slot.sequence != info.sequence) return false;
+  if (maxTimeStampDiff == 0) return true;
+  uint64_t diff = (slot.timeStamp > info.timeStamp)
+                  ? slot.timeStamp - info.timeStamp
+                  : info.timeStamp - slot.timeStamp;
+  return diff <= maxTimeStampDiff;
+}
+
+void PerceptionStereoPairAssembler::clearSlot(Slot &slot, bool dropped,
+                                              Stats &stats) {
+  if (slot.hasLeft) {
+    slot.left.buffer->release();
+    if (dropped) stats.droppedImageCount++;
+  }
+  if (slot.hasRight) {
+    slot.right.buffer->release();
+    if (dropped) stats.droppedImageCount++;
+  }
+  slot.used = false;
+  slot.hasLeft = false;
+  slot.hasRight = false;
+}
+
+void PerceptionStereoPairAssembler::pushImageFrame(
+    const Perception::PerceptionImageFrame &frame) {
+  uint8_t dir = frame.info.rawInfo.direction;
+  if (!frame.buffer) return;
+
+  OsdkOsal_MutexLock(mutex);
+  if (dir >= IMAGE_MAX_DIRECTION_NUM) {
+    /*! counted on the down direction, there is no better place */
+    stats[Perception::RECTIFY_DOWN].invalidImageCount++;
+    OsdkOsal_MutexUnlock(mutex);
+    return;
+  }
+
+  Slot *dirSlots = slots[dir];
+  Stats &dirStats = stats[dir];
+  bool isLeft = isLeftImage(frame.info.dataType);
+  Slot *target = NULL;
+  Slot *oldest = NULL;
+  Slot *unused = NULL;
+
+  for (int i = 0; i < SLOT_NUM; i++) {
+    if (!dirSlots[i].used) {
+      if (!unused) unused = &dirSlots[i];
+    } else if (isSamePair(dirSlots[i], frame.info)) {
+      target = &dirSlots[i];
+    } else if (!oldest || dirSlots[i].age < oldest->age) {
+      oldest = &dirSlots[i];
+    }
+  }
+
+  if (!target) {
+    if (!unused) {
+      clearSlot(*oldest, true, dirStats);
+      unused = oldest;
+    }
+    target = unused;
+    target->used = true;
+    target->sequence = frame.info.sequence;
+    target->timeStamp = frame.info.timeStamp;
+    target->age = slotAge++;
+  }
+
+  /*! a repeated image replaces the one waiting in the slot */
+  if (isLeft && target->hasLeft) {
+    target->left.buffer->release();
+    dirStats.droppedImageCount++;
+  } else if (!isLeft && target->hasRight) {
+    target->right.buffer->release();
+    dirStats.droppedImageCount++;
+  }
+
+  frame.buffer->retain();
+  if (isLeft) {
+    target->left = frame;
+    target->hasLeft = true;
+  } else {
+    target->right = frame;
+    target->hasRight = true;
+  }
+
+  bool isComplete = target->hasLeft && target->hasRight;
+  StereoPair pair;
+  if (isComplete) {
+    pair.direction = (Perception::DirectionType) dir;
+    pair.left = target->left;
+    pair.right = target->right;
+    pair.hasCamParam = camParamValid[dir];
+    pair.camParam = camParams[dir];
+    target->used = false;
+    target->hasLeft = false;
+    target->hasRight = false;
+    dirStats.pairCount++;
+
+    /*! images arrive in order, the older slots will never complete */
+    for (int i = 0; i < SLOT_NUM; i++) {
+      if (dirSlots[i].used && dirSlots[i].age < target->age)
+        clearSlot(dirSlots[i], true, dirStats);
+    }
+  }
+  OsdkOsal_MutexUnlock(mutex);
+
+  if (isComplete) {
+    if (cb) cb(pair, userData);
+    pair.left.buffer->release();
+    pair.right.buffer->release();
+  }
+}
+
+void PerceptionStereoPairAssembler::updateCamParam(
+    const Perception::CamParamPacketType &paramPacket) {
+  OsdkOsal_MutexLock(mutex);
+  for (uint32_t i = 0;
+       i < paramPacket.directionNum && i < IMAGE_MAX_DIRECTION_NUM; i++) {
+    uint8_t dir = paramPacket.cameraParam[i].direction;
+    if (dir < IMAGE_MAX_DIRECTION_NUM) {
+      camParams[dir] = paramPacket.cameraParam[i];
+      camParamValid[dir] = true;
+    }
+  }
+  OsdkOsal_MutexUnlock(mutex);
+}
+
+void PerceptionStereoPairAssembler::reset() {
+  OsdkOsal_MutexLock(mutex);
+  for (int dir = 0; dir < IMAGE_MAX_DIRECTION_NUM; dir++) {
+    for (int i = 0; i < SLOT_NUM; i++) {
+      if (slots[dir][i].used) clearSlot(slots[dir][i], true, stats[dir]);
+    }
+  }
+  OsdkOsal_MutexUnlock(mutex);
+}
+
+PerceptionStereoPairAssembler::Stats PerceptionStereoPairAssembler::getStats(
+    Perception::DirectionType direction) {
+  Stats ret = {0};
+  OsdkOsal_MutexLock(mutex);
+  if (direction < IMAGE_MAX_DIRECTION_NUM) ret = stats[direction];
+  OsdkOsal_MutexUnlock(mutex);
+  return ret;
+}
+
+void PerceptionStereoPairAssembler::imageFrameCallback(
+    const Perception::PerceptionImageFrame &frame, void *userData) {
+  if (userData)
+    ((PerceptionStereoPairAssembler *) userData)->pushImageFrame(frame);
+}
+
+void PerceptionStereoPairAssembler::camParamCallback(
+    Perception::CamParamPacketType paramPacket, void *userData) {
+  if (userData)
+    ((PerceptionStereoPairAssembler *) userData)->updateCamParam(paramPacket);
+}
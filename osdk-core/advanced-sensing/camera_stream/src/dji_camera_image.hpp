@@ -22,6 +22,20 @@ struct CameraRGBImage
   int width;
 };
 
+/*! @brief Read position of one consumer of the latest decoded image.
+ *  Every consumer keeps its own cursor, so they do not take frames away from
+ *  each other.
+ */
+struct CameraImageCursor
+{
+  // sequence number of the last image taken, 0 before the first one
+  uint64_t sequence;
+  // images published after the last one taken but never taken
+  uint64_t missed;
+
+  CameraImageCursor() : sequence(0), missed(0) {}
+};
+
 /*! @brief User callback function called by OSDK (in a dedicated thread)
  *  when a new image frame from camera is received.
  */
@@ -32,6 +46,48 @@ typedef void (*CameraImageCallback)(CameraRGBImage pImg, void* userData);
  */
 typedef void (*H264Callback)(uint8_t* buf, int bufLen, void* userData);
 
+/*! @brief One complete H264 access unit (all the NAL units of one picture,
+ *         Annex-B framed) reassembled from the raw liveview fragments
+ */
+struct H264AccessUnit
+{
+  const uint8_t* data;
+  int            len;
+  // increases by one for every access unit assembled from the stream
+  uint32_t       sequence;
+  bool           hasSPS;
+  bool           hasPPS;
+  bool           isIDR;
+  // true while the cached GOP is replayed to a newly added observer
+  bool           isReplay;
+};
+
+/*! @brief User callback function called by OSDK when a complete H264 access
+ *  unit is assembled. The data is only valid inside the callback.
+ */
+typedef void (*H264AccessUnitCallback)(const H264AccessUnit& au, void* userData);
+
+/*! @brief Frame-drop policy of one decoded image subscriber
+ */
+enum CameraImageDropPolicy
+{
+  // keep only the newest frame, undelivered older frames are dropped
+  CAMERA_IMAGE_LATEST_ONLY   = 0,
+  // keep up to queueDepth frames, the oldest is dropped when full
+  CAMERA_IMAGE_BOUNDED_QUEUE = 1,
+  // take every Nth decoded frame, keeping only the newest taken one
+  CAMERA_IMAGE_EVERY_NTH     = 2,
+};
+
+struct CameraImageSubscriberConfig
+{
+  CameraImageDropPolicy policy;
+  // only used by CAMERA_IMAGE_BOUNDED_QUEUE
+  int queueDepth;
+  // only used by CAMERA_IMAGE_EVERY_NTH
+  int everyNth;
+};
+
 /*! @brief Data structure for the image frames from the
  *         FPV camera or main camera
  */
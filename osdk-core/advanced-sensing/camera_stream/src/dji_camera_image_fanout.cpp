@@ -0,0 +1,251 @@
+/*
+ * DJI Onboard SDK Advanced Sensing APIs
+ *
+ * Copyright (c) 2017-2020 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ * @file dji_camera_image_fanout.cpp
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ */
+
+#include <vector>
+#include "dji_camera_image_fanout.hpp"
+#include "dji_log.hpp"
+
+DJICameraImageFanout::DJICameraImageFanout() : m_nextId(0)
+{
+  pthread_mutex_init(&m_mutex, NULL);
+}
+
+DJICameraImageFanout::~DJICameraImageFanout()
+{
+  removeAllSubscribers();
+  pthread_mutex_destroy(&m_mutex);
+}
+
+int DJICameraImageFanout::addSubscriber(CameraImageCallback cb, void* userData,
+                                        const CameraImageSubscriberConfig& config)
+{
+  if (!cb)
+  {
+    DERROR_PRIVATE("Subscriber callback is NULL\n");
+    return -1;
+  }
+  if ((config.policy == CAMERA_IMAGE_BOUNDED_QUEUE && config.queueDepth <= 0) ||
+      (config.policy == CAMERA_IMAGE_EVERY_NTH && config.everyNth <= 0))
+  {
+    DERROR_PRIVATE("Invalid subscriber config, policy = %d\n", config.policy);
+    return -1;
+  }
+
+  Subscriber* sub = new Subscriber();
+  sub->owner      = this;
+  sub->cb         = cb;
+  sub->userData   = userData;
+  sub->config     = config;
+  sub->isRunning  = true;
+  sub->frameCount = 0;
+  sub->delivered  = 0;
+  sub->dropped    = 0;
+  pthread_cond_init(&sub->condv, NULL);
+
+  pthread_mutex_lock(&m_mutex);
+  sub->id = m_nextId++;
+  if (0 != pthread_create(&sub->thread, NULL, subscriberThreadEntry, sub))
+  {
+    pthread_mutex_unlock(&m_mutex);
+    DERROR_PRIVATE("Subscriber thread creation failed!\n");
+    pthread_cond_destroy(&sub->condv);
+    delete sub;
+    return -1;
+  }
+  m_subscribers[sub->id] = sub;
+  pthread_mutex_unlock(&m_mutex);
+  DJI::OSDK::Platform::instance().applyTaskPolicy(
+    &sub->thread, OSDK_TASK_CLASS_VIDEO_DECODE, "imageSubscriber");
+
+  DSTATUS_PRIVATE("Image subscriber %d added, policy = %d\n", sub->id,
+                  config.policy);
+  return sub->id;
+}
+
+bool DJICameraImageFanout::removeSubscriber(int id)
+{
+  pthread_mutex_lock(&m_mutex);
+  std::map<int, Subscriber*>::iterator it = m_subscribers.find(id);
+  if (it == m_subscribers.end())
+  {
+    pthread_mutex_unlock(&m_mutex);
+    return false;
+  }
+  Subscriber* sub = it->second;
+  m_subscribers.erase(it);
+  pthread_mutex_unlock(&m_mutex);
+
+  stopSubscriber(sub);
+  return true;
+}
+
+void DJICameraImageFanout::removeAllSubscribers()
+{
+  std::map<int, Subscriber*> subscribers;
+  pthread_mutex_lock(&m_mutex);
+  subscribers.swap(m_subscribers);
+  pthread_mutex_unlock(&m_mutex);
+
+  for (std::map<int, Subscriber*>::iterator it = subscribers.begin();
+       it != subscribers.end(); ++it)
+  {
+    stopSubscriber(it->second);
+  }
+}
+
+int DJICameraImageFanout::subscriberCount()
+{
+  pthread_mutex_lock(&m_mutex);
+  int count = m_subscribers.size();
+  pthread_mutex_unlock(&m_mutex);
+  return count;
+}
+
+bool DJICameraImageFanout::getSubscriberStats(int id, uint32_t& delivered,
+                                              uint32_t& dropped)
+{
+  bool found = false;
+  pthread_mutex_lock(&m_mutex);
+  std::map<int, Subscriber*>::iterator it = m_subscribers.find(id);
+  if (it != m_subscribers.end())
+  {
+    delivered = it->second->delivered;
+    dropped   = it->second->dropped;
+    found     = true;
+  }
+  pthread_mutex_unlock(&m_mutex);
+  return found;
+}
+
+void DJICameraImageFanout::publish(uint8_t* buf, int bufSize, int width,
+                                   int height)
+{
+  std::vector<int> takers;
+  pthread_mutex_lock(&m_mutex);
+  for (std::map<int, Subscriber*>::iterator it = m_subscribers.begin();
+       it != m_subscribers.end(); ++it)
+  {
+    if (acceptFrame(it->second))
+    {
+      takers.push_back(it->first);
+    }
+  }
+  pthread_mutex_unlock(&m_mutex);
+
+  if (takers.empty())
+  {
+    return;
+  }
+
+  /* Copy outside the lock, so the subscriber threads are not blocked */
+  CameraRGBImage* img = new CameraRGBImage();
+  img->rawData.assign(buf, buf + bufSize);
+  img->width  = width;
+  img->height = height;
+  ImagePtr shared(img);
+
+  pthread_mutex_lock(&m_mutex);
+  for (size_t i = 0; i < takers.size(); ++i)
+  {
+    std::map<int, Subscriber*>::iterator it = m_subscribers.find(takers[i]);
+    if (it != m_subscribers.end())
+    {
+      enqueueFrame(it->second, shared);
+    }
+  }
+  pthread_mutex_unlock(&m_mutex);
+}
+
+bool DJICameraImageFanout::acceptFrame(Subscriber* sub)
+{
+  if (sub->config.policy == CAMERA_IMAGE_EVERY_NTH)
+  {
+    return (sub->frameCount++ % sub->config.everyNth) == 0;
+  }
+  return true;
+}
+
+void DJICameraImageFanout::enqueueFrame(Subscriber* sub, const ImagePtr& img)
+{
+  if (sub->config.policy == CAMERA_IMAGE_BOUNDED_QUEUE)
+  {
+    while (sub->queue.size() >= (size_t)sub->config.queueDepth)
+    {
+      sub->queue.pop_front();
+      sub->dropped++;
+    }
+  }
+  else
+  {
+    sub->dropped += sub->queue.size();
+    sub->queue.clear();
+  }
+  sub->queue.push_back(img);
+  pthread_cond_signal(&sub->condv);
+}
+
+void DJICameraImageFanout::stopSubscriber(Subscriber* sub)
+{
+  pthread_mutex_lock(&m_mutex);
+  sub->isRunning = false;
+  pthread_cond_signal(&sub->condv);
+  pthread_mutex_unlock(&m_mutex);
+
+  pthread_join(sub->thread, NULL);
+  pthread_cond_destroy(&sub->condv);
+  DSTATUS_PRIVATE("Image subscriber %d removed, delivered %u, dropped %u\n",
+                  sub->id, sub->delivered, sub->dropped);
+  delete sub;
+}
+
+void* DJICameraImageFanout::subscriberThreadEntry(void* p)
+{
+  Subscriber* sub = static_cast<Subscriber*>(p);
+  sub->owner->subscriberThreadFunc(sub);
+  return NULL;
+}
+
+void DJICameraImageFanout::subscriberThreadFunc(Subscriber* sub)
+{
+  pthread_mutex_lock(&m_mutex);
+  while (sub->isRunning)
+  {
+    if (sub->queue.empty())
+    {
+      pthread_cond_wait(&sub->condv, &m_mutex);
+      continue;
+    }
+
+    ImagePtr img = sub->queue.front();
+    sub->queue.pop_front();
+    sub->delivered++;
+    pthread_mutex_unlock(&m_mutex);
+
+    (*sub->cb)(*img, sub->userData);
+
+    pthread_mutex_lock(&m_mutex);
+  }
+  pthread_mutex_unlock(&m_mutex);
+}
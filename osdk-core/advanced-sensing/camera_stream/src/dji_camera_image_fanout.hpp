@@ -0,0 +1,72 @@
+/** @file dji_camera_image_fanout.hpp
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ *  @brief Share the images of one decoder among several subscribers,
+ *  each with its own callback thread and frame-drop policy
+ *
+ *  @copyright 2020 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJICAMERAIMAGEFANOUT_HH
+#define DJICAMERAIMAGEFANOUT_HH
+
+#include <deque>
+#include <map>
+#include <memory>
+#include "pthread.h"
+#include "dji_camera_image.hpp"
+
+class DJICameraImageFanout
+{
+public:
+  DJICameraImageFanout();
+  ~DJICameraImageFanout();
+
+  /*! @return subscriber id (>= 0), or -1 if failed */
+  int  addSubscriber(CameraImageCallback cb, void* userData,
+                     const CameraImageSubscriberConfig& config);
+  bool removeSubscriber(int id);
+  void removeAllSubscribers();
+  int  subscriberCount();
+
+  bool getSubscriberStats(int id, uint32_t& delivered, uint32_t& dropped);
+
+  /*! Called by the decoder thread. The image is copied once and shared by
+   *  all the subscribers that take it.
+   */
+  void publish(uint8_t* buf, int bufSize, int width, int height);
+
+private:
+  typedef std::shared_ptr<const CameraRGBImage> ImagePtr;
+
+  typedef struct Subscriber
+  {
+    DJICameraImageFanout*       owner;
+    int                         id;
+    CameraImageCallback         cb;
+    void*                       userData;
+    CameraImageSubscriberConfig config;
+    pthread_t                   thread;
+    pthread_cond_t              condv;
+    bool                        isRunning;
+    std::deque<ImagePtr>        queue;
+    uint32_t                    frameCount;
+    uint32_t                    delivered;
+    uint32_t                    dropped;
+  } Subscriber;
+
+  static void* subscriberThreadEntry(void* p);
+  void subscriberThreadFunc(Subscriber* sub);
+  bool acceptFrame(Subscriber* sub);
+  void enqueueFrame(Subscriber* sub, const ImagePtr& img);
+  void stopSubscriber(Subscriber* sub);
+
+private:
+  pthread_mutex_t            m_mutex;
+  std::map<int, Subscriber*> m_subscribers;
+  int                        m_nextId;
+};
+
+#endif // DJICAMERAIMAGEFANOUT_HH
@@ -24,11 +24,19 @@
  */
 
 #include "dji_camera_image_handler.hpp"
+#include <atomic>
+#include <cerrno>
+#include <ctime>
 
-DJICameraImageHandler::DJICameraImageHandler():m_newImageFlag(false)
+DJICameraImageHandler::DJICameraImageHandler() : m_sequence(0)
 {
   pthread_mutex_init(&m_mutex, NULL);
-  pthread_cond_init(&m_condv, NULL);
+
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&m_condv, &attr);
+  pthread_condattr_destroy(&attr);
 }
 
 DJICameraImageHandler::~DJICameraImageHandler()
@@ -39,54 +47,104 @@ DJICameraImageHandler::~DJICameraImageHandler()
 
 bool DJICameraImageHandler::getNewImageWithLock(CameraRGBImage & copyOfImage, int timeoutMilliSec)
 {
-  int result = -1;
+  return getNewImage(m_defaultCursor, copyOfImage, timeoutMilliSec);
+}
 
-  /*! @note
-   * Here result == 0 means successful.
-   * Because this is the behavior of pthread_cond_timedwait.
-   */
-  pthread_mutex_lock(&m_mutex);
-  if(m_newImageFlag)
+bool DJICameraImageHandler::getNewImage(CameraImageCursor& cursor,
+                                        CameraRGBImage & copyOfImage,
+                                        int timeoutMilliSec)
+{
+  struct timespec absTimeout;
+  clock_gettime(CLOCK_MONOTONIC, &absTimeout);
+  if (timeoutMilliSec > 0)
   {
-    /* At this point, a copy of m_img is made, so it is safe to 
-     * do any modifications to copyOfImage in user code.
-     */
-    copyOfImage = m_img;
-    m_newImageFlag = false;
-    result = 0;
+    absTimeout.tv_sec  += timeoutMilliSec / 1000;
+    absTimeout.tv_nsec += (long)(timeoutMilliSec % 1000) * 1000000L;
+    if (absTimeout.tv_nsec >= 1000000000L)
+    {
+      absTimeout.tv_sec  += 1;
+      absTimeout.tv_nsec -= 1000000000L;
+    }
   }
-  else
-  {
-    struct timespec absTimeout;
-    clock_gettime(CLOCK_REALTIME, &absTimeout);
-    absTimeout.tv_nsec += timeoutMilliSec * 1e6;
-    result = pthread_cond_timedwait(&m_condv, &m_mutex, &absTimeout);
 
-    if(result == 0)
+  pthread_mutex_lock(&m_mutex);
+  while (m_sequence == cursor.sequence && timeoutMilliSec > 0)
+  {
+    if (pthread_cond_timedwait(&m_condv, &m_mutex, &absTimeout) == ETIMEDOUT)
     {
-      copyOfImage = m_img;
-      m_newImageFlag = false;
+      break;
     }
   }
+  if (m_sequence == cursor.sequence)
+  {
+    pthread_mutex_unlock(&m_mutex);
+    return false;
+  }
+
+  /*! The cursor is updated under the lock, so the callers sharing one
+   *  cursor never take the same image twice.
+   */
+  ImagePtr img = m_img;
+  if (cursor.sequence != 0)
+  {
+    cursor.missed += m_sequence - cursor.sequence - 1;
+  }
+  cursor.sequence = m_sequence;
   pthread_mutex_unlock(&m_mutex);
-  return (result == 0) ? true : false;
+
+  /* At this point, a copy of the image is made, so it is safe to
+   * do any modifications to copyOfImage in user code.
+   */
+  copyOfImage = *img;
+  return true;
 }
 
 bool DJICameraImageHandler::newImageIsReady()
 {
-  return m_newImageFlag;
+  return newImageIsReady(m_defaultCursor);
 }
 
-void DJICameraImageHandler::writeNewImageWithLock(uint8_t* buf, int bufSize, int width, int height)
+bool DJICameraImageHandler::newImageIsReady(const CameraImageCursor& cursor)
 {
   pthread_mutex_lock(&m_mutex);
+  bool ready = (m_sequence != cursor.sequence);
+  pthread_mutex_unlock(&m_mutex);
+  return ready;
+}
 
-  m_img.rawData.assign(buf, buf+bufSize);
-  m_img.height = height;
-  m_img.width  = width;
-  m_newImageFlag = true;
-
-  pthread_cond_signal(&m_condv);
+uint64_t DJICameraImageHandler::getSequence()
+{
+  pthread_mutex_lock(&m_mutex);
+  uint64_t sequence = m_sequence;
   pthread_mutex_unlock(&m_mutex);
+  return sequence;
 }
 
+void DJICameraImageHandler::writeNewImageWithLock(uint8_t* buf, int bufSize, int width, int height)
+{
+  /*! Fill the image outside the lock. The spare one is only touched by the
+   *  writer, and no consumer can take a new reference to it.
+   */
+  ImagePtr img;
+  if (m_spare && m_spare.unique())
+  {
+    // pairs with the release of the last consumer reference
+    std::atomic_thread_fence(std::memory_order_acquire);
+    img.swap(m_spare);
+  }
+  else
+  {
+    img = std::make_shared<CameraRGBImage>();
+  }
+  img->rawData.assign(buf, buf+bufSize);
+  img->height = height;
+  img->width  = width;
+
+  pthread_mutex_lock(&m_mutex);
+  m_img.swap(img);
+  m_sequence++;
+  pthread_cond_broadcast(&m_condv);
+  pthread_mutex_unlock(&m_mutex);
+
+  m_spare.swap(img);
+}
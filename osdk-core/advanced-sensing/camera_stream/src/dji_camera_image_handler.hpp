@@ -12,25 +12,53 @@
 #ifndef DJICAMERAIMAGEHANDLER_HH
 #define DJICAMERAIMAGEHANDLER_HH
 
+#include <memory>
 #include "pthread.h"
 #include "dji_camera_image.hpp"
 
+/*! Holds the latest decoded image for any number of consumers. Each write
+ *  gets the next sequence number and wakes up all the waiting consumers,
+ *  each consumer takes the image once through its own CameraImageCursor.
+ */
 class DJICameraImageHandler
 {
 public:
   DJICameraImageHandler();
   ~DJICameraImageHandler();
 
+  //! True if there is an image the default consumer has not taken yet
   bool newImageIsReady();
+  bool newImageIsReady(const CameraImageCursor& cursor);
 
   void writeNewImageWithLock(uint8_t* buf, int bufSize, int width, int height);
+
+  /*! Take the image with the default consumer, shared by all the callers
+   *  that do not keep a cursor of their own.
+   */
   bool getNewImageWithLock(CameraRGBImage & copyOfImage, int timeoutMilliSec);
 
+  /*! Wait up to timeoutMilliSec for an image newer than the cursor, then
+   *  copy it out and move the cursor to it. Images written in between are
+   *  added to cursor.missed.
+   *  @note The wait runs on CLOCK_MONOTONIC, the copy is made without
+   *  holding the lock so the decoder is never blocked by a slow consumer.
+   */
+  bool getNewImage(CameraImageCursor& cursor, CameraRGBImage & copyOfImage,
+                   int timeoutMilliSec);
+
+  //! Sequence number of the latest image, 0 before the first one
+  uint64_t getSequence();
+
 private:
-  pthread_mutex_t m_mutex;
-  pthread_cond_t  m_condv;
-  CameraRGBImage  m_img;
-  bool            m_newImageFlag;
+  typedef std::shared_ptr<CameraRGBImage> ImagePtr;
+
+  pthread_mutex_t   m_mutex;
+  pthread_cond_t    m_condv;
+  ImagePtr          m_img;
+  uint64_t          m_sequence;
+  CameraImageCursor m_defaultCursor;
+  // the image replaced by the last write, reused once no consumer holds it
+  ImagePtr          m_spare;
 };
 
 #endif
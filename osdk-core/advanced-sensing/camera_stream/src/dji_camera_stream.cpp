@@ -94,6 +94,11 @@ bool DJICameraStream::startCameraStream(CameraImageCallback cb, void* cbParam)
   return true;
 }
 
+void DJICameraStream::setIoReactor(DJI::OSDK::LinuxIoReactor* reactor)
+{
+  rawDataStream->setIoReactor(reactor);
+}
+
 void DJICameraStream::stopCameraStream()
 {
   decoder->registerCallback(NULL, NULL);
@@ -14,6 +14,13 @@
 #include "dji_camera_image.hpp"
 class DJICameraStreamLink;
 class DJICameraStreamDecoder;
+namespace DJI
+{
+namespace OSDK
+{
+class LinuxIoReactor;
+}
+}
 
 class DJICameraStream
 {
@@ -34,6 +41,9 @@ public:
 
   void stopCameraStream();
 
+  /* Read the stream through a shared IO reactor, see AdvancedSensing::enableIoReactor */
+  void setIoReactor(DJI::OSDK::LinuxIoReactor* reactor);
+
   bool startCameraH264(H264Callback cb = NULL, void * cbParam = NULL);
 
   void stopCameraH264();
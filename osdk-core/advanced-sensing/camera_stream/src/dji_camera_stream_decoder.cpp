@@ -111,6 +111,13 @@ bool DJICameraStreamDecoder::getNewImage(CameraRGBImage & copyOfImage, int timeo
   return decodedImageHandler.getNewImageWithLock(copyOfImage, timeoutMilliSec);
 }
 
+bool DJICameraStreamDecoder::getNewImage(CameraImageCursor& cursor,
+                                         CameraRGBImage & copyOfImage,
+                                         int timeoutMilliSec)
+{
+  return decodedImageHandler.getNewImage(cursor, copyOfImage, timeoutMilliSec);
+}
+
 void DJICameraStreamDecoder::cleanup()
 {
   initSuccess = false;
@@ -166,10 +173,14 @@ void* DJICameraStreamDecoder::callbackThreadEntry(void* p)
 
 void DJICameraStreamDecoder::callbackThreadFunc()
 {
+  /*! A cursor of its own, so polling getNewImage does not take frames away
+   *  from the callback.
+   */
+  CameraImageCursor cursor;
   while(cbThreadIsRunning)
   {
     CameraRGBImage copyOfImage;
-    if(!decodedImageHandler.getNewImageWithLock(copyOfImage, 1000))
+    if(!decodedImageHandler.getNewImage(cursor, copyOfImage, 1000))
     {
       DDEBUG_PRIVATE("Decoder Callback Thread: Get image time out\n");
       continue;
@@ -240,6 +251,7 @@ void DJICameraStreamDecoder::decodeBuffer(uint8_t* buf, int bufLen)
           pFrameRGB->width = w;
 
           decodedImageHandler.writeNewImageWithLock(pFrameRGB->data[0], bufSize, w, h);
+          imageFanout.publish(pFrameRGB->data[0], bufSize, w, h);
         }
       }
     }
@@ -260,6 +272,8 @@ bool DJICameraStreamDecoder::registerCallback(CameraImageCallback f, void *param
       cbThreadStatus = pthread_create(&callbackThread, NULL, callbackThreadEntry, this);
       if(0 == cbThreadStatus)
       {
+        DJI::OSDK::Platform::instance().applyTaskPolicy(
+          &callbackThread, OSDK_TASK_CLASS_VIDEO_DECODE, "decoderCallback");
         DSTATUS_PRIVATE("User callback thread created successfully!\n");
         cbThreadIsRunning = true;
         return true;
@@ -19,6 +19,7 @@ extern "C"{
 #include "pthread.h"
 #include "dji_camera_image.hpp"
 #include "dji_camera_image_handler.hpp"
+#include "dji_camera_image_fanout.hpp"
 
 class DJICameraStreamDecoder
 {
@@ -29,6 +30,8 @@ public:
   void cleanup();
 
   bool getNewImage(CameraRGBImage & copyOfImage, int timeoutMilliSec);
+  bool getNewImage(CameraImageCursor& cursor, CameraRGBImage & copyOfImage,
+                   int timeoutMilliSec);
 
   void callbackThreadFunc();
 
@@ -40,6 +43,9 @@ public:
 
   DJICameraImageHandler decodedImageHandler;
 
+  /*! Decoded images are shared with all the fan-out subscribers */
+  DJICameraImageFanout imageFanout;
+
 private:
   bool initSuccess;
 
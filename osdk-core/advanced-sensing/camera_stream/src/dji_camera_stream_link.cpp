@@ -24,6 +24,7 @@
  */
 
 #include "dji_camera_stream_link.hpp"
+#include "linux_io_reactor.hpp"
 #include "dji_log.hpp"
 
 #ifndef WIN32
@@ -61,7 +62,9 @@ DJICameraStreamLink::DJICameraStreamLink(CameraType c)
     threadStatus(-1),
     isRunning(false),
     cb(NULL),
-    cbParam(NULL)
+    cbParam(NULL),
+    ioReactor(NULL),
+    reactorMode(false)
 {
   camNameStr = ((c==FPV_CAMERA) ? std::string("FPV_CAMERA") : std::string("MAIN_CAMERA"));
   port = ((c==FPV_CAMERA) ? std::string(UDT_SERVER_PORT_FPV) : std::string(UDT_SERVER_PORT_MAIN));
@@ -158,6 +161,17 @@ bool DJICameraStreamLink::start()
     return false;
   }
 
+  if (ioReactor && ioReactor->isRunning())
+  {
+    isRunning   = true;
+    reactorMode = addToReactor();
+    if (!reactorMode)
+    {
+      isRunning = false;
+    }
+    return reactorMode;
+  }
+
   threadStatus = pthread_create(&readThread, NULL, DJICameraStreamLink::readThreadEntry, this);
   if (threadStatus != 0)
   {
@@ -167,6 +181,8 @@ bool DJICameraStreamLink::start()
   }
   else
   {
+    DJI::OSDK::Platform::instance().applyTaskPolicy(
+      &readThread, OSDK_TASK_CLASS_VIDEO_READ, "camStreamRead");
     isRunning = true;
     return true;
   }
@@ -175,6 +191,22 @@ bool DJICameraStreamLink::start()
 void DJICameraStreamLink::stop()
 {
   isRunning = false;
+  if (reactorMode)
+  {
+    /* The handler may still post chunks or a reconnect until the socket is
+     * removed, the worker then has to finish what was posted. A reconnect
+     * that was running may have added the new socket, so remove it again.
+     */
+    if (ioReactor)
+    {
+      ioReactor->removeUdtSocket(fHandle);
+      ioReactor->sync(reactorKey());
+      ioReactor->removeUdtSocket(fHandle);
+    }
+    reactorMode = false;
+    unInit();
+    DSTATUS_PRIVATE("**** %s reactor reading stopped\n", camNameStr.c_str());
+  }
   if(0 == threadStatus)
   {
     pthread_join(readThread, NULL);
@@ -272,3 +304,146 @@ bool DJICameraStreamLink::isThreadRunning()
 {
   return isRunning;
 }
+
+void DJICameraStreamLink::setIoReactor(DJI::OSDK::LinuxIoReactor* reactor)
+{
+  if (reactor == ioReactor)
+  {
+    return;
+  }
+
+  /* A link reading through the old reactor is detached from it before the
+   * reactor can go away, and reconnected through the new reader.
+   */
+  bool restart = reactorMode && isRunning;
+  if (reactorMode)
+  {
+    stop();
+  }
+  ioReactor = reactor;
+  if (restart)
+  {
+    if (!init() || !start())
+    {
+      DERROR_PRIVATE("Failed to restart reading from %s\n", camNameStr.c_str());
+    }
+  }
+}
+
+bool DJICameraStreamLink::addToReactor()
+{
+  /* The reactor thread must never block in recv */
+  bool sync = false;
+  if (UDT::ERROR == UDT::setsockopt(fHandle, 0, UDT_RCVSYN, &sync, sizeof(bool)))
+  {
+    DERROR_PRIVATE("Failed to make the %s socket non-blocking, %s\n",
+                   camNameStr.c_str(), UDT::getlasterror().getErrorMessage());
+    return false;
+  }
+  if (!ioReactor->addUdtSocket(fHandle, udtReadableHandler, this))
+  {
+    return false;
+  }
+  DSTATUS_PRIVATE("**** %s data reading through the IO reactor ****\n",
+                  camNameStr.c_str());
+  return true;
+}
+
+uint32_t DJICameraStreamLink::reactorKey()
+{
+  /* One key per camera, so its chunks are decoded in order on one worker */
+  return (uint32_t)camType;
+}
+
+void DJICameraStreamLink::udtReadableHandler(void* p, uint32_t events)
+{
+  (reinterpret_cast<DJICameraStreamLink*>(p))->readAvailable(events);
+}
+
+/* Runs on the reactor UDT thread: drain the socket and hand the chunks over
+ * to the worker, where the callback (decoding) runs.
+ */
+void DJICameraStreamLink::readAvailable(uint32_t events)
+{
+  bool broken = (events & DJI::OSDK::LinuxIoReactor::IO_EVENT_ERR) != 0;
+
+  if (reactorBuffer.size() != RECEIVE_SIZE)
+  {
+    reactorBuffer.resize(RECEIVE_SIZE);
+  }
+
+  while (!broken && isRunning)
+  {
+    int rcvLen = UDT::recv(fHandle, reinterpret_cast<char*>(&reactorBuffer[0]),
+                           RECEIVE_SIZE, 0);
+    if (UDT::ERROR == rcvLen)
+    {
+      broken = (UDT::getlasterror().getErrorCode() != CUDTException::EASYNCRCV);
+      break;
+    }
+    if (rcvLen == 0)
+    {
+      break;
+    }
+
+    StreamChunk* chunk = new StreamChunk();
+    chunk->link = this;
+    chunk->data.assign(reactorBuffer.begin(), reactorBuffer.begin() + rcvLen);
+    if (!ioReactor->post(reactorKey(), deliverChunkTask, chunk))
+    {
+      delete chunk;
+    }
+  }
+
+  if (broken && isRunning)
+  {
+    DSTATUS_PRIVATE("Unable to read from %s lost, retry connecting ...\n", camNameStr.c_str());
+    ioReactor->removeUdtSocket(fHandle);
+    ioReactor->post(reactorKey(), reconnectTask, this);
+  }
+}
+
+void DJICameraStreamLink::deliverChunkTask(void* p)
+{
+  StreamChunk*         chunk = reinterpret_cast<StreamChunk*>(p);
+  DJICameraStreamLink* link  = chunk->link;
+  if (link->cb)
+  {
+    (*link->cb)(link->cbParam, &chunk->data[0], chunk->data.size());
+  }
+  delete chunk;
+}
+
+void DJICameraStreamLink::reconnectTask(void* p)
+{
+  (reinterpret_cast<DJICameraStreamLink*>(p))->reconnect();
+}
+
+/* Runs on the worker, it is the only one touching the link until the new
+ * socket is added to the reactor again.
+ */
+void DJICameraStreamLink::reconnect()
+{
+  int retryConnect = 0;
+
+  unInit();
+  while (isRunning)
+  {
+    if (init())
+    {
+      if (isRunning && addToReactor())
+      {
+        return;
+      }
+      unInit();
+    }
+    if (10 == retryConnect++)
+    {
+      break;
+    }
+    usleep(1e5);
+  }
+
+  isRunning = false;
+  DERROR_PRIVATE("Unable to reconnect to %s ..., stop reading\n", camNameStr.c_str());
+}
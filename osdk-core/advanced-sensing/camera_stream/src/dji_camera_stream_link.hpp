@@ -12,12 +12,21 @@
 #define DJICAMERASTREAMLINK_HH
 #include "netdb.h"
 #include <string>
+#include <vector>
 #include "pthread.h"
 
 #include "dji_camera_image.hpp"
 
 typedef void (*CAMCALLBACK)(void*, uint8_t*, int);
 
+namespace DJI
+{
+namespace OSDK
+{
+class LinuxIoReactor;
+}
+}
+
 class DJICameraStreamLink
 {
 public:
@@ -43,6 +52,13 @@ public:
   /* register a callback function */
   void registerCallback(CAMCALLBACK f, void* param);
 
+  /* Read through a shared reactor instead of an own thread, the callback
+   * then runs on a reactor worker. NULL goes back to the own thread. Takes
+   * effect on the next start(), except that a link reading through the
+   * current reactor is moved to the new reader at once.
+   */
+  void setIoReactor(DJI::OSDK::LinuxIoReactor* reactor);
+
 private:
   CameraType  camType;
   std::string camNameStr;
@@ -58,11 +74,32 @@ private:
   CAMCALLBACK cb;
   void* cbParam;
 
+  DJI::OSDK::LinuxIoReactor* ioReactor;
+  bool                       reactorMode;
+  std::vector<uint8_t>       reactorBuffer;
+
+  /* A received chunk on its way to a reactor worker */
+  typedef struct StreamChunk
+  {
+    DJICameraStreamLink* link;
+    std::vector<uint8_t> data;
+  } StreamChunk;
+
   /* disconnect link from camera */
   void unInit();
 
   /* real function to read data from camera */
   void readThreadFunc();
+
+  /* reactor mode: register the socket, read what is available, reconnect */
+  bool addToReactor();
+  void readAvailable(uint32_t events);
+  void reconnect();
+  uint32_t reactorKey();
+
+  static void udtReadableHandler(void* p, uint32_t events);
+  static void deliverChunkTask(void* p);
+  static void reconnectTask(void* p);
 };
 
 #endif // DJICAMERASTREAMLINK_HH
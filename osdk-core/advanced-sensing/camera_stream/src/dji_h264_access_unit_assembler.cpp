@@ -0,0 +1,343 @@
+/*
+ * DJI Onboard SDK Advanced Sensing APIs
+ *
+ * Copyright (c) 2017-2020 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ * @file dji_h264_access_unit_assembler.cpp
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ */
+
+#include "dji_h264_access_unit_assembler.hpp"
+#include "dji_log.hpp"
+
+#define H264_NAL_TYPE_SLICE       (1)
+#define H264_NAL_TYPE_IDR         (5)
+#define H264_NAL_TYPE_SEI         (6)
+#define H264_NAL_TYPE_SPS         (7)
+#define H264_NAL_TYPE_PPS         (8)
+#define H264_NAL_TYPE_AUD         (9)
+
+/*! Return the offset of the next "00 00 01" in [begin, end), or end. */
+static size_t findStartCode(const uint8_t* p, size_t begin, size_t end)
+{
+  for (size_t i = begin; i + 3 <= end; ++i)
+  {
+    if (p[i + 2] > 1)
+    {
+      // p[i + 2] can't be a part of a start code, skip ahead
+      i += 2;
+    }
+    else if (p[i] == 0 && p[i + 1] == 0 && p[i + 2] == 1)
+    {
+      return i;
+    }
+  }
+  return end;
+}
+
+DJIH264AccessUnitAssembler::DJIH264AccessUnitAssembler(size_t maxGopBytes)
+  : m_active(false),
+    m_maxGopBytes(maxGopBytes),
+    m_synced(false),
+    m_scanFrom(0),
+    m_auHasVcl(false),
+    m_auHasSPS(false),
+    m_auHasPPS(false),
+    m_auIsIDR(false),
+    m_sequence(0),
+    m_gopBytes(0),
+    m_gopValid(false)
+{
+  pthread_mutex_init(&m_mutex, NULL);
+}
+
+DJIH264AccessUnitAssembler::~DJIH264AccessUnitAssembler()
+{
+  pthread_mutex_destroy(&m_mutex);
+}
+
+void DJIH264AccessUnitAssembler::pushBuffer(const uint8_t* buf, int bufLen)
+{
+  if (!buf || bufLen <= 0)
+  {
+    return;
+  }
+
+  pthread_mutex_lock(&m_mutex);
+  if (!m_active)
+  {
+    pthread_mutex_unlock(&m_mutex);
+    return;
+  }
+
+  m_pending.insert(m_pending.end(), buf, buf + bufLen);
+  const uint8_t* data = &m_pending[0];
+  size_t size = m_pending.size();
+  size_t consumed = 0;
+
+  if (!m_synced)
+  {
+    size_t pos = findStartCode(data, 0, size);
+    if (pos == size)
+    {
+      // keep the tail in case a start code is split over two fragments
+      consumed = (size > 2) ? (size - 2) : 0;
+      m_pending.erase(m_pending.begin(), m_pending.begin() + consumed);
+      pthread_mutex_unlock(&m_mutex);
+      return;
+    }
+    consumed = pos;
+    m_scanFrom = pos + 3;
+    m_synced = true;
+  }
+
+  while (true)
+  {
+    size_t next = findStartCode(data, m_scanFrom, size);
+    if (next == size)
+    {
+      break;
+    }
+    // a zero byte right before "00 00 01" belongs to a 4-byte start code
+    size_t nalEnd = next;
+    if (nalEnd > consumed + 4 && data[nalEnd - 1] == 0)
+    {
+      --nalEnd;
+    }
+    onNalUnit(data + consumed, nalEnd - consumed);
+    consumed = nalEnd;
+    m_scanFrom = next + 3;
+  }
+
+  m_pending.erase(m_pending.begin(), m_pending.begin() + consumed);
+  m_scanFrom -= consumed;
+  // the unterminated NAL unit has been scanned except for its last bytes
+  if (m_pending.size() > m_scanFrom + 2)
+  {
+    m_scanFrom = m_pending.size() - 2;
+  }
+  pthread_mutex_unlock(&m_mutex);
+}
+
+void DJIH264AccessUnitAssembler::onNalUnit(const uint8_t* nal, size_t len)
+{
+  size_t scLen = (nal[2] == 1) ? 3 : 4;
+  if (len <= scLen)
+  {
+    return;
+  }
+
+  uint8_t type = nal[scLen] & 0x1F;
+  bool isVcl = (type == H264_NAL_TYPE_SLICE) || (type == H264_NAL_TYPE_IDR);
+  /*! first_mb_in_slice is ue(v) coded, so a leading 1 bit means 0, which is
+   *  the first slice of a new picture.
+   */
+  bool firstSlice = isVcl && (len > scLen + 1) && (nal[scLen + 1] & 0x80);
+
+  if (m_auHasVcl &&
+      (firstSlice || type == H264_NAL_TYPE_AUD || type == H264_NAL_TYPE_SPS ||
+       type == H264_NAL_TYPE_PPS || type == H264_NAL_TYPE_SEI))
+  {
+    emitAccessUnit();
+  }
+
+  m_au.insert(m_au.end(), nal, nal + len);
+  switch (type)
+  {
+    case H264_NAL_TYPE_SPS:
+      m_auHasSPS = true;
+      m_lastSPS.assign(nal, nal + len);
+      break;
+    case H264_NAL_TYPE_PPS:
+      m_auHasPPS = true;
+      m_lastPPS.assign(nal, nal + len);
+      break;
+    case H264_NAL_TYPE_IDR:
+      m_auIsIDR = true;
+      break;
+    default:
+      break;
+  }
+  m_auHasVcl = m_auHasVcl || isVcl;
+}
+
+void DJIH264AccessUnitAssembler::emitAccessUnit()
+{
+  H264AccessUnit au;
+  au.data     = &m_au[0];
+  au.len      = m_au.size();
+  au.sequence = m_sequence++;
+  au.hasSPS   = m_auHasSPS;
+  au.hasPPS   = m_auHasPPS;
+  au.isIDR    = m_auIsIDR;
+  au.isReplay = false;
+
+  cacheAccessUnit(au);
+
+  for (size_t i = 0; i < m_observers.size(); ++i)
+  {
+    m_observers[i].cb(au, m_observers[i].userData);
+  }
+
+  clearAccessUnit();
+}
+
+void DJIH264AccessUnitAssembler::cacheAccessUnit(const H264AccessUnit& au)
+{
+  if (au.isIDR)
+  {
+    m_gop.clear();
+    m_gopBytes = 0;
+    m_gopValid = true;
+  }
+  if (!m_gopValid)
+  {
+    return;
+  }
+
+  CachedAccessUnit cached;
+  cached.sequence = au.sequence;
+  cached.hasSPS   = au.hasSPS;
+  cached.hasPPS   = au.hasPPS;
+  cached.isIDR    = au.isIDR;
+  /*! Make the keyframe self-contained so a decoder attached later does not
+   *  depend on parameter sets sent before the cached GOP.
+   */
+  if (au.isIDR && !au.hasSPS && !m_lastSPS.empty())
+  {
+    cached.data.insert(cached.data.end(), m_lastSPS.begin(), m_lastSPS.end());
+    cached.hasSPS = true;
+  }
+  if (au.isIDR && !au.hasPPS && !m_lastPPS.empty())
+  {
+    cached.data.insert(cached.data.end(), m_lastPPS.begin(), m_lastPPS.end());
+    cached.hasPPS = true;
+  }
+  cached.data.insert(cached.data.end(), au.data, au.data + au.len);
+
+  if (m_gopBytes + cached.data.size() > m_maxGopBytes)
+  {
+    DDEBUG_PRIVATE("GOP exceeds %d bytes, stop caching until next IDR\n",
+                   (int)m_maxGopBytes);
+    m_gop.clear();
+    m_gopBytes = 0;
+    m_gopValid = false;
+    return;
+  }
+  m_gopBytes += cached.data.size();
+  m_gop.push_back(cached);
+}
+
+void DJIH264AccessUnitAssembler::clearAccessUnit()
+{
+  m_au.clear();
+  m_auHasVcl = false;
+  m_auHasSPS = false;
+  m_auHasPPS = false;
+  m_auIsIDR  = false;
+}
+
+void DJIH264AccessUnitAssembler::clearStream()
+{
+  m_pending.clear();
+  m_synced   = false;
+  m_scanFrom = 0;
+  clearAccessUnit();
+  m_lastSPS.clear();
+  m_lastPPS.clear();
+  m_gop.clear();
+  m_gopBytes = 0;
+  m_gopValid = false;
+}
+
+void DJIH264AccessUnitAssembler::reset()
+{
+  pthread_mutex_lock(&m_mutex);
+  clearStream();
+  pthread_mutex_unlock(&m_mutex);
+}
+
+bool DJIH264AccessUnitAssembler::addObserver(H264AccessUnitCallback cb,
+                                             void* userData)
+{
+  if (!cb)
+  {
+    return false;
+  }
+
+  pthread_mutex_lock(&m_mutex);
+  for (size_t i = 0; i < m_observers.size(); ++i)
+  {
+    if (m_observers[i].cb == cb && m_observers[i].userData == userData)
+    {
+      pthread_mutex_unlock(&m_mutex);
+      return false;
+    }
+  }
+
+  Observer observer = {cb, userData};
+  m_observers.push_back(observer);
+  m_active = true;
+
+  for (size_t i = 0; i < m_gop.size(); ++i)
+  {
+    H264AccessUnit au;
+    au.data     = &m_gop[i].data[0];
+    au.len      = m_gop[i].data.size();
+    au.sequence = m_gop[i].sequence;
+    au.hasSPS   = m_gop[i].hasSPS;
+    au.hasPPS   = m_gop[i].hasPPS;
+    au.isIDR    = m_gop[i].isIDR;
+    au.isReplay = true;
+    cb(au, userData);
+  }
+  pthread_mutex_unlock(&m_mutex);
+  return true;
+}
+
+bool DJIH264AccessUnitAssembler::removeObserver(H264AccessUnitCallback cb,
+                                                void* userData)
+{
+  bool found = false;
+  pthread_mutex_lock(&m_mutex);
+  for (size_t i = 0; i < m_observers.size(); ++i)
+  {
+    if (m_observers[i].cb == cb && m_observers[i].userData == userData)
+    {
+      m_observers.erase(m_observers.begin() + i);
+      found = true;
+      break;
+    }
+  }
+  if (found && m_observers.empty())
+  {
+    m_active = false;
+    clearStream();
+  }
+  pthread_mutex_unlock(&m_mutex);
+  return found;
+}
+
+int DJIH264AccessUnitAssembler::observerCount()
+{
+  pthread_mutex_lock(&m_mutex);
+  int count = m_observers.size();
+  pthread_mutex_unlock(&m_mutex);
+  return count;
+}
@@ -0,0 +1,103 @@
+/** @file dji_h264_access_unit_assembler.hpp
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ *  @brief Reassemble complete H264 access units from the raw liveview
+ *  fragments and keep the latest GOP for late observers
+ *
+ *  @copyright 2020 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJIH264ACCESSUNITASSEMBLER_HH
+#define DJIH264ACCESSUNITASSEMBLER_HH
+
+#include <vector>
+#include "pthread.h"
+#include "dji_camera_image.hpp"
+
+class DJIH264AccessUnitAssembler
+{
+public:
+  /*! Upper bound of the bytes cached for the latest GOP. If one GOP grows
+   *  larger than this, late observers wait for the next IDR instead.
+   */
+  static const size_t DEFAULT_MAX_GOP_BYTES = 8 * 1024 * 1024;
+
+  DJIH264AccessUnitAssembler(size_t maxGopBytes = DEFAULT_MAX_GOP_BYTES);
+  ~DJIH264AccessUnitAssembler();
+
+  /*! Feed raw fragments of arbitrary size, as delivered by the bulk link.
+   *  Fragments are ignored while there is no observer.
+   */
+  void pushBuffer(const uint8_t* buf, int bufLen);
+
+  /*! Drop all partial data and the cached GOP, e.g. when the stream stops.
+   *  Observers stay registered.
+   */
+  void reset();
+
+  /*! Add an observer. The cached GOP starting from the latest keyframe is
+   *  replayed to it at once, so it can start decoding without waiting for
+   *  the next IDR.
+   *  @note Callbacks are called with the assembler locked, they must not
+   *  call back into the same assembler.
+   */
+  bool addObserver(H264AccessUnitCallback cb, void* userData);
+  /*! Remove an observer. Removing the last one stops the parsing and drops
+   *  the cached GOP, the next observer waits for the next IDR.
+   */
+  bool removeObserver(H264AccessUnitCallback cb, void* userData);
+  int  observerCount();
+
+private:
+  typedef struct Observer
+  {
+    H264AccessUnitCallback cb;
+    void*                  userData;
+  } Observer;
+
+  typedef struct CachedAccessUnit
+  {
+    std::vector<uint8_t> data;
+    uint32_t             sequence;
+    bool                 hasSPS;
+    bool                 hasPPS;
+    bool                 isIDR;
+  } CachedAccessUnit;
+
+  void onNalUnit(const uint8_t* nal, size_t len);
+  void emitAccessUnit();
+  void cacheAccessUnit(const H264AccessUnit& au);
+  void clearAccessUnit();
+  void clearStream();
+
+private:
+  pthread_mutex_t m_mutex;
+  bool            m_active;
+  size_t          m_maxGopBytes;
+
+  // raw bytes not yet split into NAL units, always starts on a start code
+  std::vector<uint8_t> m_pending;
+  bool                 m_synced;
+  size_t               m_scanFrom;
+
+  // access unit being assembled
+  std::vector<uint8_t> m_au;
+  bool                 m_auHasVcl;
+  bool                 m_auHasSPS;
+  bool                 m_auHasPPS;
+  bool                 m_auIsIDR;
+  uint32_t             m_sequence;
+
+  std::vector<uint8_t> m_lastSPS;
+  std::vector<uint8_t> m_lastPPS;
+
+  std::vector<CachedAccessUnit> m_gop;
+  size_t                        m_gopBytes;
+  bool                          m_gopValid;
+
+  std::vector<Observer> m_observers;
+};
+
+#endif // DJIH264ACCESSUNITASSEMBLER_HH
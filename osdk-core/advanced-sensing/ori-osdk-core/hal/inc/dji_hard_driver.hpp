@@ -96,10 +96,24 @@ public:
   virtual time_ms getTimeStamp() = 0;
   virtual size_t send(const uint8_t* buf, size_t len) = 0;
   virtual size_t readall(uint8_t* buf, size_t maxlen) = 0;
+  //! Zero-copy variant of readall(): points data at the driver buffer that
+  //! holds the received bytes, valid until the next call. Drivers without
+  //! their own buffers read into fallback.
+  virtual size_t readBuffer(uint8_t** data, uint8_t* fallback, size_t maxlen)
+  {
+    *data = fallback;
+    return readall(fallback, maxlen);
+  }
   virtual bool getDeviceStatus()
   {
     return true;
   }
+  //! Block until readall() has data to return or timeoutMs elapsed.
+  //! Drivers that cannot wait return true at once, the reader then polls.
+  virtual bool waitForData(int timeoutMs)
+  {
+    return true;
+  }
 
 public:
   //! @todo move to Logging class
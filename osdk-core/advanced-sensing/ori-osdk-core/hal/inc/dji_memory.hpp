@@ -39,21 +39,63 @@ namespace OSDK
 
 #define PRO_PURE_DATA_MAX_SIZE 1007 // 2^10 - header size
 
+/*! @brief Memory of the protocol sessions
+ *
+ *  @details Two-level segregated fit allocator: free blocks are kept in
+ *  size-class lists indexed by two bitmaps, so allocMemory and freeMemory
+ *  are O(1) and a freed block is merged with its free neighbours at once.
+ *  Blocks never move once allocated.
+ *
+ *  The arena can be split into shards, e.g. one per session, so that one
+ *  session can not starve the others. Allocation prefers the hinted shard
+ *  and falls back to the other ones when it is full.
+ */
 class MMU
 {
 public:
   MMU();
+  ~MMU();
+
+  //! Change the arena size and shard count. Takes effect at the next
+  //! setupMMU(), i.e. call it before the protocol layer is initialized.
+  //! Each shard gets arenaSize / shardNum bytes.
+  bool configure(uint32_t arenaSize, int shardNum = 1,
+                 int tableNum = MMU_TABLE_NUM);
+
   void setupMMU(void);
   void freeMemory(MMU_Tab* mmu_tab);
   MMU_Tab* allocMemory(uint16_t size);
+  MMU_Tab* allocMemory(uint16_t size, int shardHint);
 
 public:
   static const int MMU_TABLE_NUM = 32;
-  static const int MEMORY_SIZE   = 1024;
+  static const int MEMORY_SIZE   = 4096;
+  static const int MAX_SHARD_NUM = 32;
 
 private:
-  MMU_Tab memoryTable[MMU_TABLE_NUM];
-  uint8_t memory[MEMORY_SIZE];
+  //! Not copyable, the table entries point into the arena
+  MMU(const MMU&);
+  MMU& operator=(const MMU&);
+
+  struct Shard;
+
+  void releaseArena();
+
+private:
+  uint32_t arenaSize;
+  int      shardNum;
+  int      tableNum;
+
+  Shard*   shards;
+  uint8_t* memory;
+
+  MMU_Tab* memoryTable;
+  //! Shard and block offset of each table entry
+  uint8_t*  tabShard;
+  uint32_t* tabBlock;
+  //! Stack of the unused table entries
+  uint16_t* freeTab;
+  int       freeTabNum;
 };
 
 } // OSDK
@@ -34,168 +34,414 @@
  */
 
 #include "dji_memory.hpp"
+#include <new>
 #include <string.h>
 
 using namespace DJI::OSDK;
 
-MMU::MMU()
+namespace
+{
+//! Block sizes are multiples of ALIGN, the first level splits them by
+//! power of two and the second level into SL_COUNT linear classes.
+const uint32_t ALIGN_SHIFT = 3;
+const uint32_t ALIGN       = 1 << ALIGN_SHIFT;
+const uint32_t SL_BITS     = 3;
+const uint32_t SL_COUNT    = 1 << SL_BITS;
+const uint32_t FL_SHIFT    = SL_BITS + ALIGN_SHIFT;
+const uint32_t SMALL_BLOCK = 1 << FL_SHIFT;
+const uint32_t FL_MAX      = 24;
+const uint32_t FL_COUNT    = FL_MAX - FL_SHIFT + 1;
+const uint32_t MAX_ARENA   = 1 << FL_MAX;
+
+const uint32_t NONE     = 0xFFFFFFFF;
+const uint32_t FREE_BIT = 1;
+
+//! Lies right before the payload of every block. Offsets are relative to
+//! the shard base, the free list links are only valid for free blocks.
+typedef struct BlockHeader
 {
+  uint32_t prevPhys;
+  uint32_t size;
+  uint32_t nextFree;
+  uint32_t prevFree;
+} BlockHeader;
+
+const uint32_t HEADER_SIZE = sizeof(BlockHeader);
+
+inline uint32_t
+highBit(uint32_t x)
+{
+  return 31 - __builtin_clz(x);
 }
 
-void
-MMU::setupMMU()
+inline uint32_t
+lowBit(uint32_t x)
 {
-  uint32_t i;
-  memoryTable[0].tabIndex  = 0;
-  memoryTable[0].usageFlag = 1;
-  memoryTable[0].pmem      = memory;
-  memoryTable[0].memSize   = 0;
-  for (i = 1; i < (MMU_TABLE_NUM - 1); i++)
-  {
-    memoryTable[i].tabIndex  = i;
-    memoryTable[i].usageFlag = 0;
-  }
-  memoryTable[MMU_TABLE_NUM - 1].tabIndex  = MMU_TABLE_NUM - 1;
-  memoryTable[MMU_TABLE_NUM - 1].usageFlag = 1;
-  memoryTable[MMU_TABLE_NUM - 1].pmem      = memory + MEMORY_SIZE;
-  memoryTable[MMU_TABLE_NUM - 1].memSize   = 0;
+  return __builtin_ctz(x);
 }
 
-void
-MMU::freeMemory(MMU_Tab* mmu_tab)
+inline void
+mapping(uint32_t size, uint32_t& fl, uint32_t& sl)
 {
-  if (mmu_tab == (MMU_Tab*)0)
+  if (size < SMALL_BLOCK)
   {
-    return;
+    fl = 0;
+    sl = size / (SMALL_BLOCK / SL_COUNT);
   }
-  if (mmu_tab->tabIndex == 0 || mmu_tab->tabIndex == (MMU_TABLE_NUM - 1))
+  else
   {
-    return;
+    uint32_t bit = highBit(size);
+    sl           = (size >> (bit - SL_BITS)) ^ SL_COUNT;
+    fl           = bit - FL_SHIFT + 1;
   }
-  mmu_tab->usageFlag = 0;
 }
+} // namespace
 
-MMU_Tab*
-MMU::allocMemory(uint16_t size)
+struct MMU::Shard
 {
-  uint32_t mem_used = 0;
-  uint8_t  i;
-  uint8_t  j                = 0;
-  uint8_t  mmu_tab_used_num = 0;
-  uint8_t  mmu_tab_used_index[MMU_TABLE_NUM];
+  uint8_t* base;
+  uint32_t size;
+  uint32_t flBitmap;
+  uint32_t slBitmap[FL_COUNT];
+  uint32_t freeHead[FL_COUNT][SL_COUNT];
 
-  uint32_t temp32;
-  uint32_t temp_area[2] = { 0xFFFFFFFF, 0xFFFFFFFF };
+  BlockHeader* header(uint32_t offset)
+  {
+    return (BlockHeader*)(base + offset);
+  }
+
+  uint32_t blockSize(uint32_t offset)
+  {
+    return header(offset)->size & ~FREE_BIT;
+  }
 
-  uint32_t record_temp32 = 0;
-  uint8_t  magic_flag    = 0;
+  bool isFree(uint32_t offset)
+  {
+    return (header(offset)->size & FREE_BIT) != 0;
+  }
 
-  if (size > PRO_PURE_DATA_MAX_SIZE || size > MEMORY_SIZE)
+  uint32_t nextPhys(uint32_t offset)
   {
-    return (MMU_Tab *) 0;
+    uint32_t next = offset + HEADER_SIZE + blockSize(offset);
+    return (next < size) ? next : NONE;
   }
 
-  for (i = 0; i < MMU_TABLE_NUM; i++)
+  void reset(uint8_t* mem, uint32_t memSize)
   {
-    if (memoryTable[i].usageFlag == 1)
+    base     = mem;
+    size     = memSize;
+    flBitmap = 0;
+    memset(slBitmap, 0, sizeof(slBitmap));
+    memset(freeHead, 0xFF, sizeof(freeHead));
+
+    if (memSize >= HEADER_SIZE + ALIGN)
     {
-      mem_used += memoryTable[i].memSize;
-      mmu_tab_used_index[mmu_tab_used_num++] = memoryTable[i].tabIndex;
+      BlockHeader* block = header(0);
+      block->prevPhys    = NONE;
+      block->size        = memSize - HEADER_SIZE;
+      insertFree(0);
     }
   }
 
-  if (MEMORY_SIZE < (mem_used + size))
+  void insertFree(uint32_t offset)
   {
-    return (MMU_Tab *) 0;
-  }
+    uint32_t     fl, sl;
+    BlockHeader* block = header(offset);
+    mapping(blockSize(offset), fl, sl);
 
-  if (mem_used == 0)
-  {
-    memoryTable[1].pmem      = memoryTable[0].pmem;
-    memoryTable[1].memSize   = size;
-    memoryTable[1].usageFlag = 1;
-    return &memoryTable[1];
+    block->size |= FREE_BIT;
+    block->prevFree = NONE;
+    block->nextFree = freeHead[fl][sl];
+    if (block->nextFree != NONE)
+    {
+      header(block->nextFree)->prevFree = offset;
+    }
+    freeHead[fl][sl] = offset;
+    flBitmap |= 1u << fl;
+    slBitmap[fl] |= 1u << sl;
   }
 
-  for (i = 0; i < (mmu_tab_used_num - 1); i++)
+  void removeFree(uint32_t offset)
   {
-    for (j = 0; j < (mmu_tab_used_num - i - 1); j++)
+    uint32_t     fl, sl;
+    BlockHeader* block = header(offset);
+    mapping(blockSize(offset), fl, sl);
+
+    if (block->prevFree != NONE)
+    {
+      header(block->prevFree)->nextFree = block->nextFree;
+    }
+    else
+    {
+      freeHead[fl][sl] = block->nextFree;
+    }
+    if (block->nextFree != NONE)
+    {
+      header(block->nextFree)->prevFree = block->prevFree;
+    }
+
+    if (freeHead[fl][sl] == NONE)
     {
-      if (memoryTable[mmu_tab_used_index[j]].pmem >
-          memoryTable[mmu_tab_used_index[j + 1]].pmem)
+      slBitmap[fl] &= ~(1u << sl);
+      if (slBitmap[fl] == 0)
       {
-        mmu_tab_used_index[j + 1] ^= mmu_tab_used_index[j];
-        mmu_tab_used_index[j] ^= mmu_tab_used_index[j + 1];
-        mmu_tab_used_index[j + 1] ^= mmu_tab_used_index[j];
+        flBitmap &= ~(1u << fl);
       }
     }
+    block->size &= ~FREE_BIT;
   }
-  for (i = 0; i < (mmu_tab_used_num - 1); i++)
+
+  //! @return offset of the block header, or NONE
+  uint32_t alloc(uint32_t request)
   {
-    temp32 = static_cast<uint32_t>(memoryTable[mmu_tab_used_index[i + 1]].pmem -
-                                   memoryTable[mmu_tab_used_index[i]].pmem);
+    uint32_t need = (request + ALIGN - 1) & ~(ALIGN - 1);
+    if (need == 0)
+    {
+      need = ALIGN;
+    }
 
-    if ((temp32 - memoryTable[mmu_tab_used_index[i]].memSize) >= size)
+    //! Round up to the next class, so that any block found there fits
+    uint32_t search = need;
+    if (search >= SMALL_BLOCK)
+    {
+      search += (1u << (highBit(search) - SL_BITS)) - 1;
+    }
+    uint32_t fl, sl;
+    uint32_t offset = NONE;
+    mapping(search, fl, sl);
+    if (fl < FL_COUNT)
     {
-      if (temp_area[1] > (temp32 - memoryTable[mmu_tab_used_index[i]].memSize))
+      uint32_t slMap = slBitmap[fl] & (~0u << sl);
+      if (slMap == 0)
+      {
+        uint32_t flMap = flBitmap & (~0u << (fl + 1));
+        if (flMap != 0)
+        {
+          fl    = lowBit(flMap);
+          slMap = slBitmap[fl];
+        }
+      }
+      if (slMap != 0)
       {
-        temp_area[0] = memoryTable[mmu_tab_used_index[i]].tabIndex;
-        temp_area[1] = temp32 - memoryTable[mmu_tab_used_index[i]].memSize;
+        sl     = lowBit(slMap);
+        offset = freeHead[fl][sl];
       }
     }
+    if (offset == NONE)
+    {
+      //! The rounding skips blocks of the request's own class that are
+      //! large enough, e.g. the whole arena. Walk that class before failing.
+      mapping(need, fl, sl);
+      for (offset = freeHead[fl][sl]; offset != NONE;
+           offset = header(offset)->nextFree)
+      {
+        if (blockSize(offset) >= need)
+        {
+          break;
+        }
+      }
+      if (offset == NONE)
+      {
+        return NONE;
+      }
+    }
+    removeFree(offset);
 
-    record_temp32 += temp32 - memoryTable[mmu_tab_used_index[i]].memSize;
-    if (record_temp32 >= size && magic_flag == 0)
+    //! Give the tail back if it can hold another block
+    BlockHeader* block = header(offset);
+    if (block->size >= need + HEADER_SIZE + ALIGN)
     {
-      j          = i;
-      magic_flag = 1;
+      uint32_t     restOffset = offset + HEADER_SIZE + need;
+      BlockHeader* rest       = header(restOffset);
+      rest->prevPhys          = offset;
+      rest->size              = block->size - need - HEADER_SIZE;
+      block->size             = need;
+
+      uint32_t next = nextPhys(restOffset);
+      if (next != NONE)
+      {
+        header(next)->prevPhys = restOffset;
+      }
+      insertFree(restOffset);
     }
+    return offset;
   }
 
-  if (temp_area[0] == 0xFFFFFFFF && temp_area[1] == 0xFFFFFFFF)
+  void free(uint32_t offset)
   {
-    for (i = 0; i < j; i++)
+    BlockHeader* block = header(offset);
+
+    uint32_t next = nextPhys(offset);
+    if (next != NONE && isFree(next))
     {
-      if (memoryTable[mmu_tab_used_index[i + 1]].pmem >
-          (memoryTable[mmu_tab_used_index[i]].pmem +
-           memoryTable[mmu_tab_used_index[i]].memSize))
-      {
-        memmove(memoryTable[mmu_tab_used_index[i]].pmem +
-                  memoryTable[mmu_tab_used_index[i]].memSize,
-                memoryTable[mmu_tab_used_index[i + 1]].pmem,
-                memoryTable[mmu_tab_used_index[i + 1]].memSize);
-        memoryTable[mmu_tab_used_index[i + 1]].pmem =
-          memoryTable[mmu_tab_used_index[i]].pmem +
-          memoryTable[mmu_tab_used_index[i]].memSize;
-      }
+      removeFree(next);
+      block->size += HEADER_SIZE + header(next)->size;
     }
 
-    for (i = 1; i < (MMU_TABLE_NUM - 1); i++)
+    if (block->prevPhys != NONE && isFree(block->prevPhys))
     {
-      if (memoryTable[i].usageFlag == 0)
-      {
-        memoryTable[i].pmem = memoryTable[mmu_tab_used_index[j]].pmem +
-                              memoryTable[mmu_tab_used_index[j]].memSize;
+      uint32_t prev = block->prevPhys;
+      removeFree(prev);
+      header(prev)->size += HEADER_SIZE + block->size;
+      offset = prev;
+    }
 
-        memoryTable[i].memSize   = size;
-        memoryTable[i].usageFlag = 1;
-        return &memoryTable[i];
-      }
+    next = nextPhys(offset);
+    if (next != NONE)
+    {
+      header(next)->prevPhys = offset;
     }
-    return (MMU_Tab*)0;
+    insertFree(offset);
+  }
+};
+
+MMU::MMU()
+  : arenaSize(MEMORY_SIZE)
+  , shardNum(1)
+  , tableNum(MMU_TABLE_NUM)
+  , shards(NULL)
+  , memory(NULL)
+  , memoryTable(NULL)
+  , tabShard(NULL)
+  , tabBlock(NULL)
+  , freeTab(NULL)
+  , freeTabNum(0)
+{
+}
+
+MMU::~MMU()
+{
+  releaseArena();
+}
+
+void
+MMU::releaseArena()
+{
+  delete[] shards;
+  delete[] memory;
+  delete[] memoryTable;
+  delete[] tabShard;
+  delete[] tabBlock;
+  delete[] freeTab;
+  shards      = NULL;
+  memory      = NULL;
+  memoryTable = NULL;
+  tabShard    = NULL;
+  tabBlock    = NULL;
+  freeTab     = NULL;
+  freeTabNum  = 0;
+}
+
+bool
+MMU::configure(uint32_t arenaSize, int shardNum, int tableNum)
+{
+  if (shardNum < 1 || shardNum > MAX_SHARD_NUM || tableNum < 1 ||
+      tableNum > 0xFFFF || arenaSize > MAX_ARENA ||
+      arenaSize / shardNum < HEADER_SIZE + ALIGN)
+  {
+    return false;
   }
 
-  for (i = 1; i < (MMU_TABLE_NUM - 1); i++)
+  releaseArena();
+  this->arenaSize = arenaSize;
+  this->shardNum  = shardNum;
+  this->tableNum  = tableNum;
+  return true;
+}
+
+void
+MMU::setupMMU()
+{
+  if (memory == NULL)
   {
-    if (memoryTable[i].usageFlag == 0)
+    shards      = new (std::nothrow) Shard[shardNum];
+    memory      = new (std::nothrow) uint8_t[arenaSize];
+    memoryTable = new (std::nothrow) MMU_Tab[tableNum];
+    tabShard    = new (std::nothrow) uint8_t[tableNum];
+    tabBlock    = new (std::nothrow) uint32_t[tableNum];
+    freeTab     = new (std::nothrow) uint16_t[tableNum];
+    if (!shards || !memory || !memoryTable || !tabShard || !tabBlock ||
+        !freeTab)
     {
-      memoryTable[i].pmem =
-        memoryTable[temp_area[0]].pmem + memoryTable[temp_area[0]].memSize;
+      releaseArena();
+      return;
+    }
+  }
+
+  //! Shards start on an ALIGN boundary so that the payloads are aligned
+  uint32_t shardSize = (arenaSize / shardNum) & ~(ALIGN - 1);
+  for (int i = 0; i < shardNum; i++)
+  {
+    shards[i].reset(memory + i * shardSize, shardSize);
+  }
+
+  for (int i = 0; i < tableNum; i++)
+  {
+    memoryTable[i].tabIndex  = i;
+    memoryTable[i].usageFlag = 0;
+    memoryTable[i].memSize   = 0;
+    memoryTable[i].pmem      = NULL;
+    freeTab[i]               = tableNum - 1 - i;
+  }
+  freeTabNum = tableNum;
+}
 
-      memoryTable[i].memSize   = size;
-      memoryTable[i].usageFlag = 1;
-      return &memoryTable[i];
+void
+MMU::freeMemory(MMU_Tab* mmu_tab)
+{
+  if (mmu_tab == (MMU_Tab*)0 || memoryTable == NULL)
+  {
+    return;
+  }
+
+  int index = (int)(mmu_tab - memoryTable);
+  if (index < 0 || index >= tableNum || mmu_tab->usageFlag == 0)
+  {
+    return;
+  }
+
+  shards[tabShard[index]].free(tabBlock[index]);
+  mmu_tab->usageFlag = 0;
+  mmu_tab->pmem      = NULL;
+  freeTab[freeTabNum++] = index;
+}
+
+MMU_Tab*
+MMU::allocMemory(uint16_t size)
+{
+  return allocMemory(size, 0);
+}
+
+MMU_Tab*
+MMU::allocMemory(uint16_t size, int shardHint)
+{
+  if (memoryTable == NULL || freeTabNum == 0)
+  {
+    return (MMU_Tab*)0;
+  }
+
+  if (shardHint < 0)
+  {
+    shardHint = 0;
+  }
+  for (int i = 0; i < shardNum; i++)
+  {
+    int      shard  = (shardHint + i) % shardNum;
+    uint32_t offset = shards[shard].alloc(size);
+    if (offset == NONE)
+    {
+      continue;
     }
+
+    int index       = freeTab[--freeTabNum];
+    tabShard[index] = shard;
+    tabBlock[index] = offset;
+
+    MMU_Tab* tab   = &memoryTable[index];
+    tab->usageFlag = 1;
+    tab->memSize   = size;
+    tab->pmem      = shards[shard].base + offset + HEADER_SIZE;
+    return tab;
   }
 
   return (MMU_Tab*)0;
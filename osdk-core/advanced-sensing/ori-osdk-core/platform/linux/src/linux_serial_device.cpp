@@ -77,12 +77,11 @@ LinuxSerialDevice::getDeviceStatus()
 DJI::OSDK::time_ms
 LinuxSerialDevice::getTimeStamp()
 {
-  struct timeval tv = {0};
+  struct timespec ts;
 
-  gettimeofday(&tv, NULL);
+  clock_gettime(CLOCK_MONOTONIC, &ts);
 
-  return (tv.tv_sec*1000 + tv.tv_usec/1000);
-  //return (uint32_t)time(NULL);
+  return ((uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
 }
 
 size_t
@@ -140,9 +139,8 @@ int LinuxSerialDevice::_checkBaudRate(uint8_t (&buf)[BUFFER_SIZE])
   int timeoutInSeconds = 2;
 
   struct timespec curTime, absTimeout;
-  // Use clock_gettime instead of getttimeofday for compatibility with POSIX
-  // APIs
-  clock_gettime(CLOCK_REALTIME, &curTime);
+  // Monotonic, a wall clock step must not cut the check short or stretch it
+  clock_gettime(CLOCK_MONOTONIC, &curTime);
   absTimeout.tv_sec  = curTime.tv_sec + timeoutInSeconds;
   absTimeout.tv_nsec = curTime.tv_nsec;
 
@@ -156,7 +154,7 @@ int LinuxSerialDevice::_checkBaudRate(uint8_t (&buf)[BUFFER_SIZE])
     else
       break;
 
-    clock_gettime(CLOCK_REALTIME, &curTime);
+    clock_gettime(CLOCK_MONOTONIC, &curTime);
   }
   if (curTime.tv_sec >= absTimeout.tv_sec)
     return -1;
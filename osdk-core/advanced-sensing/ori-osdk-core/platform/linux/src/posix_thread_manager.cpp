@@ -28,6 +28,7 @@
  */
 
 #include "posix_thread_manager.hpp"
+#include <ctime>
 
 using namespace DJI::OSDK;
 
@@ -53,7 +54,13 @@ PosixThreadManager::init()
   m_memLock = PTHREAD_MUTEX_INITIALIZER;
   m_msgLock = PTHREAD_MUTEX_INITIALIZER;
   m_ackLock = PTHREAD_MUTEX_INITIALIZER;
-  pthread_cond_init(&m_ackRecvCv, NULL);
+
+  /*! Timed waits must not be stretched by wall clock adjustments */
+  pthread_condattr_t monotonicAttr;
+  pthread_condattr_init(&monotonicAttr);
+  pthread_condattr_setclock(&monotonicAttr, CLOCK_MONOTONIC);
+  pthread_cond_init(&m_ackRecvCv, &monotonicAttr);
+  pthread_condattr_destroy(&monotonicAttr);
 
   /*! These mutexes are used for the non blocking callback ACK mechanism */
   m_nbAckLock  = PTHREAD_MUTEX_INITIALIZER;
@@ -174,11 +181,9 @@ void
 PosixThreadManager::wait(int timeoutInSeconds)
 {
   struct timespec curTime, absTimeout;
-  // Use clock_gettime instead of getttimeofday for compatibility with POSIX
-  // APIs
-  clock_gettime(CLOCK_REALTIME, &curTime);
-  // absTimeout = curTime;
+  // m_ackRecvCv runs on CLOCK_MONOTONIC, see init()
+  clock_gettime(CLOCK_MONOTONIC, &curTime);
   absTimeout.tv_sec  = curTime.tv_sec + timeoutInSeconds;
   absTimeout.tv_nsec = curTime.tv_nsec;
   pthread_cond_timedwait(&m_ackRecvCv, &m_ackLock, &absTimeout);
-}
\ No newline at end of file
+}
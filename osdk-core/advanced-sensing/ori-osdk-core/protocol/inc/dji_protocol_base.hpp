@@ -103,6 +103,10 @@ public:
   //! highest level of receive function
   virtual RecvContainer* receive();
 
+  //! Block until receive() has bytes to parse or timeoutMs elapsed. Used by
+  //! the advanced sensing read thread instead of sleeping between polls.
+  bool waitForData(int timeoutMs);
+
 protected:
   typedef struct SDKFilter
   {
@@ -207,6 +211,8 @@ protected:
   int            read_len;
   int            BUFFER_SIZE; // this should not be changed, init this in constructor
   uint8_t*       buf;
+  //! Bytes being parsed, buf or a buffer of the driver, see readBuffer()
+  uint8_t*       read_buf;
   uint8_t        HEADER_LEN;
   int            MAX_RECV_LEN;
   RecvContainer* p_recvContainer;
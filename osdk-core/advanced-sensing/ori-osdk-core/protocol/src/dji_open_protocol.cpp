@@ -152,7 +152,7 @@ OpenProtocol::allocSession(uint16_t session_id, uint16_t size)
   if (i < 32 && CMDSessionTab[i].usageFlag == 0)
   {
     CMDSessionTab[i].usageFlag = 1;
-    memoryTab                  = mmu->allocMemory(size);
+    memoryTab                  = mmu->allocMemory(size, i);
     if (memoryTab == NULL)
       CMDSessionTab[i].usageFlag = 0;
     else
@@ -171,6 +171,7 @@ OpenProtocol::freeSession(CMDSession* session)
   {
     DDEBUG("session id %d\n", session->sessionID);
     mmu->freeMemory(session->mmu);
+    session->mmu       = (MMU_Tab*)NULL;
     session->usageFlag = 0;
   }
 }
@@ -183,7 +184,7 @@ OpenProtocol::allocACK(uint16_t session_id, uint16_t size)
   {
     if (ACKSessionTab[session_id - 1].mmu)
       freeACK(&ACKSessionTab[session_id - 1]);
-    memoryTab = mmu->allocMemory(size);
+    memoryTab = mmu->allocMemory(size, session_id);
     if (memoryTab == NULL)
     {
       DERROR("there is not enough memory\n");
@@ -203,6 +204,7 @@ void
 OpenProtocol::freeACK(ACKSession* session)
 {
   mmu->freeMemory(session->mmu);
+  session->mmu = (MMU_Tab*)NULL;
 }
 
 /******************** Send Pipeline **********************/
@@ -36,6 +36,7 @@ ProtocolBase::ProtocolBase()
   : reuse_buffer(true)
   , is_large_data_protocol(false)
   , BUFFER_SIZE(1024)
+  , read_buf(NULL)
 {
 }
 
@@ -65,6 +66,17 @@ ProtocolBase::receive()
   return p_recvContainer;
 }
 
+bool
+ProtocolBase::waitForData(int timeoutMs)
+{
+  //! Bytes left over from the last readall() are parsed first
+  if (buf_read_pos < read_len)
+  {
+    return true;
+  }
+  return deviceDriver->waitForData(timeoutMs);
+}
+
 //! Step 1
 bool
 ProtocolBase::readPoll()
@@ -73,10 +85,12 @@ ProtocolBase::readPoll()
   bool isFrame = false;
 
   //! Step 1: Check if the buffer has been consumed
+  //! The driver may hand out its own buffer instead of copying into buf
   if (buf_read_pos >= read_len)
   {
     this->buf_read_pos = 0;
-    this->read_len     = deviceDriver->readall(this->buf, BUFFER_SIZE);
+    this->read_len =
+      deviceDriver->readBuffer(&this->read_buf, this->buf, BUFFER_SIZE);
   }
 
 #ifdef API_BUFFER_DATA
@@ -91,7 +105,7 @@ ProtocolBase::readPoll()
   //! buffer data we have already read
   if (is_large_data_protocol && this->read_len == BUFFER_SIZE)
   {
-    memcpy(p_filter->recvBuf + (p_filter->recvIndex), this->buf,
+    memcpy(p_filter->recvBuf + (p_filter->recvIndex), this->read_buf,
            sizeof(uint8_t) * BUFFER_SIZE);
     p_filter->recvIndex += BUFFER_SIZE;
     this->buf_read_pos = BUFFER_SIZE;
@@ -101,7 +115,7 @@ ProtocolBase::readPoll()
     for (this->buf_read_pos; this->buf_read_pos < this->read_len;
          this->buf_read_pos++)
     {
-      isFrame = byteHandler(buf[this->buf_read_pos]);
+      isFrame = byteHandler(read_buf[this->buf_read_pos]);
 
       if (isFrame)
       {
@@ -0,0 +1,201 @@
+/*! @file linux_io_reactor.hpp
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ *
+ *  @Copyright (c) 2020 DJI.
+ *  NOTE THAT this file is part of the advanced sensing
+ *  closed-source library. For licensing information,
+ *  please visit https://developer.dji.com/policies/eula/
+ * */
+
+#ifndef ONBOARDSDK_LINUX_IO_REACTOR_H
+#define ONBOARDSDK_LINUX_IO_REACTOR_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
+
+struct libusb_context;
+
+namespace DJI
+{
+
+namespace OSDK
+{
+
+/*! @brief Multiplexed I/O for the advanced sensing channels
+ *
+ * @details Instead of one blocking read thread per channel, the channels
+ * register their handles here and are serviced by at most two threads:
+ * - the epoll thread for file descriptors (serial ports, sockets) and the
+ *   libusb event handling of asynchronous transfers,
+ * - the UDT thread for the camera stream sockets, which UDT only reports
+ *   through its own epoll.
+ *
+ * Readiness handlers run on these threads and are expected to only read
+ * what is available and return. The processing is then posted to a small
+ * worker pool. Tasks posted with the same key run on the same worker in
+ * posting order, so each channel keeps its frame order.
+ */
+class LinuxIoReactor
+{
+public:
+  //! Called on a reactor thread when the handle is ready
+  typedef void (*IoHandler)(void* userData, uint32_t events);
+  //! Called on a worker thread
+  typedef void (*IoTask)(void* arg);
+
+  //! Events passed to the handlers, same values as epoll and UDT epoll
+  static const uint32_t IO_EVENT_IN  = 0x1;
+  static const uint32_t IO_EVENT_ERR = 0x8;
+
+  static const int DEFAULT_WORKER_NUM = 2;
+  static const int MAX_WORKER_NUM     = 8;
+  //! Longest time the threads sleep, bounds the time stop() waits
+  static const int POLL_PERIOD_MS     = 100;
+
+  LinuxIoReactor();
+  ~LinuxIoReactor();
+
+  /*!
+   * @brief Start the reactor threads and the worker pool.
+   * @param workerNum number of workers, clamped to [1, MAX_WORKER_NUM]
+   * @return false if already running or a thread could not be created
+   */
+  bool start(int workerNum = DEFAULT_WORKER_NUM);
+
+  /*! @brief Stop all the threads, the pending tasks are run first. The
+   *  registered handles are not closed.
+   */
+  void stop();
+
+  bool isRunning();
+
+  /*!
+   * @brief Watch a file descriptor for input on the epoll thread.
+   * @note The fd should be non-blocking, a handler blocking in read()
+   * stalls every other channel.
+   */
+  bool addFd(int fd, IoHandler handler, void* userData);
+
+  /*!
+   * @brief Stop watching a file descriptor. Once it returns the handler is
+   * not running and will not be called again, unless it is called from the
+   * handler itself.
+   */
+  bool removeFd(int fd);
+
+  /*!
+   * @brief Watch a UDT socket for input on the UDT thread.
+   * @note The socket has to be non-blocking (UDT_RCVSYN false).
+   */
+  bool addUdtSocket(int sock, IoHandler handler, void* userData);
+
+  //! Same guarantee as removeFd()
+  bool removeUdtSocket(int sock);
+
+  /*!
+   * @brief Handle the events of a libusb context on the epoll thread, so
+   * the completion callbacks of its asynchronous transfers are called there.
+   * Only one context can be added.
+   */
+  bool addLibusbContext(libusb_context* ctx);
+
+  void removeLibusbContext();
+
+  /*!
+   * @brief Run a task on the worker selected by key.
+   * @return false if the reactor is not running, the task is then not run
+   */
+  bool post(uint32_t key, IoTask task, void* arg);
+
+  /*!
+   * @brief Wait until the tasks already posted with this key are done.
+   * @note Must not be called from a worker thread.
+   */
+  void sync(uint32_t key);
+
+private:
+  typedef struct Source
+  {
+    IoHandler handler;
+    void*     userData;
+  } Source;
+
+  typedef struct Task
+  {
+    IoTask task;
+    void*  arg;
+  } Task;
+
+  typedef struct Worker
+  {
+    LinuxIoReactor*  owner;
+    pthread_t        thread;
+    pthread_mutex_t  mutex;
+    pthread_cond_t   cond;
+    std::deque<Task> queue;
+    bool             isRunning;
+  } Worker;
+
+  LinuxIoReactor(const LinuxIoReactor&);
+  LinuxIoReactor& operator=(const LinuxIoReactor&);
+
+  bool addEpollFd(int fd, uint32_t epollEvents);
+  bool dispatch(std::map<int, Source>& sources, int handle, uint32_t events,
+                int& dispatching);
+  void waitDispatch(pthread_t thread, const int& dispatching, int handle);
+  bool isUsbFd(int fd);
+  int  getEpollTimeout();
+  void handleUsbEvents();
+
+  void epollThreadFunc();
+  void udtThreadFunc();
+  void workerThreadFunc(Worker* worker);
+
+  static void* epollThreadEntry(void* p);
+  static void* udtThreadEntry(void* p);
+  static void* workerThreadEntry(void* p);
+  static void  usbPollfdAdded(int fd, short events, void* userData);
+  static void  usbPollfdRemoved(int fd, void* userData);
+  static void  syncTask(void* arg);
+
+private:
+  volatile bool m_isRunning;
+
+  //! Handle of the source whose handler runs, NO_HANDLE if none
+  static const int NO_HANDLE  = -1;
+  static const int USB_HANDLE = -2;
+
+  //! Protects the sources and the dispatching handles
+  pthread_mutex_t m_mutex;
+  pthread_cond_t  m_dispatchCond;
+
+  int                   m_epollFd;
+  int                   m_wakeupFd;
+  pthread_t             m_epollThread;
+  bool                  m_epollThreadCreated;
+  std::map<int, Source> m_fdSources;
+  int                   m_fdDispatching;
+
+  int                   m_udtEpollId;
+  pthread_t             m_udtThread;
+  bool                  m_udtThreadCreated;
+  std::map<int, Source> m_udtSources;
+  int                   m_udtDispatching;
+
+  //! libusb context and its pollfds, handled on the epoll thread
+  libusb_context*       m_usbCtx;
+  std::set<int>         m_usbFds;
+
+  std::vector<Worker*>  m_workers;
+};
+
+} // namespace OSDK
+} // namespace DJI
+
+#endif // ONBOARDSDK_LINUX_IO_REACTOR_H
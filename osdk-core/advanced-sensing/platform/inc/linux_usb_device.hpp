@@ -16,6 +16,7 @@
 #include <fcntl.h>
 #include <termios.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <libusb.h>
 
 #include "dji_hard_driver.hpp"
@@ -36,6 +37,10 @@ class LinuxUSBDevice : public HardDriver
   static const int TIMEOUT                  = 50;
   static const int OUT_END_PT               = 0x0A;
   static const int IN_END_PT                = 0x84;
+  //! Transfers kept submitted in each direction
+  static const int TRANSFER_NUM             = 4;
+  //! Larger sends go out synchronously
+  static const int TX_BUFFER_SIZE           = 4096;
 
   typedef struct USBFilter
   {
@@ -43,6 +48,14 @@ class LinuxUSBDevice : public HardDriver
     uint16_t  pid;
   } USBFilter;
 
+  typedef struct TransferSlot
+  {
+    LinuxUSBDevice*  owner;
+    int              index;
+    libusb_transfer* transfer;
+    uint8_t*         buffer;
+  } TransferSlot;
+
 
 public:
 //  static const int BUFFER_SIZE = 2048;
@@ -58,8 +71,27 @@ public:
   //! Start of DJI_HardDriver virtual function implementations
   size_t send(const uint8_t* buf, size_t len);
   size_t readall(uint8_t* buf, size_t maxlen);
+  size_t readBuffer(uint8_t** data, uint8_t* fallback, size_t maxlen);
+  bool waitForData(int timeoutMs);
 
   time_ms getTimeStamp();
+
+  //! Context of the device, its events may also be handled by an IO reactor
+  libusb_context* getContext();
+
+private:
+  bool startAsync(size_t rxSize);
+  void stopAsync();
+  void freeAsync();
+  int  submit(TransferSlot* slot);
+  void submitRx(TransferSlot* slot);
+  void retryIdleRx();
+  void handleEvents(int* completed, int timeoutMs);
+  size_t sendSync(const uint8_t* buf, size_t len);
+
+  static void LIBUSB_CALL rxCallback(libusb_transfer* transfer);
+  static void LIBUSB_CALL txCallback(libusb_transfer* transfer);
+
 private:
   libusb_device*        DJI_device;
   libusb_device_handle* DJI_dev_handle;
@@ -68,6 +100,36 @@ private:
 
   bool                  deviceStatus;
   bool                  foundDJIDevice;
+  //! Result of the last IN transfer, see waitForData()
+  int                   lastReadRet;
+
+  libusb_context*       usbContext;
+
+  /*! Asynchronous transfer ring, protected by asyncMutex. Completed IN
+   *  transfers wait in rxDone until readBuffer() hands them out, the one
+   *  handed out goes back to the bus on the next call.
+   */
+  pthread_mutex_t       asyncMutex;
+  bool                  asyncReady;
+  //! The device is gone, the only error the ring does not recover from
+  bool                  deviceGone;
+  size_t                rxTransferSize;
+  TransferSlot          rxSlots[TRANSFER_NUM];
+  int                   rxDone[TRANSFER_NUM];
+  int                   rxHead;
+  int                   rxCount;
+  int                   rxHeld;
+  int                   rxCompleted;
+  //! IN slots a transfer error took off the bus, see retryIdleRx()
+  int                   rxIdle[TRANSFER_NUM];
+  int                   rxIdleCount;
+  bool                  rxHalted;
+  time_ms               rxRetryTime;
+  TransferSlot          txSlots[TRANSFER_NUM];
+  int                   txFree[TRANSFER_NUM];
+  int                   txFreeCount;
+  int                   txCompleted;
+  int                   inFlight;
 };
 }
 }
@@ -0,0 +1,675 @@
+/*
+ * DJI Onboard SDK Advanced Sensing APIs
+ *
+ * Copyright (c) 2020 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ */
+
+#include "linux_io_reactor.hpp"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <libusb.h>
+
+#include "udt.h"
+#include "dji_log.hpp"
+#include "dji_platform.hpp"
+
+using namespace DJI::OSDK;
+
+//! Events returned by one epoll_wait
+static const int MAX_EPOLL_EVENTS = 16;
+
+typedef struct SyncPoint
+{
+  pthread_mutex_t mutex;
+  pthread_cond_t  cond;
+  bool            done;
+} SyncPoint;
+
+LinuxIoReactor::LinuxIoReactor() :
+  m_isRunning(false),
+  m_epollFd(-1),
+  m_wakeupFd(-1),
+  m_epollThreadCreated(false),
+  m_fdDispatching(NO_HANDLE),
+  m_udtEpollId(-1),
+  m_udtThreadCreated(false),
+  m_udtDispatching(NO_HANDLE),
+  m_usbCtx(NULL)
+{
+  pthread_mutex_init(&m_mutex, NULL);
+  pthread_cond_init(&m_dispatchCond, NULL);
+}
+
+LinuxIoReactor::~LinuxIoReactor()
+{
+  stop();
+  pthread_cond_destroy(&m_dispatchCond);
+  pthread_mutex_destroy(&m_mutex);
+}
+
+bool
+LinuxIoReactor::start(int workerNum)
+{
+  if (m_isRunning)
+  {
+    DSTATUS("IO reactor is already running");
+    return false;
+  }
+
+  workerNum = (workerNum < 1) ? 1 : workerNum;
+  workerNum = (workerNum > MAX_WORKER_NUM) ? MAX_WORKER_NUM : workerNum;
+
+  m_epollFd  = epoll_create1(EPOLL_CLOEXEC);
+  m_wakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (m_epollFd < 0 || m_wakeupFd < 0 || !addEpollFd(m_wakeupFd, EPOLLIN))
+  {
+    DERROR("Failed to create the IO reactor epoll, errno = %d", errno);
+    stop();
+    return false;
+  }
+
+  UDT::startup();
+  m_udtEpollId = UDT::epoll_create();
+  if (m_udtEpollId < 0)
+  {
+    DERROR("Failed to create the IO reactor UDT epoll, %s",
+           UDT::getlasterror().getErrorMessage());
+    UDT::cleanup();
+    stop();
+    return false;
+  }
+
+  /*! Workers first, the reactor threads post to them as soon as they run */
+  m_isRunning = true;
+  for (int i = 0; i < workerNum; i++)
+  {
+    Worker* worker    = new Worker();
+    worker->owner     = this;
+    worker->isRunning = true;
+    pthread_mutex_init(&worker->mutex, NULL);
+    pthread_cond_init(&worker->cond, NULL);
+    if (0 != pthread_create(&worker->thread, NULL, workerThreadEntry, worker))
+    {
+      DERROR("Failed to create IO worker %d", i);
+      pthread_cond_destroy(&worker->cond);
+      pthread_mutex_destroy(&worker->mutex);
+      delete worker;
+      stop();
+      return false;
+    }
+    Platform::instance().applyTaskPolicy(&worker->thread,
+                                         OSDK_TASK_CLASS_VIDEO_DECODE,
+                                         "ioWorker");
+    m_workers.push_back(worker);
+  }
+
+  m_epollThreadCreated =
+    (0 == pthread_create(&m_epollThread, NULL, epollThreadEntry, this));
+  m_udtThreadCreated =
+    (0 == pthread_create(&m_udtThread, NULL, udtThreadEntry, this));
+  if (!m_epollThreadCreated || !m_udtThreadCreated)
+  {
+    DERROR("Failed to create the IO reactor threads");
+    stop();
+    return false;
+  }
+  Platform::instance().applyTaskPolicy(&m_epollThread,
+                                       OSDK_TASK_CLASS_LINK_READ, "ioReactor");
+  Platform::instance().applyTaskPolicy(&m_udtThread,
+                                       OSDK_TASK_CLASS_VIDEO_READ, "udtReactor");
+
+  DSTATUS("IO reactor started with %d workers", workerNum);
+  return true;
+}
+
+void
+LinuxIoReactor::stop()
+{
+  m_isRunning = false;
+
+  if (m_epollThreadCreated)
+  {
+    uint64_t one = 1;
+    if (write(m_wakeupFd, &one, sizeof(one)) < 0)
+    {
+      DDEBUG("IO reactor wakeup failed, errno = %d", errno);
+    }
+    pthread_join(m_epollThread, NULL);
+    m_epollThreadCreated = false;
+  }
+  if (m_udtThreadCreated)
+  {
+    pthread_join(m_udtThread, NULL);
+    m_udtThreadCreated = false;
+  }
+  removeLibusbContext();
+
+  /*! The workers run what is already queued before they exit */
+  for (size_t i = 0; i < m_workers.size(); i++)
+  {
+    Worker* worker = m_workers[i];
+    pthread_mutex_lock(&worker->mutex);
+    worker->isRunning = false;
+    pthread_cond_signal(&worker->cond);
+    pthread_mutex_unlock(&worker->mutex);
+
+    pthread_join(worker->thread, NULL);
+    pthread_cond_destroy(&worker->cond);
+    pthread_mutex_destroy(&worker->mutex);
+    delete worker;
+  }
+  m_workers.clear();
+
+  if (m_udtEpollId >= 0)
+  {
+    UDT::epoll_release(m_udtEpollId);
+    UDT::cleanup();
+    m_udtEpollId = -1;
+  }
+  if (m_wakeupFd >= 0)
+  {
+    close(m_wakeupFd);
+    m_wakeupFd = -1;
+  }
+  if (m_epollFd >= 0)
+  {
+    close(m_epollFd);
+    m_epollFd = -1;
+  }
+
+  pthread_mutex_lock(&m_mutex);
+  m_fdSources.clear();
+  m_udtSources.clear();
+  pthread_mutex_unlock(&m_mutex);
+}
+
+bool
+LinuxIoReactor::isRunning()
+{
+  return m_isRunning;
+}
+
+bool
+LinuxIoReactor::addFd(int fd, IoHandler handler, void* userData)
+{
+  if (!m_isRunning || fd < 0 || !handler)
+  {
+    return false;
+  }
+
+  Source source = { handler, userData };
+  pthread_mutex_lock(&m_mutex);
+  if (!m_fdSources.insert(std::make_pair(fd, source)).second)
+  {
+    pthread_mutex_unlock(&m_mutex);
+    DERROR("fd %d is already watched", fd);
+    return false;
+  }
+  pthread_mutex_unlock(&m_mutex);
+
+  if (!addEpollFd(fd, EPOLLIN))
+  {
+    DERROR("Failed to watch fd %d, errno = %d", fd, errno);
+    pthread_mutex_lock(&m_mutex);
+    m_fdSources.erase(fd);
+    pthread_mutex_unlock(&m_mutex);
+    return false;
+  }
+  return true;
+}
+
+bool
+LinuxIoReactor::removeFd(int fd)
+{
+  pthread_mutex_lock(&m_mutex);
+  if (0 == m_fdSources.erase(fd))
+  {
+    pthread_mutex_unlock(&m_mutex);
+    return false;
+  }
+  if (m_epollFd >= 0)
+  {
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, NULL);
+  }
+  waitDispatch(m_epollThread, m_fdDispatching, fd);
+  pthread_mutex_unlock(&m_mutex);
+  return true;
+}
+
+bool
+LinuxIoReactor::addUdtSocket(int sock, IoHandler handler, void* userData)
+{
+  if (!m_isRunning || sock < 0 || !handler)
+  {
+    return false;
+  }
+
+  Source source = { handler, userData };
+  pthread_mutex_lock(&m_mutex);
+  if (!m_udtSources.insert(std::make_pair(sock, source)).second)
+  {
+    pthread_mutex_unlock(&m_mutex);
+    DERROR("UDT socket %d is already watched", sock);
+    return false;
+  }
+  pthread_mutex_unlock(&m_mutex);
+
+  int events = UDT_EPOLL_IN | UDT_EPOLL_ERR;
+  if (UDT::ERROR == UDT::epoll_add_usock(m_udtEpollId, sock, &events))
+  {
+    DERROR("Failed to watch UDT socket %d, %s", sock,
+           UDT::getlasterror().getErrorMessage());
+    pthread_mutex_lock(&m_mutex);
+    m_udtSources.erase(sock);
+    pthread_mutex_unlock(&m_mutex);
+    return false;
+  }
+  return true;
+}
+
+bool
+LinuxIoReactor::removeUdtSocket(int sock)
+{
+  pthread_mutex_lock(&m_mutex);
+  if (0 == m_udtSources.erase(sock))
+  {
+    pthread_mutex_unlock(&m_mutex);
+    return false;
+  }
+  if (m_udtEpollId >= 0)
+  {
+    UDT::epoll_remove_usock(m_udtEpollId, sock);
+  }
+  waitDispatch(m_udtThread, m_udtDispatching, sock);
+  pthread_mutex_unlock(&m_mutex);
+  return true;
+}
+
+bool
+LinuxIoReactor::addLibusbContext(libusb_context* ctx)
+{
+  if (!m_isRunning || !ctx)
+  {
+    return false;
+  }
+
+  pthread_mutex_lock(&m_mutex);
+  if (m_usbCtx)
+  {
+    pthread_mutex_unlock(&m_mutex);
+    DERROR("A libusb context is already handled");
+    return false;
+  }
+  m_usbCtx = ctx;
+  pthread_mutex_unlock(&m_mutex);
+
+  /*! Notifiers first, so no fd opened in between is missed */
+  libusb_set_pollfd_notifiers(ctx, usbPollfdAdded, usbPollfdRemoved, this);
+  const struct libusb_pollfd** pollfds = libusb_get_pollfds(ctx);
+  if (!pollfds)
+  {
+    DERROR("Failed to get the libusb pollfds");
+    removeLibusbContext();
+    return false;
+  }
+  for (int i = 0; pollfds[i] != NULL; i++)
+  {
+    usbPollfdAdded(pollfds[i]->fd, pollfds[i]->events, this);
+  }
+  libusb_free_pollfds(pollfds);
+  return true;
+}
+
+void
+LinuxIoReactor::removeLibusbContext()
+{
+  pthread_mutex_lock(&m_mutex);
+  libusb_context* ctx = m_usbCtx;
+  if (!ctx)
+  {
+    pthread_mutex_unlock(&m_mutex);
+    return;
+  }
+  m_usbCtx = NULL;
+  std::set<int> fds;
+  fds.swap(m_usbFds);
+  waitDispatch(m_epollThread, m_fdDispatching, USB_HANDLE);
+  pthread_mutex_unlock(&m_mutex);
+
+  libusb_set_pollfd_notifiers(ctx, NULL, NULL, NULL);
+  for (std::set<int>::iterator it = fds.begin(); it != fds.end(); ++it)
+  {
+    if (m_epollFd >= 0)
+    {
+      epoll_ctl(m_epollFd, EPOLL_CTL_DEL, *it, NULL);
+    }
+  }
+}
+
+bool
+LinuxIoReactor::post(uint32_t key, IoTask task, void* arg)
+{
+  if (!m_isRunning || m_workers.empty() || !task)
+  {
+    return false;
+  }
+
+  Task t = { task, arg };
+  Worker* worker = m_workers[key % m_workers.size()];
+  pthread_mutex_lock(&worker->mutex);
+  worker->queue.push_back(t);
+  pthread_cond_signal(&worker->cond);
+  pthread_mutex_unlock(&worker->mutex);
+  return true;
+}
+
+void
+LinuxIoReactor::sync(uint32_t key)
+{
+  SyncPoint point;
+  pthread_mutex_init(&point.mutex, NULL);
+  pthread_cond_init(&point.cond, NULL);
+  point.done = false;
+
+  if (post(key, syncTask, &point))
+  {
+    pthread_mutex_lock(&point.mutex);
+    while (!point.done)
+    {
+      pthread_cond_wait(&point.cond, &point.mutex);
+    }
+    pthread_mutex_unlock(&point.mutex);
+  }
+
+  pthread_cond_destroy(&point.cond);
+  pthread_mutex_destroy(&point.mutex);
+}
+
+bool
+LinuxIoReactor::addEpollFd(int fd, uint32_t epollEvents)
+{
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events  = epollEvents;
+  ev.data.fd = fd;
+  return (0 == epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &ev));
+}
+
+/*! The handler is copied and run without the lock, so it may add or remove
+ *  sources itself. The dispatching handle lets the remove functions wait for
+ *  a handler running on the reactor thread.
+ */
+bool
+LinuxIoReactor::dispatch(std::map<int, Source>& sources, int handle,
+                         uint32_t events, int& dispatching)
+{
+  pthread_mutex_lock(&m_mutex);
+  std::map<int, Source>::iterator it = sources.find(handle);
+  if (it == sources.end())
+  {
+    pthread_mutex_unlock(&m_mutex);
+    return false;
+  }
+  Source source = it->second;
+  dispatching   = handle;
+  pthread_mutex_unlock(&m_mutex);
+
+  (*source.handler)(source.userData, events);
+
+  pthread_mutex_lock(&m_mutex);
+  dispatching = NO_HANDLE;
+  pthread_cond_broadcast(&m_dispatchCond);
+  pthread_mutex_unlock(&m_mutex);
+  return true;
+}
+
+//! Called with m_mutex held
+void
+LinuxIoReactor::waitDispatch(pthread_t thread, const int& dispatching,
+                             int handle)
+{
+  while (dispatching == handle && !pthread_equal(pthread_self(), thread))
+  {
+    pthread_cond_wait(&m_dispatchCond, &m_mutex);
+  }
+}
+
+bool
+LinuxIoReactor::isUsbFd(int fd)
+{
+  pthread_mutex_lock(&m_mutex);
+  bool found = (m_usbFds.find(fd) != m_usbFds.end());
+  pthread_mutex_unlock(&m_mutex);
+  return found;
+}
+
+int
+LinuxIoReactor::getEpollTimeout()
+{
+  int            timeoutMs = POLL_PERIOD_MS;
+  struct timeval tv;
+
+  pthread_mutex_lock(&m_mutex);
+  if (m_usbCtx && 1 == libusb_get_next_timeout(m_usbCtx, &tv))
+  {
+    int usbTimeoutMs = tv.tv_sec * 1000 + (tv.tv_usec + 999) / 1000;
+    timeoutMs = (usbTimeoutMs < timeoutMs) ? usbTimeoutMs : timeoutMs;
+  }
+  pthread_mutex_unlock(&m_mutex);
+  return timeoutMs;
+}
+
+void
+LinuxIoReactor::handleUsbEvents()
+{
+  pthread_mutex_lock(&m_mutex);
+  libusb_context* ctx = m_usbCtx;
+  if (!ctx)
+  {
+    pthread_mutex_unlock(&m_mutex);
+    return;
+  }
+  m_fdDispatching = USB_HANDLE;
+  pthread_mutex_unlock(&m_mutex);
+
+  /*! Only what is ready, the fds are already known to be readable */
+  struct timeval zero = { 0, 0 };
+  libusb_handle_events_timeout_completed(ctx, &zero, NULL);
+
+  pthread_mutex_lock(&m_mutex);
+  m_fdDispatching = NO_HANDLE;
+  pthread_cond_broadcast(&m_dispatchCond);
+  pthread_mutex_unlock(&m_mutex);
+}
+
+void
+LinuxIoReactor::epollThreadFunc()
+{
+  struct epoll_event events[MAX_EPOLL_EVENTS];
+
+  while (m_isRunning)
+  {
+    int n = epoll_wait(m_epollFd, events, MAX_EPOLL_EVENTS, getEpollTimeout());
+    if (n < 0)
+    {
+      if (errno != EINTR)
+      {
+        DERROR("IO reactor epoll_wait failed, errno = %d", errno);
+        usleep(POLL_PERIOD_MS * 1000);
+      }
+      continue;
+    }
+
+    /*! A timeout may be a libusb transfer timeout as well */
+    bool usbReady = (n == 0);
+    for (int i = 0; i < n; i++)
+    {
+      int fd = events[i].data.fd;
+      if (fd == m_wakeupFd)
+      {
+        uint64_t count;
+        while (read(m_wakeupFd, &count, sizeof(count)) > 0)
+        {
+        }
+        continue;
+      }
+      if (isUsbFd(fd))
+      {
+        usbReady = true;
+        continue;
+      }
+      uint32_t ev = (events[i].events & (EPOLLERR | EPOLLHUP))
+                      ? (uint32_t)IO_EVENT_ERR
+                      : (uint32_t)IO_EVENT_IN;
+      dispatch(m_fdSources, fd, ev, m_fdDispatching);
+    }
+
+    if (usbReady)
+    {
+      handleUsbEvents();
+    }
+  }
+}
+
+void
+LinuxIoReactor::udtThreadFunc()
+{
+  std::set<UDTSOCKET> readfds;
+
+  while (m_isRunning)
+  {
+    /*! Broken sockets are reported in readfds as well. A timeout is an
+     *  error in UDT, any other error would return at once, so back off.
+     */
+    if (UDT::ERROR ==
+        UDT::epoll_wait(m_udtEpollId, &readfds, NULL, POLL_PERIOD_MS))
+    {
+      if (UDT::getlasterror().getErrorCode() != CUDTException::ETIMEOUT)
+      {
+        usleep(POLL_PERIOD_MS * 1000);
+      }
+      continue;
+    }
+
+    for (std::set<UDTSOCKET>::iterator it = readfds.begin();
+         it != readfds.end() && m_isRunning; ++it)
+    {
+      UDTSTATUS status = UDT::getsockstate(*it);
+      uint32_t  ev     = (status == CONNECTED) ? (uint32_t)IO_EVENT_IN
+                                               : (uint32_t)IO_EVENT_ERR;
+      dispatch(m_udtSources, *it, ev, m_udtDispatching);
+    }
+  }
+}
+
+void
+LinuxIoReactor::workerThreadFunc(Worker* worker)
+{
+  pthread_mutex_lock(&worker->mutex);
+  while (worker->isRunning || !worker->queue.empty())
+  {
+    if (worker->queue.empty())
+    {
+      pthread_cond_wait(&worker->cond, &worker->mutex);
+      continue;
+    }
+
+    Task t = worker->queue.front();
+    worker->queue.pop_front();
+    pthread_mutex_unlock(&worker->mutex);
+
+    (*t.task)(t.arg);
+
+    pthread_mutex_lock(&worker->mutex);
+  }
+  pthread_mutex_unlock(&worker->mutex);
+}
+
+void*
+LinuxIoReactor::epollThreadEntry(void* p)
+{
+  static_cast<LinuxIoReactor*>(p)->epollThreadFunc();
+  return NULL;
+}
+
+void*
+LinuxIoReactor::udtThreadEntry(void* p)
+{
+  static_cast<LinuxIoReactor*>(p)->udtThreadFunc();
+  return NULL;
+}
+
+void*
+LinuxIoReactor::workerThreadEntry(void* p)
+{
+  Worker* worker = static_cast<Worker*>(p);
+  worker->owner->workerThreadFunc(worker);
+  return NULL;
+}
+
+void
+LinuxIoReactor::usbPollfdAdded(int fd, short events, void* userData)
+{
+  LinuxIoReactor* reactor = static_cast<LinuxIoReactor*>(userData);
+
+  uint32_t epollEvents = 0;
+  epollEvents |= (events & POLLIN) ? EPOLLIN : 0;
+  epollEvents |= (events & POLLOUT) ? EPOLLOUT : 0;
+
+  pthread_mutex_lock(&reactor->m_mutex);
+  if (!reactor->m_usbCtx || !reactor->m_usbFds.insert(fd).second)
+  {
+    pthread_mutex_unlock(&reactor->m_mutex);
+    return;
+  }
+  pthread_mutex_unlock(&reactor->m_mutex);
+
+  if (!reactor->addEpollFd(fd, epollEvents))
+  {
+    DERROR("Failed to watch libusb fd %d, errno = %d", fd, errno);
+  }
+}
+
+void
+LinuxIoReactor::usbPollfdRemoved(int fd, void* userData)
+{
+  LinuxIoReactor* reactor = static_cast<LinuxIoReactor*>(userData);
+
+  pthread_mutex_lock(&reactor->m_mutex);
+  bool found = (0 != reactor->m_usbFds.erase(fd));
+  pthread_mutex_unlock(&reactor->m_mutex);
+
+  if (found)
+  {
+    epoll_ctl(reactor->m_epollFd, EPOLL_CTL_DEL, fd, NULL);
+  }
+}
+
+void
+LinuxIoReactor::syncTask(void* arg)
+{
+  SyncPoint* point = static_cast<SyncPoint*>(arg);
+  pthread_mutex_lock(&point->mutex);
+  point->done = true;
+  pthread_cond_signal(&point->cond);
+  pthread_mutex_unlock(&point->mutex);
+}
@@ -23,12 +23,34 @@
 #include <iterator>
 
 #include "iostream"
+#include <unistd.h>
+#include <ctime>
+#include <new>
 
 using namespace DJI::OSDK;
 
 LinuxUSBDevice::LinuxUSBDevice() :
-  foundDJIDevice(false)
+  DJI_dev_handle(NULL),
+  foundDJIDevice(false),
+  lastReadRet(0),
+  usbContext(NULL),
+  asyncReady(false),
+  deviceGone(false),
+  rxTransferSize(0),
+  rxHead(0),
+  rxCount(0),
+  rxHeld(-1),
+  rxCompleted(0),
+  rxIdleCount(0),
+  rxHalted(false),
+  rxRetryTime(0),
+  txFreeCount(0),
+  txCompleted(0),
+  inFlight(0)
 {
+  pthread_mutex_init(&asyncMutex, NULL);
+  memset(rxSlots, 0, sizeof(rxSlots));
+  memset(txSlots, 0, sizeof(txSlots));
   DJI_usb_dev_filter[0].pid = 0x001F;  DJI_usb_dev_filter[0].vid = 0xFFF0;
   DJI_usb_dev_filter[1].pid = 0x0020;  DJI_usb_dev_filter[1].vid = 0xFFF0;
   DJI_usb_dev_filter[2].pid = 0xd008;  DJI_usb_dev_filter[2].vid = 0x18d1;
@@ -40,7 +62,16 @@ LinuxUSBDevice::LinuxUSBDevice() :
 LinuxUSBDevice::~LinuxUSBDevice()
 {
   // @todo maybe there's more steps
-  libusb_close(DJI_dev_handle);
+  stopAsync();
+  if (DJI_dev_handle)
+  {
+    libusb_close(DJI_dev_handle);
+  }
+  if (usbContext)
+  {
+    libusb_exit(usbContext);
+  }
+  pthread_mutex_destroy(&asyncMutex);
 }
 
 void
@@ -48,15 +79,18 @@ LinuxUSBDevice::init()
 {
   DSTATUS("Looking for USB device...\n");
 
-  libusb_context *ctx = NULL;
-  int ret = libusb_init(&ctx);
+  int ret = libusb_init(&usbContext);
   if(ret < 0) {
     DERROR("Failed to Initialized libusb session...\n");
+    usbContext = NULL;
     return;
   }
 
+  /*! The device has to belong to usbContext, whose events are handled for
+   *  the asynchronous transfers
+   */
   libusb_device **devs;
-  ret = libusb_get_device_list(NULL, &devs);
+  ret = libusb_get_device_list(usbContext, &devs);
   if(ret < 0) {
     DERROR("....Failed to get any USB Device\n");
     deviceStatus = false;
@@ -147,9 +181,57 @@ LinuxUSBDevice::isDJIUSBDevice(uint16_t idVendor, uint16_t idProduct)
   return false;
 }
 
-// @note libusb_bulk_transfer return sending result instead of sent length
+/*! Copied into a free slot of the transfer ring and submitted, so the
+ *  caller does not wait for the bus. It only waits when all the slots are
+ *  still in flight. Errors of the transfer itself can then only be logged.
+ */
 size_t
 LinuxUSBDevice::send(const uint8_t* buf, size_t len)
+{
+  if (!asyncReady || len > (size_t)TX_BUFFER_SIZE)
+  {
+    return sendSync(buf, len);
+  }
+
+  size_t  sent     = (size_t)-1;
+  time_ms deadline = getTimeStamp() + TIMEOUT;
+  pthread_mutex_lock(&asyncMutex);
+  //! Other completions wake the event handling as well
+  while (txFreeCount == 0)
+  {
+    time_ms now = getTimeStamp();
+    if (now >= deadline)
+    {
+      break;
+    }
+    txCompleted = 0;
+    handleEvents(&txCompleted, (int)(deadline - now));
+  }
+  if (txFreeCount > 0)
+  {
+    TransferSlot* slot = &txSlots[txFree[--txFreeCount]];
+    memcpy(slot->buffer, buf, len);
+    slot->transfer->length = (int)len;
+    if (submit(slot) == LIBUSB_SUCCESS)
+    {
+      sent = len;
+    }
+    else
+    {
+      txFree[txFreeCount++] = slot->index;
+    }
+  }
+  else
+  {
+    DERROR("LIBUSB send error, all %d transfers are pending", TRANSFER_NUM);
+  }
+  pthread_mutex_unlock(&asyncMutex);
+  return sent;
+}
+
+// @note libusb_bulk_transfer return sending result instead of sent length
+size_t
+LinuxUSBDevice::sendSync(const uint8_t* buf, size_t len)
 {
   static int retry_count = 0;
   int sent_len = 0, ret;
@@ -165,7 +247,7 @@ LinuxUSBDevice::send(const uint8_t* buf, size_t len)
       return -1;
     }
     DERROR("LIBUSB send error, retry %d times", ++retry_count);
-    send(buf, len);
+    sendSync(buf, len);
   }
   return (size_t)-1;
 }
@@ -173,17 +255,353 @@ LinuxUSBDevice::send(const uint8_t* buf, size_t len)
 size_t
 LinuxUSBDevice::readall(uint8_t* buf, size_t maxlen)
 {
-  int read_len = 0, ret;
-  ret = libusb_bulk_transfer(DJI_dev_handle, IN_END_PT,
-                             buf, maxlen, &read_len, TIMEOUT);
-  if (0 == ret)
-    return (size_t)read_len;
+  uint8_t* data = buf;
+  size_t   len  = readBuffer(&data, buf, maxlen);
+  if (len != (size_t)-1 && data != buf)
+  {
+    memcpy(buf, data, len);
+  }
+  return len;
+}
 
-  return (size_t)-1;
+/*! The ring is sized by the first call, the protocol always reads its
+ *  whole buffer. A smaller maxlen later on reads synchronously, since a
+ *  completed transfer might not fit.
+ */
+size_t
+LinuxUSBDevice::readBuffer(uint8_t** data, uint8_t* fallback, size_t maxlen)
+{
+  if (!asyncReady && rxTransferSize == 0)
+  {
+    rxTransferSize = maxlen;
+    startAsync(maxlen);
+  }
+
+  if (!asyncReady || maxlen < rxTransferSize)
+  {
+    int read_len = 0, ret;
+    ret = libusb_bulk_transfer(DJI_dev_handle, IN_END_PT,
+                               fallback, maxlen, &read_len, TIMEOUT);
+    lastReadRet = ret;
+    *data       = fallback;
+    if (0 == ret)
+      return (size_t)read_len;
+
+    return (size_t)-1;
+  }
+
+  size_t len = (size_t)-1;
+  pthread_mutex_lock(&asyncMutex);
+  //! The caller is done with the buffer handed out last time
+  if (rxHeld >= 0)
+  {
+    submitRx(&rxSlots[rxHeld]);
+    rxHeld = -1;
+  }
+  retryIdleRx();
+  if (rxCount == 0 && !deviceGone)
+  {
+    rxCompleted = 0;
+    handleEvents(&rxCompleted, TIMEOUT);
+  }
+  if (rxCount > 0)
+  {
+    rxHeld      = rxDone[rxHead];
+    rxHead      = (rxHead + 1) % TRANSFER_NUM;
+    rxCount--;
+    *data       = rxSlots[rxHeld].buffer;
+    len         = (size_t)rxSlots[rxHeld].transfer->actual_length;
+    lastReadRet = 0;
+  }
+  else
+  {
+    lastReadRet = deviceGone ? LIBUSB_ERROR_NO_DEVICE : LIBUSB_ERROR_TIMEOUT;
+  }
+  pthread_mutex_unlock(&asyncMutex);
+  return len;
+}
+
+/*! With the transfer ring this sleeps in libusb until an IN transfer
+ *  completes. Otherwise readall() already sleeps in libusb until the IN
+ *  transfer completes or times out, so there is nothing to wait for here.
+ *  Only when the last transfer failed for another reason (e.g. the device is
+ *  gone) back off for one timeout period, otherwise the reader would spin on
+ *  the error.
+ */
+bool
+LinuxUSBDevice::waitForData(int timeoutMs)
+{
+  if (asyncReady && !deviceGone)
+  {
+    pthread_mutex_lock(&asyncMutex);
+    retryIdleRx();
+    if (rxCount == 0)
+    {
+      rxCompleted = 0;
+      handleEvents(&rxCompleted, timeoutMs);
+    }
+    bool ready = (rxCount > 0);
+    pthread_mutex_unlock(&asyncMutex);
+    return ready;
+  }
+
+  if (lastReadRet == 0 || lastReadRet == LIBUSB_ERROR_TIMEOUT)
+  {
+    return true;
+  }
+  usleep(std::min(timeoutMs, (int)TIMEOUT) * 1000);
+  lastReadRet = 0;
+  return false;
+}
+
+libusb_context*
+LinuxUSBDevice::getContext()
+{
+  return usbContext;
+}
+
+bool
+LinuxUSBDevice::startAsync(size_t rxSize)
+{
+  if (!DJI_dev_handle || !usbContext)
+  {
+    return false;
+  }
+
+  //! Allocated once here, the transfers only reuse the buffers
+  for (int i = 0; i < TRANSFER_NUM; i++)
+  {
+    rxSlots[i].owner    = this;
+    rxSlots[i].index    = i;
+    rxSlots[i].transfer = libusb_alloc_transfer(0);
+    rxSlots[i].buffer   = new (std::nothrow) uint8_t[rxSize];
+    txSlots[i].owner    = this;
+    txSlots[i].index    = i;
+    txSlots[i].transfer = libusb_alloc_transfer(0);
+    txSlots[i].buffer   = new (std::nothrow) uint8_t[TX_BUFFER_SIZE];
+    if (!rxSlots[i].transfer || !rxSlots[i].buffer ||
+        !txSlots[i].transfer || !txSlots[i].buffer)
+    {
+      DERROR("Failed to allocate the USB transfer ring, reading synchronously");
+      freeAsync();
+      return false;
+    }
+    libusb_fill_bulk_transfer(rxSlots[i].transfer, DJI_dev_handle, IN_END_PT,
+                              rxSlots[i].buffer, (int)rxSize, rxCallback,
+                              &rxSlots[i], 0);
+    libusb_fill_bulk_transfer(txSlots[i].transfer, DJI_dev_handle, OUT_END_PT,
+                              txSlots[i].buffer, 0, txCallback, &txSlots[i],
+                              TIMEOUT * 3);
+    txFree[i] = i;
+  }
+
+  pthread_mutex_lock(&asyncMutex);
+  txFreeCount = TRANSFER_NUM;
+  asyncReady  = true;
+  for (int i = 0; i < TRANSFER_NUM; i++)
+  {
+    submitRx(&rxSlots[i]);
+  }
+  pthread_mutex_unlock(&asyncMutex);
+
+  DSTATUS("USB transfer ring started, %d x %u bytes in flight", TRANSFER_NUM,
+          (unsigned)rxSize);
+  return true;
+}
+
+void
+LinuxUSBDevice::stopAsync()
+{
+  if (!asyncReady)
+  {
+    return;
+  }
+
+  pthread_mutex_lock(&asyncMutex);
+  asyncReady = false;
+  for (int i = 0; i < TRANSFER_NUM; i++)
+  {
+    libusb_cancel_transfer(rxSlots[i].transfer);
+    libusb_cancel_transfer(txSlots[i].transfer);
+  }
+  //! The buffers can only go once libusb gave all the transfers back
+  while (inFlight > 0)
+  {
+    int done = 0;
+    handleEvents(&done, TIMEOUT);
+  }
+  pthread_mutex_unlock(&asyncMutex);
+
+  freeAsync();
+}
+
+void
+LinuxUSBDevice::freeAsync()
+{
+  for (int i = 0; i < TRANSFER_NUM; i++)
+  {
+    if (rxSlots[i].transfer)
+      libusb_free_transfer(rxSlots[i].transfer);
+    if (txSlots[i].transfer)
+      libusb_free_transfer(txSlots[i].transfer);
+    delete[] rxSlots[i].buffer;
+    delete[] txSlots[i].buffer;
+  }
+  memset(rxSlots, 0, sizeof(rxSlots));
+  memset(txSlots, 0, sizeof(txSlots));
+}
+
+//! Called with asyncMutex held, nothing goes out once stopAsync() started
+int
+LinuxUSBDevice::submit(TransferSlot* slot)
+{
+  if (!asyncReady)
+  {
+    return LIBUSB_ERROR_INTERRUPTED;
+  }
+  int ret = libusb_submit_transfer(slot->transfer);
+  if (ret != LIBUSB_SUCCESS)
+  {
+    DERROR("LIBUSB submit error %d", ret);
+    return ret;
+  }
+  inFlight++;
+  return ret;
+}
+
+/*! Called with asyncMutex held. Only a missing device is final, a slot
+ *  that could not be submitted otherwise waits for retryIdleRx().
+ */
+void
+LinuxUSBDevice::submitRx(TransferSlot* slot)
+{
+  int ret = submit(slot);
+  if (ret == LIBUSB_ERROR_NO_DEVICE)
+  {
+    deviceGone = true;
+  }
+  else if (ret != LIBUSB_SUCCESS && asyncReady)
+  {
+    rxIdle[rxIdleCount++] = slot->index;
+  }
+}
+
+/*! Called with asyncMutex held by the reader. The idle slots go back to the
+ *  bus once per TIMEOUT at most, so a persistent error does not spin.
+ */
+void
+LinuxUSBDevice::retryIdleRx()
+{
+  if (rxIdleCount == 0 || deviceGone || !asyncReady)
+  {
+    return;
+  }
+  time_ms now = getTimeStamp();
+  if (now - rxRetryTime < (time_ms)TIMEOUT)
+  {
+    return;
+  }
+  rxRetryTime = now;
+
+  if (rxHalted)
+  {
+    //! Synchronous, it handles events itself and the callbacks lock
+    rxHalted = false;
+    pthread_mutex_unlock(&asyncMutex);
+    libusb_clear_halt(DJI_dev_handle, IN_END_PT);
+    pthread_mutex_lock(&asyncMutex);
+  }
+
+  int idle[TRANSFER_NUM];
+  int idleCount = rxIdleCount;
+  memcpy(idle, rxIdle, sizeof(idle[0]) * idleCount);
+  rxIdleCount = 0;
+  for (int i = 0; i < idleCount; i++)
+  {
+    submitRx(&rxSlots[idle[i]]);
+  }
+}
+
+/*! Called with asyncMutex held, which is released while libusb handles the
+ *  events: the callbacks take it. Whichever thread waits (reader, sender or
+ *  an IO reactor) handles the completions of all the transfers.
+ */
+void
+LinuxUSBDevice::handleEvents(int* completed, int timeoutMs)
+{
+  struct timeval tv;
+  tv.tv_sec  = timeoutMs / 1000;
+  tv.tv_usec = (timeoutMs % 1000) * 1000;
+
+  pthread_mutex_unlock(&asyncMutex);
+  libusb_handle_events_timeout_completed(usbContext, &tv, completed);
+  pthread_mutex_lock(&asyncMutex);
+}
+
+void LIBUSB_CALL
+LinuxUSBDevice::rxCallback(libusb_transfer* transfer)
+{
+  TransferSlot*   slot = static_cast<TransferSlot*>(transfer->user_data);
+  LinuxUSBDevice* dev  = slot->owner;
+
+  pthread_mutex_lock(&dev->asyncMutex);
+  dev->inFlight--;
+  if (transfer->status == LIBUSB_TRANSFER_COMPLETED &&
+      transfer->actual_length > 0)
+  {
+    dev->rxDone[(dev->rxHead + dev->rxCount) % TRANSFER_NUM] = slot->index;
+    dev->rxCount++;
+  }
+  else if (transfer->status == LIBUSB_TRANSFER_COMPLETED)
+  {
+    //! Nothing to hand over, straight back to the bus
+    dev->submitRx(slot);
+  }
+  else if (transfer->status == LIBUSB_TRANSFER_NO_DEVICE)
+  {
+    DERROR("LIBUSB read error, the device is gone");
+    dev->deviceGone = true;
+  }
+  else if (transfer->status != LIBUSB_TRANSFER_CANCELLED)
+  {
+    //! Timeout, stall, overflow or a bus error: the reader retries the slot
+    DERROR("LIBUSB read error, transfer status %d", transfer->status);
+    if (transfer->status == LIBUSB_TRANSFER_STALL)
+    {
+      dev->rxHalted = true;
+    }
+    if (dev->asyncReady)
+    {
+      dev->rxIdle[dev->rxIdleCount++] = slot->index;
+    }
+  }
+  dev->rxCompleted = 1;
+  pthread_mutex_unlock(&dev->asyncMutex);
+}
+
+void LIBUSB_CALL
+LinuxUSBDevice::txCallback(libusb_transfer* transfer)
+{
+  TransferSlot*   slot = static_cast<TransferSlot*>(transfer->user_data);
+  LinuxUSBDevice* dev  = slot->owner;
+
+  pthread_mutex_lock(&dev->asyncMutex);
+  dev->inFlight--;
+  if (transfer->status != LIBUSB_TRANSFER_COMPLETED &&
+      transfer->status != LIBUSB_TRANSFER_CANCELLED)
+  {
+    DERROR("LIBUSB send error, transfer status %d", transfer->status);
+  }
+  dev->txFree[dev->txFreeCount++] = slot->index;
+  dev->txCompleted = 1;
+  pthread_mutex_unlock(&dev->asyncMutex);
 }
 
 time_ms
 LinuxUSBDevice::getTimeStamp()
 {
-  return (uint32_t)time(NULL);
+  //! Milliseconds like the other drivers, protocol timeouts compare it in ms
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (time_ms)((uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
 }
\ No newline at end of file
@@ -17,6 +17,8 @@
 #include "dji_protocol_base.hpp"
 #include "linux_usb_device.hpp"
 #include "dji_ack.hpp"
+#include "dji_perception.hpp"
+#include "dji_perception_frame.hpp"
 
 /*! Platform includes:
  *  This set of macros figures out which files to include based on your
@@ -86,6 +88,22 @@ public:
 
   int send(void *cmd, void *data, uint16_t data_len);
 
+  /*************************** Frame Observer ******************************/
+public:
+  /*! @brief Hand the received stereo images to cb in pooled buffers instead
+   *  of copying them to the ACK staging structs. The receive buffer itself
+   *  is handed over, so the images are not copied at all.
+   *  @note Frames with a disparity image still go through the legacy path.
+   *  @param cb observer of the images, NULL to go back to the legacy path
+   *  @param userData passed to cb
+   */
+  void setFrameObserver(Perception::PerceptionImageFrameCB cb, void *userData);
+
+  //! Frames dropped because all the pooled buffers are retained by the user
+  uint32_t getDroppedFrameCount();
+
+  static const int FRAME_POOL_NUM = 4;
+
 private:
   int sendInterface(void *in_cmd_container);
 
@@ -117,6 +135,20 @@ private:
   //! A lot of ACK parsing logic
   bool appHandler(void *protocolHeader);
 
+  //! step 8 with a frame observer, return true if the frame is consumed
+  bool deliverFrame();
+
+  void dispatchStereoImgFrame(PerceptionFrameBuffer *frame,
+                              Perception::PerceptionImageFrameCB cb,
+                              void *userData);
+
+  void dispatchStereoVGAFrame(PerceptionFrameBuffer *frame,
+                              Perception::PerceptionImageFrameCB cb,
+                              void *userData);
+
+  //! Receive into the default buffer again once the observer is removed
+  void restoreRecvBuffer();
+
   /********************************** CRC **********************************/
 private:
   int crcHeadCheck(uint8_t* pMsg, size_t nLen);
@@ -128,6 +160,14 @@ private:
   ACK::StereoImgData      *stereoImgData;
   ACK::StereoVGAImgData   *stereoVGAImgData;
 
+  PerceptionFramePool                *framePool;
+  //! pooled buffer p_filter->recvBuf points to, NULL for defaultRecvBuf
+  PerceptionFrameBuffer              *recvFrameBuffer;
+  uint8_t                            *defaultRecvBuf;
+  Perception::PerceptionImageFrameCB  frameObserverCb;
+  void                               *frameObserverUserData;
+  uint32_t                            droppedFrameCount;
+
 }; // class AdvancedSensingProtocol
 
 } // namespace OSDK
@@ -61,6 +61,12 @@ typedef struct AdvancedSensingCmdContainer {
 AdvancedSensingProtocol::AdvancedSensingProtocol()
   : stereoImgData(NULL)
   , stereoVGAImgData(NULL)
+  , framePool(NULL)
+  , recvFrameBuffer(NULL)
+  , defaultRecvBuf(NULL)
+  , frameObserverCb(NULL)
+  , frameObserverUserData(NULL)
+  , droppedFrameCount(0)
 {
   //! Step 1: Initialize Hardware Driver
   this->deviceDriver = new LinuxUSBDevice();
@@ -86,6 +92,15 @@ AdvancedSensingProtocol::~AdvancedSensingProtocol()
   if (this->stereoVGAImgData)
     delete this->stereoVGAImgData;
 
+  if (this->recvFrameBuffer)
+  {
+    this->recvFrameBuffer->release();
+    this->p_filter->recvBuf = this->defaultRecvBuf;
+  }
+
+  if (this->framePool)
+    delete this->framePool;
+
   if (this->p_filter)
     delete this->p_filter;
 }
@@ -104,6 +119,7 @@ AdvancedSensingProtocol::init(HardDriver* Driver, MMU* mmuPtr, bool userCallback
   p_filter->reuseIndex  = 0;
   p_filter->encode      = 0;
   p_filter->recvBuf     = new uint8_t[MAX_RECV_LEN];
+  defaultRecvBuf        = p_filter->recvBuf;
 
   BUFFER_SIZE = 1024*600;
 
@@ -281,10 +297,14 @@ AdvancedSensingProtocol::verifyData()
 bool
 AdvancedSensingProtocol::callApp()
 {
+  if (deliverFrame())
+  {
+    return false;
+  }
 
   bool isFrame = appHandler((void *) p_filter->recvBuf);
   prepareDataStream();
-
+  restoreRecvBuffer();
 
   return isFrame;
 }
@@ -389,6 +409,257 @@ AdvancedSensingProtocol::appHandler(void *protocolHeader)
   return isFrame;
 }
 
+/******************** Frame Observer **********************/
+
+void
+AdvancedSensingProtocol::setFrameObserver(Perception::PerceptionImageFrameCB cb,
+                                          void *userData)
+{
+  threadHandle->lockRecvContainer();
+  if (cb && !framePool)
+  {
+    framePool = new PerceptionFramePool(FRAME_POOL_NUM, MAX_RECV_LEN);
+  }
+  frameObserverCb       = cb;
+  frameObserverUserData = userData;
+  threadHandle->freeRecvContainer();
+}
+
+uint32_t
+AdvancedSensingProtocol::getDroppedFrameCount()
+{
+  threadHandle->lockRecvContainer();
+  uint32_t count = droppedFrameCount;
+  threadHandle->freeRecvContainer();
+  return count;
+}
+
+bool
+AdvancedSensingProtocol::deliverFrame()
+{
+  threadHandle->lockRecvContainer();
+  Perception::PerceptionImageFrameCB cb = frameObserverCb;
+  void *userData = frameObserverUserData;
+  threadHandle->freeRecvContainer();
+
+  if (!cb)
+  {
+    return false;
+  }
+
+  AdvancedSensingHeader header;
+  memcpy(&header, p_filter->recvBuf, sizeof(AdvancedSensingHeader));
+
+  if (header.cmd_id == AdvancedSensingProtocol::PROCESS_IMG_CMD_ID)
+  {
+    uint32_t img_desc[CAMERA_PAIR_NUM][IMAGE_TYPE_NUM];
+    memcpy(&img_desc,
+           &p_filter->recvBuf[sizeof(AdvancedSensingHeader)+header.length-sizeof(img_desc)],
+           sizeof(img_desc));
+    if (img_desc[AdvancedSensingProtocol::FRONT][AdvancedSensingProtocol::DISPARITY])
+    {
+      return false;
+    }
+  }
+  else if (header.cmd_id != AdvancedSensingProtocol::PROCESS_VGA_CMD_ID)
+  {
+    return false;
+  }
+
+  //! @note the receive buffer holding this frame is handed to the observer
+  //! and a free pooled buffer takes its place, like prepareDataStream the
+  //! last HEADER_LEN - 1 bytes are carried over
+  PerceptionFrameBuffer *frame = recvFrameBuffer;
+  PerceptionFrameBuffer *next  = framePool->acquire();
+  if (next && !frame)
+  {
+    //! still receiving into the default buffer, copy this frame once
+    frame = framePool->acquire();
+    if (frame)
+    {
+      memcpy(frame->data(), p_filter->recvBuf, p_filter->recvIndex);
+    }
+  }
+  if (!next || !frame)
+  {
+    if (next)
+    {
+      next->release();
+    }
+    droppedFrameCount++;
+    prepareDataStream();
+    return true;
+  }
+
+  uint32_t bytes_to_move = HEADER_LEN - 1;
+  memcpy(next->data(), p_filter->recvBuf + p_filter->recvIndex - bytes_to_move,
+         bytes_to_move);
+  p_filter->recvBuf   = next->data();
+  p_filter->recvIndex = bytes_to_move;
+  recvFrameBuffer     = next;
+
+  if (header.cmd_id == AdvancedSensingProtocol::PROCESS_IMG_CMD_ID)
+  {
+    dispatchStereoImgFrame(frame, cb, userData);
+  }
+  else
+  {
+    dispatchStereoVGAFrame(frame, cb, userData);
+  }
+  frame->release();
+
+  return true;
+}
+
+void
+AdvancedSensingProtocol::dispatchStereoImgFrame(PerceptionFrameBuffer *frame,
+                                                Perception::PerceptionImageFrameCB cb,
+                                                void *userData)
+{
+  uint8_t *data_buf = frame->data();
+
+  AdvancedSensingHeader header;
+  memcpy(&header, &data_buf[0], sizeof(AdvancedSensingHeader));
+
+  uint32_t img_desc[CAMERA_PAIR_NUM][IMAGE_TYPE_NUM];
+  memcpy(&img_desc,
+         &data_buf[sizeof(AdvancedSensingHeader)+header.length-sizeof(img_desc)],
+         sizeof(img_desc));
+
+  //! frame index and time stamp follow the images
+  int num_imgs = 0;
+  for (int pair_idx = 0; pair_idx < CAMERA_PAIR_NUM; ++pair_idx)
+    for (int dir_idx = 0; dir_idx < IMAGE_TYPE_NUM; ++dir_idx)
+      if (img_desc[pair_idx][dir_idx])
+        num_imgs++;
+
+  int frame_index = 0;
+  int time_stamp  = 0;
+  int meta_offset = sizeof(AdvancedSensingHeader) + num_imgs*ACK::IMG_240P_SIZE;
+  memcpy(&frame_index, data_buf+meta_offset, sizeof(int));
+  memcpy(&time_stamp, data_buf+meta_offset+sizeof(int), sizeof(int));
+
+  int mem_location_offset = sizeof(AdvancedSensingHeader);
+  for (int pair_idx = 0; pair_idx < CAMERA_PAIR_NUM; ++pair_idx) {
+    for (int dir_idx = 0; dir_idx < IMAGE_TYPE_NUM; ++dir_idx) {
+      if (!img_desc[pair_idx][dir_idx])
+        continue;
+
+      Perception::PerceptionImageFrame image;
+      memset(&image.info, 0, sizeof(image.info));
+      image.info.rawInfo.width  = 320;
+      image.info.rawInfo.height = 240;
+      image.info.rawInfo.index  = frame_index;
+      image.info.sequence       = frame_index;
+      image.info.timeStamp      = time_stamp;
+      image.image               = data_buf + mem_location_offset;
+      image.imageLen            = ACK::IMG_240P_SIZE;
+      image.buffer              = frame;
+      mem_location_offset += ACK::IMG_240P_SIZE;
+
+      if (pair_idx == AdvancedSensingProtocol::FRONT &&
+          dir_idx == AdvancedSensingProtocol::LEFT)
+      {
+        image.info.dataType          = Perception::RAW_FRONT_LEFT;
+        image.info.rawInfo.direction = Perception::RECTIFY_FRONT;
+      }
+      else if (pair_idx == AdvancedSensingProtocol::FRONT &&
+               dir_idx == AdvancedSensingProtocol::RIGHT)
+      {
+        image.info.dataType          = Perception::RAW_FRONT_RIGHT;
+        image.info.rawInfo.direction = Perception::RECTIFY_FRONT;
+      }
+      else if (pair_idx == AdvancedSensingProtocol::DOWN &&
+               dir_idx == AdvancedSensingProtocol::LEFT)
+      {
+        image.info.dataType          = Perception::RAW_DOWN_BACK;
+        image.info.rawInfo.direction = Perception::RECTIFY_DOWN;
+      }
+      else if (pair_idx == AdvancedSensingProtocol::DOWN &&
+               dir_idx == AdvancedSensingProtocol::RIGHT)
+      {
+        image.info.dataType          = Perception::RAW_DOWN_FRONT;
+        image.info.rawInfo.direction = Perception::RECTIFY_DOWN;
+      }
+      else
+      {
+        continue;
+      }
+
+      cb(image, userData);
+    }
+  }
+}
+
+void
+AdvancedSensingProtocol::dispatchStereoVGAFrame(PerceptionFrameBuffer *frame,
+                                                Perception::PerceptionImageFrameCB cb,
+                                                void *userData)
+{
+  uint8_t *data_buf = frame->data();
+
+  AdvancedSensingHeader header;
+  memcpy(&header, &data_buf[0], sizeof(AdvancedSensingHeader));
+
+  VGADescription desc;
+  memcpy(&desc, &data_buf[sizeof(AdvancedSensingHeader)+header.length-sizeof(VGADescription)],
+         sizeof(VGADescription));
+
+  Perception::DirectionType direction;
+  Perception::CamPositionType leftType;
+  Perception::CamPositionType rightType;
+  if (desc.direction == AdvancedSensingProtocol::FRONT)
+  {
+    direction = Perception::RECTIFY_FRONT;
+    leftType  = Perception::RAW_FRONT_LEFT;
+    rightType = Perception::RAW_FRONT_RIGHT;
+  }
+  else if (desc.direction == AdvancedSensingProtocol::DOWN)
+  {
+    direction = Perception::RECTIFY_DOWN;
+    leftType  = Perception::RAW_DOWN_BACK;
+    rightType = Perception::RAW_DOWN_FRONT;
+  }
+  else
+  {
+    DSTATUS("Get unknown stereo VGA images flow");
+    return;
+  }
+
+  for (int i = 0; i < 2; ++i)
+  {
+    Perception::PerceptionImageFrame image;
+    memset(&image.info, 0, sizeof(image.info));
+    image.info.rawInfo.width     = 640;
+    image.info.rawInfo.height    = 480;
+    image.info.rawInfo.index     = desc.index;
+    image.info.rawInfo.direction = direction;
+    image.info.dataType          = (i == 0) ? leftType : rightType;
+    image.info.sequence          = desc.index;
+    image.info.timeStamp         = desc.time_stamp;
+    image.image    = data_buf + sizeof(AdvancedSensingHeader) + i*ACK::IMG_VGA_SIZE;
+    image.imageLen = ACK::IMG_VGA_SIZE;
+    image.buffer   = frame;
+
+    cb(image, userData);
+  }
+}
+
+void
+AdvancedSensingProtocol::restoreRecvBuffer()
+{
+  if (!recvFrameBuffer || frameObserverCb)
+  {
+    return;
+  }
+
+  uint32_t bytes_to_move = p_filter->recvIndex;
+  memcpy(defaultRecvBuf, p_filter->recvBuf, bytes_to_move);
+  p_filter->recvBuf = defaultRecvBuf;
+  recvFrameBuffer->release();
+  recvFrameBuffer = NULL;
+}
+
 int
 AdvancedSensingProtocol::crcHeadCheck(uint8_t* pMsg, size_t nLen)
 {
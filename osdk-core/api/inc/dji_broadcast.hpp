@@ -32,6 +32,7 @@
 
 #include "dji_telemetry.hpp"
 #include "dji_vehicle_callback.hpp"
+#include "dji_fc_time_sync.hpp"
 
 namespace DJI
 {
@@ -133,6 +134,15 @@ public:
    */
   Telemetry::SyncStamp    getSyncStamp()          ;
 
+  /*! Get the mapping between the FC clock and the local monotonic clock
+   *
+   *  @platforms M210V2, M300
+   *  @note Fed by the timestamp of every broadcast package, so the time
+   *  topic has to be enabled in the broadcast frequency.
+   *  @return FCTimeSync converting FC timestamps to DJI_GET_TIME_NS time
+   */
+  FCTimeSync&             getFCTimeSync()         ;
+
   /*! Get quaternion data from local cache
    *
    *  @platforms M210V2, M300
@@ -486,6 +496,8 @@ private:
   uint16_t passFlag;
   uint16_t broadcastLength;
 
+  FCTimeSync fcTimeSync;
+
   T_OsdkMutexHandle m_msgLock;
   void lockMSG();
   void freeMSG();
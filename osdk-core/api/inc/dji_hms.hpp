@@ -31,6 +31,7 @@
 #define ONBOARDSDK_DJI_HMS_H
 
 #include "dji_type.hpp"
+#include <string>
 #include <vector>
 
 
@@ -66,6 +67,41 @@ typedef struct HMSPushPacket
     uint32_t     timeStamp;   /*! timestamp of the packet*/
 } HMSPushPacket;
 
+/*! the state of one active fault, a fault is identified by
+ *  (alarmId, sensorIndex, componentIndex)*/
+typedef struct HMSFaultState
+{
+    uint32_t alarmId;        /*! error code*/
+    uint8_t  sensorIndex;    /*! fault sensor's index*/
+    uint8_t  componentIndex; /*! camera or gimbal index, InvalidIndex for other devices*/
+    uint8_t  reportLevel;    /*! fault level, 1-4, 4 is highest*/
+    uint32_t firstSeen;      /*! timestamp of the push which raised the fault*/
+    uint32_t lastSeen;       /*! timestamp of the last push reporting the fault*/
+} HMSFaultState;
+
+typedef enum
+{
+    HMSFaultRaised  = 0, /*! the fault was not active*/
+    HMSFaultCleared = 1, /*! the fault was not reported in the last push cycle*/
+    HMSFaultChanged = 2, /*! the report level of an active fault changed*/
+} HMSFaultEventType;
+
+/*! the type of a change of the active fault set*/
+typedef struct HMSFaultEvent
+{
+    HMSFaultEventType type;
+    HMSFaultState     fault;             /*! state after the change, the last state if cleared*/
+    uint8_t           lastReportLevel;   /*! level before the change, 0 if raised*/
+    uint32_t          timeStamp;         /*! timestamp of the push causing the change, of the last push if
+                                          *  cleared by unsubscribing*/
+} HMSFaultEvent;
+
+/*! @brief Called on the receive thread with the changes caused by one push,
+ *  in the order they happened. The events are only valid during the call.
+ */
+typedef void (*HMSFaultEventCallback)(const HMSFaultEvent *events, uint32_t eventNum,
+                                      void *userData);
+
 typedef enum
 {
     CameraIndex1 = 1,
@@ -150,6 +186,31 @@ public:
    */
     uint8_t  getDeviceIndex();
 
+  /*! @brief Subscribe the changes of the active fault set. Instead of diffing
+   *  the pushing data, the callback only gets the raised, cleared and changed
+   *  faults.
+   *
+   *  @platforms M300
+   *  @param callback called with the events of each push changing the set
+   *  @param userData passed back to the callback
+   *  @return bool false if already subscribed or too many subscribers
+   *
+   *  @note A fault is cleared when a push cycle (up to the pack with msgEnd)
+   *  of the device which reported it no longer contains it. Unsubscribing
+   *  HMS's information with subscribeHMSInf clears all the active faults.
+   */
+    bool subscribeFaultEvent(HMSFaultEventCallback callback, void *userData);
+
+    bool unsubscribeFaultEvent(HMSFaultEventCallback callback, void *userData);
+
+  /*! @brief The interface of getting the active faults
+   *
+   *  @platforms M300
+   *  @return std::vector<HMSFaultState> the faults reported in the current
+   *  push cycles, sorted by alarmId, sensorIndex and componentIndex
+   */
+    std::vector<HMSFaultState> getActiveFaults();
+
 private:
     Vehicle *vehicle;
     DJIHMSImpl *djiHMSImpl;
@@ -34,6 +34,7 @@
 #include <string>
 #include "dji_type.hpp"
 #include "dji_hms.hpp"
+#include "dji_hms_state_tracker.hpp"
 #include "dji_telemetry.hpp"
 
 namespace  DJI{
@@ -82,6 +83,18 @@ public:
     void setHMSTimeStamp();
     void setDeviceIndex(uint8_t sender);
 
+  /*! @brief Update the active faults with one push and call the fault
+   *  event subscribers with the changes, outside of the HMS info lock.
+   */
+    void trackHMSPushData(uint8_t sender, const uint8_t *hmsPushData, uint16_t dataLen);
+
+  /*! @brief Clear the active faults and notify the subscribers*/
+    void resetFaultState();
+
+    bool subscribeFaultEvent(HMSFaultEventCallback callback, void *userData);
+    bool unsubscribeFaultEvent(HMSFaultEventCallback callback, void *userData);
+    std::vector<HMSFaultState> getActiveFaults();
+
     bool createHMSInfoLock();
     bool lockHMSInfo();
     bool freeHMSInfo();
@@ -93,6 +106,21 @@ private:
 
     T_OsdkMutexHandle m_hmsLock;
 
+    typedef struct FaultEventSubscriber {
+        HMSFaultEventCallback callback;
+        void                 *userData;
+    } FaultEventSubscriber;
+
+    static const uint32_t MAX_FAULT_EVENT_SUBSCRIBER_NUM = 8;
+
+    HMSStateTracker      stateTracker;
+    /*! only used on the receive thread, kept to reuse its storage*/
+    std::vector<HMSFaultEvent> faultEvents;
+    FaultEventSubscriber faultEventSubscribers[MAX_FAULT_EVENT_SUBSCRIBER_NUM];
+    uint32_t             faultEventSubscriberNum;
+
+    void notifyFaultEvents();
+
     /*! @brief get camera(payload)'s or gimbal's index(same with deviceindex) by sender
      *
      *  @platforms M300
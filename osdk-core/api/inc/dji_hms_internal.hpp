@@ -30,6 +30,7 @@
 #define ONBOARDSDK_DJI_HMS_INTERNAL_HPP
 #include "dji_type.hpp"
 #include <iostream>
+#include <string>
 using namespace std;
 
 namespace DJI{
@@ -45,8 +46,36 @@ typedef struct HMSErrCodeInfo {
 /*! the length of HMS's error code table*/
 const uint32_t dbHMSErrNum = 600;
 
+/*! the buffer length enough for any formatted alarm information*/
+const uint32_t hmsAlarmInfoMaxLen = 256;
+
+/*! the alarm information of one error code, with the identified strs
+ *  (%alarmid, %index, %component_index) compiled into one byte markers*/
+typedef struct HMSErrCodeTemplate {
+    uint32_t alarmId;            /*! error code*/
+    std::string groundAlarmFmt;  /*! alarm template when the flight is on the ground*/
+    std::string flyAlarmFmt;     /*! alarm template when the flight is in the air*/
+} HMSErrCodeTemplate;
+
 extern void encodeSender(const uint8_t sender,uint8_t & deviceType, uint8_t & deviceIndex);
 extern bool replaceStr(string &str, const string oldReplaceStr, const string newReplaceStr);
+
+/*! @brief Find the template of an error code. hmsErrCodeInfoTbl is compiled
+ *  into an index sorted by alarmId on the first call.
+ *
+ *  @return the template, NULL if the error code is not in the table
+ */
+extern const HMSErrCodeTemplate *findHMSErrCodeTemplate(uint32_t alarmId);
+
+/*! @brief Format an alarm template in one pass, every identified str is
+ *  replaced with the real data.
+ *
+ *  @param buf output buffer, always null terminated, truncated if too short
+ *  @return the length of the formatted information
+ */
+extern uint32_t formatHMSAlarmInfo(const std::string &alarmFmt, uint32_t alarmId,
+                                   uint8_t sensorIndex, uint8_t componentIndex,
+                                   char *buf, uint32_t bufLen);
  }
   }
 #endif //ONBOARDSDK_DJI_HMS_INTERNAL_HPP
\ No newline at end of file
@@ -0,0 +1,107 @@
+/** @file dji_hms_state_tracker.hpp
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ *  @brief Incremental tracking of HMS(Health Management System)'s active faults
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef ONBOARDSDK_DJI_HMS_STATE_TRACKER_HPP
+#define ONBOARDSDK_DJI_HMS_STATE_TRACKER_HPP
+
+#include <map>
+#include <vector>
+#include "dji_hms.hpp"
+
+namespace DJI{
+namespace OSDK{
+
+/*! @brief Active fault set built from HMS's raw pushing data
+ *
+ *  @details Each device pushes its error list in cycles split into packs,
+ *  the last pack of a cycle has msgEnd set. The faults of a pack are raised
+ *  or changed as soon as it arrives, the faults of the device not reported
+ *  in the whole cycle are cleared at its last pack. A lost last pack only
+ *  merges two cycles, so it delays the clearing without false events.
+ *
+ *  The tracker has no lock and no clock, the timestamps come with the
+ *  data: recorded pushes replayed through update() give the same events.
+ */
+class HMSStateTracker {
+public:
+    HMSStateTracker();
+    ~HMSStateTracker();
+
+  /*! @brief Apply one push of HMS's raw data
+   *
+   *  @param sender sender of the push, devices are tracked separately
+   *  @param componentIndex camera or gimbal index of the sender
+   *  @param hmsPushData raw pushing data, as received
+   *  @param timeStamp time of the push
+   *  @param events the changes are appended to it
+   *  @return bool false if the data is malformed, it is then ignored
+   */
+    bool update(uint8_t sender, uint8_t componentIndex, const uint8_t *hmsPushData,
+                uint16_t dataLen, uint32_t timeStamp, std::vector<HMSFaultEvent> &events);
+
+  /*! @brief Clear all the active faults, e.g. when the pushing stops
+   *
+   *  @param events a cleared event for each fault is appended to it
+   */
+    void reset(uint32_t timeStamp, std::vector<HMSFaultEvent> &events);
+
+    void getActiveFaults(std::vector<HMSFaultState> &faults) const;
+
+    uint32_t getActiveFaultNum() const;
+
+private:
+    typedef struct ActiveFault {
+        HMSFaultState state;
+        uint8_t       sender;    /*! device which reported it last*/
+        uint32_t      seenCycle; /*! cycle of the sender it was reported in*/
+    } ActiveFault;
+
+    /*! (alarmId, sensorIndex, componentIndex) packed, so the faults are
+     *  ordered by alarmId first*/
+    typedef uint64_t FaultKey;
+    typedef std::map<FaultKey, ActiveFault> FaultMap;
+
+    static const uint32_t HEADER_LEN = 3;
+    static const uint32_t SENDER_NUM = 256;
+
+    static FaultKey makeFaultKey(uint32_t alarmId, uint8_t sensorIndex,
+                                 uint8_t componentIndex);
+    static void addEvent(HMSFaultEventType type, const HMSFaultState &fault,
+                         uint8_t lastReportLevel, uint32_t timeStamp,
+                         std::vector<HMSFaultEvent> &events);
+
+    void endCycle(uint8_t sender, uint32_t timeStamp, std::vector<HMSFaultEvent> &events);
+
+    FaultMap activeFaults;
+    /*! current push cycle of each sender*/
+    uint32_t senderCycle[SENDER_NUM];
+};
+    }// OSDK
+} //DJI
+
+#endif //ONBOARDSDK_DJI_HMS_STATE_TRACKER_HPP
@@ -130,6 +130,12 @@ DataBroadcast::getSyncStamp()
   return data;
 }
 
+FCTimeSync&
+DataBroadcast::getFCTimeSync()
+{
+  return fcTimeSync;
+}
+
 Telemetry::Quaternion
 DataBroadcast::getQuaternion()
 {
@@ -425,6 +431,8 @@ void
 DataBroadcast::unpackData(RecvContainer* pRecvFrame)
 {
   uint8_t* pdata = pRecvFrame->recvData.raw_ack_array;
+  uint64_t recvNs = 0;
+  Platform::instance().getTimeNs(&recvNs);
   lockMSG();
   passFlag = *(uint16_t*)pdata;
   pdata += sizeof(uint16_t);
@@ -448,6 +456,11 @@ DataBroadcast::unpackData(RecvContainer* pRecvFrame)
   unpackOne(FLAG_DEVICE      ,&info      ,pdata,sizeof(info      ));
   unpackOne(FLAG_COMPASS     ,&compass   ,pdata,sizeof(compass   ));
   // clang-format on
+  if (passFlag & FLAG_TIME)
+  {
+    fcTimeSync.update(
+      FCTimeSync::fromTimeStamp(timeStamp.time_ms, timeStamp.time_ns), recvNs);
+  }
   freeMSG();
 }
 
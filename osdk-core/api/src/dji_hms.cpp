@@ -43,13 +43,6 @@ using namespace DJI;
 using namespace DJI::OSDK;
 using namespace DJI::OSDK::Telemetry;
 
-namespace DJI{
-    namespace OSDK{
-        extern HMSErrCodeInfo hmsErrCodeInfoTbl[dbHMSErrNum];
-        extern bool replaceStr(string &str, const string oldReplaceStr, const string newReplaceStr);
-    }
-}
-
 /*! @brief Compare HMS's pushing error code with the error code in the error code table,
 * and print the prompt message.
 *
@@ -59,15 +52,11 @@ namespace DJI{
 *  @return bool pointer and status of subcribing flight check
 *
 *  @note Each error code will print different prompt information according to different states of the aircraft
-*  (ground or air)
+*  (ground or air). The error codes are looked up in the sorted index of the table, the identified strs
+*  (%alarmid, %index, %component_index) are replaced when the message is formatted.
 */
 static bool MarchErrCodeInfoTbl(DJIHMSImpl * djiHMSImpl, HMSPushData *hmsPushData);
 
-/*! In hmsErrCodeInfoTbl's alarmInfo,we need to replace some identified str with real data.
- *  for example, %alarmid <-> 0x1a010040 , %index <-> 1, %component_index <-> 1*/
-static void replaceHMSIdentifyStr(string &alarmInfo, uint32_t alarmId, uint8_t sensorIndex,
-                                  uint8_t componentIndex);
-
 static E_OsdkStat HMSRecvDataCallBack(struct _CommandHandle *cmdHandle,
                                       const T_CmdInfo *cmdInfo,
                                       const uint8_t *cmdData, void *userData);
@@ -119,6 +108,7 @@ DJIHMS::subscribeHMSInf(bool enable, uint32_t timeOutMs) {
         else
         {
             this->enableListeningHmsData(false);
+            djiHMSImpl->resetFaultState();
             DSTATUS("Unsubscribe all flight data success!");
         }
         return true;
@@ -149,6 +139,21 @@ uint8_t DJIHMS::getDeviceIndex()
     return data;
 }
 
+bool DJIHMS::subscribeFaultEvent(HMSFaultEventCallback callback, void *userData)
+{
+    return djiHMSImpl->subscribeFaultEvent(callback, userData);
+}
+
+bool DJIHMS::unsubscribeFaultEvent(HMSFaultEventCallback callback, void *userData)
+{
+    return djiHMSImpl->unsubscribeFaultEvent(callback, userData);
+}
+
+std::vector<HMSFaultState> DJIHMS::getActiveFaults()
+{
+    return djiHMSImpl->getActiveFaults();
+}
+
 bool DJIHMS::enableListeningHmsData(bool enable) {
     static T_RecvCmdHandle recvCmdHandle;
     static T_RecvCmdItem recvCmdItem;
@@ -188,6 +193,7 @@ static E_OsdkStat HMSRecvDataCallBack(struct _CommandHandle *cmdHandle,
     djiHMSImpl->setHMSPushData(cmdData, cmdInfo->dataLen);
     djiHMSImpl->setHMSTimeStamp();
     djiHMSImpl->freeHMSInfo();
+    djiHMSImpl->trackHMSPushData(cmdInfo->sender, cmdData, cmdInfo->dataLen);
     MarchErrCodeInfoTbl(djiHMSImpl, &(djiHMSImpl->getHMSPushPacket().hmsPushData));
 
     return OSDK_STAT_OK;
@@ -199,66 +205,36 @@ static bool MarchErrCodeInfoTbl(DJIHMSImpl *djiHMSImpl, HMSPushData *hmsPushData
         DSTATUS("HMS Push Data is nullptr!");
         return false;
     }
-    OsdkOsal_TaskSleepMs(200);
 
-    for (int i = 0; i < hmsPushData->errList.size(); i++)
+    if (hmsPushData->errList.empty())
     {
-        for (int j = 0; j < sizeof(DJI::OSDK::hmsErrCodeInfoTbl) / sizeof(HMSErrCodeInfo); j++)
+        return true;
+    }
+
+    bool inAir = (djiHMSImpl->vehicle->subscribe->getValue<TOPIC_STATUS_FLIGHT>() ==
+                  VehicleStatus::FlightStatus::IN_AIR);
+    uint32_t timeStamp = djiHMSImpl->getHMSPushPacket().timeStamp;
+    uint8_t componentIndex = djiHMSImpl->getDeviceIndex();
+    char alarmInfo[hmsAlarmInfoMaxLen];
+
+    for (uint32_t i = 0; i < hmsPushData->errList.size(); i++)
+    {
+        const ErrList &err = hmsPushData->errList[i];
+        const HMSErrCodeTemplate *errCodeTemplate = findHMSErrCodeTemplate(err.alarmID);
+        if (!errCodeTemplate)
         {
-            if (hmsPushData->errList[i].alarmID == DJI::OSDK::hmsErrCodeInfoTbl[j].alarmId)
-            {
-                switch (djiHMSImpl->vehicle->subscribe->getValue<TOPIC_STATUS_FLIGHT>())
-                {
-                    case VehicleStatus::FlightStatus::IN_AIR:
-                    {
-                        if (DJI::OSDK::hmsErrCodeInfoTbl[j].flyAlarmInfo != "")
-                        {
-                            replaceHMSIdentifyStr(DJI::OSDK::hmsErrCodeInfoTbl[j].flyAlarmInfo,
-                                                  hmsPushData->errList[i].alarmID,
-                                                  hmsPushData->errList[i].sensorIndex,
-                                                  djiHMSImpl->getDeviceIndex());
-                            DSTATUS("TimeStamp: %ld.Info: %s\n", djiHMSImpl->getHMSPushPacket().timeStamp,
-                                    DJI::OSDK::hmsErrCodeInfoTbl[j].flyAlarmInfo.c_str());
-                        }
-                        break;
-                    }
-                    default:
-                    {
-                        if (DJI::OSDK::hmsErrCodeInfoTbl[j].groundAlarmInfo != "")
-                        {
-                            replaceHMSIdentifyStr(DJI::OSDK::hmsErrCodeInfoTbl[j].groundAlarmInfo,
-                                                  hmsPushData->errList[i].alarmID,
-                                                  hmsPushData->errList[i].sensorIndex,
-                                                  djiHMSImpl->getDeviceIndex());
-                            DSTATUS("TimeStamp: %ld.Info:%s\n",djiHMSImpl->getHMSPushPacket().timeStamp,
-                                    DJI::OSDK::hmsErrCodeInfoTbl[j].groundAlarmInfo.c_str());
-                        }
-                        break;
-                    }
-                }
-            }
+            continue;
         }
+
+        const std::string &alarmFmt = inAir ? errCodeTemplate->flyAlarmFmt : errCodeTemplate->groundAlarmFmt;
+        if (alarmFmt.empty())
+        {
+            continue;
+        }
+        formatHMSAlarmInfo(alarmFmt, err.alarmID, err.sensorIndex, componentIndex,
+                           alarmInfo, sizeof(alarmInfo));
+        DSTATUS("TimeStamp: %u.Info: %s\n", timeStamp, alarmInfo);
     }
 
     return true;
 }
-
-static void replaceHMSIdentifyStr(string & alarmInfo, uint32_t alarmId, uint8_t sensorIndex,
-                                  uint8_t componentIndex)
-{
-    const string oldReplaceAlarmIdStr        = "%alarmid";
-    const string oldReplaceIndexStr          = "%index";
-    const string oldReplaceComponentIndexStr = "%component_index";
-
-    string newReplaceAlarmIdStr;
-    string newReplaceIndexStr ;
-    string newReplaceComponentIndexStr;
-
-    sprintf((char *)newReplaceAlarmIdStr.data(), "0x%08X" , alarmId);
-    sprintf((char *)newReplaceIndexStr.data(), "%d" , sensorIndex);
-    sprintf((char *)newReplaceComponentIndexStr.data(), "%d" ,componentIndex);
-
-    DJI::OSDK::replaceStr(alarmInfo, oldReplaceAlarmIdStr,newReplaceAlarmIdStr.data());
-    DJI::OSDK::replaceStr(alarmInfo, oldReplaceIndexStr,newReplaceIndexStr.data());
-    DJI::OSDK::replaceStr(alarmInfo, oldReplaceComponentIndexStr, newReplaceComponentIndexStr.data());
-}
\ No newline at end of file
@@ -55,6 +55,8 @@ namespace DJI{
 
 DJIHMSImpl::DJIHMSImpl(Vehicle *vehicle):vehicle(vehicle)
 {
+    this->deviceIndex = InvalidIndex;
+    this->faultEventSubscriberNum = 0;
     this->createHMSInfoLock();
 }
 
@@ -85,10 +87,18 @@ uint8_t DJIHMSImpl::getDeviceIndex()
 
 void DJIHMSImpl::setHMSPushData(const uint8_t *hmsPushData, uint16_t dataLen)
 {
-    memcpy(&(this->hmsPushPacket.hmsPushData), hmsPushData, 3 * sizeof(uint8_t));
-    this->hmsPushPacket.hmsPushData.errList.clear();
-    this->hmsPushPacket.hmsPushData.errList.resize((dataLen - 3 * sizeof(uint8_t)) / sizeof(ErrList));
-    memcpy(&(this->hmsPushPacket.hmsPushData.errList[0]), hmsPushData + 3 * sizeof(uint8_t), dataLen - 3 * sizeof(uint8_t));
+    if (dataLen < 3 * sizeof(uint8_t))
+    {
+        return;
+    }
+    this->hmsPushPacket.hmsPushData.msgVersion  = hmsPushData[0];
+    this->hmsPushPacket.hmsPushData.globalIndex = hmsPushData[1];
+    this->hmsPushPacket.hmsPushData.msgEnd      = hmsPushData[2] & 0x01;
+    this->hmsPushPacket.hmsPushData.msgIndex    = hmsPushData[2] >> 1;
+    /*! the list keeps its capacity, so it is only allocated by the first pushes*/
+    const ErrList *errList = (const ErrList *)(hmsPushData + 3 * sizeof(uint8_t));
+    this->hmsPushPacket.hmsPushData.errList.assign(
+        errList, errList + (dataLen - 3 * sizeof(uint8_t)) / sizeof(ErrList));
 }
 
 void DJIHMSImpl::setHMSTimeStamp()
@@ -142,6 +152,116 @@ uint8_t DJIHMSImpl::getComponentIndex(uint8_t sender)
     return InvalidIndex;
 }
 
+void DJIHMSImpl::trackHMSPushData(uint8_t sender, const uint8_t *hmsPushData, uint16_t dataLen)
+{
+    faultEvents.clear();
+    lockHMSInfo();
+    /*! same timestamp as the push packet set with setHMSTimeStamp*/
+    stateTracker.update(sender, getComponentIndex(sender), hmsPushData, dataLen,
+                        hmsPushPacket.timeStamp, faultEvents);
+    freeHMSInfo();
+    notifyFaultEvents();
+}
+
+void DJIHMSImpl::resetFaultState()
+{
+    std::vector<HMSFaultEvent> events;
+    lockHMSInfo();
+    /*! stamped with the last push like the other events, no push clears them*/
+    stateTracker.reset(hmsPushPacket.timeStamp, events);
+    FaultEventSubscriber subscribers[MAX_FAULT_EVENT_SUBSCRIBER_NUM];
+    uint32_t subscriberNum = faultEventSubscriberNum;
+    memcpy(subscribers, faultEventSubscribers, subscriberNum * sizeof(FaultEventSubscriber));
+    freeHMSInfo();
+
+    for (uint32_t i = 0; i < subscriberNum && !events.empty(); i++)
+    {
+        subscribers[i].callback(&events[0], events.size(), subscribers[i].userData);
+    }
+}
+
+void DJIHMSImpl::notifyFaultEvents()
+{
+    if (faultEvents.empty())
+    {
+        return;
+    }
+
+    /*! the callbacks may (un)subscribe, they are called on a copy of the list*/
+    lockHMSInfo();
+    FaultEventSubscriber subscribers[MAX_FAULT_EVENT_SUBSCRIBER_NUM];
+    uint32_t subscriberNum = faultEventSubscriberNum;
+    memcpy(subscribers, faultEventSubscribers, subscriberNum * sizeof(FaultEventSubscriber));
+    freeHMSInfo();
+
+    for (uint32_t i = 0; i < subscriberNum; i++)
+    {
+        subscribers[i].callback(&faultEvents[0], faultEvents.size(), subscribers[i].userData);
+    }
+}
+
+bool DJIHMSImpl::subscribeFaultEvent(HMSFaultEventCallback callback, void *userData)
+{
+    if (!callback)
+    {
+        return false;
+    }
+
+    bool result = false;
+    lockHMSInfo();
+    uint32_t i;
+    for (i = 0; i < faultEventSubscriberNum; i++)
+    {
+        if (faultEventSubscribers[i].callback == callback &&
+            faultEventSubscribers[i].userData == userData)
+        {
+            break;
+        }
+    }
+    if (i == faultEventSubscriberNum && faultEventSubscriberNum < MAX_FAULT_EVENT_SUBSCRIBER_NUM)
+    {
+        faultEventSubscribers[faultEventSubscriberNum].callback = callback;
+        faultEventSubscribers[faultEventSubscriberNum].userData = userData;
+        faultEventSubscriberNum++;
+        result = true;
+    }
+    freeHMSInfo();
+
+    return result;
+}
+
+bool DJIHMSImpl::unsubscribeFaultEvent(HMSFaultEventCallback callback, void *userData)
+{
+    bool result = false;
+    lockHMSInfo();
+    for (uint32_t i = 0; i < faultEventSubscriberNum; i++)
+    {
+        if (faultEventSubscribers[i].callback == callback &&
+            faultEventSubscribers[i].userData == userData)
+        {
+            /*! keep the subscribing order*/
+            memmove(&faultEventSubscribers[i], &faultEventSubscribers[i + 1],
+                    (faultEventSubscriberNum - i - 1) * sizeof(FaultEventSubscriber));
+            faultEventSubscriberNum--;
+            result = true;
+            break;
+        }
+    }
+    freeHMSInfo();
+
+    return result;
+}
+
+std::vector<HMSFaultState> DJIHMSImpl::getActiveFaults()
+{
+    std::vector<HMSFaultState> faults;
+    lockHMSInfo();
+    stateTracker.getActiveFaults(faults);
+    freeHMSInfo();
+
+    return faults;
+}
+
 bool DJIHMSImpl::createHMSInfoLock()
 {
     E_OsdkStat errCode;
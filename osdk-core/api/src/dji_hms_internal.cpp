@@ -27,6 +27,10 @@
  */
 
 #include "dji_hms_internal.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
 
 namespace DJI{
 namespace OSDK{
@@ -603,5 +607,130 @@ HMSErrCodeInfo hmsErrCodeInfoTbl[dbHMSErrNum] = {
         { 0x1f0b001a , "LTE Transmission error. Switched to OcuSync. Restart aircraft and remote controller to re-establish LTE Transmission (%alarmid)" , "" },
         { 0x1f0b001b , "LTE Transmission error. Switched to OcuSync. Restart aircraft and remote controller to re-establish LTE Transmission (%alarmid)" , "" },
 };
+
+/*! markers of the identified strs, control chars never used by the alarm information*/
+static const char hmsAlarmIdMarker        = '\x01';
+static const char hmsIndexMarker          = '\x02';
+static const char hmsComponentIndexMarker = '\x03';
+
+static std::string compileHMSAlarmInfo(const std::string &alarmInfo)
+{
+    static const struct {
+        const char *str;
+        char marker;
+    } identifyStrs[] = {
+        { "%component_index", hmsComponentIndexMarker },
+        { "%alarmid",         hmsAlarmIdMarker },
+        { "%index",           hmsIndexMarker },
+    };
+
+    std::string alarmFmt;
+    alarmFmt.reserve(alarmInfo.size());
+    for (std::string::size_type pos = 0; pos < alarmInfo.size();)
+    {
+        bool replaced = false;
+        if (alarmInfo[pos] == '%')
+        {
+            for (uint32_t i = 0; i < sizeof(identifyStrs) / sizeof(identifyStrs[0]); i++)
+            {
+                std::string::size_type len = strlen(identifyStrs[i].str);
+                if (alarmInfo.compare(pos, len, identifyStrs[i].str) == 0)
+                {
+                    alarmFmt += identifyStrs[i].marker;
+                    pos += len;
+                    replaced = true;
+                    break;
+                }
+            }
+        }
+        if (!replaced)
+        {
+            alarmFmt += alarmInfo[pos++];
+        }
+    }
+    return alarmFmt;
+}
+
+static bool lessHMSErrCodeTemplate(const HMSErrCodeTemplate &a, const HMSErrCodeTemplate &b)
+{
+    return a.alarmId < b.alarmId;
+}
+
+static bool lessHMSErrCodeAlarmId(const HMSErrCodeTemplate &a, uint32_t alarmId)
+{
+    return a.alarmId < alarmId;
+}
+
+static std::vector<HMSErrCodeTemplate> buildHMSErrCodeIndex()
+{
+    std::vector<HMSErrCodeTemplate> index;
+    index.reserve(dbHMSErrNum);
+    for (uint32_t i = 0; i < dbHMSErrNum; i++)
+    {
+        const HMSErrCodeInfo &info = hmsErrCodeInfoTbl[i];
+        /*! the unused tail of the table is zero filled*/
+        if (info.groundAlarmInfo.empty() && info.flyAlarmInfo.empty())
+        {
+            continue;
+        }
+        HMSErrCodeTemplate errCodeTemplate;
+        errCodeTemplate.alarmId        = info.alarmId;
+        errCodeTemplate.groundAlarmFmt = compileHMSAlarmInfo(info.groundAlarmInfo);
+        errCodeTemplate.flyAlarmFmt    = compileHMSAlarmInfo(info.flyAlarmInfo);
+        index.push_back(errCodeTemplate);
+    }
+    /*! stable, so a duplicated error code still resolves to its first entry*/
+    std::stable_sort(index.begin(), index.end(), lessHMSErrCodeTemplate);
+    return index;
+}
+
+const HMSErrCodeTemplate *findHMSErrCodeTemplate(uint32_t alarmId)
+{
+    static const std::vector<HMSErrCodeTemplate> index = buildHMSErrCodeIndex();
+
+    std::vector<HMSErrCodeTemplate>::const_iterator it =
+        std::lower_bound(index.begin(), index.end(), alarmId, lessHMSErrCodeAlarmId);
+    if (it == index.end() || it->alarmId != alarmId)
+    {
+        return NULL;
+    }
+    return &(*it);
+}
+
+uint32_t formatHMSAlarmInfo(const std::string &alarmFmt, uint32_t alarmId,
+                            uint8_t sensorIndex, uint8_t componentIndex,
+                            char *buf, uint32_t bufLen)
+{
+    if (!buf || bufLen == 0)
+    {
+        return 0;
+    }
+
+    uint32_t len = 0;
+    for (std::string::size_type i = 0; i < alarmFmt.size() && len < bufLen - 1; i++)
+    {
+        int n;
+        switch (alarmFmt[i])
+        {
+            case hmsAlarmIdMarker:
+                n = snprintf(buf + len, bufLen - len, "0x%08X", alarmId);
+                break;
+            case hmsIndexMarker:
+                n = snprintf(buf + len, bufLen - len, "%d", sensorIndex);
+                break;
+            case hmsComponentIndexMarker:
+                n = snprintf(buf + len, bufLen - len, "%d", componentIndex);
+                break;
+            default:
+                buf[len] = alarmFmt[i];
+                n = 1;
+                break;
+        }
+        /*! snprintf returns the untruncated length*/
+        len = (n < 0) ? len : std::min(len + (uint32_t)n, bufLen - 1);
+    }
+    buf[len] = '\0';
+    return len;
+}
   }
-}
\ No newline at end of file
+}
@@ -0,0 +1,166 @@
+/** @file dji_hms_state_tracker.cpp
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ *  @brief Incremental tracking of HMS(Health Management System)'s active faults
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <string.h>
+#include "dji_hms_state_tracker.hpp"
+
+using namespace DJI;
+using namespace DJI::OSDK;
+
+HMSStateTracker::HMSStateTracker()
+{
+    memset(senderCycle, 0, sizeof(senderCycle));
+}
+
+HMSStateTracker::~HMSStateTracker()
+{
+}
+
+HMSStateTracker::FaultKey HMSStateTracker::makeFaultKey(uint32_t alarmId, uint8_t sensorIndex,
+                                                        uint8_t componentIndex)
+{
+    return ((FaultKey)alarmId << 16) | ((FaultKey)sensorIndex << 8) | componentIndex;
+}
+
+void HMSStateTracker::addEvent(HMSFaultEventType type, const HMSFaultState &fault,
+                               uint8_t lastReportLevel, uint32_t timeStamp,
+                               std::vector<HMSFaultEvent> &events)
+{
+    HMSFaultEvent event;
+    event.type            = type;
+    event.fault           = fault;
+    event.lastReportLevel = lastReportLevel;
+    event.timeStamp       = timeStamp;
+    events.push_back(event);
+}
+
+bool HMSStateTracker::update(uint8_t sender, uint8_t componentIndex, const uint8_t *hmsPushData,
+                             uint16_t dataLen, uint32_t timeStamp, std::vector<HMSFaultEvent> &events)
+{
+    if (!hmsPushData || dataLen < HEADER_LEN || (dataLen - HEADER_LEN) % sizeof(ErrList) != 0)
+    {
+        return false;
+    }
+
+    /*! same layout as HMSPushData: msgEnd is the lowest bit of the third byte*/
+    bool msgEnd = (hmsPushData[2] & 0x01) != 0;
+    uint32_t errNum = (dataLen - HEADER_LEN) / sizeof(ErrList);
+    uint32_t cycle = senderCycle[sender];
+
+    for (uint32_t i = 0; i < errNum; i++)
+    {
+        ErrList err;
+        memcpy(&err, hmsPushData + HEADER_LEN + i * sizeof(ErrList), sizeof(ErrList));
+        /*! level 0 is no error, the fault is then cleared with the cycle*/
+        if (err.reportLevel == 0)
+        {
+            continue;
+        }
+
+        FaultKey key = makeFaultKey(err.alarmID, err.sensorIndex, componentIndex);
+        FaultMap::iterator it = activeFaults.find(key);
+        if (it == activeFaults.end())
+        {
+            ActiveFault fault;
+            fault.state.alarmId        = err.alarmID;
+            fault.state.sensorIndex    = err.sensorIndex;
+            fault.state.componentIndex = componentIndex;
+            fault.state.reportLevel    = err.reportLevel;
+            fault.state.firstSeen      = timeStamp;
+            fault.state.lastSeen       = timeStamp;
+            fault.sender               = sender;
+            fault.seenCycle            = cycle;
+            activeFaults.insert(std::make_pair(key, fault));
+            addEvent(HMSFaultRaised, fault.state, 0, timeStamp, events);
+            continue;
+        }
+
+        ActiveFault &fault = it->second;
+        uint8_t lastReportLevel = fault.state.reportLevel;
+        fault.state.reportLevel = err.reportLevel;
+        fault.state.lastSeen    = timeStamp;
+        fault.sender            = sender;
+        fault.seenCycle         = cycle;
+        if (lastReportLevel != err.reportLevel)
+        {
+            addEvent(HMSFaultChanged, fault.state, lastReportLevel, timeStamp, events);
+        }
+    }
+
+    if (msgEnd)
+    {
+        endCycle(sender, timeStamp, events);
+    }
+    return true;
+}
+
+void HMSStateTracker::endCycle(uint8_t sender, uint32_t timeStamp,
+                               std::vector<HMSFaultEvent> &events)
+{
+    uint32_t cycle = senderCycle[sender];
+    for (FaultMap::iterator it = activeFaults.begin(); it != activeFaults.end();)
+    {
+        if (it->second.sender == sender && it->second.seenCycle != cycle)
+        {
+            addEvent(HMSFaultCleared, it->second.state, it->second.state.reportLevel,
+                     timeStamp, events);
+            activeFaults.erase(it++);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    senderCycle[sender] = cycle + 1;
+}
+
+void HMSStateTracker::reset(uint32_t timeStamp, std::vector<HMSFaultEvent> &events)
+{
+    for (FaultMap::iterator it = activeFaults.begin(); it != activeFaults.end(); ++it)
+    {
+        addEvent(HMSFaultCleared, it->second.state, it->second.state.reportLevel,
+                 timeStamp, events);
+    }
+    activeFaults.clear();
+    memset(senderCycle, 0, sizeof(senderCycle));
+}
+
+void HMSStateTracker::getActiveFaults(std::vector<HMSFaultState> &faults) const
+{
+    faults.clear();
+    faults.reserve(activeFaults.size());
+    for (FaultMap::const_iterator it = activeFaults.begin(); it != activeFaults.end(); ++it)
+    {
+        faults.push_back(it->second.state);
+    }
+}
+
+uint32_t HMSStateTracker::getActiveFaultNum() const
+{
+    return activeFaults.size();
+}
@@ -86,6 +86,10 @@ void LegacyLinker::initX5SEnableThread() {
       OSDK_TASK_STACK_SIZE_DEFAULT, vehicle->linker);
   if (osdkStat != OSDK_STAT_OK) {
     DERROR("legacyX5SEnableTask create error:%d", osdkStat);
+  } else {
+    Platform::instance().applyTaskPolicy(legacyX5SEnableHandle,
+                                         OSDK_TASK_CLASS_CONTROL,
+                                         "legacyX5S");
   }
 }
 
@@ -916,6 +916,9 @@ Vehicle::initOSDKHeartBeatThread() {
         DERROR("osdk heart beat task create error:%d", osdkStat);
         return false;
       }
+      Platform::instance().applyTaskPolicy(sendHeartbeatToFCHandle,
+                                           OSDK_TASK_CLASS_CONTROL,
+                                           "osdkHeartbeat");
     }
 
     return true;
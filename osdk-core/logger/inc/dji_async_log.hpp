@@ -0,0 +1,265 @@
+/** @file dji_async_log.hpp
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ *  @brief
+ *  Asynchronous logging backend: per-thread lock-free rings drained by a
+ *  background thread in batched writes.
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef ASYNC_LOG_H
+#define ASYNC_LOG_H
+
+#if defined(__linux__)
+
+#include <pthread.h>
+#include <string.h>
+#include <atomic>
+#include "dji_singleton.hpp"
+#include "osdk_logger.h"
+
+namespace DJI
+{
+namespace OSDK
+{
+
+/*! @brief Asynchronous log sink shared by DLOG and the linker console
+ *
+ * @details Every producer thread owns a single-producer/single-consumer byte
+ * ring, so writing a line is a memcpy and one release store, without any lock
+ * or syscall. A drain thread collects the complete lines of all the rings into
+ * one batch and hands it to the sink in a single call. When a ring is full the
+ * line is dropped and counted, the producer is never blocked.
+ *
+ * Lines of one thread keep their order. Lines of different threads never
+ * interleave inside a line, but their relative order is the drain order.
+ *
+ * Deferred lines (DLOG_DEFERRED) skip the formatting as well: the producer
+ * only stores the format pointer and the raw arguments, the drain thread
+ * does the printf work.
+ */
+class AsyncLog : public Singleton<AsyncLog>
+{
+public:
+  static const uint32_t DEFAULT_RING_SIZE = 16 * 1024;
+  static const uint32_t MAX_RING_NUM      = 64;
+  static const uint32_t BATCH_SIZE        = 8 * 1024;
+  static const int      DRAIN_PERIOD_MS   = 10;
+
+  AsyncLog();
+  ~AsyncLog();
+
+  /*!
+   * @brief Start the drain thread.
+   * @param ringSize bytes of each per-thread ring, rounded up to a power of 2
+   * @param sink where the batches go, stdout if NULL
+   * @return false if already running or the thread could not be created
+   */
+  bool start(uint32_t ringSize = DEFAULT_RING_SIZE,
+             OsdkLogger_ConsoleFunc sink = NULL);
+
+  /*! @brief Flush all the pending lines and stop the drain thread */
+  void stop();
+
+  bool isRunning();
+
+  /*!
+   * @brief Queue one complete line from the calling thread.
+   * @note Written straight to the sink if the drain thread is not running.
+   * @return false if the line was dropped
+   */
+  bool write(const char* data, uint32_t len);
+
+  //! Size of a deferred record, and of a deferred line once formatted
+  static const uint32_t DEFERRED_SIZE = 512;
+
+  /*! @brief Raw arguments of a deferred line
+   *  @details Integers and floating point values are stored by value,
+   *  strings are copied since they may not outlive the call. Arguments that
+   *  do not fit are left out and their conversions printed as is.
+   */
+  class DeferredRecord
+  {
+  public:
+    enum ArgType
+    {
+      ARG_INT,
+      ARG_UINT,
+      ARG_DOUBLE,
+      ARG_LONG_DOUBLE,
+      ARG_PTR,
+      ARG_STR
+    };
+
+    DeferredRecord(int level, const char* prefix, const char* func, int line,
+                   const char* fmt);
+
+    const uint8_t* data() const { return buf; }
+    uint32_t       size() const { return len; }
+
+    void put(bool v) { putInt(v); }
+    void put(char v) { putInt(v); }
+    void put(signed char v) { putInt(v); }
+    void put(unsigned char v) { putUint(v); }
+    void put(short v) { putInt(v); }
+    void put(unsigned short v) { putUint(v); }
+    void put(int v) { putInt(v); }
+    void put(unsigned int v) { putUint(v); }
+    void put(long v) { putInt(v); }
+    void put(unsigned long v) { putUint(v); }
+    void put(long long v) { putInt(v); }
+    void put(unsigned long long v) { putUint(v); }
+    void put(float v) { double d = v; putRaw(ARG_DOUBLE, &d, sizeof(d)); }
+    void put(double v) { putRaw(ARG_DOUBLE, &v, sizeof(v)); }
+    void put(long double v) { putRaw(ARG_LONG_DOUBLE, &v, sizeof(v)); }
+    void put(char* v) { put((const char*)v); }
+    void put(const char* v);
+    template <typename T>
+    void put(T* v)
+    {
+      const void* p = v;
+      putRaw(ARG_PTR, &p, sizeof(p));
+    }
+
+  private:
+    void putInt(long long v) { putRaw(ARG_INT, &v, sizeof(v)); }
+    void putUint(unsigned long long v) { putRaw(ARG_UINT, &v, sizeof(v)); }
+    void putRaw(uint8_t type, const void* v, uint32_t n)
+    {
+      // Once an argument is left out the following ones would be mismatched
+      if (!full && len + 1 + n <= DEFERRED_SIZE)
+      {
+        buf[len++] = type;
+        memcpy(buf + len, v, n);
+        len += n;
+      }
+      else
+      {
+        full = true;
+      }
+    }
+
+  private:
+    uint8_t  buf[DEFERRED_SIZE];
+    uint32_t len;
+    bool     full;
+  };
+
+  /*!
+   * @brief Queue a line as its format and raw arguments, formatted later by
+   * the drain thread. Normally used through DLOG_DEFERRED, DSTATUS_DEFERRED
+   * and so on.
+   * @note fmt must stay valid until the line is drained, so it has to be a
+   * string literal. Variable width and precision ('*') are not supported.
+   * @return false if the line was dropped
+   */
+  template <typename... Args>
+  bool writeDeferred(int level, const char* prefix, const char* func, int line,
+                     const char* fmt, Args... args)
+  {
+    DeferredRecord record(level, prefix, func, line, fmt);
+    putArgs(record, args...);
+    return writeRecord(record.data(), record.size(), true);
+  }
+
+  //! Lines dropped because a ring was full or no ring was left
+  uint32_t getDroppedCount();
+  void     resetDroppedCount();
+
+  /*!
+   * @brief Console function to register through DJI_REG_LOGGER_CONSOLE, so
+   * the linker logs go through the same rings as DLOG.
+   */
+  static E_OsdkStat consoleFunc(const uint8_t* data, uint16_t dataLen);
+
+private:
+  typedef struct Ring
+  {
+    uint8_t*              buf;
+    uint32_t              mask;
+    //! Free running indexes, head is written by the owner only
+    std::atomic<uint32_t> head;
+    std::atomic<uint32_t> tail;
+    //! Cleared when the owner thread exits, the ring is then reusable
+    std::atomic<bool>     owned;
+  } Ring;
+
+  //! Length prefix of each record in the ring, the top bit marks a deferred one
+  typedef uint16_t RecordLen;
+  static const RecordLen DEFERRED_FLAG = 0x8000;
+
+  static void putArgs(DeferredRecord& record)
+  {
+  }
+  template <typename T, typename... Rest>
+  static void putArgs(DeferredRecord& record, T arg, Rest... rest)
+  {
+    record.put(arg);
+    putArgs(record, rest...);
+  }
+
+  AsyncLog(const AsyncLog&);
+  AsyncLog& operator=(const AsyncLog&);
+
+  bool  writeRecord(const uint8_t* data, uint32_t len, bool deferred);
+  Ring* getThreadRing();
+  bool  push(Ring* ring, const uint8_t* data, uint32_t len, bool deferred);
+  bool  drainOnce();
+  void  flushBatch();
+
+  static void     copyFromRing(const Ring* ring, uint32_t from, uint8_t* dst,
+                               uint32_t len);
+  static uint32_t formatDeferred(const uint8_t* record, uint32_t recordLen,
+                                 char* out, uint32_t outSize);
+
+  static void* drainThreadEntry(void* p);
+  static void  releaseThreadRing(void* p);
+  static E_OsdkStat stdoutSink(const uint8_t* data, uint16_t dataLen);
+
+private:
+  pthread_key_t          ringKey;
+  pthread_mutex_t        ringLock;
+  Ring*                  rings[MAX_RING_NUM];
+  std::atomic<uint32_t>  ringNum;
+  uint32_t               ringSize;
+
+  pthread_t              drainThread;
+  pthread_mutex_t        drainLock;
+  pthread_cond_t         drainCond;
+  std::atomic<bool>      running;
+  OsdkLogger_ConsoleFunc sink;
+
+  uint8_t                batch[BATCH_SIZE];
+  uint32_t               batchLen;
+  uint8_t                deferred[DEFERRED_SIZE];
+
+  std::atomic<uint32_t>  dropped;
+};
+
+} // namespace OSDK
+} // namespace DJI
+
+#endif // __linux__
+
+#endif // ASYNC_LOG_H
@@ -32,22 +32,63 @@
 
 #include "dji_singleton.hpp"
 #include "dji_platform.hpp"
+#if defined(__linux__)
+#include "dji_async_log.hpp"
+#endif
 
 
 #ifdef WIN32
 #define __func__ __FUNCTION__
 #endif // WIN32
 
+/*! @brief Compile-time log levels
+ *  @details Logs below DJI_LOG_MIN_LEVEL are removed at compile time, their
+ *  arguments are never evaluated. Set it with e.g.
+ *  -DDJI_LOG_MIN_LEVEL=DJI_LOG_LEVEL_STATUS, levels at or above it can still
+ *  be switched at run time through the DJI::OSDK::Log methods.
+ */
+#define DJI_LOG_LEVEL_DEBUG  0
+#define DJI_LOG_LEVEL_STATUS 1
+#define DJI_LOG_LEVEL_ERROR  2
+#define DJI_LOG_LEVEL_NONE   3
+
+#ifndef DJI_LOG_MIN_LEVEL
+#define DJI_LOG_MIN_LEVEL DJI_LOG_LEVEL_DEBUG
+#endif
+
+/*! The switch is checked first, a disabled log does not take the timestamp
+ *  nor evaluate its arguments. The guard is a one pass for loop rather than
+ *  an if/else, so that a log in an unbraced if does not capture its else. */
 #define DLOG(_title_)                                                          \
+  for (bool _dlog_once_ = (_title_); _dlog_once_; _dlog_once_ = false)         \
   DJI::OSDK::Log::instance()                                                   \
     .title((_title_), #_title_, __func__, __LINE__)                            \
     .print
 
 #define DLOG_PRIVATE(_title_)                                                  \
+  for (bool _dlog_once_ = (_title_); _dlog_once_; _dlog_once_ = false)         \
   DJI::OSDK::Log::instance()                                                   \
-    .title((_title_), #_title_)                            \
+    .title((_title_), #_title_)                                                \
     .print
 
+//! A compiled out log, the arguments are type checked only
+#define DLOG_DISABLED while (0) DJI::OSDK::Log::instance().print
+
+#if defined(__linux__)
+/*! @brief Deferred logging, see DJI::OSDK::AsyncLog::writeDeferred
+ *  @details Only the format pointer and the raw arguments are queued, the
+ *  line is formatted by the drain thread. The format must be a string literal.
+ */
+#define DLOG_DEFERRED(_title_, ...)                                            \
+  for (bool _dlog_once_ = (_title_); _dlog_once_; _dlog_once_ = false)         \
+  DJI::OSDK::AsyncLog::instance().writeDeferred(                               \
+    (_title_), #_title_, __func__, __LINE__, __VA_ARGS__)
+#else
+#define DLOG_DEFERRED(_title_, ...) DLOG(_title_)(__VA_ARGS__)
+#endif
+
+#define DLOG_DEFERRED_DISABLED(...) DLOG_DISABLED(__VA_ARGS__)
+
 #define STATUS DJI::OSDK::Log::instance().getStatusLogState()
 #define ERRORLOG DJI::OSDK::Log::instance().getErrorLogState()
 #define DEBUG DJI::OSDK::Log::instance().getDebugLogState()
@@ -56,22 +97,43 @@
  *  @details Users can use methods in the DJI::OSDK::Log class to
  *  enable/disable this logging channel
  */
+#if DJI_LOG_MIN_LEVEL <= DJI_LOG_LEVEL_STATUS
 #define DSTATUS DLOG(STATUS)
 #define DSTATUS_PRIVATE DLOG_PRIVATE(STATUS)
+#define DSTATUS_DEFERRED(...) DLOG_DEFERRED(STATUS, __VA_ARGS__)
+#else
+#define DSTATUS DLOG_DISABLED
+#define DSTATUS_PRIVATE DLOG_DISABLED
+#define DSTATUS_DEFERRED DLOG_DEFERRED_DISABLED
+#endif
 
 /*! @brief Global Logging macro for error messages
  *  @details Users can use methods in the DJI::OSDK::Log class to
  *  enable/disable this logging channel
  */
+#if DJI_LOG_MIN_LEVEL <= DJI_LOG_LEVEL_ERROR
 #define DERROR DLOG(ERRORLOG)
 #define DERROR_PRIVATE DLOG_PRIVATE(ERRORLOG)
+#define DERROR_DEFERRED(...) DLOG_DEFERRED(ERRORLOG, __VA_ARGS__)
+#else
+#define DERROR DLOG_DISABLED
+#define DERROR_PRIVATE DLOG_DISABLED
+#define DERROR_DEFERRED DLOG_DEFERRED_DISABLED
+#endif
 
 /*! @brief Global Logging macro for debug messages
  *  @details Users can use methods in the DJI::OSDK::Log class to
  *  enable/disable this logging channel
  */
+#if DJI_LOG_MIN_LEVEL <= DJI_LOG_LEVEL_DEBUG
 #define DDEBUG DLOG(DEBUG)
 #define DDEBUG_PRIVATE DLOG_PRIVATE(DEBUG)
+#define DDEBUG_DEFERRED(...) DLOG_DEFERRED(DEBUG, __VA_ARGS__)
+#else
+#define DDEBUG DLOG_DISABLED
+#define DDEBUG_PRIVATE DLOG_DISABLED
+#define DDEBUG_DEFERRED DLOG_DEFERRED_DISABLED
+#endif
 
 namespace DJI
 {
@@ -143,6 +205,25 @@ public:
   bool getDebugLogState();
   bool getErrorLogState();
 
+  /*!
+   * @brief Queue the log lines to the asynchronous backend (DJI::OSDK::AsyncLog)
+   * instead of printing them in the calling thread.
+   * @details The calling threads only copy the line into a per-thread ring,
+   * a background thread writes them out in batches. Lines are dropped and
+   * counted rather than blocking when a ring is full. Only supported on Linux,
+   * use AsyncLog::start directly for a custom ring size or sink.
+   * @return false if the backend could not be started
+   */
+  bool enableAsyncLogging();
+
+  /*!
+   * @brief Flush the queued lines and go back to printing synchronously,
+   * which is the default mode.
+   */
+  void disableAsyncLogging();
+
+  bool getAsyncLogState();
+
   virtual Log& print(const char* fmt, ...);
 
   Log& operator<<(bool val);
@@ -163,10 +244,16 @@ public:
   Log& operator<<(int8_t c);
   Log& operator<<(const char* str);
 
+  //! Header and body of one line are formatted here and written at once
+  static const int LOG_LINE_SIZE = 512;
+
+private:
+  void output(const char* line, int len);
+
 private:
   Mutex* mutex;
-  bool   vaild;
   bool   initFlag;
+  bool   asyncMode;
 
   // @todo implement
   typedef enum NUMBER_STYLE {
@@ -0,0 +1,679 @@
+/** @file dji_async_log.cpp
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ *  @brief
+ *  Asynchronous logging backend: per-thread lock-free rings drained by a
+ *  background thread in batched writes.
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "dji_async_log.hpp"
+
+#if defined(__linux__)
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "dji_platform.hpp"
+
+using namespace DJI::OSDK;
+
+namespace
+{
+//! Leads every deferred record, followed by the tagged arguments
+typedef struct DeferredHeader
+{
+  const char* prefix;
+  const char* func;
+  const char* fmt;
+  uint32_t    timeMs;
+  int32_t     level;
+  int32_t     line;
+} DeferredHeader;
+
+//! snprintf that appends at out[*pos] and never moves past outSize - 1
+void
+appendf(char* out, uint32_t outSize, uint32_t* pos, const char* fmt, ...)
+{
+  if (*pos + 1 >= outSize)
+  {
+    return;
+  }
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(out + *pos, outSize - *pos, fmt, args);
+  va_end(args);
+  if (n > 0)
+  {
+    *pos += ((uint32_t)n < outSize - *pos) ? n : outSize - *pos - 1;
+  }
+}
+} // namespace
+
+AsyncLog::AsyncLog()
+  : ringNum(0)
+  , ringSize(DEFAULT_RING_SIZE)
+  , running(false)
+  , sink(stdoutSink)
+  , batchLen(0)
+  , dropped(0)
+{
+  memset(rings, 0, sizeof(rings));
+  pthread_key_create(&ringKey, releaseThreadRing);
+  pthread_mutex_init(&ringLock, NULL);
+  pthread_mutex_init(&drainLock, NULL);
+
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&drainCond, &attr);
+  pthread_condattr_destroy(&attr);
+}
+
+AsyncLog::~AsyncLog()
+{
+  stop();
+  for (uint32_t i = 0; i < ringNum.load(); ++i)
+  {
+    delete[] rings[i]->buf;
+    delete rings[i];
+  }
+  pthread_key_delete(ringKey);
+  pthread_cond_destroy(&drainCond);
+  pthread_mutex_destroy(&drainLock);
+  pthread_mutex_destroy(&ringLock);
+}
+
+bool
+AsyncLog::start(uint32_t ringSize, OsdkLogger_ConsoleFunc sink)
+{
+  pthread_mutex_lock(&drainLock);
+  if (running.load())
+  {
+    pthread_mutex_unlock(&drainLock);
+    return false;
+  }
+
+  uint32_t size = 256;
+  while (size < ringSize && size < (1u << 24))
+  {
+    size <<= 1;
+  }
+  this->ringSize = size;
+  this->sink     = sink ? sink : stdoutSink;
+  this->batchLen = 0;
+
+  running.store(true);
+  if (pthread_create(&drainThread, NULL, drainThreadEntry, this) != 0)
+  {
+    running.store(false);
+    pthread_mutex_unlock(&drainLock);
+    return false;
+  }
+  pthread_mutex_unlock(&drainLock);
+
+  Platform::instance().applyTaskPolicy(&drainThread, OSDK_TASK_CLASS_DEFAULT,
+                                       "osdkLogDrain");
+  return true;
+}
+
+void
+AsyncLog::stop()
+{
+  pthread_mutex_lock(&drainLock);
+  if (!running.load())
+  {
+    pthread_mutex_unlock(&drainLock);
+    return;
+  }
+  running.store(false);
+  pthread_cond_signal(&drainCond);
+  pthread_mutex_unlock(&drainLock);
+
+  pthread_join(drainThread, NULL);
+}
+
+bool
+AsyncLog::isRunning()
+{
+  return running.load(std::memory_order_acquire);
+}
+
+bool
+AsyncLog::write(const char* data, uint32_t len)
+{
+  return writeRecord((const uint8_t*)data, len, false);
+}
+
+bool
+AsyncLog::writeRecord(const uint8_t* data, uint32_t len, bool deferred)
+{
+  if (!data || len == 0)
+  {
+    return true;
+  }
+
+  if (!isRunning())
+  {
+    if (deferred)
+    {
+      char line[DEFERRED_SIZE];
+      sink((const uint8_t*)line, formatDeferred(data, len, line, sizeof(line)));
+    }
+    else
+    {
+      sink(data, (uint16_t)(len > BATCH_SIZE ? BATCH_SIZE : len));
+    }
+    return true;
+  }
+
+  Ring* ring = getThreadRing();
+  if (!ring || !push(ring, data, len, deferred))
+  {
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+uint32_t
+AsyncLog::getDroppedCount()
+{
+  return dropped.load(std::memory_order_relaxed);
+}
+
+void
+AsyncLog::resetDroppedCount()
+{
+  dropped.store(0, std::memory_order_relaxed);
+}
+
+AsyncLog::DeferredRecord::DeferredRecord(int level, const char* prefix,
+                                         const char* func, int line,
+                                         const char* fmt)
+  : len(sizeof(DeferredHeader))
+  , full(false)
+{
+  DeferredHeader hdr;
+  hdr.prefix = prefix;
+  hdr.func   = func;
+  hdr.fmt    = fmt;
+  hdr.timeMs = 0;
+  hdr.level  = level;
+  hdr.line   = line;
+  OsdkOsal_GetTimeMs(&hdr.timeMs);
+  memcpy(buf, &hdr, sizeof(hdr));
+}
+
+void
+AsyncLog::DeferredRecord::put(const char* v)
+{
+  if (!v)
+  {
+    v = "(null)";
+  }
+  uint32_t n    = strlen(v);
+  uint32_t room = DEFERRED_SIZE - len;
+  if (full || room <= 1 + sizeof(uint16_t))
+  {
+    full = true;
+    return;
+  }
+  room -= 1 + sizeof(uint16_t);
+  if (n > room)
+  {
+    n = room;
+  }
+
+  uint16_t strLen = (uint16_t)n;
+  buf[len++]      = ARG_STR;
+  memcpy(buf + len, &strLen, sizeof(strLen));
+  len += sizeof(strLen);
+  memcpy(buf + len, v, n);
+  len += n;
+}
+
+E_OsdkStat
+AsyncLog::consoleFunc(const uint8_t* data, uint16_t dataLen)
+{
+  instance().write((const char*)data, dataLen);
+  return OSDK_STAT_OK;
+}
+
+AsyncLog::Ring*
+AsyncLog::getThreadRing()
+{
+  Ring* ring = (Ring*)pthread_getspecific(ringKey);
+  if (ring)
+  {
+    return ring;
+  }
+
+  pthread_mutex_lock(&ringLock);
+  // Adopt the ring of an exited thread first, its pending lines stay in order
+  uint32_t num = ringNum.load(std::memory_order_relaxed);
+  for (uint32_t i = 0; i < num; ++i)
+  {
+    if (!rings[i]->owned.load(std::memory_order_acquire))
+    {
+      ring = rings[i];
+      break;
+    }
+  }
+  if (!ring && num < MAX_RING_NUM)
+  {
+    ring       = new Ring();
+    ring->buf  = new uint8_t[ringSize];
+    ring->mask = ringSize - 1;
+    ring->head.store(0);
+    ring->tail.store(0);
+    rings[num] = ring;
+    ringNum.store(num + 1, std::memory_order_release);
+  }
+  if (ring)
+  {
+    ring->owned.store(true, std::memory_order_relaxed);
+    pthread_setspecific(ringKey, ring);
+  }
+  pthread_mutex_unlock(&ringLock);
+  return ring;
+}
+
+bool
+AsyncLog::push(Ring* ring, const uint8_t* data, uint32_t len, bool deferred)
+{
+  if (len > BATCH_SIZE)
+  {
+    len = BATCH_SIZE;
+  }
+
+  uint32_t need = sizeof(RecordLen) + len;
+  uint32_t head = ring->head.load(std::memory_order_relaxed);
+  uint32_t tail = ring->tail.load(std::memory_order_acquire);
+  if (need > ring->mask + 1 - (head - tail))
+  {
+    return false;
+  }
+
+  RecordLen recordLen = (RecordLen)len | (deferred ? DEFERRED_FLAG : 0);
+  const uint8_t* src[2]  = { (const uint8_t*)&recordLen, data };
+  uint32_t       size[2] = { sizeof(RecordLen), len };
+  for (int n = 0; n < 2; ++n)
+  {
+    uint32_t pos   = head & ring->mask;
+    uint32_t first = ring->mask + 1 - pos;
+    if (first > size[n])
+    {
+      first = size[n];
+    }
+    memcpy(ring->buf + pos, src[n], first);
+    memcpy(ring->buf, src[n] + first, size[n] - first);
+    head += size[n];
+  }
+
+  ring->head.store(head, std::memory_order_release);
+  return true;
+}
+
+bool
+AsyncLog::drainOnce()
+{
+  bool     drained = false;
+  uint32_t num     = ringNum.load(std::memory_order_acquire);
+  for (uint32_t i = 0; i < num; ++i)
+  {
+    Ring*    ring = rings[i];
+    uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+    uint32_t head = ring->head.load(std::memory_order_acquire);
+
+    while (tail != head)
+    {
+      RecordLen len;
+      copyFromRing(ring, tail, (uint8_t*)&len, sizeof(len));
+      tail += sizeof(RecordLen);
+
+      if (len & DEFERRED_FLAG)
+      {
+        len &= ~DEFERRED_FLAG;
+        if (batchLen + DEFERRED_SIZE > BATCH_SIZE)
+        {
+          flushBatch();
+        }
+        copyFromRing(ring, tail, deferred, len);
+        batchLen += formatDeferred(deferred, len, (char*)batch + batchLen,
+                                   DEFERRED_SIZE);
+      }
+      else
+      {
+        if (batchLen + len > BATCH_SIZE)
+        {
+          flushBatch();
+        }
+        copyFromRing(ring, tail, batch + batchLen, len);
+        batchLen += len;
+      }
+      tail += len;
+
+      ring->tail.store(tail, std::memory_order_release);
+      drained = true;
+    }
+  }
+  return drained;
+}
+
+void
+AsyncLog::copyFromRing(const Ring* ring, uint32_t from, uint8_t* dst,
+                       uint32_t len)
+{
+  uint32_t pos   = from & ring->mask;
+  uint32_t first = ring->mask + 1 - pos;
+  if (first > len)
+  {
+    first = len;
+  }
+  memcpy(dst, ring->buf + pos, first);
+  memcpy(dst + first, ring->buf, len - first);
+}
+
+void
+AsyncLog::flushBatch()
+{
+  if (batchLen)
+  {
+    sink(batch, (uint16_t)batchLen);
+    batchLen = 0;
+  }
+}
+
+void*
+AsyncLog::drainThreadEntry(void* p)
+{
+  AsyncLog* log = (AsyncLog*)p;
+
+  while (log->isRunning())
+  {
+    if (log->drainOnce())
+    {
+      continue;
+    }
+    log->flushBatch();
+
+    /*! Producers never signal, that would cost them a syscall per line.
+     *  Idle rings are polled instead. */
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_nsec += DRAIN_PERIOD_MS * 1000000L;
+    if (ts.tv_nsec >= 1000000000L)
+    {
+      ts.tv_sec  += 1;
+      ts.tv_nsec -= 1000000000L;
+    }
+    pthread_mutex_lock(&log->drainLock);
+    if (log->isRunning())
+    {
+      pthread_cond_timedwait(&log->drainCond, &log->drainLock, &ts);
+    }
+    pthread_mutex_unlock(&log->drainLock);
+  }
+
+  while (log->drainOnce())
+  {
+  }
+  log->flushBatch();
+
+  uint32_t dropped = log->getDroppedCount();
+  if (dropped)
+  {
+    char tip[64];
+    int  len = snprintf(tip, sizeof(tip), "AsyncLog: %u lines dropped\n",
+                       dropped);
+    log->sink((const uint8_t*)tip, (uint16_t)len);
+  }
+  return NULL;
+}
+
+uint32_t
+AsyncLog::formatDeferred(const uint8_t* record, uint32_t recordLen, char* out,
+                         uint32_t outSize)
+{
+  DeferredHeader hdr;
+  memcpy(&hdr, record, sizeof(hdr));
+  const uint8_t* arg    = record + sizeof(hdr);
+  const uint8_t* argEnd = record + recordLen;
+
+  // Same layout as Log::title, so both kinds of lines parse alike
+  uint32_t pos = 0;
+  appendf(out, outSize, &pos, "[%d.%03d]%s/%d @ %s, L%d: ", hdr.timeMs / 1000,
+          hdr.timeMs % 1000, hdr.prefix, hdr.level, hdr.func, hdr.line);
+
+  const char* f = hdr.fmt;
+  while (*f && pos + 1 < outSize)
+  {
+    if (*f != '%')
+    {
+      out[pos++] = *f++;
+      continue;
+    }
+    if (f[1] == '%')
+    {
+      out[pos++] = '%';
+      f += 2;
+      continue;
+    }
+
+    // Split one conversion: %[flags][width][.precision][length]type
+    const char* specBegin = f++;
+    while (*f && strchr("-+ #0", *f))
+    {
+      f++;
+    }
+    while ((*f >= '0' && *f <= '9') || *f == '.')
+    {
+      f++;
+    }
+    const char* lengthBegin = f;
+    while (*f && strchr("hljztL", *f))
+    {
+      f++;
+    }
+    char type = *f;
+    if (!type)
+    {
+      break;
+    }
+    f++;
+
+    char     spec[32];
+    uint32_t specLen = f - specBegin;
+    if (specLen >= sizeof(spec) || arg >= argEnd || type == 'n')
+    {
+      appendf(out, outSize, &pos, "%.*s", (int)specLen, specBegin);
+      continue;
+    }
+    memcpy(spec, specBegin, specLen);
+    spec[specLen] = 0;
+
+    uint8_t argType = *arg++;
+    union {
+      long long          i;
+      unsigned long long u;
+      double             d;
+      long double        ld;
+      const void*        p;
+    } v;
+    v.u = 0;
+    const char* str    = "";
+    uint16_t    strLen = 0;
+    switch (argType)
+    {
+      case DeferredRecord::ARG_INT:
+      case DeferredRecord::ARG_UINT:
+        memcpy(&v.u, arg, sizeof(v.u));
+        arg += sizeof(v.u);
+        break;
+      case DeferredRecord::ARG_DOUBLE:
+        memcpy(&v.d, arg, sizeof(v.d));
+        arg += sizeof(v.d);
+        break;
+      case DeferredRecord::ARG_LONG_DOUBLE:
+        memcpy(&v.ld, arg, sizeof(v.ld));
+        arg += sizeof(v.ld);
+        break;
+      case DeferredRecord::ARG_PTR:
+        memcpy(&v.p, arg, sizeof(v.p));
+        arg += sizeof(v.p);
+        break;
+      default:
+        memcpy(&strLen, arg, sizeof(strLen));
+        str = (const char*)arg + sizeof(strLen);
+        arg += sizeof(strLen) + strLen;
+        break;
+    }
+
+    /*! The value has to be passed as the type the conversion expects, pick
+     *  it from the length modifier like printf would. */
+    bool longLong = strstr(lengthBegin, "ll") == lengthBegin ||
+                    *lengthBegin == 'j';
+    bool isLong = !longLong && (*lengthBegin == 'l' || *lengthBegin == 'z' ||
+                                *lengthBegin == 't');
+    bool isFloat  = argType == DeferredRecord::ARG_DOUBLE;
+    bool isLFloat = argType == DeferredRecord::ARG_LONG_DOUBLE;
+    switch (type)
+    {
+      case 'd':
+      case 'i':
+      case 'c':
+      {
+        long long n = isFloat ? (long long)v.d
+                              : isLFloat ? (long long)v.ld : v.i;
+        if (longLong)
+        {
+          appendf(out, outSize, &pos, spec, n);
+        }
+        else if (isLong)
+        {
+          appendf(out, outSize, &pos, spec, (long)n);
+        }
+        else
+        {
+          appendf(out, outSize, &pos, spec, (int)n);
+        }
+        break;
+      }
+      case 'u':
+      case 'x':
+      case 'X':
+      case 'o':
+      {
+        unsigned long long n =
+          isFloat ? (unsigned long long)v.d
+                  : isLFloat ? (unsigned long long)v.ld : v.u;
+        if (longLong)
+        {
+          appendf(out, outSize, &pos, spec, n);
+        }
+        else if (isLong)
+        {
+          appendf(out, outSize, &pos, spec, (unsigned long)n);
+        }
+        else
+        {
+          appendf(out, outSize, &pos, spec, (unsigned int)n);
+        }
+        break;
+      }
+      case 'f':
+      case 'F':
+      case 'e':
+      case 'E':
+      case 'g':
+      case 'G':
+      case 'a':
+      case 'A':
+      {
+        long double n = isFloat ? v.d
+                                : isLFloat ? v.ld
+                                           : argType == DeferredRecord::ARG_INT
+                                               ? (long double)v.i
+                                               : (long double)v.u;
+        if (*lengthBegin == 'L')
+        {
+          appendf(out, outSize, &pos, spec, n);
+        }
+        else
+        {
+          appendf(out, outSize, &pos, spec, (double)n);
+        }
+        break;
+      }
+      case 's':
+        if (argType == DeferredRecord::ARG_STR)
+        {
+          // The string is not terminated in the record
+          char text[DEFERRED_SIZE];
+          memcpy(text, str, strLen);
+          text[strLen] = 0;
+          appendf(out, outSize, &pos, spec, text);
+        }
+        else
+        {
+          appendf(out, outSize, &pos, "%s", "(?)");
+        }
+        break;
+      case 'p':
+        appendf(out, outSize, &pos, spec, v.p);
+        break;
+      default:
+        appendf(out, outSize, &pos, "%s", spec);
+        break;
+    }
+  }
+
+  if (pos + 1 >= outSize)
+  {
+    pos = outSize - 2;
+  }
+  if (pos == 0 || out[pos - 1] != '\n')
+  {
+    out[pos++] = '\n';
+  }
+  return pos;
+}
+
+void
+AsyncLog::releaseThreadRing(void* p)
+{
+  ((Ring*)p)->owned.store(false, std::memory_order_release);
+}
+
+E_OsdkStat
+AsyncLog::stdoutSink(const uint8_t* data, uint16_t dataLen)
+{
+  fwrite(data, 1, dataLen, stdout);
+  fflush(stdout);
+  return OSDK_STAT_OK;
+}
+
+#endif // __linux__
@@ -28,6 +28,7 @@
  */
 
 #include "dji_log.hpp"
+#include "dji_async_log.hpp"
 
 #include <stdarg.h>
 #include <stdio.h>
@@ -35,6 +36,24 @@
 
 using namespace DJI::OSDK;
 
+namespace
+{
+/*! The line being built by title() and print(). It is per thread, so the
+ *  title of one thread can never be followed by the body of another. */
+typedef struct LogLine
+{
+  char buf[Log::LOG_LINE_SIZE];
+  int  len;
+  bool vaild;
+} LogLine;
+
+#if defined(__linux__)
+__thread LogLine threadLine;
+#else
+LogLine threadLine;
+#endif
+} // namespace
+
 Log::Log(Mutex* m)
 {
   if (m)
@@ -43,6 +62,7 @@ Log::Log(Mutex* m)
     this->initFlag = true;
   }
   this->initFlag = false;
+  this->asyncMode = false;
   this->enable_status = true;
   this->enable_debug  = false;
   this->enable_error = true;
@@ -50,30 +70,35 @@ Log::Log(Mutex* m)
 
 Log::~Log()
 {
+#if defined(__linux__)
+  if (asyncMode)
+  {
+    AsyncLog::instance().stop();
+  }
+#endif
   delete mutex;
 }
 
 Log&
 Log::title(int level, const char* prefix, const char* func, int line)
 {
-  if(!initFlag)
-  {
-    mutex = new Mutex();
-    initFlag = true;
-  }
-
+  LogLine& l = threadLine;
   if (level)
   {
-    vaild = true;
-    mutex->lock();
+    l.vaild = true;
     uint32_t timeMs = 0;
     OsdkOsal_GetTimeMs(&timeMs);
-    printf("[%d.%03d]%s/%d @ %s, L%d: ", timeMs / 1000, timeMs % 1000, prefix, level, func, line);
-    mutex->unlock();
+    l.len = snprintf(l.buf, sizeof(l.buf), "[%d.%03d]%s/%d @ %s, L%d: ",
+                     timeMs / 1000, timeMs % 1000, prefix, level, func, line);
+    if (l.len < 0 || l.len > (int)sizeof(l.buf) - 2)
+    {
+      l.len = (l.len < 0) ? 0 : (int)sizeof(l.buf) - 2;
+    }
   }
   else
   {
-    vaild = false;
+    l.vaild = false;
+    l.len   = 0;
   }
   return *this;
 }
@@ -82,22 +107,20 @@ Log::title(int level, const char* prefix, const char* func, int line)
 Log&
 Log::title(int level, const char* prefix)
 {
-  if(!initFlag)
-  {
-    mutex = new Mutex();
-    initFlag = true;
-  }
-
+  LogLine& l = threadLine;
   if (level)
   {
-    vaild = true;
-    mutex->lock();
-    printf("%s/%d" , prefix, level);
-    mutex->unlock();
+    l.vaild = true;
+    l.len   = snprintf(l.buf, sizeof(l.buf), "%s/%d", prefix, level);
+    if (l.len < 0 || l.len > (int)sizeof(l.buf) - 2)
+    {
+      l.len = (l.len < 0) ? 0 : (int)sizeof(l.buf) - 2;
+    }
   }
   else
   {
-    vaild = false;
+    l.vaild = false;
+    l.len   = 0;
   }
   return *this;
 }
@@ -111,31 +134,57 @@ Log::print()
 Log&
 Log::print(const char* fmt, ...)
 {
-  char log[300] = {0};
+  LogLine& l = threadLine;
+  if ((!release) && l.vaild)
+  {
+    // Keep room for the line feed and the terminator
+    int room = (int)sizeof(l.buf) - 1 - l.len;
+    if (room > 1)
+    {
+      va_list args;
+      va_start(args, fmt);
+      int n = vsnprintf(l.buf + l.len, room, fmt, args);
+      va_end(args);
+      if (n > 0)
+      {
+        l.len += (n < room) ? n : room - 1;
+      }
+    }
+    if (l.len == 0 || l.buf[l.len - 1] != '\n')
+    {
+      l.buf[l.len++] = '\n';
+    }
+    l.buf[l.len] = 0;
+
+    output(l.buf, l.len);
+    // The title is consumed, chained prints go out as lines of their own
+    l.len = 0;
+  }
+  return *this;
+}
+
+void
+Log::output(const char* line, int len)
+{
+#if defined(__linux__)
+  if (asyncMode)
+  {
+    AsyncLog::instance().write(line, len);
+    return;
+  }
+#endif
 
   if(!initFlag)
   {
     mutex = new Mutex();
     initFlag = true;
   }
-  if ((!release) && vaild)
-  {
-    va_list args;
-    va_start(args, fmt);
-    mutex->lock();
-    vsnprintf(log, sizeof(log) - 1, fmt, args);
-    va_end(args);
-    if(log[strlen(log)] != '\n') {
-      printf("%s\n", log);
-    } else {
-      printf("%s", log);
-    };
-    mutex->unlock();
+  mutex->lock();
+  printf("%s", line);
+  mutex->unlock();
 #if defined(__linux__)
-    fflush(stdout);
+  fflush(stdout);
 #endif
-  }
-  return *this;
 }
 
 Log&
@@ -329,3 +378,39 @@ Log::getErrorLogState()
 {
   return this->enable_error;
 }
+
+bool
+Log::enableAsyncLogging()
+{
+#if defined(__linux__)
+  if (!asyncMode)
+  {
+    if (!AsyncLog::instance().isRunning() && !AsyncLog::instance().start())
+    {
+      return false;
+    }
+    asyncMode = true;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+void
+Log::disableAsyncLogging()
+{
+#if defined(__linux__)
+  if (asyncMode)
+  {
+    asyncMode = false;
+    AsyncLog::instance().stop();
+  }
+#endif
+}
+
+bool
+Log::getAsyncLogState()
+{
+  return this->asyncMode;
+}
@@ -0,0 +1,159 @@
+/** @file dji_download_scheduler.hpp
+ *  @version 4.0
+ *  @date July 2020
+ *
+ *  @brief Scheduler of the file downloads of several devices
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef DJI_DOWNLOAD_SCHEDULER_HPP
+#define DJI_DOWNLOAD_SCHEDULER_HPP
+
+#include <atomic>
+#include <deque>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "dji_file_mgr.hpp"
+#include "osdk_osal.h"
+
+namespace DJI {
+namespace OSDK {
+
+/*! @brief Queue file downloads over the FileMgr of several devices
+ *
+ * @details The download protocol runs one file at a time per device, so the
+ * requests are queued per FileMgr and the devices download in parallel, up
+ * to maxActiveNum at once. When more devices have requests than active
+ * slots, the slots are given round-robin, so a device with a long queue does
+ * not hold back the others. Requests of a device are downloaded in order.
+ *
+ * The callbacks are called on the scheduler task, not on the link thread,
+ * and may add or cancel requests.
+ */
+class DownloadScheduler {
+ public:
+  typedef uint32_t ReqId;
+  static const ReqId INVALID_REQ_ID = 0;
+
+  typedef enum DownloadState {
+    DOWNLOAD_QUEUED,
+    DOWNLOAD_RUNNING,
+    DOWNLOAD_FINISHED,
+    DOWNLOAD_FAILED,
+    DOWNLOAD_CANCELED,
+  } DownloadState;
+
+  typedef struct DownloadProgress {
+    DownloadState state;
+    uint64_t recvSize;
+    /*! 0 until the file size is received */
+    uint64_t fileSize;
+  } DownloadProgress;
+
+  /*! ret_code is OSDK_STAT_OK only if the whole file is written */
+  typedef void (*FileDoneCBType)(E_OsdkStat ret_code, ReqId reqId, void *userData);
+
+  static const uint32_t DEFAULT_MAX_ACTIVE_NUM = 4;
+  //! Longest time the scheduler task sleeps without an event
+  static const uint32_t SCHEDULE_PERIOD_MS = 100;
+
+  DownloadScheduler(uint32_t maxActiveNum = DEFAULT_MAX_ACTIVE_NUM);
+  /*! Running downloads are stopped, the callbacks of the requests left are
+   *  not called */
+  ~DownloadScheduler();
+
+  /*!
+   * @brief Queue a file download on a device.
+   * @param fileMgr FileMgr of the device, it has to outlive the request
+   * @return the id of the request, INVALID_REQ_ID on invalid params
+   */
+  ReqId addReqFileData(FileMgr *fileMgr, int fileIndex, std::string localPath,
+                       FileDoneCBType cb, void *userData);
+
+  /*!
+   * @brief Remove a queued request or stop a running one. Its callback is
+   * called with OSDK_STAT_ERR.
+   * @return false if the request is unknown or already done
+   */
+  bool cancelReqFileData(ReqId reqId);
+
+  /*! @return false if the request is unknown or its callback was called */
+  bool getProgress(ReqId reqId, DownloadProgress &progress);
+
+  /*! @brief Number of requests queued or running */
+  uint32_t getPendingNum();
+
+ private:
+  typedef struct Request {
+    DownloadScheduler *owner;
+    ReqId reqId;
+    FileMgr *fileMgr;
+    int fileIndex;
+    std::string localPath;
+    FileDoneCBType cb;
+    void *userData;
+    DownloadState state;
+    E_OsdkStat ret;
+  } Request;
+
+  typedef struct Device {
+    FileMgr *fileMgr;
+    std::deque<Request *> queue;
+    Request *active;
+  } Device;
+
+  DownloadScheduler(const DownloadScheduler &);
+  DownloadScheduler &operator=(const DownloadScheduler &);
+
+  Device *getDevice(FileMgr *fileMgr);
+  void startRequests();
+  void finishRequests();
+
+  static void *schedulerTask(void *arg);
+  static void fileDataReqCB(E_OsdkStat ret_code, void *userData);
+
+ private:
+  uint32_t maxActiveNum;
+  uint32_t activeNum;
+  ReqId nextReqId;
+  /*! Device served first at the next scheduling, for the round-robin */
+  uint32_t rrIndex;
+
+  std::mutex reqMutex;
+  std::vector<Device *> devices;
+  std::map<ReqId, Request *> requests;
+  std::list<Request *> doneRequests;
+
+  T_OsdkSemHandle wakeSem;
+  T_OsdkTaskHandle schedulerHandle;
+  std::atomic<bool> isRunning;
+  std::atomic<bool> isTaskExited;
+};
+
+}
+}
+
+#endif  // DJI_DOWNLOAD_SCHEDULER_HPP
@@ -47,10 +47,33 @@ class FileMgr {
 
   typedef void (*FileListReqCBType)(E_OsdkStat ret_code, const FilePackage file_list, void* userData);
   typedef void (*FileDataReqCBType)(E_OsdkStat ret_code, void* userData);
+  /*! Called with the entries decoded from each list pack, before the whole
+   *  list is given to the FileListReqCBType callback */
+  typedef void (*FileListPageCBType)(const FilePackage &page, void* userData);
 
   ErrorCode::ErrorCodeType startReqFileList(FileListReqCBType cb, void* userData);
+  ErrorCode::ErrorCodeType startReqFileList(FileListReqCBType cb, FileListPageCBType pageCB, void* userData);
   ErrorCode::ErrorCodeType startReqFileData(int fileIndex, std::string localPath, FileDataReqCBType cb, void* userData);
 
+  /*! @brief Abort the file data request in progress, its callback is called
+   *  with OSDK_STAT_ERR before returning.
+   */
+  ErrorCode::ErrorCodeType stopReqFileData();
+
+  /*! @brief Whether a new file data request can be started */
+  bool isReqFileDataIdle();
+
+  /*! @brief Progress of the current file data request in bytes, fileSize is
+   *  0 until the first pack is received.
+   */
+  void getFileDataProgress(uint64_t &recvSize, uint64_t &fileSize);
+
+  /*! @brief Set the receive window of the file data download in packs. The
+   *  default depends on the device type, a larger window keeps more packs in
+   *  flight on fast links.
+   */
+  void setRecvWindow(uint32_t windowSize);
+
  private:
   FileMgrImpl *impl;
   uint8_t type;
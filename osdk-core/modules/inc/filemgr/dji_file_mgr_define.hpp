@@ -6,6 +6,7 @@
 #define DJI_FILE_MGR_DEFINE_HPP
 
 #include <vector>
+#include <string>
 
 namespace DJI {
 namespace OSDK {
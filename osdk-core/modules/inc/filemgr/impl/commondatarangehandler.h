@@ -24,7 +24,15 @@ public:
     // seqNum: 收到包seq
     // confirmSeq: 确认收到最大连续包seq
     // bufSize: 缓存buf的大小
-    void AddSeqIndex(uint32_t seqNum, uint32_t confirmSeq, uint32_t bufSize);
+    // return: false if the seq is a duplicate or out of the window, its data
+    //         should be dropped
+    bool AddSeqIndex(uint32_t seqNum, uint32_t confirmSeq, uint32_t bufSize);
+
+    // Same check as AddSeqIndex without recording the seq
+    bool IsNewSeq(uint32_t seqNum, uint32_t confirmSeq, uint32_t bufSize);
+
+    // First seq not received yet, everything before it is received
+    uint32_t GetExpectSeq();
 
     bool IsResentAllNeeded();
 
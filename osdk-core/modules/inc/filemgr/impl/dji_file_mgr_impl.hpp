@@ -36,6 +36,8 @@
 #include <unistd.h>
 #include <memory>
 #include <atomic>
+#include <mutex>
+#include <condition_variable>
 #include "dji_error.hpp"
 #include "osdk_command.h"
 #include "dji_file_mgr_internal_define.hpp"
@@ -44,6 +46,8 @@
 #include "dji_file_mgr_define.hpp"
 #include "dji_file_mgr.hpp"
 #include "mmap_file_buffer.hpp"
+#include "file_list_parser.hpp"
+#include "download_journal.hpp"
 
 #if 0
 #include "commondatarangehandler.h"
@@ -71,9 +75,13 @@ class DownloadListHandler {
   CommonDataRangeHandler *range_handler_;
   DownloadBufferQueue *download_buffer_;
   FileMgr::FileListReqCBType reqCB;
+  FileMgr::FileListPageCBType pageCB;
   void* reqCBUserData;
   std::atomic<int> downloadState;
   std::atomic<uint32_t> updateTimeMs;
+  /*! The list is parsed while it is received */
+  FileListParser parser;
+  FilePackage filePackage;
 };
 
 class DownloadDataHandler {
@@ -89,6 +97,27 @@ class DownloadDataHandler {
   std::string downloadPath;
   std::atomic<int> downloadState;
   std::atomic<int> curTargetFileIndex;
+  /*! Guards range_handler_, updated on the receiving thread and read by the
+   *  monitor task */
+  std::mutex rangeMutex;
+  /*! Receive window in packs, seqs beyond expect seq + recvWindow are dropped
+   *  and requested again later */
+  std::atomic<uint32_t> recvWindow;
+  std::atomic<uint32_t> lastAckTimeMs;
+  /*! Seq of the pack flagged as the last one, -1 until received. Guarded by
+   *  rangeMutex */
+  int64_t lastPackSeq;
+  /*! Counts the requests, a monitor task exits once its request is over */
+  std::atomic<uint32_t> reqCnt;
+  /*! Byte offset asked in the request, from the journal when resuming */
+  uint32_t reqOffset;
+  DownloadJournal::Record resumeRecord;
+  /*! Bytes recorded in the journal. Guarded by rangeMutex */
+  uint64_t journalSize;
+  /*! A journal save is syncing the mapping with rangeMutex released, the
+   *  mapping must not be changed until journalIdle. Guarded by rangeMutex */
+  bool journalBusy;
+  std::condition_variable journalIdle;
 };
 
 class FileMgrImpl {
@@ -96,9 +125,20 @@ class FileMgrImpl {
   FileMgrImpl(Linker *linker, E_OSDKCommandDeiveType type, uint8_t index);
   ~FileMgrImpl();
 
-  ErrorCode::ErrorCodeType startReqFileList(FileMgr::FileListReqCBType cb, void* userData);
+  ErrorCode::ErrorCodeType startReqFileList(FileMgr::FileListReqCBType cb, void* userData,
+                                            FileMgr::FileListPageCBType pageCB = NULL);
   ErrorCode::ErrorCodeType startReqFileData(int fileIndex, std::string localPath, FileMgr::FileDataReqCBType cb, void* userData);
 
+  ErrorCode::ErrorCodeType stopReqFileData();
+  bool isReqFileDataIdle();
+  void getFileDataProgress(uint64_t &recvSize, uint64_t &fileSize);
+
+  void setRecvWindow(uint32_t windowSize);
+  static uint32_t getDefaultRecvWindow(E_OSDKCommandDeiveType type);
+
+  /*! The download packs of all the devices come to one handler */
+  static FileMgrImpl *findInstance(uint8_t sender);
+
   void HandlePushPack(dji_general_transfer_msg_ack *rsp);
   ErrorCode::ErrorCodeType SendReqFileListPack();
   ErrorCode::ErrorCodeType SendReqFileDataPack(int fileIndex) ;
@@ -107,6 +147,15 @@ class FileMgrImpl {
   ErrorCode::ErrorCodeType SendAbortPack(DJI_GENERAL_DOWNLOAD_FILE_TASK_TYPE taskId);
   ErrorCode::ErrorCodeType SendACKPack(DJI_GENERAL_DOWNLOAD_FILE_TASK_TYPE taskId, dji_download_ack *ack);
   ErrorCode::ErrorCodeType SendMissedAckPack(DJI_GENERAL_DOWNLOAD_FILE_TASK_TYPE taskId);
+  /*! Go idle and call the request callback, only the first call for a
+   *  request does it */
+  bool finishReqFileData(E_OsdkStat ret);
+  /*! Record the received part of the file. rangeMutex is only held to read
+   *  the progress, the disk I/O runs without it */
+  void saveFileDataJournal();
+  /*! Wait for a journal save to leave the mapping, before it is mapped or
+   *  unmapped. Called with rangeMutex held */
+  void waitFileDataJournal(std::unique_lock<std::mutex> &lock);
 
  private:
   DownloadListHandler *fileListHandler;
@@ -119,18 +168,16 @@ class FileMgrImpl {
  private:
   //typedef void (*FileDataReqCBType)(E_OsdkStat ret_code, dji_general_transfer_msg_ack* ackData);
   //static void internalFileDataReqCB(E_OsdkStat ret_code, void *userData);
-  typedef struct ConsumeDataBuffer {
-    uint8_t data[1024];
-    uint16_t index;
-  } ConsumeDataBuffer;
-  ConsumeDataBuffer ConsumeChunk(DataPointer data_pointer, size_t &chunk_index, size_t consumSize);
-  FilePackage parseFileList(std::list<DataPointer> fullDataList);
+  void parseFileList(const dji_general_transfer_msg_ack *rsp);
   bool parseFileData(dji_general_transfer_msg_ack *rsp);
 
  private:
   void OnReceiveAbortPack(dji_general_transfer_msg_ack *rsp);
   void OnReceiveUrgePack(dji_general_transfer_msg_ack *rsp);
   void OnReceiveDataPack(dji_general_transfer_msg_ack *rsp);
+  /*! Seq of the last data pack, only to log skipped packs. Reset when a
+   *  download starts */
+  uint32_t lastRecvSeq;
 
   void fileListRawDataCB(dji_general_transfer_msg_ack *rsp);
   void fileDataRawDataCB(dji_general_transfer_msg_ack *rsp);
@@ -138,6 +185,8 @@ class FileMgrImpl {
   uint16_t createNextReqSessionId() {return reqSessionId++;};
   uint16_t getCurReqSessionId() {return reqSessionId;};
   static std::atomic<uint16_t> reqSessionId;
+  static std::mutex instanceMutex;
+  static std::vector<FileMgrImpl *> instances;
   T_OsdkTaskHandle reqFileListHandle;
   T_OsdkTaskHandle reqFileDataHandle;
   static void fileListMonitorTask(void *arg);
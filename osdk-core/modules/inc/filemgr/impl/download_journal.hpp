@@ -0,0 +1,66 @@
+/** @file download_journal.hpp
+ *  @version 4.0
+ *  @date July 2020
+ *
+ *  @brief Sidecar journal of a file download, for resuming it
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef DOWNLOAD_JOURNAL_HPP
+#define DOWNLOAD_JOURNAL_HPP
+
+#include <stdint.h>
+#include <string>
+
+namespace DJI {
+namespace OSDK {
+
+/*! The journal lives next to the downloading file, in <path>.journal. It
+ *  records how many bytes from the start of the file are written and synced,
+ *  so a new request for the same file continues from there. It is replaced
+ *  atomically and removed once the file is complete.
+ */
+class DownloadJournal {
+ public:
+  typedef struct Record {
+    int32_t fileIndex;
+    uint64_t fileSize;
+    /*! Bytes without hole from the file start */
+    uint64_t recvSize;
+  } Record;
+
+  static std::string GetPath(const std::string &filePath);
+
+  /*! @return false if there is no journal, or it does not match the file on
+   *  the disk */
+  static bool Load(const std::string &filePath, Record &record);
+
+  static bool Save(const std::string &filePath, const Record &record);
+
+  static void Remove(const std::string &filePath);
+};
+
+}
+}
+
+#endif  // DOWNLOAD_JOURNAL_HPP
@@ -44,6 +44,8 @@ public:
     bool InitBufferQueue(int size, int start_index);
 
     bool FindBlockByIndex(int index);
+    // 期待的包被直接使用时不缓存, 只移动窗口. 没有移动时返回false
+    bool SkipExpectedBlock(int index);
     InsertRetType InsertBlock(const uint8_t *data, uint32_t data_length, int index, bool flag);
 
     DataPointer DequeueBuffer();
@@ -0,0 +1,81 @@
+/** @file file_list_parser.hpp
+ *  @version 4.0
+ *  @date July 2020
+ *
+ *  @brief Incremental parser of the file list packs
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef FILE_LIST_PARSER_HPP
+#define FILE_LIST_PARSER_HPP
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "dji_file_mgr_define.hpp"
+#include "dji_file_mgr_internal_define.hpp"
+
+namespace DJI {
+namespace OSDK {
+
+/*! Decodes the file list as its packs arrive, in seq order. The records are
+ *  decoded in place in the pack, only a record split over two packs is
+ *  assembled in a small carry buffer. The state is per instance.
+ */
+class FileListParser {
+ public:
+  FileListParser();
+
+  void Reset();
+
+  /*! @brief Decode one list pack, the packs have to be fed in seq order
+   *  @param files the decoded entries are appended to it
+   *  @return number of entries decoded from this pack
+   */
+  uint32_t Feed(const dji_general_transfer_msg_ack *rsp, std::vector<MediaFile> &files);
+
+  /*! File amount announced in the first pack */
+  uint32_t GetAmount() { return amount_; }
+
+  /*! All the announced entries are decoded, the rest is padding. Without
+   *  an amount every record is decoded */
+  bool IsComplete() { return amount_ && (decoded_cnt_ >= amount_); }
+
+ private:
+  void DecodeDescriptor(const dji_list_info_descriptor *data, MediaFile &file);
+
+  static const uint32_t DESC_FIXED_SIZE =
+      sizeof(dji_list_info_descriptor) - sizeof(dji_file_list_ext_info);
+  /*! A record is the fixed part and at most 255 bytes of ext data */
+  static const uint32_t DESC_MAX_SIZE = DESC_FIXED_SIZE + 0xFF;
+
+  uint8_t carry_[DESC_MAX_SIZE];
+  uint32_t carry_len_;
+  uint32_t amount_;
+  uint32_t decoded_cnt_;
+};
+
+}
+}
+
+#endif  // FILE_LIST_PARSER_HPP
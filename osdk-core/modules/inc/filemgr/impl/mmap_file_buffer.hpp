@@ -12,9 +12,15 @@
 #include <unistd.h>
 #include <memory>
 #include <atomic>
+#include <string>
 
 namespace DJI {
 namespace OSDK {
+/*! Download sink, the payload of each block is copied straight to its final
+ *  offset in the mmap'd file, so out of order blocks need no staging. The
+ *  state is per instance, one instance per downloading file. Once seq 0 is
+ *  inserted, blocks of different seqs can be inserted from several threads.
+ */
 class MmapFileBuffer {
  public:
   MmapFileBuffer();
@@ -24,13 +30,39 @@ class MmapFileBuffer {
   int fd;
   char *fdAddr;
   uint64_t fdAddrSize;
+  /*! Bytes written so far, each block is counted once */
+  std::atomic<uint64_t> writtenSize;
 
-  bool init(std::string path, uint64_t fileSize);
+  /*! @param baseOffset offset of the seq 0 block in the file, the bytes
+   *  before it are kept from a previous download */
+  bool init(std::string path, uint64_t fileSize, uint64_t baseOffset = 0);
 
   bool deInit();
 
-  bool InsertBlock(const uint8_t *pack, uint32_t data_length, int index);
+  bool isReady() { return fdAddr != NULL || (fd >= 0 && fdAddrSize == 0); }
 
+  /*! @brief Write a block at the offset given by its seq
+   *  @details Seq 0 is the first block, every block between it and the
+   *  last one has the same size, which is learnt from the first of them.
+   *  @param isLast the last block is shorter and does not give the size
+   *  @return false if the block cannot be placed yet (sink not ready, block
+   *  size not known) or does not fit the file, it has to be received again
+   */
+  bool InsertBlock(const uint8_t *pack, uint32_t data_length, uint32_t seq, bool isLast);
+
+  /*! Bytes written without hole from the file start, when every block
+   *  before expectSeq is written */
+  uint64_t getContiguousSize(uint32_t expectSeq);
+
+  /*! Flush [from, to) of the mapping to the disk */
+  bool sync(uint64_t from, uint64_t to);
+
+ private:
+  bool getBlockOffset(uint32_t seq, uint64_t &offset);
+
+  uint64_t baseOffset;
+  std::atomic<uint32_t> firstBlockSize;
+  std::atomic<uint32_t> blockSize;
 };
 }
 }
@@ -29,6 +29,8 @@
 #ifndef DJI_MOP_CLIENT_HPP
 #define DJI_MOP_CLIENT_HPP
 
+#include <mutex>
+#include <set>
 #include "dji_mop_pipeline.hpp"
 #include "dji_mop_pipeline_manager_base.hpp"
 
@@ -63,9 +65,9 @@ class MopClient : MopPipelineManagerBase {
    * pipeline type. If success, a pipeline object will be created.
    *
    *  @platforms M300
-   *  @note This is a non-blocking api.
-   *  @todo This api is not implemented yet, it will be implemented in the
-   *  future.
+   *  @note This is a non-blocking api. The connecting is retried every
+   *  CONNECT_RETRY_MS until it succeeds or disconnect is called. The client
+   *  has to outlive the callback.
    *  @param id The pipeline id which to be connected, ref to
    * DJI::OSDK::MOP::PipelineID
    *  @param type The pipeline type. It can be set to be RELIABLE or UBRELIABLE
@@ -97,8 +99,6 @@ class MopClient : MopPipelineManagerBase {
    * 
    *  @platforms M300
    *  @note This is a non-blocking api
-   *  @todo This api is not implemented yet, it will be implemented in the
-   *  future.
    *  @param id The pipeline id which to be connected, ref to the enum
    *  @param cb Callback function defined by user
    *  @arg @b errCode is the DJI::OSDK::MOP::MopErrCode error code
@@ -110,9 +110,43 @@ class MopClient : MopPipelineManagerBase {
                   void (*cb)(MopErrCode errCode, void *userData),
                   void *userData);
 
+  //! Interval of the connecting retries of the non-blocking connect
+  static const uint32_t CONNECT_RETRY_MS = 1000;
+
+ private:
+  typedef struct ConnectCtx {
+    MopClient *client;
+    PipelineID id;
+    MopPipeline *p;
+    void (*cb)(MopErrCode errCode, MopPipeline *p, void *userData);
+    void *userData;
+    /*! Error before the connecting, reported without connecting */
+    MopErrCode errCode;
+    int32_t ret;
+  } ConnectCtx;
+
+  typedef struct DisconnectCtx {
+    void *channelHandle;
+    void (*cb)(MopErrCode errCode, void *userData);
+    void *userData;
+    int32_t ret;
+  } DisconnectCtx;
+
+  MopErrCode createChannel(PipelineID id, PipelineType type, MopPipeline *&p);
+  bool isConnecting(PipelineID id);
+
+  static void connectTask(void *arg);
+  static void connectDoneEvent(void *arg);
+  static void connectRetryEvent(void *arg);
+  static void disconnectTask(void *arg);
+  static void disconnectDoneEvent(void *arg);
+
  private:
   Vehicle *vehicle;
   SlotType slot;
+  /*! Pipelines of the non-blocking connect still connecting */
+  std::mutex connectMutex;
+  std::set<PipelineID> connectingIds;
 };
 
 }
@@ -0,0 +1,144 @@
+
+/** @file dji_mop_event_loop.hpp
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ *  @brief Event loop of the asynchronous mop apis
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#ifndef DJI_MOP_EVENT_LOOP_HPP
+#define DJI_MOP_EVENT_LOOP_HPP
+
+#include <stdint.h>
+#include <deque>
+#include <list>
+#include <mutex>
+#include "dji_singleton.hpp"
+#include "osdk_osal.h"
+
+namespace DJI {
+namespace OSDK {
+
+/*! @brief Event loop behind the non-blocking mop apis
+ *
+ * @details All the callbacks of the non-blocking apis of MopClient,
+ * MopServer and MopPipeline are called on the single task of this loop, so
+ * an application can drive many pipelines from its callbacks without a
+ * thread of its own per pipeline.
+ *
+ * The mop library only offers blocking calls, without a timeout or a way to
+ * poll a channel. The calls which end by themselves (send, connect, close)
+ * are queued to a fixed set of WORKER_NUM worker tasks shared by all the
+ * pipelines. The calls which wait for the peer without bound (receive,
+ * accept) each keep a waiter task of their own until they return: a
+ * receiving pipeline or a pending accept costs one task, whatever the
+ * number of pipelines driven by the loop.
+ *
+ * The loop is started by the first event posted and runs until the process
+ * exits, so do the workers once created.
+ */
+class MopEventLoop : public Singleton<MopEventLoop> {
+ public:
+  typedef void (*EventFunc)(void *arg);
+
+  //! Longest time the loop task sleeps without an event
+  static const uint32_t MAX_WAIT_MS = 100;
+  //! Tasks shared by the blocking calls, created as the calls queue up
+  static const uint32_t WORKER_NUM = 4;
+
+  MopEventLoop();
+  ~MopEventLoop();
+
+  /*!
+   * @brief Run func(arg) on the loop task.
+   * @param delayMs delay before it runs, 0 to run it after the events
+   * already posted
+   * @return false if the loop could not be started, func is then not run
+   */
+  bool post(EventFunc func, void *arg, uint32_t delayMs = 0);
+
+  /*!
+   * @brief Run a blocking func(arg) on one of the worker tasks, in the order
+   * it is queued. func must return by itself, a call which waits for the
+   * peer holds a worker and delays the others. func passes its result back
+   * with post().
+   * @return false if no worker could be started, func is then not run
+   */
+  bool runBlocking(EventFunc func, void *arg, const char *name);
+
+  /*!
+   * @brief Run a func(arg) which may wait without bound on a new waiter
+   * task, which is reclaimed by the loop once func returns. func passes its
+   * result back with post().
+   * @return false if the task could not be created, func is then not run
+   */
+  bool runWaiter(EventFunc func, void *arg, const char *name);
+
+ private:
+  typedef struct Event {
+    EventFunc func;
+    void *arg;
+    uint32_t dueMs;
+  } Event;
+
+  typedef struct Waiter {
+    MopEventLoop *owner;
+    EventFunc func;
+    void *arg;
+    T_OsdkTaskHandle handle;
+  } Waiter;
+
+  MopEventLoop(const MopEventLoop &);
+  MopEventLoop &operator=(const MopEventLoop &);
+
+  bool start();
+  bool startWorker();
+  uint32_t runEvents();
+
+  static void *loopTask(void *arg);
+  static void *workerTask(void *arg);
+  static void *waiterTask(void *arg);
+
+ private:
+  std::mutex eventMutex;
+  std::deque<Event> events;
+  //! Delayed events, few enough to be scanned
+  std::list<Event> timers;
+  std::list<Waiter *> exitedWaiters;
+  //! Blocking calls not yet taken by a worker
+  std::deque<Event> jobs;
+
+  bool isStarted;
+  T_OsdkSemHandle wakeSem;
+  T_OsdkTaskHandle loopHandle;
+
+  T_OsdkSemHandle jobSem;
+  T_OsdkTaskHandle workerHandles[WORKER_NUM];
+  uint32_t workerNum;
+  uint32_t idleWorkerNum;
+};
+
+}  // namespace OSDK
+}  // namespace DJI
+
+#endif  // DJI_MOP_EVENT_LOOP_HPP
@@ -0,0 +1,237 @@
+
+/** @file dji_mop_file_transfer.hpp
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ *  @brief Pipelined file transfer over a mop pipeline
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#ifndef DJI_MOP_FILE_TRANSFER_HPP
+#define DJI_MOP_FILE_TRANSFER_HPP
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "dji_mop_pipeline.hpp"
+#include "osdk_md5.h"
+#include "osdk_osal.h"
+
+namespace DJI {
+namespace OSDK {
+
+/*! @brief Send or receive a file over a reliable mop pipeline
+ *
+ * @details Both ends run this class, one calls sendFile and the other
+ * recvFile. The sender keeps up to windowNum chunks read ahead and in
+ * flight, and the receiver acknowledges the bytes written to disk every
+ * windowNum / 2 chunks, so the transfer is not bound by the round trip:
+ * - the sender reads and hashes the file on a reader task while the
+ *   chunks already read are sent,
+ * - the receiver writes and hashes on a writer task while the next chunks
+ *   are received.
+ *
+ * The MD5 of the file is computed as the chunks pass and checked by the
+ * receiver at the end. If the receiver already has the beginning of the
+ * file, e.g. from an interrupted transfer, only the rest is sent once the
+ * sender has checked the MD5 of that part. A part which does not match, or
+ * a file failing the final check, is truncated by the receiver, so the
+ * next transfer of it starts over.
+ *
+ * Messages, one per mop write, start with a MopFileTransfer::MsgHeader:
+ * - START (sender): file size, chunk size, window and file name
+ * - START_ACK (receiver): resume offset, granted chunk size and window,
+ *   MD5 of the part up to the resume offset
+ * - DATA (sender): one chunk at the offset of the header
+ * - ACK (receiver): bytes written from the start of the file
+ * - END (sender): MD5 of the whole file
+ * - RESULT (receiver): MOP_PASSED if the MD5 matches
+ * - ABORT (both): the transfer is given up, MOP_CRC from the sender if the
+ *   part of the receiver is not from the file
+ */
+class MopFileTransfer {
+ public:
+  static const uint32_t DEFAULT_CHUNK_SIZE = 60 * 1024;
+  static const uint32_t DEFAULT_WINDOW_NUM = 8;
+  static const uint32_t MAX_CHUNK_SIZE = 1024 * 1024;
+  static const uint32_t MAX_WINDOW_NUM = 64;
+  static const uint32_t FILE_NAME_MAX_LEN = 64;
+  //! Longest time without progress from the peer
+  static const uint32_t PEER_TIMEOUT_MS = 5000;
+
+  typedef enum MsgCmd : uint8_t {
+    MSG_START = 0x70,
+    MSG_START_ACK = 0x71,
+    MSG_DATA = 0x72,
+    MSG_ACK = 0x73,
+    MSG_END = 0x74,
+    MSG_RESULT = 0x75,
+    MSG_ABORT = 0x76,
+  } MsgCmd;
+
+#pragma pack(1)
+  typedef struct MsgHeader {
+    uint8_t cmd;
+    /*! DJI::OSDK::MOP::MopErrCode of START_ACK, RESULT and ABORT */
+    uint8_t result;
+    uint16_t reserved;
+    uint32_t seq;
+    uint64_t offset;
+    uint32_t dataLen;
+  } MsgHeader;
+
+  typedef struct StartInfo {
+    uint64_t fileSize;
+    uint32_t chunkSize;
+    uint32_t windowNum;
+    char fileName[FILE_NAME_MAX_LEN];
+  } StartInfo;
+#pragma pack()
+
+  //! Called on the transfer tasks as the acknowledged bytes grow
+  typedef void (*ProgressCBType)(uint64_t doneSize, uint64_t fileSize,
+                                 void *userData);
+
+  /*!
+   * @param pipeline a RELIABLE pipeline, not used by others during the
+   * transfer
+   * @param chunkSize data bytes of one DATA message, the receiver may
+   * lower it
+   * @param windowNum chunks read ahead and in flight, the lower of both
+   * ends is used
+   */
+  MopFileTransfer(MopPipeline *pipeline,
+                  uint32_t chunkSize = DEFAULT_CHUNK_SIZE,
+                  uint32_t windowNum = DEFAULT_WINDOW_NUM);
+  ~MopFileTransfer();
+
+  void setProgressCallback(ProgressCBType cb, void *userData);
+
+  /*!
+   * @brief Send a file, blocks until the receiver has checked it.
+   * @param remoteName name given to the receiver, the file name of
+   * localPath if empty
+   * @return MOP_PASSED once the receiver reports a matching MD5
+   */
+  MopErrCode sendFile(const std::string &localPath,
+                      const std::string &remoteName = "");
+
+  /*!
+   * @brief Receive a file into localDir, blocks until it is checked. A file
+   * of the same name is resumed.
+   * @param fileName name of the received file
+   * @return MOP_PASSED if the MD5 matches
+   */
+  MopErrCode recvFile(const std::string &localDir, std::string &fileName);
+
+  /*! @brief Give up the running transfer, it returns MOP_CONNECTIONCLOSE.
+   *  A receiver blocked in a read only notices it with the next message.
+   *  Called before sendFile or recvFile starts, that transfer returns at
+   *  once; the stop is cleared when a transfer returns.
+   */
+  void stop();
+
+  /*! @brief MD5 of the last file sent or received */
+  void getDigest(uint8_t md5[MD5_BLOCK_SIZE]);
+
+ private:
+  typedef struct Chunk {
+    std::vector<uint8_t> buf;
+    uint32_t dataLen;
+  } Chunk;
+
+  MopFileTransfer(const MopFileTransfer &);
+  MopFileTransfer &operator=(const MopFileTransfer &);
+
+  //! Clears the state of a transfer, in the constructor and once it returns
+  void reset();
+  MopErrCode runSend(const std::string &localPath,
+                     const std::string &remoteName);
+  MopErrCode runRecv(const std::string &localDir, std::string &fileName);
+  void setError(MopErrCode err);
+  MopErrCode sendMsg(uint8_t cmd, uint8_t result, uint64_t offset,
+                     const void *data, uint32_t dataLen);
+  bool hashFile(int fd, uint64_t size);
+  void reportProgress(uint64_t doneSize);
+
+  bool readChunks();
+  static void *readerTask(void *arg);
+  static void senderRecvCB(MopErrCode errCode, uint8_t *data, uint32_t len,
+                           void *userData);
+
+  void writeChunks();
+  static void *writerTask(void *arg);
+
+  bool startTask(void *(*taskFunc)(void *), const char *name);
+  void joinTask();
+
+ private:
+  MopPipeline *pipeline;
+  uint32_t chunkSize;
+  uint32_t windowNum;
+  ProgressCBType progressCB;
+  void *progressUserData;
+
+  std::mutex mutex;
+  std::condition_variable cond;
+  MopErrCode error;
+  std::atomic<bool> isStopped;
+
+  int fd;
+  uint64_t fileSize;
+  uint64_t resumeOffset;
+  uint32_t chunkNum;
+  MD5_CTX md5Ctx;
+  uint8_t digest[MD5_BLOCK_SIZE];
+
+  /*! Chunk seq is at chunks[seq % windowNum]. Sender: chunks below readSeq
+   *  are read, below sentSeq sent and below ackedSeq acknowledged.
+   *  Receiver: the free chunks are in freeChunks, the received ones wait in
+   *  recvChunks for the writer. */
+  std::vector<Chunk> chunks;
+  uint32_t readSeq;
+  uint32_t sentSeq;
+  uint32_t ackedSeq;
+  std::deque<Chunk *> freeChunks;
+  std::deque<Chunk *> recvChunks;
+  /*! Bytes from the start of the file the peer has acknowledged, or the
+   *  receiver has written */
+  uint64_t doneOffset;
+  /*! Sender: MD5 of the receiver's part up to resumeOffset */
+  uint8_t peerPrefixDigest[MD5_BLOCK_SIZE];
+  bool isStartAcked;
+  bool isResultRecved;
+  /*! Receiver: no more chunks for the writer */
+  bool isRecvDone;
+  bool isTaskDone;
+
+  T_OsdkTaskHandle taskHandle;
+};
+
+}  // namespace OSDK
+}  // namespace DJI
+
+#endif  // DJI_MOP_FILE_TRANSFER_HPP
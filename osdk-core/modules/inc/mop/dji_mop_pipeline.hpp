@@ -30,6 +30,7 @@
 #define DJI_MOP_PIPELINE_HPP
 
 #include <stdint.h>
+#include <memory>
 #include "dji_mop_define.hpp"
 
 using namespace DJI::OSDK;
@@ -51,6 +52,18 @@ class MopPipeline {
     uint32_t length;
   } DataPackType;
 
+  /*! Callbacks of the non-blocking apis, called on the MopEventLoop task */
+  typedef void (*SendCBType)(MopErrCode errCode, uint32_t len, void *userData);
+  typedef void (*RecvCBType)(MopErrCode errCode, uint8_t *data, uint32_t len,
+                             void *userData);
+
+  //! Received packs kept for tryRecvData, the oldest are dropped beyond it
+  static const uint32_t MAX_RECV_QUEUE_NUM = 64;
+  //! Largest gather or scatter buffer a pipeline keeps between two calls
+  static const uint32_t MAX_KEPT_GATHER_SIZE = 256 * 1024;
+  //! Queued sends written in a row before the worker is left to the others
+  static const uint32_t MAX_SEND_BURST_NUM = 16;
+
  public:
   /*! @brief Send data packet to the pipeline
    *
@@ -76,6 +89,102 @@ class MopPipeline {
    */
   MopErrCode recvData(DataPackType dataPacket, uint32_t *len);
 
+  /*! @brief Send several data packets as one message, e.g. a header, a file
+   *  chunk and a trailer without assembling them first
+   *
+   *  @platforms M300
+   *  @note This is a blocking api. This is not zero-copy: the mop library
+   *  only writes a single buffer and has no vectored write. Packets
+   *  adjacent in memory are sent as they are, others are copied into a
+   *  buffer of the pipeline, which is freed after the send if it is larger
+   *  than MAX_KEPT_GATHER_SIZE.
+   *  @param dataPackets Array of the data packets to be sent
+   *  @param packNum Number of data packets
+   *  @param len The result of sent-byte counts
+   *  @return ref to the enum DJI::OSDK::MOP::MopErrCode
+   */
+  MopErrCode sendData(const DataPackType *dataPackets, uint32_t packNum,
+                      uint32_t *len);
+
+  /*! @brief Receive one message into several data packets, filled in order
+   *
+   *  @platforms M300
+   *  @note This is a blocking api. This is not zero-copy either: with one
+   *  packet the data is read into it directly, otherwise it is read into a
+   *  buffer of the pipeline, freed the same way, and copied to the
+   *  packets.
+   *  @param dataPackets Array of the buffers to be filled
+   *  @param packNum Number of buffers
+   *  @param len The result of reveived-byte counts
+   *  @return ref to the enum DJI::OSDK::MOP::MopErrCode
+   */
+  MopErrCode recvData(const DataPackType *dataPackets, uint32_t packNum,
+                      uint32_t *len);
+
+  /*! @brief Send data packet to the pipeline
+   *
+   *  @platforms M300
+   *  @note This is a non-blocking api. The sends of a pipeline are done in
+   *  the order they are queued, on the worker tasks of MopEventLoop shared
+   *  by all the pipelines.
+   *  @param dataPacket The data packet to be sent, it has to stay valid until
+   *  the callback is called
+   *  @param cb Callback function defined by user, may be NULL
+   *  @arg @b errCode is the DJI::OSDK::MOP::MopErrCode error code
+   *  @arg @b len sent-byte counts
+   *  @arg @b userData the interface to pass userData in when the callback is
+   * called
+   *  @param userData when UserCallBack is called, used in UserCallBack
+   *  @return MOP_PASSED if the send is queued
+   */
+  MopErrCode sendData(DataPackType dataPacket, SendCBType cb, void *userData);
+
+  /*! @brief Start receiving in background
+   *
+   *  @platforms M300
+   *  @note This is a non-blocking api. Each read of up to bufSize bytes is
+   *  passed to cb. With cb NULL the data is kept until it is polled with
+   *  tryRecvData. A read error is passed to cb and ends the receiving. The
+   *  mop library cannot poll a channel, so the reads are done on a task of
+   *  this pipeline until the receiving ends.
+   *  @param bufSize Largest length of one read
+   *  @param cb Callback function defined by user, may be NULL
+   *  @arg @b errCode is the DJI::OSDK::MOP::MopErrCode error code
+   *  @arg @b data received data, only valid during the callback
+   *  @arg @b len reveived-byte counts
+   *  @arg @b userData the interface to pass userData in when the callback is
+   * called
+   *  @param userData when UserCallBack is called, used in UserCallBack
+   *  @return MOP_RESBUSY if the pipeline is already receiving
+   */
+  MopErrCode startRecvData(uint32_t bufSize, RecvCBType cb, void *userData);
+
+  /*! @brief Stop receiving in background. No callback is called once it
+   *  returns. The pending read ends with the next data, which is dropped,
+   *  or with the close of the pipeline; startRecvData returns MOP_RESBUSY
+   *  until then.
+   *
+   *  @platforms M300
+   */
+  void stopRecvData();
+
+  /*! @brief Copy the data received in background
+   *
+   *  @platforms M300
+   *  @note This is a non-blocking api, only for startRecvData without cb
+   *  @param dataPacket The buffer to be filled
+   *  @param len Copied-byte counts
+   *  @return MOP_NOTREADY if no data is received, the error ending the
+   *  receiving once all its data is copied
+   */
+  MopErrCode tryRecvData(DataPackType dataPacket, uint32_t *len);
+
+  /*! @brief Byte counts tryRecvData can copy without waiting
+   *
+   *  @platforms M300
+   */
+  uint32_t getRecvReadySize();
+
   void *channelHandle;
 
   /*! @brief Get the pipeline id of the pipeline
@@ -91,9 +200,21 @@ class MopPipeline {
    *  @return ref to the enum DJI::OSDK::MOP::PipelineType
    */
   PipelineType getType();
+ private:
+  struct AsyncState;
+  typedef std::shared_ptr<AsyncState> AsyncStatePtr;
+
+  static void sendTask(void *arg);
+  static void sendDoneEvent(void *arg);
+  static void recvTask(void *arg);
+  static void recvDoneEvent(void *arg);
+
  private:
   PipelineID id;
   PipelineType type;
+  /*! Shared with the tasks of the non-blocking apis, which may outlive the
+   *  pipeline object */
+  AsyncStatePtr asyncState;
 
 };
 }  // namespace OSDK
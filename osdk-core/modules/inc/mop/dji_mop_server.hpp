@@ -61,6 +61,30 @@ class MopServer : MopPipelineManagerBase {
    */
   MopErrCode accept(PipelineID id, PipelineType type, MopPipeline *&p);
 
+  /*! @brief Accept the connecting request from target device with properties of
+   * a pipelineid and pipeline type. If success, a pipeline object will be
+   * created.
+   *
+   *  @platforms M300
+   *  @note This is a non-blocking api. The pipeline id is taken at once, a
+   *  second accept of it returns MOP_RESOCCUPIED until the callback. The
+   *  accept waits on a task of its own until a client connects.
+   *  @param id The pipeline id which to be connected, ref to
+   * DJI::OSDK::MOP::PipelineID
+   *  @param type The pipeline type. It can be set to be RELIABLE or UBRELIABLE
+   *  ref to the enum DJI::OSDK::MOP::PipelineType
+   *  @param cb Callback function defined by user
+   *  @arg @b errCode is the DJI::OSDK::MOP::MopErrCode error code
+   *  @arg @b p The pointer of pipeline. If success, it will be pointed to be the
+   *  target pipeline object.
+   *  @arg @b userData the interface to pass userData in when the callback is
+   * called
+   *  @param userData when UserCallBack is called, used in UserCallBack
+   */
+  void accept(PipelineID id, PipelineType type,
+              void (*cb)(MopErrCode errCode, MopPipeline *p, void *userData),
+              void *userData);
+
   /*! @brief Close the target pipeline by a pipelineid.
    *
    *  @platforms M300
@@ -70,6 +94,23 @@ class MopServer : MopPipelineManagerBase {
    *  @return ref to the enum DJI::OSDK::MOP::MopErrCode
    */
   MopErrCode close(PipelineID id);
+ private:
+  typedef struct AcceptCtx {
+    PipelineID id;
+    MopPipeline *p;
+    void *bindHandle;
+    void (*cb)(MopErrCode errCode, MopPipeline *p, void *userData);
+    void *userData;
+    /*! Error before the accepting, reported without accepting */
+    MopErrCode errCode;
+    int32_t ret;
+  } AcceptCtx;
+
+  MopErrCode bindChannel(PipelineID id, PipelineType type, void *&bindHandle);
+
+  static void acceptTask(void *arg);
+  static void acceptDoneEvent(void *arg);
+
  private:
   Vehicle *vehicle;
 };
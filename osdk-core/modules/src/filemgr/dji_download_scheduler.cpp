@@ -0,0 +1,285 @@
+/** @file dji_download_scheduler.cpp
+ *  @version 4.0
+ *  @date July 2020
+ *
+ *  @brief Scheduler of the file downloads of several devices
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "dji_download_scheduler.hpp"
+#include "dji_platform.hpp"
+#include "dji_log.hpp"
+
+using namespace DJI;
+using namespace DJI::OSDK;
+
+DownloadScheduler::DownloadScheduler(uint32_t maxActiveNum)
+    : maxActiveNum(maxActiveNum ? maxActiveNum : 1),
+      activeNum(0),
+      nextReqId(INVALID_REQ_ID + 1),
+      rrIndex(0),
+      wakeSem(NULL),
+      schedulerHandle(NULL),
+      isRunning(true),
+      isTaskExited(false) {
+  if (OsdkOsal_SemaphoreCreate(&wakeSem, 0) != OSDK_STAT_OK) {
+    DERROR("Download scheduler semaphore create failed");
+    wakeSem = NULL;
+  }
+  if (!Platform::instance().taskCreate(&schedulerHandle, schedulerTask,
+                                       OSDK_TASK_STACK_SIZE_DEFAULT, this,
+                                       OSDK_TASK_CLASS_FILE_TRANSFER,
+                                       "dlScheduler")) {
+    DERROR("Download scheduler task create failed");
+    schedulerHandle = NULL;
+    isTaskExited = true;
+  }
+}
+
+DownloadScheduler::~DownloadScheduler() {
+  isRunning = false;
+  if (wakeSem) OsdkOsal_SemaphorePost(wakeSem);
+  while (!isTaskExited) {
+    OsdkOsal_TaskSleepMs(10);
+  }
+  if (schedulerHandle) Platform::instance().taskDestroy(schedulerHandle);
+
+  /*! Stop the running downloads first, their callbacks use the requests */
+  std::vector<FileMgr *> runningMgrs;
+  {
+    std::lock_guard<std::mutex> lock(reqMutex);
+    for (auto &dev : devices) {
+      if (dev->active) runningMgrs.push_back(dev->fileMgr);
+    }
+  }
+  for (auto &mgr : runningMgrs) {
+    mgr->stopReqFileData();
+  }
+
+  for (auto &item : requests) {
+    delete item.second;
+  }
+  for (auto &dev : devices) {
+    delete dev;
+  }
+  if (wakeSem) OsdkOsal_SemaphoreDestroy(wakeSem);
+}
+
+DownloadScheduler::Device *DownloadScheduler::getDevice(FileMgr *fileMgr) {
+  for (auto &dev : devices) {
+    if (dev->fileMgr == fileMgr) return dev;
+  }
+  Device *dev = new Device;
+  dev->fileMgr = fileMgr;
+  dev->active = NULL;
+  devices.push_back(dev);
+  return dev;
+}
+
+DownloadScheduler::ReqId DownloadScheduler::addReqFileData(
+    FileMgr *fileMgr, int fileIndex, std::string localPath, FileDoneCBType cb,
+    void *userData) {
+  if (!fileMgr || localPath.empty()) {
+    DERROR("Invalid download request params");
+    return INVALID_REQ_ID;
+  }
+
+  Request *req = new Request;
+  req->owner = this;
+  req->fileMgr = fileMgr;
+  req->fileIndex = fileIndex;
+  req->localPath = localPath;
+  req->cb = cb;
+  req->userData = userData;
+  req->state = DOWNLOAD_QUEUED;
+  req->ret = OSDK_STAT_ERR;
+  {
+    std::lock_guard<std::mutex> lock(reqMutex);
+    req->reqId = nextReqId++;
+    if (nextReqId == INVALID_REQ_ID) nextReqId++;
+    requests[req->reqId] = req;
+    getDevice(fileMgr)->queue.push_back(req);
+  }
+  if (wakeSem) OsdkOsal_SemaphorePost(wakeSem);
+
+  return req->reqId;
+}
+
+bool DownloadScheduler::cancelReqFileData(ReqId reqId) {
+  FileMgr *runningMgr = NULL;
+  {
+    std::lock_guard<std::mutex> lock(reqMutex);
+    auto it = requests.find(reqId);
+    if (it == requests.end()) return false;
+    Request *req = it->second;
+
+    if (req->state == DOWNLOAD_QUEUED) {
+      Device *dev = getDevice(req->fileMgr);
+      for (auto q = dev->queue.begin(); q != dev->queue.end(); ++q) {
+        if (*q == req) {
+          dev->queue.erase(q);
+          break;
+        }
+      }
+      req->state = DOWNLOAD_CANCELED;
+      req->ret = OSDK_STAT_ERR;
+      doneRequests.push_back(req);
+    } else if (req->state == DOWNLOAD_RUNNING) {
+      /*! Finished by the FileMgr callback, which keeps this state */
+      req->state = DOWNLOAD_CANCELED;
+      runningMgr = req->fileMgr;
+    } else {
+      return false;
+    }
+  }
+
+  /*! The FileMgr calls its callback from here, not under the lock */
+  if (runningMgr) runningMgr->stopReqFileData();
+  if (wakeSem) OsdkOsal_SemaphorePost(wakeSem);
+  return true;
+}
+
+bool DownloadScheduler::getProgress(ReqId reqId, DownloadProgress &progress) {
+  std::lock_guard<std::mutex> lock(reqMutex);
+  auto it = requests.find(reqId);
+  if (it == requests.end()) return false;
+  Request *req = it->second;
+
+  progress.state = req->state;
+  progress.recvSize = 0;
+  progress.fileSize = 0;
+  if ((req->state == DOWNLOAD_RUNNING)
+      && (getDevice(req->fileMgr)->active == req)) {
+    req->fileMgr->getFileDataProgress(progress.recvSize, progress.fileSize);
+  }
+  return true;
+}
+
+uint32_t DownloadScheduler::getPendingNum() {
+  std::lock_guard<std::mutex> lock(reqMutex);
+  return requests.size() - doneRequests.size();
+}
+
+void DownloadScheduler::fileDataReqCB(E_OsdkStat ret_code, void *userData) {
+  Request *req = (Request *) userData;
+  if (!req) return;
+  DownloadScheduler *owner = req->owner;
+  {
+    std::lock_guard<std::mutex> lock(owner->reqMutex);
+    Device *dev = owner->getDevice(req->fileMgr);
+    if (dev->active != req) return;
+    dev->active = NULL;
+    owner->activeNum--;
+    if (req->state != DOWNLOAD_CANCELED) {
+      req->state = (ret_code == OSDK_STAT_OK) ? DOWNLOAD_FINISHED : DOWNLOAD_FAILED;
+    }
+    req->ret = ret_code;
+    owner->doneRequests.push_back(req);
+  }
+  if (owner->wakeSem) OsdkOsal_SemaphorePost(owner->wakeSem);
+}
+
+void DownloadScheduler::startRequests() {
+  std::vector<Request *> toStart;
+  {
+    std::lock_guard<std::mutex> lock(reqMutex);
+    uint32_t devNum = devices.size();
+    for (uint32_t i = 0; (i < devNum) && (activeNum < maxActiveNum); i++) {
+      Device *dev = devices[(rrIndex + i) % devNum];
+      /*! A request started outside of the scheduler also holds the device */
+      if (dev->active || dev->queue.empty() || !dev->fileMgr->isReqFileDataIdle()) {
+        continue;
+      }
+      Request *req = dev->queue.front();
+      dev->queue.pop_front();
+      req->state = DOWNLOAD_RUNNING;
+      dev->active = req;
+      activeNum++;
+      toStart.push_back(req);
+      rrIndex = (rrIndex + i + 1) % devNum;
+    }
+  }
+
+  for (auto &req : toStart) {
+    DSTATUS("Start download request %d : file index %d to %s", req->reqId,
+            req->fileIndex, req->localPath.c_str());
+    ErrorCode::ErrorCodeType ret = req->fileMgr->startReqFileData(
+        req->fileIndex, req->localPath, fileDataReqCB, req);
+    bool isCanceled = false;
+    {
+      std::lock_guard<std::mutex> lock(reqMutex);
+      if (ret != ErrorCode::SysCommonErr::Success) {
+        DERROR("Start download request %d failed, ret = 0x%llX", req->reqId, (unsigned long long) ret);
+      }
+      /*! A failed start without leaving idle will not call the callback */
+      if ((ret != ErrorCode::SysCommonErr::Success)
+          && req->fileMgr->isReqFileDataIdle()
+          && (getDevice(req->fileMgr)->active == req)) {
+        getDevice(req->fileMgr)->active = NULL;
+        activeNum--;
+        if (req->state != DOWNLOAD_CANCELED) req->state = DOWNLOAD_FAILED;
+        req->ret = OSDK_STAT_ERR;
+        doneRequests.push_back(req);
+      } else {
+        /*! Canceled while starting, the stop could not abort it yet */
+        isCanceled = (req->state == DOWNLOAD_CANCELED);
+      }
+    }
+    if (isCanceled) req->fileMgr->stopReqFileData();
+  }
+}
+
+void DownloadScheduler::finishRequests() {
+  std::list<Request *> finished;
+  {
+    std::lock_guard<std::mutex> lock(reqMutex);
+    finished.swap(doneRequests);
+    for (auto &req : finished) {
+      requests.erase(req->reqId);
+    }
+  }
+
+  for (auto &req : finished) {
+    DSTATUS("Download request %d done, state = %d", req->reqId, req->state);
+    if (req->cb) req->cb(req->ret, req->reqId, req->userData);
+    delete req;
+  }
+}
+
+void *DownloadScheduler::schedulerTask(void *arg) {
+  DownloadScheduler *scheduler = (DownloadScheduler *) arg;
+  if (!scheduler) return NULL;
+
+  while (scheduler->isRunning) {
+    if (scheduler->wakeSem) {
+      OsdkOsal_SemaphoreTimedWait(scheduler->wakeSem, SCHEDULE_PERIOD_MS);
+    } else {
+      OsdkOsal_TaskSleepMs(SCHEDULE_PERIOD_MS);
+    }
+    if (!scheduler->isRunning) break;
+    scheduler->finishRequests();
+    scheduler->startRequests();
+  }
+  scheduler->isTaskExited = true;
+  return NULL;
+}
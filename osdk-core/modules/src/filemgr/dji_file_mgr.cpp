@@ -52,6 +52,26 @@ ErrorCode::ErrorCodeType FileMgr::startReqFileList(FileListReqCBType cb, void* u
   return impl->startReqFileList(cb, userData);
 }
 
+ErrorCode::ErrorCodeType FileMgr::startReqFileList(FileListReqCBType cb, FileListPageCBType pageCB, void* userData) {
+  return impl->startReqFileList(cb, userData, pageCB);
+}
+
 ErrorCode::ErrorCodeType FileMgr::startReqFileData(int fileIndex, std::string localPath, FileDataReqCBType cb, void* userData) {
   return impl->startReqFileData(fileIndex, localPath, cb, userData);
 }
+
+ErrorCode::ErrorCodeType FileMgr::stopReqFileData() {
+  return impl->stopReqFileData();
+}
+
+bool FileMgr::isReqFileDataIdle() {
+  return impl->isReqFileDataIdle();
+}
+
+void FileMgr::getFileDataProgress(uint64_t &recvSize, uint64_t &fileSize) {
+  impl->getFileDataProgress(recvSize, fileSize);
+}
+
+void FileMgr::setRecvWindow(uint32_t windowSize) {
+  impl->setRecvWindow(windowSize);
+}
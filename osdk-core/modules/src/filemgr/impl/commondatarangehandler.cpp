@@ -18,6 +18,19 @@ uint32_t CommonDataRangeHandler::GetLastNotReceiveSeq() {
     return m_lastNotReceivedSeq;
 }
 
+uint32_t CommonDataRangeHandler::GetExpectSeq() {
+    return m_noAckRanges.empty() ? m_lastNotReceivedSeq : m_noAckRanges.front().seq_num;
+}
+
+bool CommonDataRangeHandler::IsNewSeq(uint32_t seqNum, uint32_t confirmSeq, uint32_t bufSize) {
+    if (seqNum > confirmSeq + bufSize) return false;
+    if (seqNum >= m_lastNotReceivedSeq) return true;
+    for (auto &range : m_noAckRanges) {
+        if (seqNum >= range.seq_num && seqNum < range.seq_num + range.length) return true;
+    }
+    return false;
+}
+
 bool CommonDataRangeHandler::IsResentAllNeeded() {
     return m_is_resent_all;
 }
@@ -28,12 +41,14 @@ void CommonDataRangeHandler::DeInit() {
   m_is_resent_all = false;
 }
 
-void CommonDataRangeHandler::AddSeqIndex(uint32_t seqNum, uint32_t confirmSeq, uint32_t bufSize) {
+bool CommonDataRangeHandler::AddSeqIndex(uint32_t seqNum, uint32_t confirmSeq, uint32_t bufSize) {
+    bool isNewSeq = false;
     do {
         if (seqNum > confirmSeq + bufSize) {
             // Logic should not go to here, because buffering seq will return false if (seqNum > confirmSeq + bufSize)
             break;
         } else {
+            isNewSeq = true;
             if (seqNum == m_lastNotReceivedSeq) {
                 m_lastNotReceivedSeq++;
                 break;
@@ -43,6 +58,8 @@ void CommonDataRangeHandler::AddSeqIndex(uint32_t seqNum, uint32_t confirmSeq, u
                 m_lastNotReceivedSeq = seqNum + 1;
                 break;
             } else {
+                // 不在任何range中就是重复包
+                isNewSeq = false;
                 // 小于当前期待收包seq，看是否在需要重传range之中
                 for (auto&& range = m_noAckRanges.begin(); range < m_noAckRanges.end(); ++range) {
                     if (seqNum < range->seq_num) {
@@ -50,6 +67,7 @@ void CommonDataRangeHandler::AddSeqIndex(uint32_t seqNum, uint32_t confirmSeq, u
                         continue;
                     } else if (range->seq_num == seqNum) {
                         // 等于当前Range最小值
+                        isNewSeq = true;
                         if (range->length <= 1) {
                             m_noAckRanges.erase(range);
                             break;
@@ -59,13 +77,15 @@ void CommonDataRangeHandler::AddSeqIndex(uint32_t seqNum, uint32_t confirmSeq, u
                         break;
                     } else if (seqNum > range->seq_num && seqNum < range->seq_num + range->length - 1) {
                         // 在当前Range中间位置，拆分为两个Range
+                        isNewSeq = true;
                         Range rangeLeft = {range->seq_num, seqNum - range->seq_num};
                         Range rangeRight = {seqNum + 1, range->seq_num + range->length - seqNum - 1};
                         *range = rangeLeft;
-                        m_noAckRanges.insert(range, rangeRight);
+                        m_noAckRanges.insert(range + 1, rangeRight);
                         break;
                     } else if (range->seq_num + range->length - 1 == seqNum) {
                         // 等于当前Range最大值
+                        isNewSeq = true;
                         if (range->length <= 1) {
                             m_noAckRanges.erase(range);
                             break;
@@ -80,6 +100,7 @@ void CommonDataRangeHandler::AddSeqIndex(uint32_t seqNum, uint32_t confirmSeq, u
             }
         }
     } while (false);
+    return isNewSeq;
 }
 }  // namespace OSDK
 
@@ -35,17 +35,52 @@
 #include "osdk_protocol.h"
 #include "dji_internal_command.hpp"
 #include "dji_log.hpp"
+#include "download_journal.hpp"
 
 using namespace DJI;
 using namespace DJI::OSDK;
 
 #define V1_HEADR_AND_CRC_LEN (11 + 2)
 
+/*! 10 bytes header + 5 bytes ack + 100 * 8 bytes loss desc stays below the
+ *  1024 bytes package limit with the v1 framing */
+#define MAX_LOSS_DESC_NUM_PER_ACK 100
+/*! A burst loss opens one gap per pack, ack them together */
+#define GAP_ACK_MIN_INTERVAL_MS 10
+/*! Repeat the missed ack while gaps are left, in case the ack is lost */
+#define MISSED_ACK_INTERVAL_MS 100
+#define DEFAULT_RECV_WINDOW 1024
+
+typedef struct RecvWindowItem {
+  E_OSDKCommandDeiveType type;
+  uint32_t windowSize;
+} RecvWindowItem;
+
+/*! Receive window in packs for each device type, the camera pushes over the
+ *  usb bulk link and keeps much more packs in flight */
+static const RecvWindowItem recvWindowTbl[] = {
+    {OSDK_COMMAND_DEVICE_TYPE_CAMERA, 8192},
+    {OSDK_COMMAND_DEVICE_TYPE_GIMBAL, 2048},
+};
+
+std::mutex FileMgrImpl::instanceMutex;
+std::vector<FileMgrImpl *> FileMgrImpl::instances;
+
+FileMgrImpl *FileMgrImpl::findInstance(uint8_t sender) {
+  std::lock_guard<std::mutex> lock(instanceMutex);
+  /*! @TODO fix H20T route, the sender may not be the device itself */
+  if (instances.size() == 1) return instances[0];
+  for (auto &impl : instances) {
+    if (OSDK_COMMAND_DEVICE_ID(impl->type, impl->index) == sender) return impl;
+  }
+  return NULL;
+}
+
 E_OsdkStat downloadFileAckCB(struct _CommandHandle *cmdHandle,
                                       const T_CmdInfo *cmdInfo,
                                       const uint8_t *cmdData,
                                       void *userData) {
-  if ((!cmdInfo) || (!userData)){
+  if (!cmdInfo){
     DERROR("Recv Info is a null value");
     return OSDK_STAT_ERR;
   }
@@ -84,8 +119,13 @@ E_OsdkStat downloadFileAckCB(struct _CommandHandle *cmdHandle,
     /*! 4.Do V1 packet unpacking */
     if (V1_ops.Unpack(NULL, (uint8_t *) (cmdData + usedDataCnt), &V1_info, buffer)
         == OSDK_STAT_OK) {
-      FileMgrImpl *fileMgrImpl = (FileMgrImpl *) userData;
-      fileMgrImpl->HandlePushPack((dji_general_transfer_msg_ack *) buffer);
+      /*! Each device has its own FileMgr, dispatch by the v1 sender */
+      FileMgrImpl *fileMgrImpl = FileMgrImpl::findInstance(V1_info.sender);
+      if (fileMgrImpl) {
+        fileMgrImpl->HandlePushPack((dji_general_transfer_msg_ack *) buffer);
+      } else {
+        DERROR("No file manager for the download pack from 0x%02X", V1_info.sender);
+      }
       usedDataCnt += (V1_info.dataLen + V1_HEADR_AND_CRC_LEN);
     } else {
       DERROR("V1 unpack failed in downloading.");
@@ -100,6 +140,7 @@ E_OsdkStat downloadFileAckCB(struct _CommandHandle *cmdHandle,
 void FileMgrImpl::printFileDownloadStatus() {
     uint32_t lossPackCnt = 0;
     uint32_t recvPackCnt = 0;
+    std::lock_guard<std::mutex> lock(fileDataHandler->rangeMutex);
     for (auto &msg : fileDataHandler->range_handler_->GetNoAckRanges()) {
       lossPackCnt += msg.length;
     }
@@ -159,8 +200,11 @@ void FileMgrImpl::fileDataMonitorTask(void *arg) {
     uint32_t curTimeMs = 0;
     uint32_t preTimeMs = 0;
     uint32_t pollTimeMsInterval = 500;
+    uint32_t missedAckTimeMsInterval = MISSED_ACK_INTERVAL_MS;
     uint32_t taskTimeOutMs = 6000;
     FileMgrImpl *impl = (FileMgrImpl *)arg;
+    /*! A new request may start as soon as this one is finished */
+    uint32_t reqCnt = impl->fileDataHandler->reqCnt;
     OsdkOsal_GetTimeMs(&curTimeMs);
     impl->fileDataHandler->updateTimeMs = curTimeMs;
     for (;;)
@@ -176,11 +220,15 @@ void FileMgrImpl::fileDataMonitorTask(void *arg) {
 
         if (impl->fileDataHandler->downloadState == RECVING_FILE_DATA) {
           impl->SendAbortPack(DJI_GENERAL_DOWNLOAD_FILE_TASK_TYPE_FILE);
-          auto cb = impl->fileDataHandler->reqCB;
-          void *udata = impl->fileDataHandler->reqCBUserData;
-          if (cb) cb(OSDK_STAT_ERR, udata);
+          /*! Keep what is received, a new request for this file resumes */
+          impl->saveFileDataJournal();
+          {
+            std::unique_lock<std::mutex> lock(impl->fileDataHandler->rangeMutex);
+            impl->waitFileDataJournal(lock);
+            impl->fileDataHandler->mmap_file_buffer_->deInit();
+          }
           DSTATUS("Finish req filedata task cause of timeout, reset downloadState to be DOWNLOAD_IDLE");
-          impl->fileDataHandler->downloadState = DOWNLOAD_IDLE;
+          impl->finishReqFileData(OSDK_STAT_ERR);
         }
       } else if (curTimeMs - refreshTimeMs >= (taskTimeOutMs * 2 / 3)) {
         DSTATUS("The second time to wake up the pushing");
@@ -190,19 +238,31 @@ void FileMgrImpl::fileDataMonitorTask(void *arg) {
         impl->SendReqFileDataPack(impl->fileDataHandler->curTargetFileIndex);
       }
 
-      if (impl->fileDataHandler->downloadState == DOWNLOAD_IDLE) return;
+      if ((impl->fileDataHandler->downloadState == DOWNLOAD_IDLE)
+          || (impl->fileDataHandler->reqCnt != reqCnt)) return;
 
       if (curTimeMs - preTimeMs >=  pollTimeMsInterval)
       {
-        /*! Here to send the miss ack packs*/
+        /*! Here to send the confirming ack packs*/
         if (impl->fileDataHandler->downloadState == RECVING_FILE_DATA) {
           impl->printFileDownloadStatus();
           impl->SendMissedAckPack(DJI_GENERAL_DOWNLOAD_FILE_TASK_TYPE_FILE);
+          impl->saveFileDataJournal();
         }
         preTimeMs = curTimeMs;
+      } else if (curTimeMs - impl->fileDataHandler->lastAckTimeMs >= missedAckTimeMsInterval) {
+        /*! Gaps are acked when detected, repeat it until they are filled */
+        bool hasGap = false;
+        {
+          std::lock_guard<std::mutex> lock(impl->fileDataHandler->rangeMutex);
+          hasGap = !impl->fileDataHandler->range_handler_->GetNoAckRanges().empty();
+        }
+        if (hasGap && (impl->fileDataHandler->downloadState == RECVING_FILE_DATA)) {
+          impl->SendMissedAckPack(DJI_GENERAL_DOWNLOAD_FILE_TASK_TYPE_FILE);
+        }
       }
 
-      /*! TODO: with out sleep 100ms, the time will get the same as last time. */
+      /*! Check every 10ms, so the gap acks repeat close to missedAckTimeMsInterval */
       OsdkOsal_TaskSleepMs(10);
     }
   } else {
@@ -214,15 +274,21 @@ void FileMgrImpl::fileDataMonitorTask(void *arg) {
 FileMgrImpl::FileMgrImpl(Linker *linker, E_OSDKCommandDeiveType type,
                          uint8_t index) : linker(linker),
                                           type(type),
-                                          index(index) {
+                                          index(index),
+                                          lastRecvSeq(0) {
   fileListHandler = new DownloadListHandler();
   fileDataHandler = new DownloadDataHandler();
+  fileDataHandler->recvWindow = getDefaultRecvWindow(type);
   localSenderId = OSDK_COMMAND_DEVICE_ID(OSDK_COMMAND_DEVICE_TYPE_APP, 0);
+  {
+    std::lock_guard<std::mutex> lock(instanceMutex);
+    instances.push_back(this);
+  }
   static bool registerCBFlag = false;
   if (!registerCBFlag) {
     registerCBFlag = true;
     static T_RecvCmdItem bulkCmdList[] = {
-        PROT_CMD_ITEM(0, 0, V1ProtocolCMD::Common::downloadFileAck[0], V1ProtocolCMD::Common::downloadFileAck[1], MASK_HOST_DEVICE_SET_ID, this, downloadFileAckCB),
+        PROT_CMD_ITEM(0, 0, V1ProtocolCMD::Common::downloadFileAck[0], V1ProtocolCMD::Common::downloadFileAck[1], MASK_HOST_DEVICE_SET_ID, NULL, downloadFileAckCB),
     };
     T_RecvCmdHandle recvCmdHandle;
     recvCmdHandle.cmdList = bulkCmdList;
@@ -237,6 +303,15 @@ FileMgrImpl::FileMgrImpl(Linker *linker, E_OSDKCommandDeiveType type,
 }
 
 FileMgrImpl::~FileMgrImpl(){
+  {
+    std::lock_guard<std::mutex> lock(instanceMutex);
+    for (auto it = instances.begin(); it != instances.end(); ++it) {
+      if (*it == this) {
+        instances.erase(it);
+        break;
+      }
+    }
+  }
   if (fileListHandler) {
     delete fileListHandler;
   }
@@ -319,7 +394,7 @@ ErrorCode::ErrorCodeType FileMgrImpl::SendReqFileDataPack(int fileIndex) {
   reqData.count = 1;
   reqData.type = DJI_MEDIA;
   reqData.sub_index = 0;
-  reqData.offset = 0;
+  reqData.offset = fileDataHandler->reqOffset;
   reqData.size = (uint32_t) (-1);
   uint32_t reqDataLen = sizeof(reqData) - sizeof(reqData.ext_sub_index)
       - sizeof(reqData.seg_sub_index);
@@ -358,7 +433,23 @@ ErrorCode::ErrorCodeType FileMgrImpl::SendReqFileDataPack(int fileIndex) {
                                  ErrorCode::CameraCommon, ackData[0]);
 }
 
-ErrorCode::ErrorCodeType FileMgrImpl::startReqFileList(FileMgr::FileListReqCBType cb, void* userData) {
+uint32_t FileMgrImpl::getDefaultRecvWindow(E_OSDKCommandDeiveType type) {
+  for (uint32_t i = 0; i < sizeof(recvWindowTbl) / sizeof(RecvWindowItem); i++) {
+    if (recvWindowTbl[i].type == type) return recvWindowTbl[i].windowSize;
+  }
+  return DEFAULT_RECV_WINDOW;
+}
+
+void FileMgrImpl::setRecvWindow(uint32_t windowSize) {
+  if (windowSize == 0) {
+    DERROR("Receive window should be at least 1 pack");
+    return;
+  }
+  fileDataHandler->recvWindow = windowSize;
+}
+
+ErrorCode::ErrorCodeType FileMgrImpl::startReqFileList(FileMgr::FileListReqCBType cb, void* userData,
+                                                       FileMgr::FileListPageCBType pageCB) {
   //SendAbortPack(DJI_GENERAL_DOWNLOAD_FILE_TASK_TYPE_LIST);
   if (fileListHandler->downloadState == DOWNLOAD_IDLE) {
     fileListHandler->downloadState = RECVING_FILE_LIST;
@@ -370,12 +461,20 @@ ErrorCode::ErrorCodeType FileMgrImpl::startReqFileList(FileMgr::FileListReqCBTyp
     if (fileListHandler->range_handler_) fileListHandler->range_handler_->DeInit();
     else return ErrorCode::SysCommonErr::AllocMemoryFailed;
 
+    fileListHandler->parser.Reset();
+    lastRecvSeq = 0;
+    fileListHandler->filePackage.type = FileType::UNKNOWN;
+    fileListHandler->filePackage.media.clear();
+
     /*! Create file list req task*/
-    OsdkOsal_TaskCreate(&reqFileListHandle,
-                        (void *(*)(void *)) (&fileListMonitorTask),
-                        OSDK_TASK_STACK_SIZE_DEFAULT, this);
+    Platform::instance().taskCreate(&reqFileListHandle,
+                                    (void *(*)(void *)) (&fileListMonitorTask),
+                                    OSDK_TASK_STACK_SIZE_DEFAULT, this,
+                                    OSDK_TASK_CLASS_FILE_TRANSFER,
+                                    "fileListMonitor");
 
     fileListHandler->reqCB = cb;
+    fileListHandler->pageCB = pageCB;
     fileListHandler->reqCBUserData = userData;
 
     return SendReqFileListPack();
@@ -386,8 +485,9 @@ ErrorCode::ErrorCodeType FileMgrImpl::startReqFileList(FileMgr::FileListReqCBTyp
 }
 
 ErrorCode::ErrorCodeType FileMgrImpl::startReqFileData(int fileIndex, std::string localPath, FileMgr::FileDataReqCBType cb, void* userData) {
-  if (fileDataHandler->downloadState == DOWNLOAD_IDLE) {
-    fileDataHandler->downloadState = RECVING_FILE_DATA;
+  int idleState = DOWNLOAD_IDLE;
+  if (fileDataHandler->downloadState.compare_exchange_strong(idleState, RECVING_FILE_DATA)) {
+    fileDataHandler->reqCnt++;
 
     fileDataHandler->downloadPath = localPath;
     fileDataHandler->mmap_file_buffer_->currentLogFilePath = localPath;
@@ -397,14 +497,35 @@ ErrorCode::ErrorCodeType FileMgrImpl::startReqFileData(int fileIndex, std::strin
     fileDataHandler->reqCBUserData = userData;
     fileDataHandler->curTargetFileIndex = fileIndex;
 
-    if (fileDataHandler->range_handler_)delete (fileDataHandler->range_handler_);
-    fileDataHandler->range_handler_ = new CommonDataRangeHandler();
-    if (!fileDataHandler->range_handler_) return ErrorCode::SysCommonErr::AllocMemoryFailed;
+    {
+      std::lock_guard<std::mutex> lock(fileDataHandler->rangeMutex);
+      if (fileDataHandler->range_handler_)delete (fileDataHandler->range_handler_);
+      fileDataHandler->range_handler_ = new CommonDataRangeHandler();
+      if (!fileDataHandler->range_handler_) return ErrorCode::SysCommonErr::AllocMemoryFailed;
+    }
+    fileDataHandler->lastAckTimeMs = 0;
+    fileDataHandler->lastPackSeq = -1;
+    lastRecvSeq = 0;
+
+    /*! Continue from the journal of an interrupted download of this file */
+    DownloadJournal::Record record;
+    fileDataHandler->reqOffset = 0;
+    fileDataHandler->journalSize = 0;
+    if (DownloadJournal::Load(localPath, record) && (record.fileIndex == fileIndex)) {
+      fileDataHandler->resumeRecord = record;
+      fileDataHandler->reqOffset = record.recvSize;
+      DSTATUS("Resume %s from %llu / %llu bytes", localPath.c_str(),
+              (unsigned long long) record.recvSize, (unsigned long long) record.fileSize);
+    } else {
+      DownloadJournal::Remove(localPath);
+    }
 
     /*! Create file data req task*/
-    OsdkOsal_TaskCreate(&reqFileDataHandle,
-                        (void *(*)(void *)) (&fileDataMonitorTask),
-                        OSDK_TASK_STACK_SIZE_DEFAULT, this);
+    Platform::instance().taskCreate(&reqFileDataHandle,
+                                    (void *(*)(void *)) (&fileDataMonitorTask),
+                                    OSDK_TASK_STACK_SIZE_DEFAULT, this,
+                                    OSDK_TASK_CLASS_FILE_TRANSFER,
+                                    "fileDataMonitor");
 
     return SendReqFileDataPack(fileIndex);
   } else {
@@ -413,6 +534,85 @@ ErrorCode::ErrorCodeType FileMgrImpl::startReqFileData(int fileIndex, std::strin
   }
 }
 
+bool FileMgrImpl::finishReqFileData(E_OsdkStat ret) {
+  /*! The callback is read before going idle, a new request can only set its
+   *  own callback after that */
+  auto cb = fileDataHandler->reqCB;
+  void *udata = fileDataHandler->reqCBUserData;
+  int recvState = RECVING_FILE_DATA;
+  if (!fileDataHandler->downloadState.compare_exchange_strong(recvState, DOWNLOAD_IDLE)) {
+    return false;
+  }
+  /*! Called idle, so the callback is free to start the next request */
+  if (cb) cb(ret, udata);
+  return true;
+}
+
+ErrorCode::ErrorCodeType FileMgrImpl::stopReqFileData() {
+  if (fileDataHandler->downloadState != RECVING_FILE_DATA) {
+    return ErrorCode::CameraCommonErr::InvalidState;
+  }
+  SendAbortPack(DJI_GENERAL_DOWNLOAD_FILE_TASK_TYPE_FILE);
+  saveFileDataJournal();
+  {
+    std::unique_lock<std::mutex> lock(fileDataHandler->rangeMutex);
+    waitFileDataJournal(lock);
+    fileDataHandler->mmap_file_buffer_->deInit();
+  }
+  DSTATUS("Stop req filedata task, reset downloadState to be DOWNLOAD_IDLE");
+  finishReqFileData(OSDK_STAT_ERR);
+  return ErrorCode::SysCommonErr::Success;
+}
+
+void FileMgrImpl::saveFileDataJournal() {
+  auto mmap_file_buffer_ = fileDataHandler->mmap_file_buffer_;
+  DownloadJournal::Record record;
+  uint64_t syncFrom = 0;
+  std::string path;
+  {
+    std::unique_lock<std::mutex> lock(fileDataHandler->rangeMutex);
+    /*! One save at a time, the later one has less to sync */
+    waitFileDataJournal(lock);
+    auto range_handler_ = fileDataHandler->range_handler_;
+    if (!range_handler_ || !mmap_file_buffer_->fdAddr) return;
+
+    record.recvSize = mmap_file_buffer_->getContiguousSize(range_handler_->GetExpectSeq());
+    if (record.recvSize <= fileDataHandler->journalSize) return;
+    record.fileIndex = fileDataHandler->curTargetFileIndex;
+    record.fileSize = mmap_file_buffer_->fdAddrSize;
+    syncFrom = fileDataHandler->journalSize;
+    path = fileDataHandler->downloadPath;
+    /*! The mapping stays until the save is done, the packs keep coming */
+    fileDataHandler->journalBusy = true;
+  }
+
+  /*! The journal must not claim data which is not on the disk yet */
+  bool saved = mmap_file_buffer_->sync(syncFrom, record.recvSize)
+      && DownloadJournal::Save(path, record);
+
+  std::lock_guard<std::mutex> lock(fileDataHandler->rangeMutex);
+  if (saved && (record.recvSize > fileDataHandler->journalSize)) {
+    fileDataHandler->journalSize = record.recvSize;
+  }
+  fileDataHandler->journalBusy = false;
+  fileDataHandler->journalIdle.notify_all();
+}
+
+void FileMgrImpl::waitFileDataJournal(std::unique_lock<std::mutex> &lock) {
+  auto handler = fileDataHandler;
+  handler->journalIdle.wait(lock, [handler] { return !handler->journalBusy; });
+}
+
+bool FileMgrImpl::isReqFileDataIdle() {
+  return (fileDataHandler->downloadState == DOWNLOAD_IDLE);
+}
+
+void FileMgrImpl::getFileDataProgress(uint64_t &recvSize, uint64_t &fileSize) {
+  std::lock_guard<std::mutex> lock(fileDataHandler->rangeMutex);
+  recvSize = fileDataHandler->mmap_file_buffer_->writtenSize;
+  fileSize = fileDataHandler->mmap_file_buffer_->fdAddrSize;
+}
+
 /**
 * 催促包只有3次，代表远程（eg.相机）已经发送完毕
 * 如果共计10个包出现  1 2 3 4 gap 6 7 empty 的情况
@@ -428,11 +628,20 @@ void FileMgrImpl::OnReceiveUrgePack(dji_general_transfer_msg_ack *rsp) {
       range_handler_ = fileDataHandler->range_handler_;
     else return;
 
-    if (range_handler_->GetNoAckRanges().size() == 0)
+    size_t rangeCnt = 0;
+    if (rsp->task_id == DJI_GENERAL_DOWNLOAD_FILE_TASK_TYPE_FILE) {
+      std::lock_guard<std::mutex> lock(fileDataHandler->rangeMutex);
+      rangeCnt = range_handler_->GetNoAckRanges().size();
+    } else {
+      rangeCnt = range_handler_->GetNoAckRanges().size();
+    }
+
+    if (rangeCnt == 0) {
       SendAbortPack((DJI_GENERAL_DOWNLOAD_FILE_TASK_TYPE) rsp->task_id);
-    else
-      DSTATUS("range_handler_->GetNoAckRanges().size() = %d", range_handler_->GetNoAckRanges().size());
+    } else {
+      DSTATUS("range_handler_->GetNoAckRanges().size() = %d", rangeCnt);
       SendMissedAckPack((DJI_GENERAL_DOWNLOAD_FILE_TASK_TYPE) rsp->task_id);
+    }
   }
 }
 
@@ -443,216 +652,58 @@ void FileMgrImpl::OnReceiveAbortPack(dji_general_transfer_msg_ack *rsp) {
           (int) rsp->session_id);
 }
 
-typedef enum ParsingStateEnum {
-  PARSING_TOTAL_HEADER,
-  PARSING_DATA_HEADER,
-  PARSING_FILEINFO,
-  PARSING_FILEDATA = PARSING_FILEINFO,
-  PARSE_FINISH,
-} ParsingFileListStateEnum, ParsingFileDataStateEnum;
-
-#include "dji_file_mgr_internal_define.hpp"
-FileMgrImpl::ConsumeDataBuffer FileMgrImpl::ConsumeChunk(DataPointer data_pointer, size_t &chunk_index, size_t consumSize) {
-  ConsumeDataBuffer ret = {{0}, 0};
-  if (consumSize > sizeof(ret.data))
-    consumSize = sizeof(ret.data);
-  if (consumSize > data_pointer.length - chunk_index)
-    consumSize = data_pointer.length - chunk_index;
-  memcpy(ret.data, (uint8_t *)data_pointer.data + chunk_index, consumSize);
-  ret.index = consumSize;
-  chunk_index += consumSize;
-  return ret;
-}
-
-FilePackage FileMgrImpl::parseFileList(std::list<DataPointer> fullDataList) {
-  static size_t chunk_index = 0;
-  FilePackage pack;
-  pack.type = FileType::UNKNOWN;
-  //pack.common.clear();
-  pack.media.clear();
-  if (fullDataList.size() == 0) return pack;
-
-  ParsingFileListStateEnum parsingState = PARSING_TOTAL_HEADER;
-  while (fullDataList.size() != 0) {
-    auto dataPtr = fullDataList.front();
-    switch (parsingState) {
-      case PARSING_TOTAL_HEADER: {
-        chunk_index = 0;
-        uint32_t consumeBytes = sizeof(dji_general_transfer_msg_ack) - sizeof(uint8_t);
-        auto buffer = ConsumeChunk(dataPtr, chunk_index, consumeBytes);
-        if (buffer.index == consumeBytes) {
-          auto data = (dji_general_transfer_msg_ack *)(buffer.data);
-          DSTATUS("Unpack datapack seq(%d)", data->seq);
-          parsingState = (data->seq == 0) ? PARSING_DATA_HEADER : PARSING_FILEINFO;
-        } else {
-          parsingState = PARSE_FINISH;
-        }
-        break;
-      }
-      case PARSING_DATA_HEADER: {
-        uint32_t consumeBytes = sizeof(dji_file_list_download_resp) - sizeof(dji_list_info_descriptor);
-        auto buffer = ConsumeChunk(dataPtr, chunk_index, consumeBytes);
-        if (buffer.index == consumeBytes) {
-          auto data = (dji_file_list_download_resp *)(buffer.data);
-          DSTATUS("###data->amount = %d, data->len = %d", data->amount, data->len);
-          parsingState = PARSING_FILEINFO;
-        } else {
-          parsingState = PARSE_FINISH;
-        }
-        break;
-      }
-      case PARSING_FILEINFO:{
-        uint32_t consumeBytes = sizeof(dji_list_info_descriptor) - sizeof(dji_file_list_ext_info);
-        auto buffer = ConsumeChunk(dataPtr, chunk_index, consumeBytes);
-        if (buffer.index == consumeBytes) {
-          if (pack.type == FileType::UNKNOWN)pack.type = FileType::MEDIA;
-          auto data = (dji_list_info_descriptor *)(buffer.data);
-          //DSTATUS("data->index = %d, data->size = %d", data->index, data->size);
-          /*! 构建file信息,装入容器 */
-          MediaFile file;
-          file.valid = true;
-          file.date.year = data->create_time.year;
-          file.date.month = data->create_time.month;
-          file.date.day = data->create_time.day;
-          file.date.hour = data->create_time.hour;
-          file.date.minute = data->create_time.minute;
-          file.date.second = data->create_time.second;
-          file.fileIndex = data->index;
-          file.fileSize = data->size;
-          file.fileType = (MediaFileType)data->type;
-          if ((data->type == (uint8_t) MediaFileType::MOV)
-              || (data->type == (uint8_t) MediaFileType::MP4)) {
-            file.duration = data->attribute.video_attribute.attribute_video_duration;
-            file.orientation = (CameraOrientation)data->attribute.video_attribute.attribute_video_rotation;
-            file.resolution = (VideoResolution)data->attribute.video_attribute.attribute_video_resolution;
-            file.frameRate = (VideoFrameRate)data->attribute.video_attribute.attribute_video_framerate;
-          } else if ((data->type == (uint8_t) MediaFileType::JPEG)
-              || (data->type == (uint8_t) MediaFileType::DNG)
-              || (data->type == (uint8_t) MediaFileType::TIFF)) {
-            file.orientation = (CameraOrientation)data->attribute.photo_attribute.attribute_photo_rotation;
-            file.photoRatio = (PhotoRatio)data->attribute.photo_attribute.attribute_photo_ratio;
-          }
-          pack.media.push_back(file);
-          /*! 这部分消耗了就算了,目前不解析 */
-          if (data->ext_size) {
-            auto extBuffer = ConsumeChunk(dataPtr, chunk_index, data->ext_size);
-            auto extData = (dji_ext_info_descriptor *) (extBuffer.data);
-            DSTATUS("extData->id = %d, %s", extData->id, extData->data);
-          }
-          parsingState = PARSING_FILEINFO;
-        } else {
-          parsingState = PARSE_FINISH;
-        }
-        break;
-      }
-      case PARSE_FINISH:
-        fullDataList.pop_front();
-        parsingState = PARSING_TOTAL_HEADER;
-        break;
-      default:break;
-    }
+void FileMgrImpl::parseFileList(const dji_general_transfer_msg_ack *rsp) {
+  DSTATUS("Unpack datapack seq(%d)", rsp->seq);
+  FilePackage page;
+  page.type = FileType::MEDIA;
+  if (fileListHandler->parser.Feed(rsp, page.media) == 0) return;
+
+  if (fileListHandler->filePackage.type == FileType::UNKNOWN)
+    fileListHandler->filePackage.type = FileType::MEDIA;
+  auto &media = fileListHandler->filePackage.media;
+  media.insert(media.end(), page.media.begin(), page.media.end());
+  if (fileListHandler->pageCB) {
+    fileListHandler->pageCB(page, fileListHandler->reqCBUserData);
   }
-  return pack;
 }
 
-#define SIZE_LIMIT 0
 bool FileMgrImpl::parseFileData(dji_general_transfer_msg_ack *rsp) {
+  auto mmap_file_buffer_ = fileDataHandler->mmap_file_buffer_;
+  bool isLast = (rsp->msg_flag & 0x01);
   if (rsp->seq == 0) {
     /*! 1. 是第一包,parse文件大小 */
     auto resp = (dji_file_data_download_resp *) (rsp->data);
     /*! 2. 文件总大小计算 */
     uint32_t file_size = resp->size - (sizeof(dji_file_data_download_resp) - sizeof(uint8_t));
-    fileDataHandler->mmap_file_buffer_->init(fileDataHandler->downloadPath, file_size);
+    uint64_t full_size = file_size;
+    uint64_t base_offset = 0;
+    if (fileDataHandler->reqOffset) {
+      /*! Resumed, the file is sent from the requested offset unless the
+       *  device ignores it and sends the whole file again */
+      auto &record = fileDataHandler->resumeRecord;
+      if (file_size + (uint64_t) fileDataHandler->reqOffset == record.fileSize) {
+        full_size = record.fileSize;
+        base_offset = fileDataHandler->reqOffset;
+      } else if (file_size != record.fileSize) {
+        DERROR("Resumed size %d does not match the journal, download from the start", file_size);
+      }
+    }
+    if (!mmap_file_buffer_->init(fileDataHandler->downloadPath, full_size, base_offset)) {
+      DERROR("Failed to prepare %s for %d bytes", fileDataHandler->downloadPath.c_str(), file_size);
+      return false;
+    }
+    fileDataHandler->journalSize = base_offset;
     /*! 3. 本包数据总大小计算 */
     uint32_t data_size = rsp->msg_length;
     data_size -= sizeof(dji_general_transfer_msg_ack) - sizeof(uint8_t);
     data_size -= sizeof(dji_file_data_download_resp) - sizeof(uint8_t);
-    fileDataHandler->mmap_file_buffer_->InsertBlock(resp->file_data, data_size, rsp->seq);
+    return mmap_file_buffer_->InsertBlock(resp->file_data, data_size, rsp->seq, isLast);
   } else {
     /*! 1. 本包数据总大小计算 */
     uint32_t data_size = rsp->msg_length;
     data_size -= sizeof(dji_general_transfer_msg_ack) - sizeof(uint8_t);
-    fileDataHandler->mmap_file_buffer_->InsertBlock(rsp->data, data_size, rsp->seq);
-  }
-
-#if 0
-    size_t chunk_index = 0;
-  ParsingFileListStateEnum parsingState = PARSING_TOTAL_HEADER;
-  DataPointer dataPtr = {
-      .data = rsp,
-      .length = rsp->msg_length
-  };
-
-  while (chunk_index < dataPtr.length) {
-    switch (parsingState) {
-      case PARSING_TOTAL_HEADER: {
-        chunk_index = 0;
-        uint32_t consumeBytes = sizeof(dji_general_transfer_msg_ack) - sizeof(uint8_t);
-        auto buffer = ConsumeChunk(dataPtr, chunk_index, consumeBytes);
-        if (buffer.index == consumeBytes) {
-          auto data = (dji_general_transfer_msg_ack *) (buffer.data);
-          parsingState = (data->seq == 0) ? PARSING_DATA_HEADER : PARSING_FILEDATA;
-        } else {
-          parsingState = PARSE_FINISH;
-        }
-        break;
-      }
-      case PARSING_DATA_HEADER: {
-        uint32_t consumeBytes = sizeof(dji_file_data_download_resp) - sizeof(uint8_t);
-        auto buffer = ConsumeChunk(dataPtr, chunk_index, consumeBytes);
-        if (buffer.index == consumeBytes) {
-          auto data = (dji_file_data_download_resp *) (buffer.data);
-          uint32_t file_size = data->size - (sizeof(dji_file_data_download_resp) - sizeof(uint8_t));
-          this->mmap_file_buffer_->init(this->currentLogFilePath, file_size);
-#if SIZE_LIMIT
-          uint32_t targetFileSize = *(uint32_t *)(buffer.data + 4);
-          uint32_t targetFileIndex = *(uint32_t *)(buffer.data + 8);
-          DSTATUS("### The size of the current target file (index:%d) : %d", targetFileIndex, targetFileSize);
-          if (targetFileSize > 2*1024*1024) {
-            DERROR("### The size of the current target file (index:%d) : %d", targetFileIndex, targetFileSize);
-            DERROR("### Current download function support only single file which is smaller than"
-                   "2MB. It will be optimized in the future.");
-            DERROR("### So sorry that this download request will go falied");
-            this->closeFile();
-            this->downloadState = DOWNLOAD_IDLE;
-            return false;
-          }
-#endif
-          parsingState = PARSING_FILEDATA;
-        } else {
-          parsingState = PARSE_FINISH;
-        }
-        break;
-      }
-      case PARSING_FILEDATA: {
-        uint32_t consumeBytes = dataPtr.length - chunk_index; // 消耗完
-        if (consumeBytes == 0) {
-          //DSTATUS("##Parse 完了");
-          parsingState = PARSE_FINISH;
-          break;
-        }
-        auto buffer = ConsumeChunk(dataPtr, chunk_index, consumeBytes);
-        if (buffer.index == consumeBytes) {
-          //DSTATUS("##記錄文件數據, %dBytes", buffer.index);
-          if (rsp->seq * 800 + buffer.index <= mmap_file_buffer_->fdAddrSize)
-            mmap_file_buffer_->InsertBlock(buffer.data, buffer.index, rsp->seq);
-          parsingState = PARSING_FILEDATA;
-        } else {
-          //DSTATUS("##Parse 完了");
-          parsingState = PARSE_FINISH;
-        }
-        break;
-      }
-      case PARSE_FINISH:
-        parsingState = PARSING_TOTAL_HEADER;
-        return true;
-        break;
-      default:break;
-    }
+    return mmap_file_buffer_->InsertBlock(rsp->data, data_size, rsp->seq, isLast);
   }
-#endif
-
-  return false;
 }
 
 void FileMgrImpl::fileListRawDataCB(dji_general_transfer_msg_ack *rsp) {
@@ -660,8 +711,19 @@ void FileMgrImpl::fileListRawDataCB(dji_general_transfer_msg_ack *rsp) {
     auto download_buffer_ = fileListHandler->download_buffer_;
     auto range_handler_ = fileListHandler->range_handler_;
     if (download_buffer_ && range_handler_) {
-      download_buffer_->InsertBlock((const uint8_t *) rsp, rsp->msg_length, rsp->seq, true);
       range_handler_->AddSeqIndex(rsp->seq, download_buffer_->GetConfirmSeq(), download_buffer_->GetSize());
+      /*! 边收边解包: the expected pack is parsed in place, the others wait
+       *  in the buffer until the packs before them are received */
+      if (download_buffer_->SkipExpectedBlock(rsp->seq)) {
+        parseFileList(rsp);
+      } else {
+        download_buffer_->InsertBlock((const uint8_t *) rsp, rsp->msg_length, rsp->seq, true);
+      }
+      DataPointer dataPtr;
+      while ((dataPtr = download_buffer_->DequeueBuffer()).data != nullptr) {
+        parseFileList((const dji_general_transfer_msg_ack *) dataPtr.data);
+        free(dataPtr.data);
+      }
     }
 
     /*! refresh the time stamp */
@@ -674,14 +736,12 @@ void FileMgrImpl::fileListRawDataCB(dji_general_transfer_msg_ack *rsp) {
     if ((rsp->msg_flag & 0x01)
     && (range_handler_->GetLastNotReceiveSeq() == rsp->seq + 1)
     && (range_handler_->GetNoAckRanges().size() == 0)) {
-      std::list<DataPointer> dataList = download_buffer_->DequeueAllBuffer();
-      FilePackage file_package = parseFileList(dataList);
-
       SendAbortPack(DJI_GENERAL_DOWNLOAD_FILE_TASK_TYPE_LIST);
       if (fileListHandler->reqCB) {
-        fileListHandler->reqCB(OSDK_STAT_OK, file_package, fileListHandler->reqCBUserData);
+        fileListHandler->reqCB(OSDK_STAT_OK, fileListHandler->filePackage, fileListHandler->reqCBUserData);
         fileListHandler->reqCB = NULL;
       }
+      fileListHandler->filePackage.media.clear();
 
       DSTATUS("Finish req filelist task, reset downloadState to be DOWNLOAD_IDLE");
       fileListHandler->downloadState = DOWNLOAD_IDLE;
@@ -690,10 +750,35 @@ void FileMgrImpl::fileListRawDataCB(dji_general_transfer_msg_ack *rsp) {
 
 void FileMgrImpl::fileDataRawDataCB(dji_general_transfer_msg_ack *rsp) {
   if (fileDataHandler->downloadState == DOWNLOAD_IDLE) return;
-  auto range_handler_ = fileDataHandler->range_handler_;
   auto mmap_file_buffer_ = fileDataHandler->mmap_file_buffer_;
-  if (range_handler_) {
-    range_handler_->AddSeqIndex(rsp->seq, 0, (uint32_t)(-1));
+  bool isNewGap = false;
+  bool isFinished = false;
+  {
+    std::unique_lock<std::mutex> lock(fileDataHandler->rangeMutex);
+    auto range_handler_ = fileDataHandler->range_handler_;
+    if (!range_handler_) return;
+    uint32_t expectSeq = range_handler_->GetExpectSeq();
+    /*! Duplicated packs and packs out of the window are not written */
+    if (!range_handler_->IsNewSeq(rsp->seq, expectSeq, fileDataHandler->recvWindow)) return;
+    /*! The first pack maps the file, only then a journal save is waited for */
+    if (rsp->seq == 0) waitFileDataJournal(lock);
+    /*! do data parsing, 边收边解包. The payload goes straight to its offset
+     *  in the file, a pack the sink cannot place yet (e.g. before seq 0) is
+     *  not recorded, so it is requested again */
+    if (!parseFileData(rsp)) return;
+    /*! A seq jumping over the expected one opens a new gap */
+    isNewGap = (rsp->seq > range_handler_->GetLastNotReceiveSeq());
+    range_handler_->AddSeqIndex(rsp->seq, expectSeq, fileDataHandler->recvWindow);
+    /*! The last pack may come before the holes are filled */
+    if (rsp->msg_flag & 0x01) fileDataHandler->lastPackSeq = rsp->seq;
+    isFinished = (fileDataHandler->lastPackSeq >= 0)
+        && (range_handler_->GetLastNotReceiveSeq() == fileDataHandler->lastPackSeq + 1)
+        && (range_handler_->GetNoAckRanges().size() == 0);
+    if (isFinished) {
+      waitFileDataJournal(lock);
+      mmap_file_buffer_->deInit();
+      DownloadJournal::Remove(fileDataHandler->downloadPath);
+    }
   }
 
   /*! refresh the time stamp */
@@ -701,21 +786,17 @@ void FileMgrImpl::fileDataRawDataCB(dji_general_transfer_msg_ack *rsp) {
   OsdkOsal_GetTimeMs(&curMs);
   fileDataHandler->updateTimeMs = curMs;
 
-  /*! do data parsing, 边收边解包 */
-  parseFileData(rsp);
+  /*! Request the missing packs now instead of waiting for the monitor task */
+  if (isNewGap && !isFinished
+      && (curMs - fileDataHandler->lastAckTimeMs >= GAP_ACK_MIN_INTERVAL_MS)) {
+    SendMissedAckPack(DJI_GENERAL_DOWNLOAD_FILE_TASK_TYPE_FILE);
+  }
 
   /*! 看看是否拿到了最后一个包 */
-  if ((rsp->msg_flag & 0x01)
-      && (range_handler_->GetLastNotReceiveSeq() == rsp->seq + 1)
-      && (range_handler_->GetNoAckRanges().size() == 0)){
-    mmap_file_buffer_->deInit();
+  if (isFinished) {
     SendAbortPack(DJI_GENERAL_DOWNLOAD_FILE_TASK_TYPE_FILE);
-    if (fileDataHandler->reqCB) {
-      fileDataHandler->reqCB(OSDK_STAT_OK, fileDataHandler->reqCBUserData);
-      fileDataHandler->reqCB = NULL;
-    }
     DSTATUS("Finish req filedata task, reset downloadState to be DOWNLOAD_IDLE");
-    fileDataHandler->downloadState = DOWNLOAD_IDLE;
+    finishReqFileData(OSDK_STAT_OK);
   }
 }
 
@@ -723,10 +804,9 @@ void FileMgrImpl::fileDataRawDataCB(dji_general_transfer_msg_ack *rsp) {
 void FileMgrImpl::OnReceiveDataPack(dji_general_transfer_msg_ack *rsp) {
   if (rsp->func_id != DJI_GENERAL_DOWNLOAD_FILE_FUNC_TYPE_DATA) return;
 
-  static uint32_t lastSeq = 0;
   if (rsp->seq == 0) DSTATUS("[First pack] get the first pack");
-  else if (rsp->seq != lastSeq + 1) DSTATUS("[Skip packs]------------------->skip seq : lastSeq = %d, rsp->seq = %d", lastSeq, rsp->seq);
-  lastSeq = rsp->seq;
+  else if (rsp->seq != lastRecvSeq + 1) DSTATUS("[Skip packs]------------------->skip seq : lastSeq = %d, rsp->seq = %d", lastRecvSeq, rsp->seq);
+  lastRecvSeq = rsp->seq;
 
 #if LOG_EVERY_PACK
   DSTATUS(
@@ -860,41 +940,43 @@ ErrorCode::ErrorCodeType FileMgrImpl::SendACKPack(DJI_GENERAL_DOWNLOAD_FILE_TASK
   return ErrorCode::SysCommonErr::Success;
 }
 
-ErrorCode::ErrorCodeType FileMgrImpl::SendMissedAckPack(DJI_GENERAL_DOWNLOAD_FILE_TASK_TYPE taskId) {
-  CommonDataRangeHandler *range_handler_;
-  if (taskId == DJI_GENERAL_DOWNLOAD_FILE_TASK_TYPE_LIST)
-    range_handler_ = fileListHandler->range_handler_;
-  else if (taskId == DJI_GENERAL_DOWNLOAD_FILE_TASK_TYPE_FILE)
-    range_handler_ = fileDataHandler->range_handler_;
-  else return ErrorCode::SysCommonErr::ReqNotSupported;
-
-  std::vector<Range> ranges = range_handler_->GetNoAckRanges();
-  if(ranges.empty()) {
-    uint8_t buf[1024] = {0};
-    dji_download_ack *ack = (dji_download_ack *)buf;
-    ack->expect_seq = range_handler_->GetLastNotReceiveSeq();
-    ack->loss_nr = 0;
-    DSTATUS("[Confirming ...]---------------ack->expect_seq = %d ack->loss_nr = %d", ack->expect_seq, ack->loss_nr);
-    SendACKPack(taskId, ack);
-    return OSDK_STAT_OK;
+static void fillMissedAck(CommonDataRangeHandler *range_handler_, dji_download_ack *ack) {
+  std::vector<Range> &ranges = range_handler_->GetNoAckRanges();
+  size_t rangeCnt = ranges.size() > MAX_LOSS_DESC_NUM_PER_ACK ?
+                    MAX_LOSS_DESC_NUM_PER_ACK : ranges.size();
+  ack->expect_seq = range_handler_->GetExpectSeq();
+  ack->loss_nr = rangeCnt;
+  for (size_t i = 0; i < rangeCnt; i++) {
+    ack->loss_desc[i].seq = ranges[i].seq_num;
+    ack->loss_desc[i].cnt = ranges[i].length;
   }
+}
 
-  auto rangeCnt = ranges.size() > 1 ? 1 : ranges.size();
+ErrorCode::ErrorCodeType FileMgrImpl::SendMissedAckPack(DJI_GENERAL_DOWNLOAD_FILE_TASK_TYPE taskId) {
   uint8_t buf[1024] = {0};
   dji_download_ack *ack = (dji_download_ack *)buf;
-  ack->expect_seq = ranges[0].seq_num;
-  ack->loss_nr = rangeCnt;
-  DSTATUS("[ReqMissingPack ...]---------------ack->expect_seq = %d ack->loss_nr = %d", ack->expect_seq, ack->loss_nr);
-  for (int i = 0; i < rangeCnt; i++) {
-    auto range = ranges[i];
-    ack->loss_desc[i].seq = range.seq_num;
-    ack->loss_desc[i].cnt = range.length;
-    DSTATUS("[MissPack]---------------loss[%d] range.seq_num = %d, range.length = %d", i, range.seq_num, range.length);
+  if (taskId == DJI_GENERAL_DOWNLOAD_FILE_TASK_TYPE_LIST) {
+    fillMissedAck(fileListHandler->range_handler_, ack);
+  } else if (taskId == DJI_GENERAL_DOWNLOAD_FILE_TASK_TYPE_FILE) {
+    std::lock_guard<std::mutex> lock(fileDataHandler->rangeMutex);
+    fillMissedAck(fileDataHandler->range_handler_, ack);
+    uint32_t curMs = 0;
+    OsdkOsal_GetTimeMs(&curMs);
+    fileDataHandler->lastAckTimeMs = curMs;
+  } else return ErrorCode::SysCommonErr::ReqNotSupported;
+
+  if (ack->loss_nr == 0) {
+    DSTATUS("[Confirming ...]---------------ack->expect_seq = %d ack->loss_nr = %d", ack->expect_seq, ack->loss_nr);
+  } else {
+    DSTATUS("[ReqMissingPack ...]---------------ack->expect_seq = %d ack->loss_nr = %d", ack->expect_seq, ack->loss_nr);
+    for (int i = 0; i < ack->loss_nr; i++) {
+      DDEBUG("[MissPack]---------------loss[%d] range.seq_num = %d, range.length = %d", i, ack->loss_desc[i].seq, ack->loss_desc[i].cnt);
+    }
   }
   return SendACKPack(taskId, ack);
 }
 
-DownloadListHandler::DownloadListHandler() : reqCB(nullptr), reqCBUserData(nullptr) {
+DownloadListHandler::DownloadListHandler() : reqCB(nullptr), pageCB(nullptr), reqCBUserData(nullptr) {
   range_handler_ = new CommonDataRangeHandler();
   download_buffer_ = new DownloadBufferQueue();
   downloadState = DOWNLOAD_IDLE;
@@ -909,6 +991,13 @@ DownloadDataHandler::DownloadDataHandler() : reqCB(nullptr), reqCBUserData(nullp
   range_handler_ = new CommonDataRangeHandler();
   mmap_file_buffer_ = new MmapFileBuffer();
   downloadState = DOWNLOAD_IDLE;
+  recvWindow = DEFAULT_RECV_WINDOW;
+  lastAckTimeMs = 0;
+  lastPackSeq = -1;
+  reqCnt = 0;
+  reqOffset = 0;
+  journalSize = 0;
+  journalBusy = false;
 }
 
 DownloadDataHandler::~DownloadDataHandler() {
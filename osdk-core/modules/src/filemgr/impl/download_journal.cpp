@@ -0,0 +1,129 @@
+/** @file download_journal.cpp
+ *  @version 4.0
+ *  @date July 2020
+ *
+ *  @brief Sidecar journal of a file download, for resuming it
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "download_journal.hpp"
+#include "dji_log.hpp"
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace DJI;
+using namespace DJI::OSDK;
+
+#define DOWNLOAD_JOURNAL_MAGIC 0x4C4A4C44 /*! "DLJL" */
+#define DOWNLOAD_JOURNAL_VERSION 1
+
+#pragma pack(1)
+typedef struct DownloadJournalFile {
+  uint32_t magic;
+  uint32_t version;
+  int32_t fileIndex;
+  uint64_t fileSize;
+  uint64_t recvSize;
+  /*! Hash of the fields above, catches a torn or foreign file */
+  uint32_t checksum;
+} DownloadJournalFile;
+#pragma pack()
+
+static uint32_t journalChecksum(const DownloadJournalFile &data) {
+  const uint8_t *p = (const uint8_t *) &data;
+  uint32_t sum = 0;
+  for (size_t i = 0; i < sizeof(data) - sizeof(data.checksum); i++) {
+    sum = sum * 31 + p[i];
+  }
+  return sum;
+}
+
+std::string DownloadJournal::GetPath(const std::string &filePath) {
+  return filePath + ".journal";
+}
+
+bool DownloadJournal::Load(const std::string &filePath, Record &record) {
+  std::string path = GetPath(filePath);
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+
+  DownloadJournalFile data;
+  memset(&data, 0, sizeof(data));
+  ssize_t len = read(fd, &data, sizeof(data));
+  close(fd);
+  if ((len != (ssize_t) sizeof(data))
+      || (data.magic != DOWNLOAD_JOURNAL_MAGIC)
+      || (data.version != DOWNLOAD_JOURNAL_VERSION)
+      || (data.checksum != journalChecksum(data))
+      || (data.recvSize > data.fileSize)) {
+    DERROR("Invalid download journal %s", path.c_str());
+    return false;
+  }
+
+  /*! The file has to be the one the journal was written for */
+  struct stat st;
+  if ((stat(filePath.c_str(), &st) != 0) || ((uint64_t) st.st_size != data.fileSize)) {
+    DERROR("Download journal %s does not match its file", path.c_str());
+    return false;
+  }
+
+  record.fileIndex = data.fileIndex;
+  record.fileSize = data.fileSize;
+  record.recvSize = data.recvSize;
+  return true;
+}
+
+bool DownloadJournal::Save(const std::string &filePath, const Record &record) {
+  std::string path = GetPath(filePath);
+  std::string tmpPath = path + ".tmp";
+
+  DownloadJournalFile data;
+  memset(&data, 0, sizeof(data));
+  data.magic = DOWNLOAD_JOURNAL_MAGIC;
+  data.version = DOWNLOAD_JOURNAL_VERSION;
+  data.fileIndex = record.fileIndex;
+  data.fileSize = record.fileSize;
+  data.recvSize = record.recvSize;
+  data.checksum = journalChecksum(data);
+
+  int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) return false;
+  bool ret = (write(fd, &data, sizeof(data)) == (ssize_t) sizeof(data))
+             && (fsync(fd) == 0);
+  close(fd);
+
+  /*! rename replaces the old journal atomically */
+  if (!ret || (rename(tmpPath.c_str(), path.c_str()) != 0)) {
+    DERROR("Failed to write download journal %s", path.c_str());
+    unlink(tmpPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+void DownloadJournal::Remove(const std::string &filePath) {
+  unlink(GetPath(filePath).c_str());
+}
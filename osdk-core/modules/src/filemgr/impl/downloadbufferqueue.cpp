@@ -98,6 +98,21 @@ bool DownloadBufferQueue::FindBlockByIndex(int index) {
     return ret;
 }
 
+bool DownloadBufferQueue::SkipExpectedBlock(int index) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_queue_ptr || index != m_expect_index || m_queue_ptr[m_head].data) {
+        return false;
+    }
+
+    m_expect_index++;
+    m_head++;
+    m_head = m_head % m_size;
+    if (index > m_buf_max_index) {
+        m_buf_max_index = index;
+    }
+    return true;
+}
+
 int DownloadBufferQueue::GetConfirmSeq() {
     return m_expect_index - 1;
 }
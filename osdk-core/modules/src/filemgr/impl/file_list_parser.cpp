@@ -0,0 +1,139 @@
+/** @file file_list_parser.cpp
+ *  @version 4.0
+ *  @date July 2020
+ *
+ *  @brief Incremental parser of the file list packs
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "file_list_parser.hpp"
+#include "dji_log.hpp"
+#include <string.h>
+
+using namespace DJI;
+using namespace DJI::OSDK;
+
+FileListParser::FileListParser() { Reset(); }
+
+void FileListParser::Reset() {
+  carry_len_ = 0;
+  amount_ = 0;
+  decoded_cnt_ = 0;
+}
+
+void FileListParser::DecodeDescriptor(const dji_list_info_descriptor *data, MediaFile &file) {
+  /*! 构建file信息 */
+  file.valid = true;
+  file.date.year = data->create_time.year;
+  file.date.month = data->create_time.month;
+  file.date.day = data->create_time.day;
+  file.date.hour = data->create_time.hour;
+  file.date.minute = data->create_time.minute;
+  file.date.second = data->create_time.second;
+  file.fileIndex = data->index;
+  file.fileSize = data->size;
+  file.fileType = (MediaFileType)data->type;
+  if ((data->type == (uint8_t) MediaFileType::MOV)
+      || (data->type == (uint8_t) MediaFileType::MP4)) {
+    file.duration = data->attribute.video_attribute.attribute_video_duration;
+    file.orientation = (CameraOrientation)data->attribute.video_attribute.attribute_video_rotation;
+    file.resolution = (VideoResolution)data->attribute.video_attribute.attribute_video_resolution;
+    file.frameRate = (VideoFrameRate)data->attribute.video_attribute.attribute_video_framerate;
+  } else if ((data->type == (uint8_t) MediaFileType::JPEG)
+      || (data->type == (uint8_t) MediaFileType::DNG)
+      || (data->type == (uint8_t) MediaFileType::TIFF)) {
+    file.orientation = (CameraOrientation)data->attribute.photo_attribute.attribute_photo_rotation;
+    file.photoRatio = (PhotoRatio)data->attribute.photo_attribute.attribute_photo_ratio;
+  }
+  /*! 扩展数据目前不解析 */
+}
+
+uint32_t FileListParser::Feed(const dji_general_transfer_msg_ack *rsp, std::vector<MediaFile> &files) {
+  uint32_t headerLen = sizeof(dji_general_transfer_msg_ack) - sizeof(uint8_t);
+  if (!rsp || rsp->msg_length < headerLen) return 0;
+
+  const uint8_t *data = rsp->data;
+  uint32_t len = rsp->msg_length - headerLen;
+  uint32_t cnt = 0;
+
+  if (rsp->seq == 0) {
+    uint32_t respHeaderLen = sizeof(dji_file_list_download_resp) - sizeof(dji_list_info_descriptor);
+    if (len < respHeaderLen) return 0;
+    auto resp = (const dji_file_list_download_resp *) data;
+    DSTATUS("###data->amount = %d, data->len = %d", resp->amount, resp->len);
+    Reset();
+    amount_ = resp->amount;
+    data += respHeaderLen;
+    len -= respHeaderLen;
+  }
+
+  /*! 1. 拼接上一包剩下的半条记录 */
+  if (carry_len_) {
+    uint32_t need = (carry_len_ < DESC_FIXED_SIZE) ? DESC_FIXED_SIZE - carry_len_ : 0;
+    need = (need > len) ? len : need;
+    memcpy(carry_ + carry_len_, data, need);
+    carry_len_ += need;
+    data += need;
+    len -= need;
+    if (carry_len_ < DESC_FIXED_SIZE) return 0;
+
+    uint32_t recordLen = DESC_FIXED_SIZE + ((const dji_list_info_descriptor *) carry_)->ext_size;
+    need = recordLen - carry_len_;
+    need = (need > len) ? len : need;
+    memcpy(carry_ + carry_len_, data, need);
+    carry_len_ += need;
+    data += need;
+    len -= need;
+    if (carry_len_ < recordLen) return 0;
+
+    if (!IsComplete()) {
+      MediaFile file = {};
+      DecodeDescriptor((const dji_list_info_descriptor *) carry_, file);
+      files.push_back(file);
+      decoded_cnt_++;
+      cnt++;
+    }
+    carry_len_ = 0;
+  }
+
+  /*! 2. 整条记录直接在包里解析 */
+  while ((len >= DESC_FIXED_SIZE) && !IsComplete()) {
+    auto desc = (const dji_list_info_descriptor *) data;
+    uint32_t recordLen = DESC_FIXED_SIZE + desc->ext_size;
+    if (len < recordLen) break;
+    MediaFile file = {};
+    DecodeDescriptor(desc, file);
+    files.push_back(file);
+    decoded_cnt_++;
+    cnt++;
+    data += recordLen;
+    len -= recordLen;
+  }
+
+  /*! 3. 剩下的半条记录留到下一包, 全部解析完后的填充数据丢弃 */
+  if (len && !IsComplete()) {
+    memcpy(carry_, data, len);
+    carry_len_ = len;
+  }
+  return cnt;
+}
@@ -8,48 +8,118 @@
 namespace DJI {
 namespace OSDK {
 
-MmapFileBuffer::MmapFileBuffer() : fdAddr(NULL) {}
+MmapFileBuffer::MmapFileBuffer()
+    : fd(-1), fdAddr(NULL), fdAddrSize(0), writtenSize(0), baseOffset(0),
+      firstBlockSize(0), blockSize(0) {}
 
-MmapFileBuffer::~MmapFileBuffer() {}
+MmapFileBuffer::~MmapFileBuffer() { deInit(); }
+
+bool MmapFileBuffer::init(std::string path, uint64_t fileSize, uint64_t baseOffset) {
+  /*! A previous download may have been given up without deinit */
+  if ((fd >= 0) || fdAddr) deInit();
 
-bool MmapFileBuffer::init(std::string path, uint64_t fileSize) {
   currentLogFilePath = path;
   fdAddrSize = fileSize;
+  this->baseOffset = (baseOffset > fileSize) ? fileSize : baseOffset;
+  firstBlockSize = 0;
+  blockSize = 0;
+  writtenSize = this->baseOffset;
   printf("Preparing File : %s\n", this->currentLogFilePath.c_str());
   fd = open(this->currentLogFilePath.c_str(), O_RDWR | O_CREAT, 0644);
   DSTATUS("fd = %d", fd);
   if (fd < 0) return false;
 
-  ftruncate(fd, fdAddrSize);
-  fdAddr = (char *) mmap(NULL, fdAddrSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (ftruncate(fd, fdAddrSize) != 0) {
+    DERROR("Failed to resize %s to %llu bytes", currentLogFilePath.c_str(),
+           (unsigned long long) fdAddrSize);
+    deInit();
+    return false;
+  }
+  /*! Nothing to map for an empty file */
+  if (fdAddrSize == 0) return true;
 
-  if (fdAddr)
-    return true;
-  else
+  void *addr = mmap(NULL, fdAddrSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (addr == MAP_FAILED) {
+    DERROR("Failed to map %s", currentLogFilePath.c_str());
+    deInit();
     return false;
+  }
+  fdAddr = (char *) addr;
+  return true;
 }
 
 bool MmapFileBuffer::deInit() {
   DSTATUS("Deinit");
-  if (fd >= 0) close(fd);
-  fd = -1;
   if (fdAddr) munmap(fdAddr, fdAddrSize);
   fdAddr = NULL;
+  if (fd >= 0) close(fd);
+  fd = -1;
   return true;
 }
 
-// flag 代表是否覆盖已有队列缓存
-bool MmapFileBuffer::InsertBlock(const uint8_t *pack, uint32_t data_length, int index) {
-  static uint32_t tempAdaptingBufferCnt = 0;
-  if (index == 1) tempAdaptingBufferCnt = data_length;
+bool MmapFileBuffer::getBlockOffset(uint32_t seq, uint64_t &offset) {
+  if (seq == 0) {
+    offset = baseOffset;
+    return true;
+  }
+  uint32_t first = firstBlockSize;
+  uint32_t size = blockSize;
+  if (first == 0) return false;
+  if (seq == 1) {
+    offset = baseOffset + first;
+    return true;
+  }
+  if (size == 0) return false;
+  offset = baseOffset + first + (uint64_t) (seq - 1) * size;
+  return true;
+}
+
+uint64_t MmapFileBuffer::getContiguousSize(uint32_t expectSeq) {
+  uint64_t offset = baseOffset;
+  if (!getBlockOffset(expectSeq, offset)) {
+    /*! Only the last block can be missing its size, it ends the file */
+    offset = fdAddrSize;
+  }
+  return (offset > fdAddrSize) ? fdAddrSize : offset;
+}
 
-  if ((data_length <= 0) || !fdAddr) {
+bool MmapFileBuffer::sync(uint64_t from, uint64_t to) {
+  if (!fdAddr || (from >= to)) return true;
+  if (to > fdAddrSize) to = fdAddrSize;
+  /*! msync needs a page aligned address */
+  uint64_t pageSize = sysconf(_SC_PAGESIZE);
+  from -= from % pageSize;
+  return (msync(fdAddr + from, to - from, MS_SYNC) == 0);
+}
+
+bool MmapFileBuffer::InsertBlock(const uint8_t *pack, uint32_t data_length, uint32_t seq, bool isLast) {
+  /*! Only an empty file has empty blocks, nothing to write */
+  if (data_length == 0) return isReady();
+  if (!pack || !fdAddr) return false;
+
+  if (seq == 0) {
+    firstBlockSize = data_length;
+  } else if (!isLast) {
+    uint32_t expected = 0;
+    if (!blockSize.compare_exchange_strong(expected, data_length)
+        && (expected != data_length)) {
+      DERROR("Block %u has %u bytes, %u expected", seq, data_length, expected);
+      return false;
+    }
+  }
+
+  uint64_t offset = 0;
+  if (!getBlockOffset(seq, offset)) return false;
+  if ((offset > fdAddrSize) || (data_length > fdAddrSize - offset)) {
+    DERROR("Block %u (%u bytes at %llu) is out of the file size %llu", seq,
+           data_length, (unsigned long long) offset,
+           (unsigned long long) fdAddrSize);
     return false;
   }
-  index = index * tempAdaptingBufferCnt;
-  memcpy(fdAddr + index, pack, data_length);
+  memcpy(fdAddr + offset, pack, data_length);
+  writtenSize += data_length;
 
   return true;
 }
 }
-}
\ No newline at end of file
+}
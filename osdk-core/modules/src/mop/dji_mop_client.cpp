@@ -27,6 +27,7 @@
  */
 
 #include "dji_mop_client.hpp"
+#include "dji_mop_event_loop.hpp"
 #include "mop.h"
 
 using namespace std;
@@ -38,8 +39,8 @@ MopClient::MopClient(SlotType slot) : MopPipelineManagerBase() {
 MopClient::~MopClient() {
 }
 
-MopErrCode MopClient::connect(PipelineID id, PipelineType type,
-                              MopPipeline *&p) {
+MopErrCode MopClient::createChannel(PipelineID id, PipelineType type,
+                                    MopPipeline *&p) {
   int32_t ret;
 
   /*! 1.Find whether the pipeline object created or not */
@@ -66,6 +67,14 @@ MopErrCode MopClient::connect(PipelineID id, PipelineType type,
     DERROR("MOP create channel failed");
     return getMopErrCode(ret);
   }
+  return MOP_PASSED;
+}
+
+MopErrCode MopClient::connect(PipelineID id, PipelineType type,
+                              MopPipeline *&p) {
+  int32_t ret;
+  MopErrCode createRet = createChannel(id, type, p);
+  if (createRet != MOP_PASSED) return createRet;
 
   /*! 3.Do connecting */
   do {
@@ -87,7 +96,87 @@ void MopClient::connect(PipelineID id, PipelineType type,
                         void (*cb)(MopErrCode errCode, MopPipeline *p,
                                    void *userData),
                         void *userData) {
-  if (cb) cb(MOP_NOTIMPLEMENT, NULL, NULL);
+  ConnectCtx *ctx = new ConnectCtx;
+  ctx->client = this;
+  ctx->id = id;
+  ctx->p = NULL;
+  ctx->cb = cb;
+  ctx->userData = userData;
+  ctx->ret = MOP_ERR_FAILED;
+  ctx->errCode = createChannel(id, type, ctx->p);
+
+  if (ctx->errCode == MOP_PASSED) {
+    {
+      std::lock_guard<std::mutex> lock(connectMutex);
+      connectingIds.insert(id);
+    }
+    if (MopEventLoop::instance().runBlocking(connectTask, ctx, "mopConnect")) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(connectMutex);
+    connectingIds.erase(id);
+    ctx->errCode = MOP_NOMEM;
+  }
+  /*! The result is always reported on the event loop */
+  if (!MopEventLoop::instance().post(connectDoneEvent, ctx)) {
+    if (cb) cb(ctx->errCode, NULL, userData);
+    delete ctx;
+  }
+}
+
+bool MopClient::isConnecting(PipelineID id) {
+  std::lock_guard<std::mutex> lock(connectMutex);
+  return connectingIds.find(id) != connectingIds.end();
+}
+
+void MopClient::connectTask(void *arg) {
+  ConnectCtx *ctx = (ConnectCtx *) arg;
+  MopClient *client = ctx->client;
+
+  DSTATUS("Trying to connect pipeline slot : %d, channel_id : %d", client->slot, ctx->id);
+  ctx->ret = mop_connect_channel(ctx->p->channelHandle, MOP_DEVICE_PSDK,
+                                 client->slot, ctx->id);
+  DSTATUS("Result of connecting pipeline (slot:%d, channel_id:%d) : %d", client->slot, ctx->id, ctx->ret);
+  if (!MopEventLoop::instance().post(connectDoneEvent, ctx)) {
+    DERROR("Failed to report the connecting of channel_id : %d", ctx->id);
+    delete ctx;
+  }
+}
+
+void MopClient::connectDoneEvent(void *arg) {
+  ConnectCtx *ctx = (ConnectCtx *) arg;
+  MopErrCode errCode = ctx->errCode;
+
+  if (errCode == MOP_PASSED) {
+    if (ctx->ret != MOP_SUCCESS && ctx->client->isConnecting(ctx->id)) {
+      /*! Same as the blocking connect, retried until the peer is ready */
+      if (MopEventLoop::instance().post(connectRetryEvent, ctx, CONNECT_RETRY_MS)) {
+        return;
+      }
+    }
+    bool isCanceled = !ctx->client->isConnecting(ctx->id);
+    {
+      std::lock_guard<std::mutex> lock(ctx->client->connectMutex);
+      ctx->client->connectingIds.erase(ctx->id);
+    }
+    if (isCanceled) {
+      errCode = MOP_CONNECTIONCLOSE;
+    } else {
+      errCode = getMopErrCode(ctx->ret);
+    }
+  }
+
+  if (ctx->cb) ctx->cb(errCode, (errCode == MOP_PASSED) ? ctx->p : NULL, ctx->userData);
+  delete ctx;
+}
+
+void MopClient::connectRetryEvent(void *arg) {
+  ConnectCtx *ctx = (ConnectCtx *) arg;
+
+  if (!MopEventLoop::instance().runBlocking(connectTask, ctx, "mopConnect")) {
+    ctx->errCode = MOP_NOMEM;
+    connectDoneEvent(ctx);
+  }
 }
 
 MopErrCode MopClient::disconnect(PipelineID id) {
@@ -96,6 +185,7 @@ MopErrCode MopClient::disconnect(PipelineID id) {
     return MOP_PARM;
   }
   mop_channel_handle_t handler = pipelineMap[id]->channelHandle;
+  pipelineMap[id]->stopRecvData();
 
   DSTATUS("Trying to disconnect pipeline slot : %d, channel_id : %d", slot, id);
   ret = mop_close_channel(handler);
@@ -107,5 +197,45 @@ MopErrCode MopClient::disconnect(PipelineID id) {
 void MopClient::disconnect(PipelineID id,
                            void (*cb)(MopErrCode errCode, void *userData),
                            void *userData) {
-  if (cb) cb(MOP_NOTIMPLEMENT, NULL);
+  DisconnectCtx *ctx = new DisconnectCtx;
+  ctx->channelHandle = NULL;
+  ctx->cb = cb;
+  ctx->userData = userData;
+  ctx->ret = MOP_ERR_PARM;
+
+  {
+    /*! A pending non-blocking connect ends with MOP_CONNECTIONCLOSE */
+    std::lock_guard<std::mutex> lock(connectMutex);
+    connectingIds.erase(id);
+  }
+  if (pipelineMap.find(id) != pipelineMap.end()) {
+    ctx->channelHandle = pipelineMap[id]->channelHandle;
+    pipelineMap[id]->stopRecvData();
+    DSTATUS("Trying to disconnect pipeline slot : %d, channel_id : %d", slot, id);
+    if (MopEventLoop::instance().runBlocking(disconnectTask, ctx, "mopClose")) {
+      return;
+    }
+    ctx->ret = MOP_ERR_NOMEM;
+  }
+  if (!MopEventLoop::instance().post(disconnectDoneEvent, ctx)) {
+    if (cb) cb(getMopErrCode(ctx->ret), userData);
+    delete ctx;
+  }
+}
+
+void MopClient::disconnectTask(void *arg) {
+  DisconnectCtx *ctx = (DisconnectCtx *) arg;
+
+  ctx->ret = mop_close_channel(ctx->channelHandle);
+  DSTATUS("Result of disconnecting pipeline : %d", ctx->ret);
+  if (!MopEventLoop::instance().post(disconnectDoneEvent, ctx)) {
+    delete ctx;
+  }
+}
+
+void MopClient::disconnectDoneEvent(void *arg) {
+  DisconnectCtx *ctx = (DisconnectCtx *) arg;
+
+  if (ctx->cb) ctx->cb(getMopErrCode(ctx->ret), ctx->userData);
+  delete ctx;
 }
@@ -0,0 +1,224 @@
+
+/** @file dji_mop_event_loop.cpp
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ *  @brief Event loop of the asynchronous mop apis
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#include "dji_mop_event_loop.hpp"
+#include "dji_platform.hpp"
+#include "dji_log.hpp"
+
+using namespace DJI;
+using namespace DJI::OSDK;
+
+MopEventLoop::MopEventLoop()
+    : isStarted(false), wakeSem(NULL), loopHandle(NULL), jobSem(NULL),
+      workerNum(0), idleWorkerNum(0) {
+  /*! The tasks are created on first use, the OSAL handler is not yet
+   *  registered when the singleton is constructed */
+}
+
+MopEventLoop::~MopEventLoop() {
+}
+
+bool MopEventLoop::start() {
+  if (isStarted) return true;
+
+  if (!wakeSem && OsdkOsal_SemaphoreCreate(&wakeSem, 0) != OSDK_STAT_OK) {
+    DERROR("Failed to create the semaphore of the mop event loop");
+    wakeSem = NULL;
+    return false;
+  }
+  if (!jobSem && OsdkOsal_SemaphoreCreate(&jobSem, 0) != OSDK_STAT_OK) {
+    DERROR("Failed to create the semaphore of the mop workers");
+    jobSem = NULL;
+    return false;
+  }
+  if (!Platform::instance().taskCreate(&loopHandle, loopTask,
+                                       OSDK_TASK_STACK_SIZE_DEFAULT, this,
+                                       OSDK_TASK_CLASS_DEFAULT, "mopEvtLoop")) {
+    DERROR("Failed to create the mop event loop task");
+    return false;
+  }
+  isStarted = true;
+  return true;
+}
+
+bool MopEventLoop::post(EventFunc func, void *arg, uint32_t delayMs) {
+  if (!func) return false;
+
+  Event event = {func, arg, 0};
+  {
+    std::lock_guard<std::mutex> lock(eventMutex);
+    if (!start()) return false;
+    if (delayMs) {
+      uint32_t nowMs = 0;
+      OsdkOsal_GetTimeMs(&nowMs);
+      event.dueMs = nowMs + delayMs;
+      timers.push_back(event);
+    } else {
+      events.push_back(event);
+    }
+  }
+  OsdkOsal_SemaphorePost(wakeSem);
+  return true;
+}
+
+bool MopEventLoop::startWorker() {
+  if (!Platform::instance().taskCreate(&workerHandles[workerNum], workerTask,
+                                       OSDK_TASK_STACK_SIZE_DEFAULT, this,
+                                       OSDK_TASK_CLASS_DEFAULT, "mopWorker")) {
+    DERROR("Failed to create the mop worker task %d", workerNum);
+    return false;
+  }
+  workerNum++;
+  return true;
+}
+
+bool MopEventLoop::runBlocking(EventFunc func, void *arg, const char *name) {
+  if (!func) return false;
+
+  Event job = {func, arg, 0};
+  {
+    std::lock_guard<std::mutex> lock(eventMutex);
+    if (!start()) return false;
+    /*! One more worker if all of them are taken, the call waits for a
+     *  worker to be free once there are WORKER_NUM */
+    if ((jobs.size() >= idleWorkerNum) && (workerNum < WORKER_NUM) &&
+        !startWorker() && !workerNum) {
+      DERROR("No worker for the mop call %s", name ? name : "");
+      return false;
+    }
+    jobs.push_back(job);
+  }
+  OsdkOsal_SemaphorePost(jobSem);
+  return true;
+}
+
+bool MopEventLoop::runWaiter(EventFunc func, void *arg, const char *name) {
+  if (!func) return false;
+
+  Waiter *waiter = new Waiter;
+  waiter->owner = this;
+  waiter->func = func;
+  waiter->arg = arg;
+  waiter->handle = NULL;
+
+  /*! Held until the handle is stored, the waiter may finish before
+   *  taskCreate returns */
+  std::lock_guard<std::mutex> lock(eventMutex);
+  if (!start() ||
+      !Platform::instance().taskCreate(&waiter->handle, waiterTask,
+                                       OSDK_TASK_STACK_SIZE_DEFAULT, waiter,
+                                       OSDK_TASK_CLASS_DEFAULT, name)) {
+    DERROR("Failed to create the mop task %s", name ? name : "");
+    delete waiter;
+    return false;
+  }
+  return true;
+}
+
+uint32_t MopEventLoop::runEvents() {
+  std::deque<Event> ready;
+  std::list<Waiter *> exited;
+  uint32_t waitMs = MAX_WAIT_MS;
+  uint32_t nowMs = 0;
+
+  OsdkOsal_GetTimeMs(&nowMs);
+  {
+    std::lock_guard<std::mutex> lock(eventMutex);
+    ready.swap(events);
+    exited.swap(exitedWaiters);
+    for (std::list<Event>::iterator it = timers.begin(); it != timers.end();) {
+      int32_t leftMs = (int32_t)(it->dueMs - nowMs);
+      if (leftMs <= 0) {
+        ready.push_back(*it);
+        it = timers.erase(it);
+      } else {
+        if ((uint32_t)leftMs < waitMs) waitMs = leftMs;
+        ++it;
+      }
+    }
+  }
+
+  for (std::deque<Event>::iterator it = ready.begin(); it != ready.end(); ++it) {
+    it->func(it->arg);
+  }
+  for (std::list<Waiter *>::iterator it = exited.begin(); it != exited.end(); ++it) {
+    /*! The task has returned, this only joins it */
+    Platform::instance().taskDestroy((*it)->handle);
+    delete *it;
+  }
+
+  /*! Events posted by the callbacks are run without sleeping */
+  std::lock_guard<std::mutex> lock(eventMutex);
+  return (events.empty() && exitedWaiters.empty()) ? waitMs : 0;
+}
+
+void *MopEventLoop::loopTask(void *arg) {
+  MopEventLoop *loop = (MopEventLoop *) arg;
+
+  while (true) {
+    uint32_t waitMs = loop->runEvents();
+    if (waitMs) OsdkOsal_SemaphoreTimedWait(loop->wakeSem, waitMs);
+  }
+  return NULL;
+}
+
+void *MopEventLoop::workerTask(void *arg) {
+  MopEventLoop *loop = (MopEventLoop *) arg;
+
+  while (true) {
+    {
+      std::lock_guard<std::mutex> lock(loop->eventMutex);
+      loop->idleWorkerNum++;
+    }
+    OsdkOsal_SemaphoreWait(loop->jobSem);
+
+    Event job;
+    {
+      std::lock_guard<std::mutex> lock(loop->eventMutex);
+      loop->idleWorkerNum--;
+      if (loop->jobs.empty()) continue;
+      job = loop->jobs.front();
+      loop->jobs.pop_front();
+    }
+    job.func(job.arg);
+  }
+  return NULL;
+}
+
+void *MopEventLoop::waiterTask(void *arg) {
+  Waiter *waiter = (Waiter *) arg;
+  MopEventLoop *loop = waiter->owner;
+
+  waiter->func(waiter->arg);
+  {
+    std::lock_guard<std::mutex> lock(loop->eventMutex);
+    loop->exitedWaiters.push_back(waiter);
+  }
+  OsdkOsal_SemaphorePost(loop->wakeSem);
+  return NULL;
+}
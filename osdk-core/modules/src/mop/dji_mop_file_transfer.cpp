@@ -0,0 +1,704 @@
+
+/** @file dji_mop_file_transfer.cpp
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ *  @brief Pipelined file transfer over a mop pipeline
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#include "dji_mop_file_transfer.hpp"
+#include "dji_platform.hpp"
+#include "dji_log.hpp"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace DJI;
+using namespace DJI::OSDK;
+
+#define HASH_READ_SIZE (64 * 1024)
+
+const uint32_t MopFileTransfer::PEER_TIMEOUT_MS;
+
+static uint32_t getTimeMs() {
+  uint32_t ms = 0;
+  OsdkOsal_GetTimeMs(&ms);
+  return ms;
+}
+
+static bool preadFull(int fd, uint8_t *buf, uint32_t len, uint64_t offset) {
+  while (len) {
+    ssize_t ret = pread(fd, buf, len, offset);
+    if (ret <= 0) return false;
+    buf += ret;
+    len -= ret;
+    offset += ret;
+  }
+  return true;
+}
+
+static bool pwriteFull(int fd, const uint8_t *buf, uint32_t len, uint64_t offset) {
+  while (len) {
+    ssize_t ret = pwrite(fd, buf, len, offset);
+    if (ret <= 0) return false;
+    buf += ret;
+    len -= ret;
+    offset += ret;
+  }
+  return true;
+}
+
+/*! Keep the last path component only, the peer must not choose the dir */
+static std::string getSafeFileName(const char *name, size_t maxLen) {
+  std::string fileName(name, strnlen(name, maxLen));
+  size_t pos = fileName.find_last_of('/');
+  if (pos != std::string::npos) fileName = fileName.substr(pos + 1);
+  if (fileName == "." || fileName == "..") fileName.clear();
+  return fileName;
+}
+
+MopFileTransfer::MopFileTransfer(MopPipeline *pipeline, uint32_t chunkSize,
+                                 uint32_t windowNum)
+    : pipeline(pipeline), progressCB(NULL), progressUserData(NULL),
+      error(MOP_PASSED), isStopped(false), fd(-1), taskHandle(NULL) {
+  if (chunkSize == 0 || chunkSize > MAX_CHUNK_SIZE) chunkSize = DEFAULT_CHUNK_SIZE;
+  if (windowNum == 0 || windowNum > MAX_WINDOW_NUM) windowNum = DEFAULT_WINDOW_NUM;
+  this->chunkSize = chunkSize;
+  this->windowNum = windowNum;
+  memset(digest, 0, sizeof(digest));
+  reset();
+}
+
+MopFileTransfer::~MopFileTransfer() {
+  stop();
+  if (fd >= 0) close(fd);
+}
+
+void MopFileTransfer::setProgressCallback(ProgressCBType cb, void *userData) {
+  progressCB = cb;
+  progressUserData = userData;
+}
+
+void MopFileTransfer::stop() {
+  isStopped = true;
+  setError(MOP_CONNECTIONCLOSE);
+}
+
+void MopFileTransfer::getDigest(uint8_t md5[MD5_BLOCK_SIZE]) {
+  memcpy(md5, digest, MD5_BLOCK_SIZE);
+}
+
+void MopFileTransfer::reset() {
+  std::lock_guard<std::mutex> lock(mutex);
+  error = MOP_PASSED;
+  isStopped = false;
+  fileSize = 0;
+  resumeOffset = 0;
+  chunkNum = 0;
+  OsdkMd5_Init(&md5Ctx);
+  chunks.clear();
+  readSeq = 0;
+  sentSeq = 0;
+  ackedSeq = 0;
+  freeChunks.clear();
+  recvChunks.clear();
+  doneOffset = 0;
+  memset(peerPrefixDigest, 0, sizeof(peerPrefixDigest));
+  isStartAcked = false;
+  isResultRecved = false;
+  isRecvDone = false;
+  isTaskDone = true;
+}
+
+void MopFileTransfer::setError(MopErrCode err) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (error == MOP_PASSED) error = err;
+  }
+  cond.notify_all();
+}
+
+MopErrCode MopFileTransfer::sendMsg(uint8_t cmd, uint8_t result, uint64_t offset,
+                                    const void *data, uint32_t dataLen) {
+  MsgHeader header;
+  memset(&header, 0, sizeof(header));
+  header.cmd = cmd;
+  header.result = result;
+  header.offset = offset;
+  header.dataLen = dataLen;
+
+  MopPipeline::DataPackType packs[2] = {
+      {(uint8_t *) &header, sizeof(header)},
+      {(uint8_t *) data, dataLen}};
+  uint32_t len = 0;
+  return pipeline->sendData(packs, 2, &len);
+}
+
+bool MopFileTransfer::hashFile(int fd, uint64_t size) {
+  std::vector<uint8_t> buf(HASH_READ_SIZE);
+  uint64_t offset = 0;
+
+  while (offset < size) {
+    uint32_t len = (size - offset > HASH_READ_SIZE) ? HASH_READ_SIZE : size - offset;
+    if (!preadFull(fd, &buf[0], len, offset)) return false;
+    OsdkMd5_Update(&md5Ctx, &buf[0], len);
+    offset += len;
+  }
+  return true;
+}
+
+void MopFileTransfer::reportProgress(uint64_t doneSize) {
+  if (progressCB) progressCB(doneSize, fileSize, progressUserData);
+}
+
+bool MopFileTransfer::startTask(void *(*taskFunc)(void *), const char *name) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    isTaskDone = false;
+  }
+  if (!Platform::instance().taskCreate(&taskHandle, taskFunc,
+                                       OSDK_TASK_STACK_SIZE_DEFAULT, this,
+                                       OSDK_TASK_CLASS_FILE_TRANSFER, name)) {
+    DERROR("Failed to create the task %s", name);
+    std::lock_guard<std::mutex> lock(mutex);
+    isTaskDone = true;
+    return false;
+  }
+  return true;
+}
+
+void MopFileTransfer::joinTask() {
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    cond.wait(lock, [this] { return isTaskDone; });
+  }
+  if (taskHandle) {
+    Platform::instance().taskDestroy(taskHandle);
+    taskHandle = NULL;
+  }
+}
+
+/*! Sender */
+
+MopErrCode MopFileTransfer::sendFile(const std::string &localPath,
+                                     const std::string &remoteName) {
+  if (!pipeline) return MOP_PARM;
+  /*! Not reset here, a stop() racing the start is kept */
+  MopErrCode ret = isStopped ? MOP_CONNECTIONCLOSE : runSend(localPath, remoteName);
+  reset();
+  return ret;
+}
+
+MopErrCode MopFileTransfer::runSend(const std::string &localPath,
+                                    const std::string &remoteName) {
+
+  fd = open(localPath.c_str(), O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    DERROR("Failed to open %s", localPath.c_str());
+    if (fd >= 0) close(fd);
+    fd = -1;
+    return MOP_PARM;
+  }
+  fileSize = st.st_size;
+
+  StartInfo info;
+  memset(&info, 0, sizeof(info));
+  info.fileSize = fileSize;
+  info.chunkSize = chunkSize;
+  info.windowNum = windowNum;
+  std::string name = remoteName.empty() ? localPath : remoteName;
+  name = getSafeFileName(name.c_str(), name.size());
+  strncpy(info.fileName, name.c_str(), FILE_NAME_MAX_LEN - 1);
+
+  /*! The acks are handled on the mop event loop while this task sends */
+  MopErrCode ret = pipeline->startRecvData(
+      sizeof(MsgHeader) + sizeof(StartInfo) + MD5_BLOCK_SIZE, senderRecvCB, this);
+  if (ret == MOP_PASSED) ret = sendMsg(MSG_START, MOP_PASSED, 0, &info, sizeof(info));
+  if (ret != MOP_PASSED) setError(ret);
+
+  std::unique_lock<std::mutex> lock(mutex);
+  if (!cond.wait_for(lock, std::chrono::milliseconds(PEER_TIMEOUT_MS),
+                     [this] { return isStartAcked || error != MOP_PASSED; })) {
+    error = MOP_TIMEOUT;
+  }
+
+  if (error == MOP_PASSED) {
+    DSTATUS("Send %s, %llu bytes from %llu, chunk %u, window %u", name.c_str(),
+            (unsigned long long) fileSize, (unsigned long long) resumeOffset,
+            chunkSize, windowNum);
+    chunkNum = (fileSize - resumeOffset + chunkSize - 1) / chunkSize;
+    chunks.resize(windowNum);
+    for (uint32_t i = 0; i < windowNum; i++) {
+      chunks[i].buf.resize(sizeof(MsgHeader) + chunkSize);
+    }
+    lock.unlock();
+    if (!startTask(readerTask, "mopFileRead")) setError(MOP_NOMEM);
+    lock.lock();
+  }
+
+  /*! Send the chunks as the reader provides them, within the window */
+  uint64_t lastDoneOffset = doneOffset;
+  uint32_t lastProgressMs = getTimeMs();
+  while (error == MOP_PASSED && ackedSeq < chunkNum) {
+    if (sentSeq < readSeq) {
+      Chunk &chunk = chunks[sentSeq % windowNum];
+      MopPipeline::DataPackType pack = {&chunk.buf[0],
+                                        (uint32_t) sizeof(MsgHeader) + chunk.dataLen};
+      lock.unlock();
+      uint32_t len = 0;
+      ret = pipeline->sendData(pack, &len);
+      lock.lock();
+      if (ret != MOP_PASSED) {
+        DERROR("Send chunk %u failed", sentSeq);
+        if (error == MOP_PASSED) error = ret;
+      } else {
+        sentSeq++;
+      }
+      continue;
+    }
+
+    cond.wait_for(lock, std::chrono::milliseconds(100));
+    if (doneOffset != lastDoneOffset) {
+      lastDoneOffset = doneOffset;
+      lastProgressMs = getTimeMs();
+    } else if ((ackedSeq < sentSeq) &&
+               (getTimeMs() - lastProgressMs > PEER_TIMEOUT_MS)) {
+      DERROR("No ack for chunk %u", ackedSeq);
+      error = MOP_TIMEOUT;
+    }
+  }
+  lock.unlock();
+  cond.notify_all();
+  joinTask();
+
+  /*! The receiver answers END with the result of its MD5 check */
+  lock.lock();
+  if (error == MOP_PASSED) {
+    OsdkMd5_Final(&md5Ctx, digest);
+    lock.unlock();
+    ret = sendMsg(MSG_END, MOP_PASSED, fileSize, digest, sizeof(digest));
+    lock.lock();
+    if (ret != MOP_PASSED) error = ret;
+  }
+  if (error == MOP_PASSED &&
+      !cond.wait_for(lock, std::chrono::milliseconds(PEER_TIMEOUT_MS),
+                     [this] { return isResultRecved || error != MOP_PASSED; })) {
+    error = MOP_TIMEOUT;
+  }
+  ret = error;
+  bool isPeerDone = isResultRecved;
+  lock.unlock();
+
+  if (ret != MOP_PASSED && !isPeerDone) {
+    sendMsg(MSG_ABORT, ret, 0, NULL, 0);
+  }
+  pipeline->stopRecvData();
+  close(fd);
+  fd = -1;
+  DSTATUS("Send %s result : %d", name.c_str(), ret);
+  return ret;
+}
+
+bool MopFileTransfer::readChunks() {
+  /*! The digest covers the whole file, also the part the peer has */
+  if (!hashFile(fd, resumeOffset)) return false;
+  if (resumeOffset) {
+    /*! The part the peer has must be the beginning of this file */
+    uint8_t prefixDigest[MD5_BLOCK_SIZE];
+    MD5_CTX prefixCtx = md5Ctx;
+    OsdkMd5_Final(&prefixCtx, prefixDigest);
+    if (memcmp(prefixDigest, peerPrefixDigest, MD5_BLOCK_SIZE) != 0) {
+      DERROR("The first %llu bytes of the receiver differ from the file",
+             (unsigned long long) resumeOffset);
+      setError(MOP_CRC);
+      return true;
+    }
+  }
+
+  for (uint32_t seq = 0; seq < chunkNum; seq++) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cond.wait(lock, [this, seq] {
+        return error != MOP_PASSED || seq < ackedSeq + windowNum;
+      });
+      if (error != MOP_PASSED) return true;
+    }
+
+    Chunk &chunk = chunks[seq % windowNum];
+    uint64_t offset = resumeOffset + (uint64_t) seq * chunkSize;
+    uint32_t len = (fileSize - offset > chunkSize) ? chunkSize : fileSize - offset;
+    MsgHeader *header = (MsgHeader *) &chunk.buf[0];
+    uint8_t *data = &chunk.buf[sizeof(MsgHeader)];
+    if (!preadFull(fd, data, len, offset)) return false;
+
+    memset(header, 0, sizeof(MsgHeader));
+    header->cmd = MSG_DATA;
+    header->seq = seq;
+    header->offset = offset;
+    header->dataLen = len;
+    chunk.dataLen = len;
+    OsdkMd5_Update(&md5Ctx, data, len);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      readSeq = seq + 1;
+    }
+    cond.notify_all();
+  }
+  return true;
+}
+
+void *MopFileTransfer::readerTask(void *arg) {
+  MopFileTransfer *transfer = (MopFileTransfer *) arg;
+
+  if (!transfer->readChunks()) {
+    DERROR("Failed to read the file to send");
+    transfer->setError(MOP_FAILED);
+  }
+  {
+    std::lock_guard<std::mutex> lock(transfer->mutex);
+    transfer->isTaskDone = true;
+  }
+  transfer->cond.notify_all();
+  return NULL;
+}
+
+void MopFileTransfer::senderRecvCB(MopErrCode errCode, uint8_t *data,
+                                   uint32_t len, void *userData) {
+  MopFileTransfer *transfer = (MopFileTransfer *) userData;
+  MsgHeader *header = (MsgHeader *) data;
+
+  if (errCode != MOP_PASSED) {
+    transfer->setError(errCode);
+    return;
+  }
+  if (len < sizeof(MsgHeader)) return;
+
+  uint64_t doneSize = 0;
+  {
+    std::lock_guard<std::mutex> lock(transfer->mutex);
+    switch (header->cmd) {
+      case MSG_START_ACK: {
+        if (header->result != MOP_PASSED) {
+          if (transfer->error == MOP_PASSED) transfer->error = (MopErrCode) header->result;
+          break;
+        }
+        if (len < sizeof(MsgHeader) + sizeof(StartInfo)) break;
+        StartInfo *info = (StartInfo *) (data + sizeof(MsgHeader));
+        /*! Without the digest of its part the receiver starts over */
+        if (header->offset &&
+            len < sizeof(MsgHeader) + sizeof(StartInfo) + MD5_BLOCK_SIZE) {
+          if (transfer->error == MOP_PASSED) transfer->error = MOP_CRC;
+          break;
+        }
+        if (header->offset) {
+          memcpy(transfer->peerPrefixDigest, data + sizeof(MsgHeader) + sizeof(StartInfo),
+                 MD5_BLOCK_SIZE);
+        }
+        if (info->chunkSize && info->chunkSize < transfer->chunkSize) {
+          transfer->chunkSize = info->chunkSize;
+        }
+        if (info->windowNum && info->windowNum < transfer->windowNum) {
+          transfer->windowNum = info->windowNum;
+        }
+        transfer->resumeOffset = (header->offset > transfer->fileSize)
+                                     ? transfer->fileSize : header->offset;
+        transfer->doneOffset = transfer->resumeOffset;
+        transfer->isStartAcked = true;
+        break;
+      }
+      case MSG_ACK: {
+        if (!transfer->isStartAcked || header->offset <= transfer->doneOffset ||
+            header->offset > transfer->fileSize) {
+          break;
+        }
+        transfer->doneOffset = header->offset;
+        transfer->ackedSeq =
+            (header->offset == transfer->fileSize)
+                ? transfer->chunkNum
+                : (header->offset - transfer->resumeOffset) / transfer->chunkSize;
+        doneSize = transfer->doneOffset;
+        break;
+      }
+      case MSG_RESULT:
+        transfer->isResultRecved = true;
+        if (transfer->error == MOP_PASSED) transfer->error = (MopErrCode) header->result;
+        break;
+      case MSG_ABORT:
+        DERROR("File transfer aborted by the receiver : %d", header->result);
+        if (transfer->error == MOP_PASSED) transfer->error = MOP_CONNECTIONCLOSE;
+        break;
+      default:
+        break;
+    }
+  }
+  transfer->cond.notify_all();
+  if (doneSize) transfer->reportProgress(doneSize);
+}
+
+/*! Receiver */
+
+MopErrCode MopFileTransfer::recvFile(const std::string &localDir,
+                                     std::string &fileName) {
+  if (!pipeline) return MOP_PARM;
+  /*! Not reset here, a stop() racing the start is kept */
+  MopErrCode ret = isStopped ? MOP_CONNECTIONCLOSE : runRecv(localDir, fileName);
+  reset();
+  return ret;
+}
+
+MopErrCode MopFileTransfer::runRecv(const std::string &localDir,
+                                    std::string &fileName) {
+
+  /*! 1. Wait for the START of the sender */
+  std::vector<uint8_t> startBuf(sizeof(MsgHeader) + sizeof(StartInfo));
+  MsgHeader *header = (MsgHeader *) &startBuf[0];
+  StartInfo *info = (StartInfo *) &startBuf[sizeof(MsgHeader)];
+  MopErrCode ret;
+  while (true) {
+    MopPipeline::DataPackType pack = {&startBuf[0], (uint32_t) startBuf.size()};
+    uint32_t len = 0;
+    ret = pipeline->recvData(pack, &len);
+    if (isStopped) return MOP_CONNECTIONCLOSE;
+    if (ret == MOP_TIMEOUT) continue;
+    if (ret != MOP_PASSED) return ret;
+    if (len >= startBuf.size() && header->cmd == MSG_START) break;
+  }
+
+  fileName = getSafeFileName(info->fileName, FILE_NAME_MAX_LEN);
+  fileSize = info->fileSize;
+  if (info->chunkSize && info->chunkSize < chunkSize) chunkSize = info->chunkSize;
+  if (info->windowNum && info->windowNum < windowNum) windowNum = info->windowNum;
+
+  /*! 2. Continue a file already there, the digest covers what it has */
+  std::string path = localDir + "/" + fileName;
+  struct stat st;
+  if (!fileName.empty()) fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    DERROR("Failed to open %s", path.c_str());
+    sendMsg(MSG_START_ACK, MOP_PARM, 0, NULL, 0);
+    if (fd >= 0) close(fd);
+    fd = -1;
+    return MOP_PARM;
+  }
+  resumeOffset = st.st_size;
+  if (resumeOffset > fileSize) {
+    /*! Not a part of this file */
+    resumeOffset = 0;
+    if (ftruncate(fd, 0) != 0) {
+      DERROR("Failed to truncate %s", path.c_str());
+    }
+  }
+  if (!hashFile(fd, resumeOffset)) {
+    resumeOffset = 0;
+    OsdkMd5_Init(&md5Ctx);
+  }
+  doneOffset = resumeOffset;
+  DSTATUS("Receive %s, %llu bytes from %llu, chunk %u, window %u",
+          fileName.c_str(), (unsigned long long) fileSize,
+          (unsigned long long) resumeOffset, chunkSize, windowNum);
+
+  /*! One chunk more than the window, the next read goes on while the
+   *  writer still holds a full window */
+  chunks.resize(windowNum + 1);
+  for (uint32_t i = 0; i < chunks.size(); i++) {
+    chunks[i].buf.resize(sizeof(MsgHeader) + chunkSize);
+    freeChunks.push_back(&chunks[i]);
+  }
+
+  /*! START_ACK carries the digest of the part already here, the sender
+   *  checks it against its file before sending the rest */
+  uint8_t ackBuf[sizeof(StartInfo) + MD5_BLOCK_SIZE];
+  StartInfo *ackInfo = (StartInfo *) ackBuf;
+  *ackInfo = *info;
+  ackInfo->chunkSize = chunkSize;
+  ackInfo->windowNum = windowNum;
+  MD5_CTX prefixCtx = md5Ctx;
+  OsdkMd5_Final(&prefixCtx, &ackBuf[sizeof(StartInfo)]);
+  ret = sendMsg(MSG_START_ACK, MOP_PASSED, resumeOffset, ackBuf, sizeof(ackBuf));
+  if (ret != MOP_PASSED || !startTask(writerTask, "mopFileWrite")) {
+    setError(ret != MOP_PASSED ? ret : MOP_NOMEM);
+  }
+
+  /*! 3. Receive into the free chunks, the writer task writes them */
+  uint64_t expectOffset = resumeOffset;
+  bool isEndRecved = false;
+  bool isCorrupted = false;
+  std::unique_lock<std::mutex> lock(mutex);
+  while (error == MOP_PASSED && !isEndRecved) {
+    cond.wait(lock, [this] { return !freeChunks.empty() || error != MOP_PASSED; });
+    if (error != MOP_PASSED) break;
+    Chunk *chunk = freeChunks.front();
+    freeChunks.pop_front();
+    lock.unlock();
+
+    MopPipeline::DataPackType pack = {&chunk->buf[0], (uint32_t) chunk->buf.size()};
+    uint32_t len = 0;
+    ret = pipeline->recvData(pack, &len);
+    header = (MsgHeader *) &chunk->buf[0];
+
+    lock.lock();
+    if (ret == MOP_TIMEOUT || (ret == MOP_PASSED && len < sizeof(MsgHeader))) {
+      freeChunks.push_back(chunk);
+      continue;
+    }
+    if (ret != MOP_PASSED) {
+      if (error == MOP_PASSED) error = ret;
+      freeChunks.push_back(chunk);
+      break;
+    }
+
+    switch (header->cmd) {
+      case MSG_DATA:
+        if (header->offset != expectOffset ||
+            header->dataLen != len - sizeof(MsgHeader) ||
+            header->dataLen > fileSize - expectOffset) {
+          DERROR("Unexpected chunk %u at %llu", header->seq,
+                 (unsigned long long) header->offset);
+          if (error == MOP_PASSED) error = MOP_RECV;
+          freeChunks.push_back(chunk);
+          break;
+        }
+        expectOffset += header->dataLen;
+        chunk->dataLen = header->dataLen;
+        recvChunks.push_back(chunk);
+        cond.notify_all();
+        break;
+      case MSG_END: {
+        /*! Wait for the writer to hash all the data */
+        isEndRecved = true;
+        uint8_t peerDigest[MD5_BLOCK_SIZE];
+        bool hasDigest = (len >= sizeof(MsgHeader) + MD5_BLOCK_SIZE);
+        if (hasDigest) memcpy(peerDigest, &chunk->buf[sizeof(MsgHeader)], MD5_BLOCK_SIZE);
+        freeChunks.push_back(chunk);
+        cond.wait(lock, [this, expectOffset] {
+          return doneOffset == expectOffset || error != MOP_PASSED;
+        });
+        if (error != MOP_PASSED) break;
+        OsdkMd5_Final(&md5Ctx, digest);
+        if (expectOffset != fileSize || !hasDigest ||
+            memcmp(peerDigest, digest, MD5_BLOCK_SIZE) != 0) {
+          DERROR("MD5 of %s does not match", fileName.c_str());
+          error = MOP_CRC;
+          isCorrupted = true;
+        }
+        MopErrCode result = error;
+        lock.unlock();
+        ret = sendMsg(MSG_RESULT, result, doneOffset, NULL, 0);
+        lock.lock();
+        /*! A mismatch is reported by RESULT, no ABORT after it */
+        if (result == MOP_PASSED && ret != MOP_PASSED) error = ret;
+        break;
+      }
+      case MSG_ABORT:
+        DERROR("File transfer aborted by the sender : %d", header->result);
+        /*! The sender found the part here is not from its file */
+        if (header->result == MOP_CRC) isCorrupted = true;
+        if (error == MOP_PASSED) error = MOP_CONNECTIONCLOSE;
+        freeChunks.push_back(chunk);
+        break;
+      default:
+        freeChunks.push_back(chunk);
+        break;
+    }
+  }
+
+  isRecvDone = true;
+  ret = error;
+  lock.unlock();
+  cond.notify_all();
+  joinTask();
+
+  if (ret != MOP_PASSED && !isEndRecved && !isStopped) {
+    sendMsg(MSG_ABORT, ret, 0, NULL, 0);
+  }
+  /*! Not resumed from, the next transfer of the file starts over */
+  if (isCorrupted && ftruncate(fd, 0) != 0) {
+    DERROR("Failed to truncate %s", path.c_str());
+  }
+  close(fd);
+  fd = -1;
+  DSTATUS("Receive %s result : %d", fileName.c_str(), ret);
+  return ret;
+}
+
+void MopFileTransfer::writeChunks() {
+  uint32_t ackEvery = (windowNum > 1) ? windowNum / 2 : 1;
+  uint32_t unackedNum = 0;
+
+  while (true) {
+    Chunk *chunk;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cond.wait(lock, [this] {
+        return !recvChunks.empty() || isRecvDone || error != MOP_PASSED;
+      });
+      if (error != MOP_PASSED || recvChunks.empty()) return;
+      chunk = recvChunks.front();
+      recvChunks.pop_front();
+    }
+
+    MsgHeader *header = (MsgHeader *) &chunk->buf[0];
+    uint8_t *data = &chunk->buf[sizeof(MsgHeader)];
+    if (!pwriteFull(fd, data, chunk->dataLen, header->offset)) {
+      DERROR("Failed to write the received file");
+      setError(MOP_FAILED);
+      return;
+    }
+    OsdkMd5_Update(&md5Ctx, data, chunk->dataLen);
+
+    uint64_t doneSize;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      doneOffset += chunk->dataLen;
+      doneSize = doneOffset;
+      freeChunks.push_back(chunk);
+    }
+    cond.notify_all();
+
+    /*! The sender slides its window on these, the last chunk is always
+     *  acknowledged */
+    if (++unackedNum >= ackEvery || doneSize == fileSize) {
+      unackedNum = 0;
+      if (sendMsg(MSG_ACK, MOP_PASSED, doneSize, NULL, 0) != MOP_PASSED) {
+        setError(MOP_SEND);
+        return;
+      }
+      reportProgress(doneSize);
+    }
+  }
+}
+
+void *MopFileTransfer::writerTask(void *arg) {
+  MopFileTransfer *transfer = (MopFileTransfer *) arg;
+
+  transfer->writeChunks();
+  {
+    std::lock_guard<std::mutex> lock(transfer->mutex);
+    transfer->isTaskDone = true;
+  }
+  transfer->cond.notify_all();
+  return NULL;
+}
@@ -27,13 +27,80 @@
  */
 
 #include "dji_mop_pipeline.hpp"
+#include "dji_mop_event_loop.hpp"
 #include "mop.h"
+#include <deque>
+#include <mutex>
+#include <string.h>
+#include <vector>
 
-MopPipeline::MopPipeline(PipelineID id, PipelineType type) : id(id),
-                                                             type(type) {
+struct MopPipeline::AsyncState {
+  typedef struct SendOp {
+    void *channelHandle;
+    DataPackType dataPacket;
+    SendCBType cb;
+    void *userData;
+  } SendOp;
+
+  std::mutex mutex;
+
+  std::deque<SendOp> sendQueue;
+  /*! A send task is draining sendQueue */
+  bool isSending;
+
+  bool isRecving;
+  /*! The read task has not exited, it may still be blocked in a read */
+  bool isReaderRunning;
+  /*! Changed by each start and stop, the reads of an older receiving are
+   *  dropped */
+  uint32_t recvGen;
+  RecvCBType recvCB;
+  void *recvUserData;
+  /*! Data kept for tryRecvData when there is no recvCB */
+  std::deque<std::vector<uint8_t> > recvQueue;
+  uint32_t recvOffset;
+  uint32_t readySize;
+  MopErrCode recvErr;
+
+  /*! Reused by the gathered sends and the scattered receives, up to
+   *  MAX_KEPT_GATHER_SIZE */
+  std::mutex gatherMutex;
+  std::vector<uint8_t> gatherBuf;
+  std::mutex scatterMutex;
+  std::vector<uint8_t> scatterBuf;
+
+  typedef struct SendDone {
+    SendCBType cb;
+    void *userData;
+    MopErrCode errCode;
+    uint32_t len;
+  } SendDone;
+
+  typedef struct RecvCtx {
+    AsyncStatePtr state;
+    void *channelHandle;
+    uint32_t bufSize;
+    uint32_t gen;
+  } RecvCtx;
+
+  typedef struct RecvDone {
+    AsyncStatePtr state;
+    uint32_t gen;
+    MopErrCode errCode;
+    std::vector<uint8_t> data;
+  } RecvDone;
+
+  AsyncState()
+      : isSending(false), isRecving(false), isReaderRunning(false), recvGen(0), recvCB(NULL),
+        recvUserData(NULL), recvOffset(0), readySize(0), recvErr(MOP_PASSED) {}
+};
+
+MopPipeline::MopPipeline(PipelineID id, PipelineType type)
+    : channelHandle(NULL), id(id), type(type), asyncState(new AsyncState) {
 }
 
 MopPipeline::~MopPipeline() {
+  stopRecvData();
 }
 
 MopErrCode MopPipeline::sendData(DataPackType dataPacket, uint32_t *len) {
@@ -67,25 +134,313 @@ MopErrCode MopPipeline::recvData(DataPackType dataPacket, uint32_t *len) {
   }
 }
 
-PipelineID MopPipeline::getId() {
-  return this->id;
+static bool getTotalLength(const MopPipeline::DataPackType *dataPackets,
+                           uint32_t packNum, uint32_t &total) {
+  total = 0;
+  if (!dataPackets || !packNum) return false;
+  for (uint32_t i = 0; i < packNum; i++) {
+    if (!dataPackets[i].data && dataPackets[i].length) return false;
+    if (dataPackets[i].length > UINT32_MAX - total) return false;
+    total += dataPackets[i].length;
+  }
+  return true;
 }
 
-PipelineType MopPipeline::getType() {
-  return this->type;
+MopErrCode MopPipeline::sendData(const DataPackType *dataPackets,
+                                 uint32_t packNum, uint32_t *len) {
+  uint32_t total;
+  if (!len || !getTotalLength(dataPackets, packNum, total)) return MOP_PARM;
+
+  /*! Skip the empty packets, the rest is sent without copy if it is one
+   *  span of memory */
+  const uint8_t *start = NULL;
+  const uint8_t *end = NULL;
+  bool isContiguous = true;
+  for (uint32_t i = 0; i < packNum; i++) {
+    if (!dataPackets[i].length) continue;
+    if (!start) {
+      start = dataPackets[i].data;
+    } else if (dataPackets[i].data != end) {
+      isContiguous = false;
+      break;
+    }
+    end = dataPackets[i].data + dataPackets[i].length;
+  }
+  if (isContiguous) {
+    DataPackType span = {(uint8_t *) start, total};
+    return sendData(span, len);
+  }
+
+  /*! mop_write_channel has no vectored form, the packets are copied once */
+  std::lock_guard<std::mutex> lock(asyncState->gatherMutex);
+  std::vector<uint8_t> &buf = asyncState->gatherBuf;
+  if (buf.size() < total) buf.resize(total);
+  uint32_t offset = 0;
+  for (uint32_t i = 0; i < packNum; i++) {
+    if (!dataPackets[i].length) continue;
+    memcpy(&buf[offset], dataPackets[i].data, dataPackets[i].length);
+    offset += dataPackets[i].length;
+  }
+  DataPackType gathered = {&buf[0], total};
+  MopErrCode ret = sendData(gathered, len);
+  if (buf.size() > MAX_KEPT_GATHER_SIZE) std::vector<uint8_t>().swap(buf);
+  return ret;
 }
 
-#if 0
-/*! 异步接口目前先不实现 @TODO:add和register的概念,add表示可以支持多个CB同时触发? */
-void MopPipeline::addDataListener(
-    void (*cb)(uint8_t *data, uint32_t *len, void *userData),
-    void *userData) {
+MopErrCode MopPipeline::recvData(const DataPackType *dataPackets,
+                                 uint32_t packNum, uint32_t *len) {
+  uint32_t total;
+  if (!len || !getTotalLength(dataPackets, packNum, total)) return MOP_PARM;
+  if (packNum == 1) return recvData(dataPackets[0], len);
 
+  /*! mop_read_channel has no vectored form, the message is copied once */
+  std::lock_guard<std::mutex> lock(asyncState->scatterMutex);
+  std::vector<uint8_t> &buf = asyncState->scatterBuf;
+  if (buf.size() < total) buf.resize(total);
+  DataPackType whole = {total ? &buf[0] : NULL, total};
+  uint32_t recvLen = 0;
+  MopErrCode ret = recvData(whole, &recvLen);
+  if (ret == MOP_PASSED) {
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < packNum && offset < recvLen; i++) {
+      uint32_t copyLen = dataPackets[i].length;
+      if (copyLen > recvLen - offset) copyLen = recvLen - offset;
+      memcpy(dataPackets[i].data, &buf[offset], copyLen);
+      offset += copyLen;
+    }
+    *len = recvLen;
+  }
+  if (buf.size() > MAX_KEPT_GATHER_SIZE) std::vector<uint8_t>().swap(buf);
+  return ret;
 }
 
-void MopPipeline::removeDataListener(
-    void (*cb)(uint8_t *data, uint32_t *len, void *userData)) {
+MopErrCode MopPipeline::sendData(DataPackType dataPacket, SendCBType cb,
+                                 void *userData) {
+  if (!this->channelHandle) return MOP_UNKNOWN_ERR;
+  if (!dataPacket.data && dataPacket.length) return MOP_PARM;
 
+  AsyncState::SendOp op = {this->channelHandle, dataPacket, cb, userData};
+  std::unique_lock<std::mutex> lock(asyncState->mutex);
+  asyncState->sendQueue.push_back(op);
+  if (asyncState->isSending) return MOP_PASSED;
+
+  asyncState->isSending = true;
+  lock.unlock();
+  AsyncStatePtr *state = new AsyncStatePtr(asyncState);
+  if (!MopEventLoop::instance().runBlocking(sendTask, state, "mopSend")) {
+    delete state;
+    lock.lock();
+    asyncState->sendQueue.pop_back();
+    asyncState->isSending = !asyncState->sendQueue.empty();
+    return MOP_NOMEM;
+  }
+  return MOP_PASSED;
 }
 
-#endif
+void MopPipeline::sendTask(void *arg) {
+  AsyncStatePtr state = *(AsyncStatePtr *) arg;
+  delete (AsyncStatePtr *) arg;
+
+  /*! Drain the queue, new sends are added to it while this one writes */
+  for (uint32_t sendNum = 0;; sendNum++) {
+    AsyncState::SendOp op;
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      if (state->sendQueue.empty()) {
+        state->isSending = false;
+        break;
+      }
+      /*! Queued again behind the other pipelines, a busy pipeline does not
+       *  keep the shared worker */
+      if (sendNum >= MAX_SEND_BURST_NUM) {
+        AsyncStatePtr *next = new AsyncStatePtr(state);
+        if (MopEventLoop::instance().runBlocking(sendTask, next, "mopSend")) break;
+        delete next;
+      }
+      op = state->sendQueue.front();
+      state->sendQueue.pop_front();
+    }
+
+    int32_t ret = mop_write_channel(op.channelHandle, op.dataPacket.data,
+                                    op.dataPacket.length);
+    if (!op.cb) continue;
+    AsyncState::SendDone *done = new AsyncState::SendDone;
+    done->cb = op.cb;
+    done->userData = op.userData;
+    done->errCode = (ret < 0) ? getMopErrCode(ret) : MOP_PASSED;
+    done->len = (ret < 0) ? 0 : ret;
+    if (!MopEventLoop::instance().post(sendDoneEvent, done)) delete done;
+  }
+}
+
+void MopPipeline::sendDoneEvent(void *arg) {
+  AsyncState::SendDone *done = (AsyncState::SendDone *) arg;
+  done->cb(done->errCode, done->len, done->userData);
+  delete done;
+}
+
+MopErrCode MopPipeline::startRecvData(uint32_t bufSize, RecvCBType cb,
+                                      void *userData) {
+  if (!this->channelHandle) return MOP_UNKNOWN_ERR;
+  if (!bufSize) return MOP_PARM;
+
+  AsyncState::RecvCtx *ctx = new AsyncState::RecvCtx;
+  ctx->state = asyncState;
+  ctx->channelHandle = this->channelHandle;
+  ctx->bufSize = bufSize;
+  {
+    std::lock_guard<std::mutex> lock(asyncState->mutex);
+    if (asyncState->isRecving || asyncState->isReaderRunning) {
+      delete ctx;
+      return MOP_RESBUSY;
+    }
+    asyncState->isRecving = true;
+    asyncState->isReaderRunning = true;
+    asyncState->recvGen++;
+    asyncState->recvCB = cb;
+    asyncState->recvUserData = userData;
+    asyncState->recvQueue.clear();
+    asyncState->recvOffset = 0;
+    asyncState->readySize = 0;
+    asyncState->recvErr = MOP_PASSED;
+    ctx->gen = asyncState->recvGen;
+  }
+
+  if (!MopEventLoop::instance().runWaiter(recvTask, ctx, "mopRecv")) {
+    delete ctx;
+    stopRecvData();
+    std::lock_guard<std::mutex> lock(asyncState->mutex);
+    asyncState->isReaderRunning = false;
+    return MOP_NOMEM;
+  }
+  return MOP_PASSED;
+}
+
+void MopPipeline::stopRecvData() {
+  std::lock_guard<std::mutex> lock(asyncState->mutex);
+  if (!asyncState->isRecving) return;
+  asyncState->isRecving = false;
+  asyncState->recvGen++;
+  asyncState->recvCB = NULL;
+}
+
+void MopPipeline::recvTask(void *arg) {
+  AsyncState::RecvCtx *ctx = (AsyncState::RecvCtx *) arg;
+  AsyncStatePtr state = ctx->state;
+
+  while (true) {
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      if (!state->isRecving || state->recvGen != ctx->gen) {
+        state->isReaderRunning = false;
+        break;
+      }
+    }
+
+    AsyncState::RecvDone *done = new AsyncState::RecvDone;
+    done->state = state;
+    done->gen = ctx->gen;
+    done->data.resize(ctx->bufSize);
+    int32_t ret = mop_read_channel(ctx->channelHandle, &done->data[0],
+                                   ctx->bufSize);
+    if (ret < 0) {
+      done->errCode = getMopErrCode(ret);
+      done->data.clear();
+      /*! Cleared before the error is passed on, so its callback can start
+       *  receiving again */
+      std::lock_guard<std::mutex> lock(state->mutex);
+      state->isReaderRunning = false;
+    } else {
+      done->errCode = MOP_PASSED;
+      done->data.resize(ret);
+    }
+    if ((ret == 0) || !MopEventLoop::instance().post(recvDoneEvent, done)) {
+      delete done;
+    }
+    if (ret < 0) break;
+  }
+  delete ctx;
+}
+
+void MopPipeline::recvDoneEvent(void *arg) {
+  AsyncState::RecvDone *done = (AsyncState::RecvDone *) arg;
+  AsyncState *state = done->state.get();
+  RecvCBType cb = NULL;
+  void *userData = NULL;
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (!state->isRecving || state->recvGen != done->gen) {
+      delete done;
+      return;
+    }
+    /*! The read task has exited, a new receiving can be started */
+    if (done->errCode != MOP_PASSED) state->isRecving = false;
+
+    cb = state->recvCB;
+    userData = state->recvUserData;
+    if (!cb) {
+      if (done->errCode != MOP_PASSED) {
+        state->recvErr = done->errCode;
+      } else {
+        if (state->recvQueue.size() >= MAX_RECV_QUEUE_NUM) {
+          DERROR("MOP receive queue full, drop %d bytes",
+                 (int) (state->recvQueue.front().size() - state->recvOffset));
+          state->readySize -= state->recvQueue.front().size() - state->recvOffset;
+          state->recvQueue.pop_front();
+          state->recvOffset = 0;
+        }
+        state->readySize += done->data.size();
+        state->recvQueue.push_back(std::vector<uint8_t>());
+        state->recvQueue.back().swap(done->data);
+      }
+    }
+  }
+
+  if (cb) {
+    cb(done->errCode, done->data.empty() ? NULL : &done->data[0],
+       done->data.size(), userData);
+  }
+  delete done;
+}
+
+MopErrCode MopPipeline::tryRecvData(DataPackType dataPacket, uint32_t *len) {
+  if (!len || (!dataPacket.data && dataPacket.length)) return MOP_PARM;
+
+  std::lock_guard<std::mutex> lock(asyncState->mutex);
+  if (!asyncState->readySize) {
+    MopErrCode err = asyncState->recvErr;
+    asyncState->recvErr = MOP_PASSED;
+    return (err != MOP_PASSED) ? err : MOP_NOTREADY;
+  }
+
+  uint32_t copied = 0;
+  while (copied < dataPacket.length && !asyncState->recvQueue.empty()) {
+    std::vector<uint8_t> &front = asyncState->recvQueue.front();
+    uint32_t left = front.size() - asyncState->recvOffset;
+    uint32_t copyLen = dataPacket.length - copied;
+    if (copyLen > left) copyLen = left;
+    memcpy(dataPacket.data + copied, &front[asyncState->recvOffset], copyLen);
+    copied += copyLen;
+    asyncState->recvOffset += copyLen;
+    if (asyncState->recvOffset == front.size()) {
+      asyncState->recvQueue.pop_front();
+      asyncState->recvOffset = 0;
+    }
+  }
+  asyncState->readySize -= copied;
+  *len = copied;
+  return MOP_PASSED;
+}
+
+uint32_t MopPipeline::getRecvReadySize() {
+  std::lock_guard<std::mutex> lock(asyncState->mutex);
+  return asyncState->readySize;
+}
+
+PipelineID MopPipeline::getId() {
+  return this->id;
+}
+
+PipelineType MopPipeline::getType() {
+  return this->type;
+}
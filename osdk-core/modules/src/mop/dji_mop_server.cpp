@@ -27,6 +27,7 @@
  */
 
 #include "dji_mop_server.hpp"
+#include "dji_mop_event_loop.hpp"
 #include "mop.h"
 
 using namespace std;
@@ -37,15 +38,9 @@ MopServer::MopServer() : MopPipelineManagerBase() {
 MopServer::~MopServer() {
 }
 
-MopErrCode MopServer::accept(PipelineID id, PipelineType type, MopPipeline *&p) {
+MopErrCode MopServer::bindChannel(PipelineID id, PipelineType type,
+                                  void *&bind_handle) {
   int32_t ret;
-  mop_channel_handle_t bind_handle;
-
-  /*! 0.Find whether the pipeline object is existed or not */
-  DSTATUS("/*! 0.Find whether the pipeline object is existed or not */");
-  if (pipelineMap.find(id) != pipelineMap.end()) {
-    return MOP_RESOCCUPIED;
-  }
 
   /*! 1.Create handler for binding */
   DSTATUS("/*! 1.Create handler for binding */");
@@ -62,6 +57,21 @@ MopErrCode MopServer::accept(PipelineID id, PipelineType type, MopPipeline *&p)
     DERROR("MOP Pipeline bind failed");
     return getMopErrCode(ret);
   }
+  return MOP_PASSED;
+}
+
+MopErrCode MopServer::accept(PipelineID id, PipelineType type, MopPipeline *&p) {
+  int32_t ret;
+  mop_channel_handle_t bind_handle;
+
+  /*! 0.Find whether the pipeline object is existed or not */
+  DSTATUS("/*! 0.Find whether the pipeline object is existed or not */");
+  if (pipelineMap.find(id) != pipelineMap.end()) {
+    return MOP_RESOCCUPIED;
+  }
+
+  MopErrCode bindRet = bindChannel(id, type, bind_handle);
+  if (bindRet != MOP_PASSED) return bindRet;
 
   /*! 3.Do accepting */
   p = new MopPipeline(id, type);
@@ -84,12 +94,73 @@ MopErrCode MopServer::accept(PipelineID id, PipelineType type, MopPipeline *&p)
   return MOP_PASSED;
 }
 
+void MopServer::accept(PipelineID id, PipelineType type,
+                       void (*cb)(MopErrCode errCode, MopPipeline *p,
+                                  void *userData),
+                       void *userData) {
+  AcceptCtx *ctx = new AcceptCtx;
+  ctx->id = id;
+  ctx->p = NULL;
+  ctx->bindHandle = NULL;
+  ctx->cb = cb;
+  ctx->userData = userData;
+  ctx->ret = MOP_ERR_FAILED;
+  ctx->errCode = MOP_PASSED;
+
+  if (pipelineMap.find(id) != pipelineMap.end()) {
+    DERROR("MOP channel [%d] is occupied", id);
+    ctx->errCode = MOP_RESOCCUPIED;
+  } else if ((ctx->errCode = bindChannel(id, type, ctx->bindHandle)) == MOP_PASSED) {
+    ctx->p = new MopPipeline(id, type);
+    /*! Reserved now, so a second accept of the id fails at once */
+    pipelineMap[id] = ctx->p;
+    DSTATUS("Do accepting for channel [%d] ...", id);
+    if (MopEventLoop::instance().runWaiter(acceptTask, ctx, "mopAccept")) {
+      return;
+    }
+    ctx->errCode = MOP_NOMEM;
+  }
+
+  /*! The result is always reported on the event loop */
+  if (!MopEventLoop::instance().post(acceptDoneEvent, ctx)) {
+    acceptDoneEvent(ctx);
+  }
+}
+
+void MopServer::acceptTask(void *arg) {
+  AcceptCtx *ctx = (AcceptCtx *) arg;
+
+  ctx->ret = mop_accept_channel(ctx->bindHandle, &ctx->p->channelHandle);
+  if (!MopEventLoop::instance().post(acceptDoneEvent, ctx)) {
+    acceptDoneEvent(ctx);
+  }
+}
+
+void MopServer::acceptDoneEvent(void *arg) {
+  AcceptCtx *ctx = (AcceptCtx *) arg;
+  MopErrCode errCode =
+      (ctx->errCode != MOP_PASSED) ? ctx->errCode : getMopErrCode(ctx->ret);
+
+  if (errCode == MOP_PASSED) {
+    DSTATUS("MOP channel [%d] accepted success", ctx->id);
+  } else if (ctx->p) {
+    DERROR("MOP accept failed");
+    pipelineMap.erase(ctx->id);
+    delete ctx->p;
+    ctx->p = NULL;
+  }
+
+  if (ctx->cb) ctx->cb(errCode, ctx->p, ctx->userData);
+  delete ctx;
+}
+
 MopErrCode MopServer::close(PipelineID id) {
   int32_t ret;
   if (pipelineMap.find(id) == pipelineMap.end()) {
     return MOP_PARM;
   }
-  mop_channel_handle_t handler = pipelineMap[id];
+  mop_channel_handle_t handler = pipelineMap[id]->channelHandle;
+  pipelineMap[id]->stopRecvData();
 
   DSTATUS("Trying to close pipeline channel_id : %d", id);
   ret = mop_close_channel(handler);
@@ -0,0 +1,97 @@
+/** @file dji_fc_time_sync.hpp
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ *  @brief
+ *  Mapping between the flight controller clock and the local monotonic clock
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef OSDK_DJI_FC_TIME_SYNC_H_
+#define OSDK_DJI_FC_TIME_SYNC_H_
+
+#include "dji_platform.hpp"
+
+namespace DJI
+{
+namespace OSDK
+{
+
+/*! @brief Maps FC timestamps to the local monotonic clock (DJI_GET_TIME_NS)
+ *
+ *  @details Every FC timestamp is paired with the local time it was received
+ *  at. The difference is the clock offset plus the link delay, so the
+ *  smallest difference over the last WINDOW_SIZE samples is taken as the
+ *  offset. The window lets the estimate follow the drift between the clocks.
+ *  The minimal link delay ends up in the offset, latencies are measured
+ *  on top of it.
+ */
+class FCTimeSync
+{
+public:
+  static const int WINDOW_SIZE = 64;
+
+  FCTimeSync();
+  ~FCTimeSync();
+
+  /*! @brief Feed an FC timestamp and the local time it was received at.
+   *  A timestamp going backwards means the FC restarted, the estimate is
+   *  started over.
+   */
+  void update(uint64_t fcNs, uint64_t localNs);
+
+  //! Feed an FC timestamp received just now
+  void update(uint64_t fcNs);
+
+  void reset();
+
+  bool isSynced();
+
+  bool fcToLocal(uint64_t fcNs, uint64_t *localNs);
+
+  bool localToFc(uint64_t localNs, uint64_t *fcNs);
+
+  /*! @brief Age of an FC timestamp on the local clock, i.e. how long ago
+   *  the FC stamped it, minus the minimal link delay.
+   */
+  bool getLatencyNs(uint64_t fcNs, int64_t *latencyNs);
+
+  //! FC time in ns from the time_ms and time_ns of Telemetry::TimeStamp
+  static uint64_t fromTimeStamp(uint32_t timeMs, uint32_t timeNs);
+
+private:
+  FCTimeSync(const FCTimeSync&);
+  FCTimeSync& operator=(const FCTimeSync&);
+
+  Mutex    mutex;
+  int64_t  offsets[WINDOW_SIZE];
+  int      sampleNum;
+  int      next;
+  int64_t  offset;
+  uint64_t lastFcNs;
+};
+
+} // namespace OSDK
+} // namespace DJI
+
+#endif // OSDK_DJI_FC_TIME_SYNC_H_
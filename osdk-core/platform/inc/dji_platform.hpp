@@ -31,6 +31,7 @@
 #define OSDK_DJI_PLATFORM_H_
 
 #include "osdk_platform.h"
+#include "dji_task_attr.h"
 #include "dji_singleton.hpp"
 #include "osdk_logger.h"
 
@@ -56,6 +57,14 @@
   DJI::OSDK::Platform::instance()                                   \
   .taskCreate(taskPtr, taskFunc, stackSize, arg)
 
+#define DJI_REG_TASK_ATTR_HANDLER(setAttrFunc)                      \
+  DJI::OSDK::Platform::instance()                                   \
+  .registerTaskAttrHandler(setAttrFunc)
+
+#define DJI_SET_TASK_POLICY(taskClass, cpuMask, priority)           \
+  DJI::OSDK::Platform::instance()                                   \
+  .setTaskPolicy(taskClass, cpuMask, priority)
+
 #define DJI_TASK_DESTROY(task)                                      \
   DJI::OSDK::Platform::instance()                                   \
   .taskDestroy(task)
@@ -112,11 +121,23 @@
   DJI::OSDK::Platform::instance()                                   \
   .getTimeMs(msPtr)
 
-#ifdef OS_DEBUG
+#define DJI_REG_TIME_NS_HANDLER(getTimeNsFunc)                      \
+  DJI::OSDK::Platform::instance()                                   \
+  .registerTimeNsHandler(getTimeNsFunc)
+
 #define DJI_GET_TIME_US(usPtr)                                      \
   DJI::OSDK::Platform::instance()                                   \
   .getTimeUs(usPtr)
-#endif
+
+#define DJI_GET_TIME_NS(nsPtr)                                      \
+  DJI::OSDK::Platform::instance()                                   \
+  .getTimeNs(nsPtr)
+
+/*! Reads a monotonic clock in nanoseconds, which must not jump with wall
+ *  time corrections (NTP, GPS). It should be the clock behind GetTimeMs, so
+ *  that both time bases agree. Users need to adapt according to their own
+ *  platform and system, e.g. CLOCK_MONOTONIC on Linux. */
+typedef E_OsdkStat (*OsdkGetTimeNsFunc)(uint64_t *ns);
 
 namespace DJI
 {
@@ -147,6 +168,38 @@ public:
 
   bool taskCreate(T_OsdkTaskHandle *task, void *(*taskFunc)(void *), uint32_t stackSize, void *arg);
 
+  /*! @brief Create a task and apply the attributes of its class
+   *
+   *  @param taskClass class of the task, looked up in the task policy table
+   *  @param name task name, truncated to OSDK_TASK_NAME_MAX_LEN - 1 chars
+   *  @return false only if the task could not be created, a failure to
+   *  apply the attributes is logged and the task keeps running
+   */
+  bool taskCreate(T_OsdkTaskHandle *task, void *(*taskFunc)(void *), uint32_t stackSize, void *arg,
+                  E_OsdkTaskClass taskClass, const char *name);
+
+  /*! @brief Register the platform function applying task attributes. Without
+   *  it the task policy table has no effect.
+   */
+  bool registerTaskAttrHandler(OsdkTaskSetAttrFunc setAttrFunc);
+
+  /*! @brief Set the cpu affinity and priority of one task class. Call it
+   *  before the vehicle is initialized, tasks that already run keep their
+   *  attributes.
+   *
+   *  @param cpuMask bit n allows cpu n, 0 means not pinned
+   *  @param priority real-time priority, 0 keeps the default policy
+   */
+  bool setTaskPolicy(E_OsdkTaskClass taskClass, uint32_t cpuMask, int32_t priority);
+
+  bool getTaskPolicy(E_OsdkTaskClass taskClass, T_OsdkTaskAttr *attr);
+
+  /*! @brief Apply the attributes of a class to a task created elsewhere. On
+   *  Linux the handle is a pointer to the pthread_t, as created by the
+   *  sample TaskCreate, so it also works for threads from pthread_create.
+   */
+  bool applyTaskPolicy(T_OsdkTaskHandle task, E_OsdkTaskClass taskClass, const char *name);
+
   bool taskDestroy(T_OsdkTaskHandle task);
 
   bool taskSleepMs(uint32_t timeMs);
@@ -171,9 +224,14 @@ public:
 
   bool getTimeMs(uint32_t *ms);
 
-#ifdef OS_DEBUG
+  /*! @brief Register the monotonic nanosecond clock. Without it getTimeNs
+   *  and getTimeUs fall back to the millisecond time of the OSAL handler.
+   */
+  bool registerTimeNsHandler(OsdkGetTimeNsFunc getTimeNsFunc);
+
+  bool getTimeNs(uint64_t *ns);
+
   bool getTimeUs(uint64_t *us);
-#endif
 
   void* malloc(uint32_t size);
 
@@ -184,6 +242,11 @@ private:
   bool halUartRegFlag;
   bool loggerConsoleRegFlag;
 
+  OsdkTaskSetAttrFunc taskSetAttrFunc;
+  T_OsdkTaskAttr      taskPolicy[OSDK_TASK_CLASS_NUM];
+
+  OsdkGetTimeNsFunc   getTimeNsFunc;
+
 };
 }
 }
@@ -0,0 +1,81 @@
+/** @file dji_task_attr.h
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ *  @brief
+ *  Task attributes (name, cpu affinity, priority) of the OSDK worker tasks
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef OSDK_DJI_TASK_ATTR_H_
+#define OSDK_DJI_TASK_ATTR_H_
+
+#include "osdk_platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! Maximum task name length including the terminator, same as Linux */
+#define OSDK_TASK_NAME_MAX_LEN 16
+
+/*! The class of an OSDK worker task. The attributes of each class come from
+ *  the task policy table, see DJI::OSDK::Platform::setTaskPolicy. */
+typedef enum {
+  /*! Tasks without a dedicated class */
+  OSDK_TASK_CLASS_DEFAULT = 0,
+  /*! Control path: heartbeat to FC, legacy link keep-alive */
+  OSDK_TASK_CLASS_CONTROL,
+  /*! Readers of the UART and USB bulk links */
+  OSDK_TASK_CLASS_LINK_READ,
+  /*! Camera stream readers and liveview keep-alive */
+  OSDK_TASK_CLASS_VIDEO_READ,
+  /*! H264 decoder callbacks and decoded image subscribers */
+  OSDK_TASK_CLASS_VIDEO_DECODE,
+  /*! Stereo image post processing */
+  OSDK_TASK_CLASS_PERCEPTION,
+  /*! Media file list and file data downloads */
+  OSDK_TASK_CLASS_FILE_TRANSFER,
+  OSDK_TASK_CLASS_NUM,
+} E_OsdkTaskClass;
+
+typedef struct {
+  /*! Task name shown by the system tools, may be NULL */
+  const char *name;
+  /*! Bit n allows the task to run on cpu n, 0 means not pinned */
+  uint32_t cpuMask;
+  /*! Real-time (SCHED_FIFO on Linux) priority, 0 keeps the default policy */
+  int32_t priority;
+} T_OsdkTaskAttr;
+
+/*! Applies the attributes to a task created by the registered TaskCreate.
+ *  Users need to adapt according to their own platform and system. Fields
+ *  the platform does not support should be ignored rather than failing. */
+typedef E_OsdkStat (*OsdkTaskSetAttrFunc)(T_OsdkTaskHandle task,
+                                          const T_OsdkTaskAttr *attr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // OSDK_DJI_TASK_ATTR_H_
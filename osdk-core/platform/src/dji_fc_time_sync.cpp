@@ -0,0 +1,145 @@
+/** @file dji_fc_time_sync.cpp
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ *  @brief
+ *  Mapping between the flight controller clock and the local monotonic clock
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "dji_fc_time_sync.hpp"
+
+using namespace DJI;
+using namespace DJI::OSDK;
+
+FCTimeSync::FCTimeSync()
+{
+  reset();
+}
+
+FCTimeSync::~FCTimeSync()
+{}
+
+void
+FCTimeSync::reset()
+{
+  mutex.lock();
+  sampleNum = 0;
+  next = 0;
+  offset = 0;
+  lastFcNs = 0;
+  mutex.unlock();
+}
+
+void
+FCTimeSync::update(uint64_t fcNs, uint64_t localNs)
+{
+  mutex.lock();
+  if (fcNs < lastFcNs) {
+    sampleNum = 0;
+    next = 0;
+  }
+  lastFcNs = fcNs;
+
+  offsets[next] = (int64_t)(localNs - fcNs);
+  next = (next + 1) % WINDOW_SIZE;
+  if (sampleNum < WINDOW_SIZE) {
+    sampleNum++;
+  }
+
+  offset = offsets[0];
+  for (int i = 1; i < sampleNum; i++) {
+    if (offsets[i] < offset) {
+      offset = offsets[i];
+    }
+  }
+  mutex.unlock();
+}
+
+void
+FCTimeSync::update(uint64_t fcNs)
+{
+  uint64_t localNs = 0;
+
+  if (Platform::instance().getTimeNs(&localNs)) {
+    update(fcNs, localNs);
+  }
+}
+
+bool
+FCTimeSync::isSynced()
+{
+  mutex.lock();
+  bool synced = (sampleNum > 0);
+  mutex.unlock();
+  return synced;
+}
+
+bool
+FCTimeSync::fcToLocal(uint64_t fcNs, uint64_t *localNs)
+{
+  if (localNs == NULL) {
+    return false;
+  }
+
+  mutex.lock();
+  bool synced = (sampleNum > 0);
+  *localNs = fcNs + offset;
+  mutex.unlock();
+  return synced;
+}
+
+bool
+FCTimeSync::localToFc(uint64_t localNs, uint64_t *fcNs)
+{
+  if (fcNs == NULL) {
+    return false;
+  }
+
+  mutex.lock();
+  bool synced = (sampleNum > 0);
+  *fcNs = localNs - offset;
+  mutex.unlock();
+  return synced;
+}
+
+bool
+FCTimeSync::getLatencyNs(uint64_t fcNs, int64_t *latencyNs)
+{
+  uint64_t nowNs = 0;
+  uint64_t stampNs = 0;
+
+  if (latencyNs == NULL || !Platform::instance().getTimeNs(&nowNs) ||
+      !fcToLocal(fcNs, &stampNs)) {
+    return false;
+  }
+  *latencyNs = (int64_t)(nowNs - stampNs);
+  return true;
+}
+
+uint64_t
+FCTimeSync::fromTimeStamp(uint32_t timeMs, uint32_t timeNs)
+{
+  /*! time_ns carries the sub-millisecond part of the same instant */
+  return (uint64_t)timeMs * 1000000 + timeNs % 1000000;
+}
@@ -28,6 +28,7 @@
  */
 
 #include "dji_platform.hpp"
+#include "dji_log.hpp"
 #include <new>
 
 using namespace DJI;
@@ -38,6 +39,16 @@ Platform::Platform()
   osalRegFlag = false;
   halUartRegFlag = false;
   loggerConsoleRegFlag = false;
+
+  /*! Nothing is pinned or prioritized until the user sets a policy */
+  taskSetAttrFunc = NULL;
+  for (int i = 0; i < OSDK_TASK_CLASS_NUM; i++) {
+    taskPolicy[i].name = NULL;
+    taskPolicy[i].cpuMask = 0;
+    taskPolicy[i].priority = 0;
+  }
+
+  getTimeNsFunc = NULL;
 }
 
 Platform::~Platform()
@@ -129,6 +140,68 @@ Platform::taskCreate(T_OsdkTaskHandle *task, void *(*taskFunc)(void *), uint32_t
   return (errCode == OSDK_STAT_OK)? true : false;
 }
 
+bool
+Platform::taskCreate(T_OsdkTaskHandle *task, void *(*taskFunc)(void *), uint32_t stackSize, void *arg,
+                     E_OsdkTaskClass taskClass, const char *name)
+{
+  if (!taskCreate(task, taskFunc, stackSize, arg)) {
+    return false;
+  }
+
+  if (!applyTaskPolicy(*task, taskClass, name)) {
+    DERROR("Failed to apply the attributes of task class %d to %s",
+           taskClass, name ? name : "task");
+  }
+  return true;
+}
+
+bool
+Platform::registerTaskAttrHandler(OsdkTaskSetAttrFunc setAttrFunc)
+{
+  taskSetAttrFunc = setAttrFunc;
+  return (setAttrFunc != NULL);
+}
+
+bool
+Platform::setTaskPolicy(E_OsdkTaskClass taskClass, uint32_t cpuMask, int32_t priority)
+{
+  if (taskClass < 0 || taskClass >= OSDK_TASK_CLASS_NUM || priority < 0) {
+    return false;
+  }
+
+  taskPolicy[taskClass].cpuMask = cpuMask;
+  taskPolicy[taskClass].priority = priority;
+  return true;
+}
+
+bool
+Platform::getTaskPolicy(E_OsdkTaskClass taskClass, T_OsdkTaskAttr *attr)
+{
+  if (taskClass < 0 || taskClass >= OSDK_TASK_CLASS_NUM || attr == NULL) {
+    return false;
+  }
+
+  *attr = taskPolicy[taskClass];
+  return true;
+}
+
+bool
+Platform::applyTaskPolicy(T_OsdkTaskHandle task, E_OsdkTaskClass taskClass, const char *name)
+{
+  T_OsdkTaskAttr attr;
+
+  if (!getTaskPolicy(taskClass, &attr) || task == NULL) {
+    return false;
+  }
+  /*! Attributes are optional, without a handler the task keeps the defaults */
+  if (taskSetAttrFunc == NULL) {
+    return true;
+  }
+
+  attr.name = name;
+  return (taskSetAttrFunc(task, &attr) == OSDK_STAT_OK);
+}
+
 bool
 Platform::taskDestroy(T_OsdkTaskHandle task)
 {
@@ -266,16 +339,43 @@ Platform::getTimeMs(uint32_t *ms)
   return (errCode == OSDK_STAT_OK)? true : false;
 }
 
-#ifdef OS_DEBUG
 bool
-Platform::getTimeUs(uint64_t *us)
+Platform::registerTimeNsHandler(OsdkGetTimeNsFunc getTimeNsFunc)
+{
+  this->getTimeNsFunc = getTimeNsFunc;
+  return (getTimeNsFunc != NULL);
+}
+
+bool
+Platform::getTimeNs(uint64_t *ns)
 {
   E_OsdkStat errCode;
-  errCode = OsdkOsal_GetTimeUs(us);
+
+  if (ns == NULL) {
+    return false;
+  }
+  if (getTimeNsFunc != NULL) {
+    errCode = getTimeNsFunc(ns);
+  } else {
+    uint32_t ms = 0;
+    errCode = OsdkOsal_GetTimeMs(&ms);
+    *ns = (uint64_t)ms * 1000000;
+  }
 
   return (errCode == OSDK_STAT_OK)? true : false;
 }
-#endif
+
+bool
+Platform::getTimeUs(uint64_t *us)
+{
+  uint64_t ns = 0;
+
+  if (us == NULL || !getTimeNs(&ns)) {
+    return false;
+  }
+  *us = ns / 1000;
+  return true;
+}
 
 void*
 Platform::malloc(uint32_t size)
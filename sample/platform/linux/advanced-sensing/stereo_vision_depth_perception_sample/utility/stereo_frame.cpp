@@ -68,6 +68,10 @@ StereoFrame::initStereoParam()
   fy_ = param_proj_left_.at<double>(1, 1);
   baseline_x_fx_ = -param_proj_right_.at<double>(0, 3);
 
+  unprojector_ = std::make_shared<DJI::OSDK::DisparityUnprojector>(
+    VGA_WIDTH, VGA_HEIGHT, fx_, fy_, principal_x_, principal_y_,
+    baseline_x_fx_, num_disp_);
+
   initUndistortRectifyMap(camera_left_ptr_->getIntrinsic(),
                               camera_left_ptr_->getDistortion(),
                               param_rect_left_,
@@ -202,29 +206,22 @@ StereoFrame::unprojectPtCloud()
   const int trunc_img_width_end = VGA_WIDTH - border_size;
   const int trunc_img_height_end = VGA_HEIGHT - border_size;
 
-  mat_vec3_pt_ = Mat_<Vec3f>(VGA_HEIGHT, VGA_WIDTH, Vec3f(0, 0, 0));
-
-  for(int v = border_size; v < trunc_img_height_end; ++v)
-  {
-    for(int u = border_size; u < trunc_img_width_end; ++u)
-    {
-      Vec3f &point = mat_vec3_pt_.at<Vec3f>(v, u);
-
 #ifdef USE_OPEN_CV_CONTRIB
-      float disparity = (float)(filtered_disparity_map_.at<short int>(v, u)*0.0625);
+  const Mat &disparity_map = filtered_disparity_map_;
 #else
-      float disparity = (float)(raw_disparity_map_.at<short int>(v, u)*0.0625);
+  const Mat &disparity_map = raw_disparity_map_;
 #endif
 
-      // do not consider pts that are farther than 8.6m, i.e. disparity < 6
-      if(disparity >= 6)
-      {
-        point[2] = baseline_x_fx_/disparity;
-        point[0] = (u-principal_x_)*point[2]/fx_;
-        point[1] = (v-principal_y_)*point[2]/fy_;
-      }
-      color_buffer_[v*VGA_WIDTH+u] = rectified_img_left_.at<uint8_t>(v, u);
-    }
+  // do not consider pts that are farther than 8.6m, i.e. disparity < 6,
+  // they are left as (0, 0, 0) like the border
+  unprojector_->unproject(disparity_map.ptr<int16_t>(), disparity_map.step1(),
+                          mat_vec3_pt_.ptr<float>(), border_size);
+
+  for(int v = border_size; v < trunc_img_height_end; ++v)
+  {
+    memcpy(&color_buffer_[v*VGA_WIDTH+border_size],
+           rectified_img_left_.ptr<uint8_t>(v) + border_size,
+           trunc_img_width_end - border_size);
   }
 
   color_mat_ = cv::Mat(VGA_HEIGHT, VGA_WIDTH, CV_8UC1, &color_buffer_[0]).clone();
@@ -8,6 +8,7 @@
 #include "dji_ack.hpp"
 #include "dji_log.hpp"
 #include "point_cloud_viewer.hpp"
+#include "dji_disparity_unprojector.hpp"
 
 #ifdef USE_GPU
   #include <opencv2/cudastereo.hpp>
@@ -97,6 +98,7 @@ protected:
   cv::Mat               color_mat_;
   cv::Mat_<cv::Vec3f>   mat_vec3_pt_;
   cv::viz::WCloud       pt_cloud_;
+  std::shared_ptr<DJI::OSDK::DisparityUnprojector> unprojector_;
 
 #ifdef USE_GPU
   cv::cuda::GpuMat  cuda_rectified_mapping_[2][2];
@@ -0,0 +1,132 @@
+/*! @file benchmark/disparity_unproject_benchmark.cpp
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ *  @brief
+ *  Benchmark of DisparityUnprojector against the per-pixel loop of the
+ *  depth perception sample, at VGA and 240p.
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+#include "dji_disparity_unprojector.hpp"
+
+using namespace DJI::OSDK;
+
+typedef std::chrono::steady_clock BenchClock;
+
+/*! The loop StereoFrame::unprojectPtCloud used, on plain arrays */
+static void unprojectReference(const int16_t *disparity, int width, int height,
+                               float fx, float fy, float cx, float cy,
+                               float baselineFx, int border, float *xyz)
+{
+  for (int i = 0; i < width * height * 3; i++) {
+    xyz[i] = 0;
+  }
+  for (int v = border; v < height - border; ++v) {
+    for (int u = border; u < width - border; ++u) {
+      float *point = xyz + (v * width + u) * 3;
+      float d = (float)(disparity[v * width + u] * 0.0625);
+      if (d >= 6) {
+        point[2] = baselineFx / d;
+        point[0] = (u - cx) * point[2] / fx;
+        point[1] = (v - cy) * point[2] / fy;
+      }
+    }
+  }
+}
+
+static double elapsedUs(BenchClock::time_point start)
+{
+  return std::chrono::duration<double, std::micro>(BenchClock::now() - start)
+      .count();
+}
+
+static void runResolution(const char *name, int width, int height, int rounds)
+{
+  const int numDisparities = 64;
+  const int border = width >= 640 ? numDisparities : numDisparities / 2;
+  const float fx = width * 0.7f, fy = width * 0.7f;
+  const float cx = width / 2.0f, cy = height / 2.0f;
+  const float baselineFx = 0.12f * fx;
+
+  /*! the output range of StereoBM, -16 marks the invalid pixels */
+  std::vector<int16_t> disparity(width * height);
+  srand(1);
+  for (size_t i = 0; i < disparity.size(); i++) {
+    disparity[i] = (int16_t)(rand() % (numDisparities * 16 + 16) - 16);
+  }
+
+  std::vector<float> reference(width * height * 3);
+  std::vector<float> xyz(width * height * 3);
+  DisparityUnprojector unprojector(width, height, fx, fy, cx, cy, baselineFx,
+                                   numDisparities);
+
+  BenchClock::time_point start = BenchClock::now();
+  for (int i = 0; i < rounds; i++) {
+    unprojectReference(&disparity[0], width, height, fx, fy, cx, cy,
+                       baselineFx, border, &reference[0]);
+  }
+  double referenceUs = elapsedUs(start) / rounds;
+  printf("%-4s %dx%d per-pixel loop        : %8.1f us/frame\n", name, width,
+         height, referenceUs);
+
+  const int threadNums[] = {1, 2, 4};
+  for (size_t t = 0; t < sizeof(threadNums) / sizeof(threadNums[0]); t++) {
+    start = BenchClock::now();
+    for (int i = 0; i < rounds; i++) {
+      unprojector.unproject(&disparity[0], width, &xyz[0], border,
+                            threadNums[t]);
+    }
+    double us = elapsedUs(start) / rounds;
+
+    double maxError = 0;
+    for (size_t i = 0; i < xyz.size(); i++) {
+      double error = fabs(xyz[i] - reference[i]);
+      if (reference[i] != 0) {
+        error /= fabs(reference[i]);
+      }
+      maxError = error > maxError ? error : maxError;
+    }
+    printf("%-4s %dx%d unprojector %d thread(s): %8.1f us/frame, x%.2f, "
+           "max relative error %.1e\n",
+           name, width, height, threadNums[t], us, referenceUs / us, maxError);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  int rounds = (argc > 1) ? atoi(argv[1]) : 200;
+  if (rounds <= 0) {
+    printf("Usage: %s [rounds]\n", argv[0]);
+    return -1;
+  }
+
+  runResolution("VGA", 640, 480, rounds);
+  runResolution("240p", 320, 240, rounds);
+  return 0;
+}
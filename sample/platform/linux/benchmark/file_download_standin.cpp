@@ -0,0 +1,339 @@
+/*! @file benchmark/file_download_standin.cpp
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ *  @brief
+ *  Loopback stand-in of the camera file server for FileMgrImpl. The packs
+ *  of a generated file are pushed straight to HandlePushPack, some are
+ *  dropped and sent again later, then the link is cut so the download times
+ *  out and keeps its journal, and a second request resumes from it. The
+ *  pack handling latency is measured while the journal is saved.
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "dji_file_mgr_impl.hpp"
+#include "dji_linker.hpp"
+#include "dji_platform.hpp"
+#include "download_journal.hpp"
+#include "osdkosal_linux.h"
+
+using namespace DJI::OSDK;
+
+typedef std::chrono::steady_clock BenchClock;
+
+//! Smaller than the 12 bit msg_length with the headers
+static const uint32_t PACK_SIZE  = 1000;
+static const int      FILE_INDEX = 7;
+
+static const uint32_t ACK_HEAD_SIZE = sizeof(dji_general_transfer_msg_ack) - 1;
+static const uint32_t RESP_HEAD_SIZE =
+  sizeof(dji_file_data_download_resp) - 1;
+
+static uint8_t
+fileByte(uint64_t offset)
+{
+  return (uint8_t)((offset * 2654435761u) >> 24);
+}
+
+struct DownloadResult
+{
+  std::atomic<bool> done;
+  E_OsdkStat        ret;
+};
+
+static void
+downloadCB(E_OsdkStat ret, void* userData)
+{
+  DownloadResult* result = (DownloadResult*)userData;
+  result->ret            = ret;
+  result->done           = true;
+}
+
+//! One file server session, the packs are numbered from the requested offset
+class StandinServer
+{
+public:
+  StandinServer(FileMgrImpl* impl, uint64_t fileSize, uint64_t offset)
+    : impl(impl)
+    , fileSize(fileSize)
+    , offset(offset)
+  {
+    packNum = (uint32_t)((fileSize - offset + PACK_SIZE - 1) / PACK_SIZE);
+  }
+
+  uint32_t getPackNum() const
+  {
+    return packNum;
+  }
+
+  void push(uint32_t seq)
+  {
+    uint8_t buf[4096];
+    dji_general_transfer_msg_ack* pack = (dji_general_transfer_msg_ack*)buf;
+    memset(pack, 0, ACK_HEAD_SIZE);
+    pack->version       = 1;
+    pack->header_length = 10;
+    pack->task_id       = DJI_GENERAL_DOWNLOAD_FILE_TASK_TYPE_FILE;
+    pack->func_id       = DJI_GENERAL_DOWNLOAD_FILE_FUNC_TYPE_DATA;
+    pack->seq           = seq;
+
+    uint64_t start = offset + (uint64_t)seq * PACK_SIZE;
+    uint32_t len   = (uint32_t)std::min<uint64_t>(PACK_SIZE, fileSize - start);
+    pack->msg_flag = (seq + 1 == packNum) ? 0x01 : 0;
+    uint8_t* data  = pack->data;
+    uint32_t head  = ACK_HEAD_SIZE;
+    if (seq == 0)
+    {
+      //! The first pack tells the size left from the requested offset
+      dji_file_data_download_resp* resp = (dji_file_data_download_resp*)data;
+      memset(resp, 0, RESP_HEAD_SIZE);
+      resp->size = (uint32_t)(fileSize - offset) + RESP_HEAD_SIZE;
+      data       = resp->file_data;
+      head += RESP_HEAD_SIZE;
+    }
+    for (uint32_t i = 0; i < len; i++)
+    {
+      data[i] = fileByte(start + i);
+    }
+    pack->msg_length = head + len;
+
+    BenchClock::time_point begin = BenchClock::now();
+    impl->HandlePushPack(pack);
+    latencyUs.push_back(
+      std::chrono::duration<double, std::micro>(BenchClock::now() - begin)
+        .count());
+  }
+
+  void printLatency(const char* name)
+  {
+    if (latencyUs.empty())
+    {
+      return;
+    }
+    std::sort(latencyUs.begin(), latencyUs.end());
+    fprintf(stderr,
+            "%-7s %6zu packs  p50 %6.1f us  p99 %7.1f us  max %8.1f us\n",
+            name, latencyUs.size(), latencyUs[latencyUs.size() / 2],
+            latencyUs[latencyUs.size() * 99 / 100], latencyUs.back());
+  }
+
+private:
+  FileMgrImpl*        impl;
+  uint64_t            fileSize;
+  uint64_t            offset;
+  uint32_t            packNum;
+  std::vector<double> latencyUs;
+};
+
+static bool
+waitResult(DownloadResult& result, int timeoutMs)
+{
+  for (int ms = 0; !result.done && ms < timeoutMs; ms += 10)
+  {
+    usleep(10 * 1000);
+  }
+  return result.done;
+}
+
+static bool
+checkFile(const std::string& path, uint64_t fileSize)
+{
+  FILE* fp = fopen(path.c_str(), "rb");
+  if (!fp)
+  {
+    return false;
+  }
+  bool     ok     = true;
+  uint64_t offset = 0;
+  uint8_t  buf[65536];
+  size_t   n;
+  while (ok && (n = fread(buf, 1, sizeof(buf), fp)) > 0)
+  {
+    for (size_t i = 0; i < n; i++)
+    {
+      if (buf[i] != fileByte(offset + i))
+      {
+        fprintf(stderr, "mismatch at byte %llu\n",
+                (unsigned long long)(offset + i));
+        ok = false;
+        break;
+      }
+    }
+    offset += n;
+  }
+  fclose(fp);
+  return ok && offset == fileSize;
+}
+
+int
+main(int argc, char** argv)
+{
+  uint64_t fileSize = (argc > 1 ? atoi(argv[1]) : 16384) * 1024ULL;
+  //! Every n-th pack is lost and sent again after the others
+  int dropEvery = argc > 2 ? atoi(argv[2]) : 50;
+  //! Percent of the packs sent before the link is cut
+  int cutPercent = argc > 3 ? atoi(argv[3]) : 60;
+  //! Pause between two packs, so the journal is saved during the transfer
+  int         paceUs = argc > 4 ? atoi(argv[4]) : 50;
+  std::string path   = argc > 5 ? argv[5] : "./standin_download.bin";
+  if (fileSize == 0 || dropEvery <= 1 || cutPercent <= 0 ||
+      cutPercent >= 100 || paceUs < 0)
+  {
+    printf("usage: %s [file KB] [drop every n-th pack] [cut at percent] "
+           "[pace us] [download path]\n",
+           argv[0]);
+    return 1;
+  }
+
+  static T_OsdkOsalHandler osalHandler = {
+    .TaskCreate         = OsdkLinux_TaskCreate,
+    .TaskDestroy        = OsdkLinux_TaskDestroy,
+    .TaskSleepMs        = OsdkLinux_TaskSleepMs,
+    .MutexCreate        = OsdkLinux_MutexCreate,
+    .MutexDestroy       = OsdkLinux_MutexDestroy,
+    .MutexLock          = OsdkLinux_MutexLock,
+    .MutexUnlock        = OsdkLinux_MutexUnlock,
+    .SemaphoreCreate    = OsdkLinux_SemaphoreCreate,
+    .SemaphoreDestroy   = OsdkLinux_SemaphoreDestroy,
+    .SemaphoreWait      = OsdkLinux_SemaphoreWait,
+    .SemaphoreTimedWait = OsdkLinux_SemaphoreTimedWait,
+    .SemaphorePost      = OsdkLinux_SemaphorePost,
+    .GetTimeMs          = OsdkLinux_GetTimeMs,
+#ifdef OS_DEBUG
+    .GetTimeUs = OsdkLinux_GetTimeUs,
+#endif
+    .Malloc = OsdkLinux_Malloc,
+    .Free   = OsdkLinux_Free,
+  };
+  if (DJI_REG_OSAL_HANDLER(&osalHandler) != true)
+  {
+    fprintf(stderr, "Osal handler register fail\n");
+    return 1;
+  }
+
+  //! No channel is added, the requests and acks of FileMgrImpl go nowhere and
+  //! the stand-in plays the answers itself
+  Linker linker;
+  linker.init();
+  FileMgrImpl impl(&linker, OSDK_COMMAND_DEVICE_TYPE_CAMERA, 0);
+  unlink(path.c_str());
+  DownloadJournal::Remove(path);
+
+  //! 1. Lossy transfer, cut before the end
+  DownloadResult first;
+  first.done = false;
+  impl.startReqFileData(FILE_INDEX, path, downloadCB, &first);
+  StandinServer      server(&impl, fileSize, 0);
+  uint32_t           cutSeq = server.getPackNum() * cutPercent / 100;
+  std::vector<uint32_t> dropped;
+  for (uint32_t seq = 0; seq < cutSeq; seq++)
+  {
+    if (seq != 0 && seq % dropEvery == 0)
+    {
+      dropped.push_back(seq);
+      continue;
+    }
+    server.push(seq);
+    if (paceUs)
+    {
+      usleep(paceUs);
+    }
+  }
+  //! As if acked as missing, only the ones before the last quarter come again
+  uint32_t resendBefore = cutSeq - cutSeq / 4;
+  for (size_t i = 0; i < dropped.size() && dropped[i] < resendBefore; i++)
+  {
+    server.push(dropped[i]);
+  }
+  server.printLatency("first");
+
+  //! 2. Link cut, the monitor task times out and keeps the journal
+  fprintf(stderr, "link cut at pack %u of %u, waiting for the timeout\n",
+          cutSeq, server.getPackNum());
+  if (!waitResult(first, 10000) || first.ret == OSDK_STAT_OK)
+  {
+    fprintf(stderr, "FAIL: the cut download did not time out\n");
+    return 1;
+  }
+  DownloadJournal::Record record;
+  if (!DownloadJournal::Load(path, record) || record.fileIndex != FILE_INDEX ||
+      record.fileSize != fileSize)
+  {
+    fprintf(stderr, "FAIL: no journal after the cut\n");
+    return 1;
+  }
+  uint64_t firstHole = 0;
+  for (size_t i = 0; i < dropped.size(); i++)
+  {
+    if (dropped[i] >= resendBefore)
+    {
+      firstHole = (uint64_t)dropped[i] * PACK_SIZE;
+      break;
+    }
+  }
+  fprintf(stderr, "journal: %llu of %llu bytes, first hole at %llu\n",
+          (unsigned long long)record.recvSize,
+          (unsigned long long)record.fileSize,
+          (unsigned long long)firstHole);
+  if (record.recvSize == 0 || (firstHole && record.recvSize > firstHole))
+  {
+    fprintf(stderr, "FAIL: the journal claims data which is not received\n");
+    return 1;
+  }
+
+  //! 3. Resume, the server sends from the journal offset
+  DownloadResult second;
+  second.done = false;
+  impl.startReqFileData(FILE_INDEX, path, downloadCB, &second);
+  StandinServer resumed(&impl, fileSize, record.recvSize);
+  for (uint32_t seq = 0; seq < resumed.getPackNum(); seq++)
+  {
+    resumed.push(seq);
+  }
+  resumed.printLatency("resumed");
+  if (!waitResult(second, 2000) || second.ret != OSDK_STAT_OK)
+  {
+    fprintf(stderr, "FAIL: the resumed download did not finish\n");
+    return 1;
+  }
+  DownloadJournal::Record left;
+  if (!checkFile(path, fileSize) || DownloadJournal::Load(path, left))
+  {
+    fprintf(stderr, "FAIL: the downloaded file is wrong\n");
+    return 1;
+  }
+  fprintf(stderr, "OK: resumed %.1f%% of the file, content verified\n",
+          100.0 * (fileSize - record.recvSize) / fileSize);
+  unlink(path.c_str());
+  return 0;
+}
@@ -0,0 +1,266 @@
+/*! @file benchmark/hms_replay_harness.cpp
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ *  @brief
+ *  Replays recorded HMS pushes through HMSStateTracker::update() and checks
+ *  the fault events against the ones expected in the recording. Without a
+ *  recording file a built-in one covers raise, change, clear, level 0, a
+ *  lost last pack, several senders, a malformed pack and reset.
+ *
+ *  One push per line: <time ms> <sender> <component index> <payload hex>,
+ *  or <time ms> reset. Like DJIHMSImpl::resetFaultState(), a reset stamps
+ *  its events with the time of the last push. The expected events may follow a '#', e.g.
+ *  "# +1a020040/0/0:2 -1b000001/1/0:1" for raised and cleared faults,
+ *  '~' for a changed level and '!' for a rejected payload.
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "dji_hms_state_tracker.hpp"
+
+using namespace DJI::OSDK;
+
+typedef std::chrono::steady_clock BenchClock;
+
+//! Payload header: version, cycle, msgEnd | msgIndex << 1. Entries: alarm id
+//! little endian, sensor index, level
+static const char* builtinRecording[] = {
+  "1000 01 0 000001 4000021a0002           # +1a020040/0/0:2",
+  "2000 01 0 000101 4000021a0003           # ~1a020040/0/0:3",
+  "3000 01 0 000200 0100001b0101           # +1b000001/1/0:1",
+  "3100 01 0 000203 4000021a0003           #",
+  "4000 01 0 000301 4000021a0000 0100001b0101 # -1a020040/0/0:3",
+  "5000 01 0 000400 0100001b0101           #",
+  "5500 01 0 000501                        #",
+  "6000 01 0 000601                        # -1b000001/1/0:1",
+  "6100 02 1 000001 0200001c0004           # +1c000002/0/1:4",
+  "6200 01 0 000701                        #",
+  "6300 01 0 0007014000                    # !",
+  "7000 reset                              # -1c000002/0/1:4",
+};
+
+struct ReplayLine
+{
+  int                  lineNo;
+  uint32_t             timeStamp;
+  bool                 isReset;
+  uint8_t              sender;
+  uint8_t              componentIndex;
+  std::vector<uint8_t> payload;
+  bool                 hasExpected;
+  std::string          expected;
+};
+
+static bool
+parseLine(const std::string& text, int lineNo, ReplayLine& line)
+{
+  std::string data = text;
+  size_t      pos  = text.find('#');
+  line.lineNo      = lineNo;
+  line.hasExpected = (pos != std::string::npos);
+  line.expected.clear();
+  if (line.hasExpected)
+  {
+    std::istringstream expected(text.substr(pos + 1));
+    std::string        token;
+    while (expected >> token)
+    {
+      line.expected += (line.expected.empty() ? "" : " ") + token;
+    }
+    data = text.substr(0, pos);
+  }
+
+  std::istringstream fields(data);
+  std::string        sender;
+  if (!(fields >> line.timeStamp >> sender))
+  {
+    return false;
+  }
+  line.isReset = (sender == "reset");
+  line.payload.clear();
+  if (line.isReset)
+  {
+    return true;
+  }
+  unsigned int componentIndex;
+  if (!(fields >> componentIndex))
+  {
+    return false;
+  }
+  line.sender         = (uint8_t)strtoul(sender.c_str(), NULL, 16);
+  line.componentIndex = (uint8_t)componentIndex;
+  std::string hex, part;
+  while (fields >> part)
+  {
+    hex += part;
+  }
+  if (hex.size() % 2)
+  {
+    return false;
+  }
+  for (size_t i = 0; i < hex.size(); i += 2)
+  {
+    line.payload.push_back(
+      (uint8_t)strtoul(hex.substr(i, 2).c_str(), NULL, 16));
+  }
+  return true;
+}
+
+static std::string
+formatEvents(const std::vector<HMSFaultEvent>& events, bool isRejected)
+{
+  static const char typeChar[] = {'+', '-', '~'};
+  std::string       out        = isRejected ? "!" : "";
+  for (size_t i = 0; i < events.size(); i++)
+  {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%c%08x/%u/%u:%u", typeChar[events[i].type],
+             events[i].fault.alarmId, events[i].fault.sensorIndex,
+             events[i].fault.componentIndex, events[i].fault.reportLevel);
+    out += (out.empty() ? "" : " ") + std::string(buf);
+  }
+  return out;
+}
+
+//! @return the number of lines whose events differ from the expected ones
+static int
+replay(const std::vector<ReplayLine>& lines, bool isVerbose)
+{
+  HMSStateTracker            tracker;
+  std::vector<HMSFaultEvent> events;
+  int                        mismatchNum = 0;
+  uint32_t                   lastPushTime = 0;
+  for (size_t i = 0; i < lines.size(); i++)
+  {
+    const ReplayLine& line = lines[i];
+    events.clear();
+    bool isRejected = false;
+    if (line.isReset)
+    {
+      tracker.reset(lastPushTime, events);
+    }
+    else
+    {
+      lastPushTime = line.timeStamp;
+      isRejected = !tracker.update(
+        line.sender, line.componentIndex,
+        line.payload.empty() ? NULL : &line.payload[0],
+        (uint16_t)line.payload.size(), line.timeStamp, events);
+    }
+    std::string got = formatEvents(events, isRejected);
+    bool isMatched  = !line.hasExpected || got == line.expected;
+    if (!isMatched)
+    {
+      mismatchNum++;
+    }
+    if (isVerbose && (!got.empty() || !isMatched))
+    {
+      printf("%6u  line %-4d %s%s%s\n", line.timeStamp, line.lineNo,
+             got.c_str(), isMatched ? "" : "   MISMATCH, expected ",
+             isMatched ? "" : line.expected.c_str());
+    }
+  }
+  if (isVerbose)
+  {
+    printf("%u faults active at the end\n", tracker.getActiveFaultNum());
+  }
+  return mismatchNum;
+}
+
+int
+main(int argc, char** argv)
+{
+  //! Replays of the recording timed after the checked one
+  int loops = argc > 2 ? atoi(argv[2]) : 1000;
+  if (loops < 0)
+  {
+    printf("usage: %s [recording file] [timed replays]\n", argv[0]);
+    return 1;
+  }
+
+  std::vector<ReplayLine> lines;
+  std::vector<std::string> texts;
+  if (argc > 1 && strcmp(argv[1], "-") != 0)
+  {
+    FILE* fp = fopen(argv[1], "r");
+    if (!fp)
+    {
+      perror(argv[1]);
+      return 1;
+    }
+    char buf[4096];
+    while (fgets(buf, sizeof(buf), fp))
+    {
+      texts.push_back(buf);
+    }
+    fclose(fp);
+  }
+  else
+  {
+    texts.assign(builtinRecording,
+                 builtinRecording +
+                   sizeof(builtinRecording) / sizeof(builtinRecording[0]));
+  }
+  for (size_t i = 0; i < texts.size(); i++)
+  {
+    ReplayLine line;
+    std::string text = texts[i];
+    size_t      pos  = text.find_first_not_of(" \t\r\n");
+    if (pos == std::string::npos || text[pos] == '#')
+    {
+      continue;
+    }
+    if (!parseLine(text, i + 1, line))
+    {
+      fprintf(stderr, "line %zu: cannot parse\n", i + 1);
+      return 1;
+    }
+    lines.push_back(line);
+  }
+
+  int mismatchNum = replay(lines, true);
+  printf("%zu pushes replayed, %d mismatches\n", lines.size(), mismatchNum);
+
+  if (loops && !lines.empty())
+  {
+    BenchClock::time_point start = BenchClock::now();
+    for (int i = 0; i < loops; i++)
+    {
+      replay(lines, false);
+    }
+    double ns =
+      std::chrono::duration<double, std::nano>(BenchClock::now() - start)
+        .count();
+    printf("%.0f ns per push over %d replays\n", ns / loops / lines.size(),
+           loops);
+  }
+  return mismatchNum ? 1 : 0;
+}
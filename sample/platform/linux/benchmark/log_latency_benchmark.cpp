@@ -0,0 +1,188 @@
+/*! @file benchmark/log_latency_benchmark.cpp
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ *  @brief
+ *  Latency of a DSTATUS call from several threads, printed synchronously,
+ *  queued to the asynchronous backend, and deferred. The log lines go to
+ *  /dev/null, the results to stderr.
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "dji_log.hpp"
+#include "osdkosal_linux.h"
+
+using namespace DJI::OSDK;
+
+typedef std::chrono::steady_clock BenchClock;
+
+enum LogMode
+{
+  LOG_SYNC,
+  LOG_ASYNC,
+  LOG_DEFERRED
+};
+
+struct WorkerArg
+{
+  LogMode             mode;
+  int                 id;
+  int                 lines;
+  int                 paceUs;
+  std::vector<double> latencyNs;
+};
+
+static void*
+logWorker(void* p)
+{
+  WorkerArg* arg = (WorkerArg*)p;
+  arg->latencyNs.reserve(arg->lines);
+  for (int i = 0; i < arg->lines; i++)
+  {
+    BenchClock::time_point start = BenchClock::now();
+    if (arg->mode == LOG_DEFERRED)
+    {
+      DSTATUS_DEFERRED("worker %d line %d value %f", arg->id, i, i * 0.5);
+    }
+    else
+    {
+      DSTATUS("worker %d line %d value %f", arg->id, i, i * 0.5);
+    }
+    arg->latencyNs.push_back(
+      std::chrono::duration<double, std::nano>(BenchClock::now() - start)
+        .count());
+    if (arg->paceUs)
+    {
+      usleep(arg->paceUs);
+    }
+  }
+  return NULL;
+}
+
+static void
+runMode(LogMode mode, const char* name, int threadNum, int lines,
+        int paceUs)
+{
+  if (mode != LOG_SYNC && !Log::instance().enableAsyncLogging())
+  {
+    fprintf(stderr, "%s: async backend failed to start\n", name);
+    return;
+  }
+  AsyncLog::instance().resetDroppedCount();
+
+  std::vector<WorkerArg> args(threadNum);
+  std::vector<pthread_t> threads(threadNum);
+  BenchClock::time_point start = BenchClock::now();
+  for (int t = 0; t < threadNum; t++)
+  {
+    args[t].mode   = mode;
+    args[t].id     = t;
+    args[t].lines  = lines;
+    args[t].paceUs = paceUs;
+    pthread_create(&threads[t], NULL, logWorker, &args[t]);
+  }
+  std::vector<double> all;
+  for (int t = 0; t < threadNum; t++)
+  {
+    pthread_join(threads[t], NULL);
+    all.insert(all.end(), args[t].latencyNs.begin(), args[t].latencyNs.end());
+  }
+  double callMs =
+    std::chrono::duration<double, std::milli>(BenchClock::now() - start)
+      .count();
+  //! Includes the flush of the queued lines
+  Log::instance().disableAsyncLogging();
+  double totalMs =
+    std::chrono::duration<double, std::milli>(BenchClock::now() - start)
+      .count();
+
+  std::sort(all.begin(), all.end());
+  fprintf(stderr,
+          "%-9s p50 %7.0f ns  p99 %7.0f ns  max %9.0f ns  "
+          "calls %7.1f ms  total %7.1f ms  dropped %u\n",
+          name, all[all.size() / 2], all[all.size() * 99 / 100], all.back(),
+          callMs, totalMs,
+          mode == LOG_SYNC ? 0 : AsyncLog::instance().getDroppedCount());
+}
+
+int
+main(int argc, char** argv)
+{
+  int threadNum = argc > 1 ? atoi(argv[1]) : 4;
+  int lines     = argc > 2 ? atoi(argv[2]) : 20000;
+  //! Pause between two lines of a thread, 0 for a burst that overruns the
+  //! async rings
+  int paceUs = argc > 3 ? atoi(argv[3]) : 50;
+  if (threadNum <= 0 || lines <= 0 || paceUs < 0)
+  {
+    printf("usage: %s [threads] [lines per thread] [pace us]\n", argv[0]);
+    return 1;
+  }
+
+  //! Only what the logger needs: its mutex and the timestamp
+  static T_OsdkOsalHandler osalHandler = {
+    .TaskCreate         = OsdkLinux_TaskCreate,
+    .TaskDestroy        = OsdkLinux_TaskDestroy,
+    .TaskSleepMs        = OsdkLinux_TaskSleepMs,
+    .MutexCreate        = OsdkLinux_MutexCreate,
+    .MutexDestroy       = OsdkLinux_MutexDestroy,
+    .MutexLock          = OsdkLinux_MutexLock,
+    .MutexUnlock        = OsdkLinux_MutexUnlock,
+    .SemaphoreCreate    = OsdkLinux_SemaphoreCreate,
+    .SemaphoreDestroy   = OsdkLinux_SemaphoreDestroy,
+    .SemaphoreWait      = OsdkLinux_SemaphoreWait,
+    .SemaphoreTimedWait = OsdkLinux_SemaphoreTimedWait,
+    .SemaphorePost      = OsdkLinux_SemaphorePost,
+    .GetTimeMs          = OsdkLinux_GetTimeMs,
+#ifdef OS_DEBUG
+    .GetTimeUs = OsdkLinux_GetTimeUs,
+#endif
+    .Malloc = OsdkLinux_Malloc,
+    .Free   = OsdkLinux_Free,
+  };
+  if (DJI_REG_OSAL_HANDLER(&osalHandler) != true)
+  {
+    fprintf(stderr, "Osal handler register fail\n");
+    return 1;
+  }
+
+  if (!freopen("/dev/null", "w", stdout))
+  {
+    perror("freopen");
+    return 1;
+  }
+
+  fprintf(stderr, "%d threads, %d lines each, one every %d us\n", threadNum,
+          lines, paceUs);
+  runMode(LOG_SYNC, "sync", threadNum, lines, paceUs);
+  runMode(LOG_ASYNC, "async", threadNum, lines, paceUs);
+  runMode(LOG_DEFERRED, "deferred", threadNum, lines, paceUs);
+  return 0;
+}
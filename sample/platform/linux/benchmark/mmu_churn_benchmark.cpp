@@ -0,0 +1,315 @@
+/*! @file benchmark/mmu_churn_benchmark.cpp
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ *  @brief
+ *  Alloc/free churn benchmark of the protocol session allocator (MMU)
+ *  against the first-fit allocator it replaced. Every block is filled
+ *  with a pattern that is checked before it is freed.
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "dji_memory.hpp"
+
+using namespace DJI::OSDK;
+
+typedef std::chrono::steady_clock BenchClock;
+
+//! The first-fit MMU of OSDK 4.0, kept here as the baseline
+class LegacyMMU
+{
+public:
+  LegacyMMU();
+  void setupMMU(void);
+  void freeMemory(MMU_Tab* mmu_tab);
+  MMU_Tab* allocMemory(uint16_t size);
+
+public:
+  static const int MMU_TABLE_NUM = 32;
+  static const int MEMORY_SIZE   = 1024;
+
+private:
+  MMU_Tab memoryTable[MMU_TABLE_NUM];
+  uint8_t memory[MEMORY_SIZE];
+};
+
+LegacyMMU::LegacyMMU()
+{
+}
+
+void
+LegacyMMU::setupMMU()
+{
+  uint32_t i;
+  memoryTable[0].tabIndex  = 0;
+  memoryTable[0].usageFlag = 1;
+  memoryTable[0].pmem      = memory;
+  memoryTable[0].memSize   = 0;
+  for (i = 1; i < (MMU_TABLE_NUM - 1); i++)
+  {
+    memoryTable[i].tabIndex  = i;
+    memoryTable[i].usageFlag = 0;
+  }
+  memoryTable[MMU_TABLE_NUM - 1].tabIndex  = MMU_TABLE_NUM - 1;
+  memoryTable[MMU_TABLE_NUM - 1].usageFlag = 1;
+  memoryTable[MMU_TABLE_NUM - 1].pmem      = memory + MEMORY_SIZE;
+  memoryTable[MMU_TABLE_NUM - 1].memSize   = 0;
+}
+
+void
+LegacyMMU::freeMemory(MMU_Tab* mmu_tab)
+{
+  if (mmu_tab == (MMU_Tab*)0)
+  {
+    return;
+  }
+  if (mmu_tab->tabIndex == 0 || mmu_tab->tabIndex == (MMU_TABLE_NUM - 1))
+  {
+    return;
+  }
+  mmu_tab->usageFlag = 0;
+}
+
+MMU_Tab*
+LegacyMMU::allocMemory(uint16_t size)
+{
+  uint32_t mem_used = 0;
+  uint8_t  i;
+  uint8_t  j                = 0;
+  uint8_t  mmu_tab_used_num = 0;
+  uint8_t  mmu_tab_used_index[MMU_TABLE_NUM];
+
+  uint32_t temp32;
+  uint32_t temp_area[2] = { 0xFFFFFFFF, 0xFFFFFFFF };
+
+  uint32_t record_temp32 = 0;
+  uint8_t  magic_flag    = 0;
+
+  if (size > PRO_PURE_DATA_MAX_SIZE || size > MEMORY_SIZE)
+  {
+    return (MMU_Tab *) 0;
+  }
+
+  for (i = 0; i < MMU_TABLE_NUM; i++)
+  {
+    if (memoryTable[i].usageFlag == 1)
+    {
+      mem_used += memoryTable[i].memSize;
+      mmu_tab_used_index[mmu_tab_used_num++] = memoryTable[i].tabIndex;
+    }
+  }
+
+  if (MEMORY_SIZE < (mem_used + size))
+  {
+    return (MMU_Tab *) 0;
+  }
+
+  if (mem_used == 0)
+  {
+    memoryTable[1].pmem      = memoryTable[0].pmem;
+    memoryTable[1].memSize   = size;
+    memoryTable[1].usageFlag = 1;
+    return &memoryTable[1];
+  }
+
+  for (i = 0; i < (mmu_tab_used_num - 1); i++)
+  {
+    for (j = 0; j < (mmu_tab_used_num - i - 1); j++)
+    {
+      if (memoryTable[mmu_tab_used_index[j]].pmem >
+          memoryTable[mmu_tab_used_index[j + 1]].pmem)
+      {
+        mmu_tab_used_index[j + 1] ^= mmu_tab_used_index[j];
+        mmu_tab_used_index[j] ^= mmu_tab_used_index[j + 1];
+        mmu_tab_used_index[j + 1] ^= mmu_tab_used_index[j];
+      }
+    }
+  }
+  for (i = 0; i < (mmu_tab_used_num - 1); i++)
+  {
+    temp32 = static_cast<uint32_t>(memoryTable[mmu_tab_used_index[i + 1]].pmem -
+                                   memoryTable[mmu_tab_used_index[i]].pmem);
+
+    if ((temp32 - memoryTable[mmu_tab_used_index[i]].memSize) >= size)
+    {
+      if (temp_area[1] > (temp32 - memoryTable[mmu_tab_used_index[i]].memSize))
+      {
+        temp_area[0] = memoryTable[mmu_tab_used_index[i]].tabIndex;
+        temp_area[1] = temp32 - memoryTable[mmu_tab_used_index[i]].memSize;
+      }
+    }
+
+    record_temp32 += temp32 - memoryTable[mmu_tab_used_index[i]].memSize;
+    if (record_temp32 >= size && magic_flag == 0)
+    {
+      j          = i;
+      magic_flag = 1;
+    }
+  }
+
+  if (temp_area[0] == 0xFFFFFFFF && temp_area[1] == 0xFFFFFFFF)
+  {
+    for (i = 0; i < j; i++)
+    {
+      if (memoryTable[mmu_tab_used_index[i + 1]].pmem >
+          (memoryTable[mmu_tab_used_index[i]].pmem +
+           memoryTable[mmu_tab_used_index[i]].memSize))
+      {
+        memmove(memoryTable[mmu_tab_used_index[i]].pmem +
+                  memoryTable[mmu_tab_used_index[i]].memSize,
+                memoryTable[mmu_tab_used_index[i + 1]].pmem,
+                memoryTable[mmu_tab_used_index[i + 1]].memSize);
+        memoryTable[mmu_tab_used_index[i + 1]].pmem =
+          memoryTable[mmu_tab_used_index[i]].pmem +
+          memoryTable[mmu_tab_used_index[i]].memSize;
+      }
+    }
+
+    for (i = 1; i < (MMU_TABLE_NUM - 1); i++)
+    {
+      if (memoryTable[i].usageFlag == 0)
+      {
+        memoryTable[i].pmem = memoryTable[mmu_tab_used_index[j]].pmem +
+                              memoryTable[mmu_tab_used_index[j]].memSize;
+
+        memoryTable[i].memSize   = size;
+        memoryTable[i].usageFlag = 1;
+        return &memoryTable[i];
+      }
+    }
+    return (MMU_Tab*)0;
+  }
+
+  for (i = 1; i < (MMU_TABLE_NUM - 1); i++)
+  {
+    if (memoryTable[i].usageFlag == 0)
+    {
+      memoryTable[i].pmem =
+        memoryTable[temp_area[0]].pmem + memoryTable[temp_area[0]].memSize;
+
+      memoryTable[i].memSize   = size;
+      memoryTable[i].usageFlag = 1;
+      return &memoryTable[i];
+    }
+  }
+
+  return (MMU_Tab*)0;
+}
+
+static const int SLOT_NUM = 16;
+
+struct ChurnResult
+{
+  double nsPerOp;
+  long   failed;
+  long   corrupted;
+};
+
+/*! Keep up to SLOT_NUM blocks of 8-128 bytes alive, each round frees or
+ *  allocates a random slot, like the ACK and session buffers do.
+ */
+template <class Allocator>
+static ChurnResult
+churn(Allocator& mmu, long ops, unsigned seed)
+{
+  MMU_Tab*    slots[SLOT_NUM] = { 0 };
+  uint8_t     tags[SLOT_NUM]  = { 0 };
+  ChurnResult result          = { 0, 0, 0 };
+
+  srand(seed);
+  mmu.setupMMU();
+  BenchClock::time_point start = BenchClock::now();
+  for (long n = 0; n < ops; n++)
+  {
+    int i = rand() % SLOT_NUM;
+    if (slots[i])
+    {
+      for (uint32_t k = 0; k < slots[i]->memSize; k++)
+      {
+        if (slots[i]->pmem[k] != tags[i])
+        {
+          result.corrupted++;
+          break;
+        }
+      }
+      mmu.freeMemory(slots[i]);
+      slots[i] = 0;
+    }
+    else
+    {
+      uint16_t size = 8 + rand() % 121;
+      slots[i]      = mmu.allocMemory(size);
+      if (!slots[i])
+      {
+        result.failed++;
+        continue;
+      }
+      tags[i] = (uint8_t)n;
+      memset(slots[i]->pmem, tags[i], size);
+    }
+  }
+  double ns = std::chrono::duration<double, std::nano>(BenchClock::now() -
+                                                       start).count();
+  result.nsPerOp = ns / ops;
+  for (int i = 0; i < SLOT_NUM; i++)
+  {
+    mmu.freeMemory(slots[i]);
+  }
+  return result;
+}
+
+static void
+report(const char* name, const ChurnResult& r)
+{
+  printf("%-10s %8.1f ns/op  failed %ld  corrupted %ld\n", name, r.nsPerOp,
+         r.failed, r.corrupted);
+}
+
+int
+main(int argc, char** argv)
+{
+  long ops = argc > 1 ? atol(argv[1]) : 2000000;
+  if (ops <= 0)
+  {
+    printf("usage: %s [ops]\n", argv[0]);
+    return 1;
+  }
+
+  static LegacyMMU legacy;
+  static MMU       tlsf;
+
+  printf("%ld ops, %d slots of 8-128 bytes\n", ops, SLOT_NUM);
+  printf("%d byte arena\n", LegacyMMU::MEMORY_SIZE);
+  report("first-fit", churn(legacy, ops, 1));
+  //! Block headers and no compaction cost some capacity at the same size
+  tlsf.configure(LegacyMMU::MEMORY_SIZE);
+  report("tlsf", churn(tlsf, ops, 1));
+  printf("%d byte arena\n", MMU::MEMORY_SIZE);
+  tlsf.configure(MMU::MEMORY_SIZE);
+  report("tlsf", churn(tlsf, ops, 1));
+  return 0;
+}
@@ -0,0 +1,214 @@
+/*! @file benchmark/mop_event_loop_benchmark.cpp
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ *  @brief
+ *  Dozens of stand-in pipelines driven by the single MopEventLoop task. Each
+ *  pipeline keeps one blocking call in flight, a sleep standing for
+ *  mop_write_channel, whose result comes back as an event on the loop. The
+ *  calls run on the shared workers (runBlocking) or on a task per call
+ *  (runWaiter); the latency from the queueing to the event, the throughput
+ *  and the peak thread count are printed.
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include "dji_mop_event_loop.hpp"
+#include "dji_platform.hpp"
+#include "osdkosal_linux.h"
+
+using namespace DJI::OSDK;
+
+typedef std::chrono::steady_clock BenchClock;
+
+struct StandinPipeline
+{
+  bool                    pooled;
+  int                     callUs;
+  int                     leftCalls;
+  BenchClock::time_point  queuedTime;
+  std::vector<double>     latencyUs;
+};
+
+static std::atomic<int> runningNum;
+
+static void callDoneEvent(void* arg);
+
+static void
+blockingCall(void* arg)
+{
+  StandinPipeline* p = (StandinPipeline*)arg;
+  if (p->callUs)
+  {
+    usleep(p->callUs);
+  }
+  MopEventLoop::instance().post(callDoneEvent, p);
+}
+
+static bool
+queueCall(StandinPipeline* p)
+{
+  p->queuedTime = BenchClock::now();
+  if (p->pooled)
+  {
+    return MopEventLoop::instance().runBlocking(blockingCall, p, "benchCall");
+  }
+  return MopEventLoop::instance().runWaiter(blockingCall, p, "benchCall");
+}
+
+//! On the loop task, as the callbacks of the non-blocking mop apis
+static void
+callDoneEvent(void* arg)
+{
+  StandinPipeline* p = (StandinPipeline*)arg;
+  p->latencyUs.push_back(
+    std::chrono::duration<double, std::micro>(BenchClock::now() -
+                                              p->queuedTime)
+      .count());
+  if (--p->leftCalls > 0 && queueCall(p))
+  {
+    return;
+  }
+  runningNum--;
+}
+
+static int
+getThreadNum()
+{
+  FILE* fp = fopen("/proc/self/status", "r");
+  if (!fp)
+  {
+    return 0;
+  }
+  char line[256];
+  int  num = 0;
+  while (fgets(line, sizeof(line), fp))
+  {
+    if (strncmp(line, "Threads:", 8) == 0)
+    {
+      num = atoi(line + 8);
+      break;
+    }
+  }
+  fclose(fp);
+  return num;
+}
+
+static void
+runMode(bool pooled, const char* name, int pipelineNum, int calls,
+        int callUs)
+{
+  std::vector<StandinPipeline> pipelines(pipelineNum);
+  runningNum = pipelineNum;
+  BenchClock::time_point start = BenchClock::now();
+  for (int i = 0; i < pipelineNum; i++)
+  {
+    pipelines[i].pooled    = pooled;
+    pipelines[i].callUs    = callUs;
+    pipelines[i].leftCalls = calls;
+    pipelines[i].latencyUs.reserve(calls);
+    if (!queueCall(&pipelines[i]))
+    {
+      runningNum--;
+    }
+  }
+  int peakThreads = 0;
+  while (runningNum > 0)
+  {
+    peakThreads = std::max(peakThreads, getThreadNum());
+    usleep(1000);
+  }
+  double totalMs =
+    std::chrono::duration<double, std::milli>(BenchClock::now() - start)
+      .count();
+  //! The events of the last calls are done, the tasks are joined later
+  usleep(200 * 1000);
+
+  std::vector<double> all;
+  for (int i = 0; i < pipelineNum; i++)
+  {
+    all.insert(all.end(), pipelines[i].latencyUs.begin(),
+               pipelines[i].latencyUs.end());
+  }
+  std::sort(all.begin(), all.end());
+  fprintf(stderr,
+          "%-8s %6zu calls  %8.0f calls/s  p50 %7.1f us  p99 %8.1f us  "
+          "peak threads %d\n",
+          name, all.size(), all.size() * 1000.0 / totalMs,
+          all[all.size() / 2], all[all.size() * 99 / 100], peakThreads);
+}
+
+int
+main(int argc, char** argv)
+{
+  int pipelineNum = argc > 1 ? atoi(argv[1]) : 48;
+  int calls       = argc > 2 ? atoi(argv[2]) : 500;
+  //! Time one blocking call takes, 0 for a write the library buffers at once
+  int callUs = argc > 3 ? atoi(argv[3]) : 50;
+  if (pipelineNum <= 0 || calls <= 0 || callUs < 0)
+  {
+    printf("usage: %s [pipelines] [calls per pipeline] [call us]\n",
+           argv[0]);
+    return 1;
+  }
+
+  static T_OsdkOsalHandler osalHandler = {
+    .TaskCreate         = OsdkLinux_TaskCreate,
+    .TaskDestroy        = OsdkLinux_TaskDestroy,
+    .TaskSleepMs        = OsdkLinux_TaskSleepMs,
+    .MutexCreate        = OsdkLinux_MutexCreate,
+    .MutexDestroy       = OsdkLinux_MutexDestroy,
+    .MutexLock          = OsdkLinux_MutexLock,
+    .MutexUnlock        = OsdkLinux_MutexUnlock,
+    .SemaphoreCreate    = OsdkLinux_SemaphoreCreate,
+    .SemaphoreDestroy   = OsdkLinux_SemaphoreDestroy,
+    .SemaphoreWait      = OsdkLinux_SemaphoreWait,
+    .SemaphoreTimedWait = OsdkLinux_SemaphoreTimedWait,
+    .SemaphorePost      = OsdkLinux_SemaphorePost,
+    .GetTimeMs          = OsdkLinux_GetTimeMs,
+#ifdef OS_DEBUG
+    .GetTimeUs = OsdkLinux_GetTimeUs,
+#endif
+    .Malloc = OsdkLinux_Malloc,
+    .Free   = OsdkLinux_Free,
+  };
+  if (DJI_REG_OSAL_HANDLER(&osalHandler) != true)
+  {
+    fprintf(stderr, "Osal handler register fail\n");
+    return 1;
+  }
+
+  fprintf(stderr, "%d pipelines, %d calls each, %d us per call, %u workers\n",
+          pipelineNum, calls, callUs, MopEventLoop::WORKER_NUM);
+  runMode(true, "workers", pipelineNum, calls, callUs);
+  runMode(false, "per-call", pipelineNum, calls, callUs);
+  return 0;
+}
@@ -0,0 +1,421 @@
+/*! @file benchmark/mop_file_transfer_standin.cpp
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ *  @brief
+ *  In-process loopback stand-in of a mop pipeline pair for MopFileTransfer.
+ *  The mop channel calls are replaced by two message queues which can drop
+ *  or reorder the DATA messages and drop the ACKs, so the window, the
+ *  resume from a partial file, its MD5 check and stop() are exercised
+ *  without a payload.
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "dji_mop_file_transfer.hpp"
+#include "dji_platform.hpp"
+#include "mop.h"
+#include "osdkosal_linux.h"
+
+using namespace DJI::OSDK;
+using namespace DJI::OSDK::MOP;
+
+typedef std::chrono::steady_clock BenchClock;
+
+//! Faults applied to the messages written to a channel
+struct FaultPolicy
+{
+  //! DATA seq lost once, -1 for none
+  int64_t dropDataSeq;
+  //! DATA seq held back and delivered after the next one, -1 for none
+  int64_t swapDataSeq;
+  //! Every n-th ACK is lost, except the last one of the file, 0 for none
+  uint32_t dropAckEvery;
+
+  uint32_t ackNum;
+  uint32_t droppedNum;
+  std::vector<uint8_t> held;
+};
+
+struct LoopbackChannel
+{
+  std::mutex                        mutex;
+  std::condition_variable           cond;
+  std::deque<std::vector<uint8_t> > msgs;
+  bool                              isClosed;
+  LoopbackChannel*                  peer;
+  FaultPolicy*                      fault;
+  uint64_t                          fileSize;
+};
+
+static void
+deliver(LoopbackChannel* to, const uint8_t* buf, uint32_t len)
+{
+  {
+    std::lock_guard<std::mutex> lock(to->mutex);
+    to->msgs.push_back(std::vector<uint8_t>(buf, buf + len));
+  }
+  to->cond.notify_all();
+}
+
+//! Stands in for the mop library, one message per write as on a RELIABLE
+//! pipeline
+extern "C" int32_t
+mop_write_channel(mop_channel_handle_t handle, void* buf, uint32_t length)
+{
+  LoopbackChannel* ch = (LoopbackChannel*)handle;
+  {
+    std::lock_guard<std::mutex> lock(ch->mutex);
+    if (ch->isClosed)
+    {
+      return MOP_ERR_CONNECTIONCLOSE;
+    }
+  }
+
+  FaultPolicy* fault = ch->fault;
+  const MopFileTransfer::MsgHeader* header =
+    (const MopFileTransfer::MsgHeader*)buf;
+  if (fault && length >= sizeof(MopFileTransfer::MsgHeader))
+  {
+    if (header->cmd == MopFileTransfer::MSG_DATA)
+    {
+      if ((int64_t)header->seq == fault->dropDataSeq)
+      {
+        fault->dropDataSeq = -1;
+        fault->droppedNum++;
+        return length;
+      }
+      if ((int64_t)header->seq == fault->swapDataSeq)
+      {
+        fault->swapDataSeq = -1;
+        fault->held.assign((uint8_t*)buf, (uint8_t*)buf + length);
+        return length;
+      }
+    }
+    else if (header->cmd == MopFileTransfer::MSG_ACK && fault->dropAckEvery)
+    {
+      if ((++fault->ackNum % fault->dropAckEvery == 0) &&
+          header->offset != ch->fileSize)
+      {
+        fault->droppedNum++;
+        return length;
+      }
+    }
+  }
+  deliver(ch->peer, (const uint8_t*)buf, length);
+  if (fault && !fault->held.empty() &&
+      header->cmd == MopFileTransfer::MSG_DATA)
+  {
+    deliver(ch->peer, &fault->held[0], fault->held.size());
+    fault->held.clear();
+  }
+  return length;
+}
+
+extern "C" int32_t
+mop_read_channel(mop_channel_handle_t handle, void* buf, uint32_t length)
+{
+  LoopbackChannel*             ch = (LoopbackChannel*)handle;
+  std::unique_lock<std::mutex> lock(ch->mutex);
+  ch->cond.wait(lock, [ch] { return !ch->msgs.empty() || ch->isClosed; });
+  if (ch->msgs.empty())
+  {
+    return MOP_ERR_CONNECTIONCLOSE;
+  }
+  std::vector<uint8_t>& msg = ch->msgs.front();
+  uint32_t              len = msg.size() < length ? msg.size() : length;
+  memcpy(buf, &msg[0], len);
+  ch->msgs.pop_front();
+  return len;
+}
+
+//! A connected pipeline pair, the channels outlive the pipelines since a
+//! reader task may still be in a read when a pipeline is deleted
+struct LoopbackLink
+{
+  LoopbackChannel senderCh;
+  LoopbackChannel recverCh;
+  MopPipeline*    sender;
+  MopPipeline*    recver;
+};
+
+static std::list<LoopbackLink*> links;
+
+static LoopbackLink*
+openLink(uint64_t fileSize, FaultPolicy* senderFault,
+         FaultPolicy* recverFault)
+{
+  LoopbackLink* link = new LoopbackLink;
+  links.push_back(link);
+  LoopbackChannel* chs[2] = {&link->senderCh, &link->recverCh};
+  for (int i = 0; i < 2; i++)
+  {
+    chs[i]->isClosed = false;
+    chs[i]->peer     = chs[1 - i];
+    chs[i]->fileSize = fileSize;
+  }
+  link->senderCh.fault = senderFault;
+  link->recverCh.fault = recverFault;
+  link->sender = new MopPipeline(49153, RELIABLE);
+  link->recver = new MopPipeline(49153, RELIABLE);
+  link->sender->channelHandle = &link->senderCh;
+  link->recver->channelHandle = &link->recverCh;
+  return link;
+}
+
+static void
+closeLink(LoopbackLink* link)
+{
+  LoopbackChannel* chs[2] = {&link->senderCh, &link->recverCh};
+  for (int i = 0; i < 2; i++)
+  {
+    {
+      std::lock_guard<std::mutex> lock(chs[i]->mutex);
+      chs[i]->isClosed = true;
+    }
+    chs[i]->cond.notify_all();
+  }
+  delete link->sender;
+  delete link->recver;
+}
+
+static uint64_t
+getFileSize(const std::string& path)
+{
+  struct stat st;
+  return (stat(path.c_str(), &st) == 0) ? st.st_size : 0;
+}
+
+static bool
+isSameFile(const std::string& a, const std::string& b)
+{
+  FILE* fa = fopen(a.c_str(), "rb");
+  FILE* fb = fopen(b.c_str(), "rb");
+  bool  ok = (fa && fb);
+  std::vector<uint8_t> ba(65536), bb(65536);
+  while (ok)
+  {
+    size_t na = fread(&ba[0], 1, ba.size(), fa);
+    size_t nb = fread(&bb[0], 1, bb.size(), fb);
+    ok = (na == nb) && (memcmp(&ba[0], &bb[0], na) == 0);
+    if (!na)
+    {
+      break;
+    }
+  }
+  if (fa)
+  {
+    fclose(fa);
+  }
+  if (fb)
+  {
+    fclose(fb);
+  }
+  return ok;
+}
+
+struct Scenario
+{
+  const char* name;
+  FaultPolicy senderFault;
+  FaultPolicy recverFault;
+  //! Flip a byte of the partial file after the first attempt
+  bool corruptPartial;
+};
+
+static bool
+runScenario(Scenario& sc, const std::string& srcPath,
+            const std::string& dir, uint32_t chunkSize, uint32_t windowNum)
+{
+  std::string dstPath  = dir + "/standin_dst.bin";
+  uint64_t    fileSize = getFileSize(srcPath);
+  unlink(dstPath.c_str());
+
+  fprintf(stderr, "%s\n", sc.name);
+  for (int attempt = 1; attempt <= 4; attempt++)
+  {
+    //! The faults only hit the first attempt
+    LoopbackLink* link =
+      openLink(fileSize, attempt == 1 ? &sc.senderFault : NULL,
+               attempt == 1 ? &sc.recverFault : NULL);
+    uint64_t haveSize = getFileSize(dstPath);
+
+    MopFileTransfer sender(link->sender, chunkSize, windowNum);
+    MopFileTransfer recver(link->recver, chunkSize, windowNum);
+    MopErrCode      recvRet = MOP_PASSED;
+    std::string     recvName;
+    std::thread     recvThread(
+      [&] { recvRet = recver.recvFile(dir, recvName); });
+
+    BenchClock::time_point start = BenchClock::now();
+    MopErrCode sendRet = sender.sendFile(srcPath, "standin_dst.bin");
+    //! A receiver left waiting for a message ends with the link
+    if (sendRet != MOP_PASSED)
+    {
+      usleep(100 * 1000);
+    }
+    closeLink(link);
+    recvThread.join();
+    double ms =
+      std::chrono::duration<double, std::milli>(BenchClock::now() - start)
+        .count();
+
+    uint32_t dropped = (attempt == 1) ? sc.senderFault.droppedNum +
+                                          sc.recverFault.droppedNum
+                                      : 0;
+    fprintf(stderr,
+            "  attempt %d: from %9llu  send %-6d recv %-6d  %7.1f ms  "
+            "dropped %u  now %llu bytes\n",
+            attempt, (unsigned long long)haveSize, sendRet, recvRet, ms,
+            dropped, (unsigned long long)getFileSize(dstPath));
+    if (sendRet == MOP_PASSED && recvRet == MOP_PASSED)
+    {
+      bool ok = isSameFile(srcPath, dstPath);
+      fprintf(stderr, "  %s\n", ok ? "OK: content verified" : "FAIL: content");
+      return ok;
+    }
+
+    if (attempt == 1 && sc.corruptPartial)
+    {
+      int fd = open(dstPath.c_str(), O_RDWR);
+      uint8_t b = 0;
+      if (fd >= 0 && pread(fd, &b, 1, 0) == 1)
+      {
+        b ^= 0xFF;
+        if (pwrite(fd, &b, 1, 0) != 1)
+        {
+          perror("pwrite");
+        }
+      }
+      if (fd >= 0)
+      {
+        close(fd);
+      }
+      fprintf(stderr, "  partial file corrupted\n");
+    }
+  }
+  fprintf(stderr, "  FAIL: no attempt succeeded\n");
+  return false;
+}
+
+static bool
+runStopBeforeStart(const std::string& srcPath)
+{
+  LoopbackLink*   link = openLink(getFileSize(srcPath), NULL, NULL);
+  MopFileTransfer sender(link->sender);
+  sender.stop();
+  MopErrCode ret = sender.sendFile(srcPath, "standin_dst.bin");
+  bool       ok  = (ret == MOP_CONNECTIONCLOSE) && link->recverCh.msgs.empty();
+  closeLink(link);
+  fprintf(stderr, "stop before start\n  send %d, %s\n", ret,
+          ok ? "OK: nothing sent" : "FAIL: the stop was lost");
+  return ok;
+}
+
+int
+main(int argc, char** argv)
+{
+  uint64_t fileSize  = (argc > 1 ? atoi(argv[1]) : 8192) * 1024ULL;
+  uint32_t chunkSize = argc > 2 ? atoi(argv[2]) : 60 * 1024;
+  uint32_t windowNum = argc > 3 ? atoi(argv[3]) : 8;
+  std::string dir    = argc > 4 ? argv[4] : ".";
+  if (fileSize == 0 || chunkSize == 0 || windowNum == 0)
+  {
+    printf("usage: %s [file KB] [chunk bytes] [window] [dir]\n", argv[0]);
+    return 1;
+  }
+
+  static T_OsdkOsalHandler osalHandler = {
+    .TaskCreate         = OsdkLinux_TaskCreate,
+    .TaskDestroy        = OsdkLinux_TaskDestroy,
+    .TaskSleepMs        = OsdkLinux_TaskSleepMs,
+    .MutexCreate        = OsdkLinux_MutexCreate,
+    .MutexDestroy       = OsdkLinux_MutexDestroy,
+    .MutexLock          = OsdkLinux_MutexLock,
+    .MutexUnlock        = OsdkLinux_MutexUnlock,
+    .SemaphoreCreate    = OsdkLinux_SemaphoreCreate,
+    .SemaphoreDestroy   = OsdkLinux_SemaphoreDestroy,
+    .SemaphoreWait      = OsdkLinux_SemaphoreWait,
+    .SemaphoreTimedWait = OsdkLinux_SemaphoreTimedWait,
+    .SemaphorePost      = OsdkLinux_SemaphorePost,
+    .GetTimeMs          = OsdkLinux_GetTimeMs,
+#ifdef OS_DEBUG
+    .GetTimeUs = OsdkLinux_GetTimeUs,
+#endif
+    .Malloc = OsdkLinux_Malloc,
+    .Free   = OsdkLinux_Free,
+  };
+  if (DJI_REG_OSAL_HANDLER(&osalHandler) != true)
+  {
+    fprintf(stderr, "Osal handler register fail\n");
+    return 1;
+  }
+
+  std::string srcPath = dir + "/standin_src.bin";
+  FILE*       fp      = fopen(srcPath.c_str(), "wb");
+  if (!fp)
+  {
+    perror("fopen");
+    return 1;
+  }
+  srand(1);
+  for (uint64_t i = 0; i < fileSize; i++)
+  {
+    fputc(rand() & 0xFF, fp);
+  }
+  fclose(fp);
+
+  uint32_t chunkNum = (fileSize + chunkSize - 1) / chunkSize;
+  Scenario scenarios[] = {
+    {"clean link", {-1, -1, 0}, {-1, -1, 0}, false},
+    {"DATA lost mid-file, resumed", {chunkNum / 2, -1, 0}, {-1, -1, 0},
+     false},
+    {"DATA reordered, resumed", {-1, chunkNum / 3, 0}, {-1, -1, 0}, false},
+    {"every 2nd ACK lost", {-1, -1, 0}, {-1, -1, 2}, false},
+    {"partial file corrupted, started over", {chunkNum / 2, -1, 0},
+     {-1, -1, 0}, true},
+  };
+  bool ok = runStopBeforeStart(srcPath);
+  for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++)
+  {
+    ok = runScenario(scenarios[i], srcPath, dir, chunkSize, windowNum) && ok;
+  }
+  unlink(srcPath.c_str());
+  unlink((dir + "/standin_dst.bin").c_str());
+  fprintf(stderr, "%s\n", ok ? "all passed" : "FAILED");
+  return ok ? 0 : 1;
+}
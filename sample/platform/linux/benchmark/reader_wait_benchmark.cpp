@@ -0,0 +1,368 @@
+/*! @file benchmark/reader_wait_benchmark.cpp
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ *  @brief
+ *  Benchmark of the advanced sensing reader loop: ProtocolBase::receive()
+ *  with a short sleep against blocking in ProtocolBase::waitForData(). A
+ *  HardDriver on a pseudo terminal stands in for the USB endpoint; a writer
+ *  thread sends frames at a fixed period and the reader reports its CPU time
+ *  and write-to-parse latency.
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include "dji_protocol_base.hpp"
+
+using namespace DJI::OSDK;
+
+//! Same bound as ADV_READ_WAIT_MS in dji_advanced_sensing.cpp
+static const int READ_WAIT_MS = 100;
+
+static double
+nowUs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static double
+threadCpuMs()
+{
+  struct rusage ru;
+  getrusage(RUSAGE_THREAD, &ru);
+  return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1e3 +
+         (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e3;
+}
+
+/*! Driver on the master side of a pseudo terminal. readall() does not block,
+ *  like the USB driver after its IN transfer timed out, and waitForData()
+ *  sleeps in poll() the way LinuxUSBDevice sleeps in libusb event handling.
+ */
+class PtyDriver : public HardDriver
+{
+public:
+  PtyDriver(int fd)
+    : fd(fd)
+  {
+  }
+
+  void init()
+  {
+  }
+
+  time_ms getTimeStamp()
+  {
+    return (time_ms)(nowUs() / 1000);
+  }
+
+  size_t send(const uint8_t* buf, size_t len)
+  {
+    ssize_t ret = write(fd, buf, len);
+    return ret > 0 ? ret : 0;
+  }
+
+  size_t readall(uint8_t* buf, size_t maxlen)
+  {
+    ssize_t ret = read(fd, buf, maxlen);
+    return ret > 0 ? ret : 0;
+  }
+
+  bool waitForData(int timeoutMs)
+  {
+    struct pollfd pfd;
+    pfd.fd      = fd;
+    pfd.events  = POLLIN;
+    pfd.revents = 0;
+    return poll(&pfd, 1, timeoutMs) > 0 && (pfd.revents & POLLIN);
+  }
+
+private:
+  int fd;
+};
+
+//! Frame of TimestampProtocol: a send timestamp between two marker bytes
+#pragma pack(1)
+struct TimestampFrame
+{
+  uint8_t head;
+  double  sendUs;
+  uint8_t tail;
+};
+#pragma pack()
+
+static const uint8_t FRAME_HEAD = 0xAA;
+static const uint8_t FRAME_TAIL = 0x55;
+
+/*! Protocol whose frames carry only a send timestamp, so the SDK receive path
+ *  (waitForData, readPoll, byteHandler, storeData) runs unchanged and only
+ *  the frame checks are trivial. readPoll() feeds the last byte of a frame
+ *  again on the next call, the head check drops it like the real protocols
+ *  do.
+ */
+class TimestampProtocol : public ProtocolBase
+{
+public:
+  TimestampProtocol(HardDriver* driver)
+    : frameUs(0)
+  {
+    threadHandle = NULL;
+    setDriver(driver);
+    init(driver, NULL);
+  }
+
+  ~TimestampProtocol()
+  {
+    delete[] p_filter->recvBuf;
+    delete p_filter;
+    delete p_recvContainer;
+    delete[] buf;
+  }
+
+  void init(HardDriver* Driver, MMU* mmuPtr, bool userCallbackThread = false)
+  {
+    setHeaderLength(1);
+    setMaxRecvLength(64);
+    p_recvContainer      = new RecvContainer();
+    p_filter             = new SDKFilter();
+    p_filter->recvIndex  = 0;
+    p_filter->reuseCount = 0;
+    p_filter->reuseIndex = 0;
+    p_filter->encode     = 0;
+    p_filter->recvBuf    = new uint8_t[MAX_RECV_LEN];
+    BUFFER_SIZE          = 1024;
+    buf                  = new uint8_t[BUFFER_SIZE];
+    buf_read_pos         = 0;
+    read_len             = 0;
+    reuse_buffer         = false;
+  }
+
+  double frameUs;
+
+protected:
+  int sendInterface(void* cmdContainer)
+  {
+    return 0;
+  }
+
+  int sendData(uint8_t* buf)
+  {
+    return 0;
+  }
+
+  bool checkStream()
+  {
+    if (p_filter->recvBuf[0] != FRAME_HEAD)
+    {
+      p_filter->recvIndex = 0;
+      return false;
+    }
+    if (p_filter->recvIndex < sizeof(TimestampFrame))
+    {
+      return false;
+    }
+    TimestampFrame frame;
+    memcpy(&frame, p_filter->recvBuf, sizeof(frame));
+    p_filter->recvIndex = 0;
+    if (frame.tail != FRAME_TAIL)
+    {
+      return false;
+    }
+    frameUs                          = frame.sendUs;
+    p_recvContainer->recvInfo.cmd_id = 0;
+    return true;
+  }
+
+  bool verifyHead()
+  {
+    return true;
+  }
+
+  bool verifyData()
+  {
+    return true;
+  }
+
+  bool callApp()
+  {
+    return true;
+  }
+
+  bool appHandler(void* protocolHeader)
+  {
+    return true;
+  }
+
+  int crcHeadCheck(uint8_t* pMsg, size_t nLen)
+  {
+    return 0;
+  }
+
+  int crcTailCheck(uint8_t* pMsg, size_t nLen)
+  {
+    return 0;
+  }
+};
+
+struct ReaderArg
+{
+  TimestampProtocol*  protocol;
+  bool                waiting;
+  std::vector<double> latencyUs;
+  double              cpuMs;
+};
+
+static std::atomic<bool> readerRunning(false);
+
+//! Body of adv_pthread: the original loop slept usleep(10) after each
+//! receive(), the current one blocks in waitForData() first
+static void*
+readerThread(void* p)
+{
+  ReaderArg*         arg      = (ReaderArg*)p;
+  TimestampProtocol* protocol = arg->protocol;
+  double             cpu      = threadCpuMs();
+  while (readerRunning)
+  {
+    if (arg->waiting && !protocol->waitForData(READ_WAIT_MS))
+    {
+      continue;
+    }
+    RecvContainer* recvContainer = protocol->receive();
+    if (recvContainer->recvInfo.cmd_id != 0xFF)
+    {
+      arg->latencyUs.push_back(nowUs() - protocol->frameUs);
+    }
+    if (!arg->waiting)
+    {
+      usleep(10);
+    }
+  }
+  arg->cpuMs = threadCpuMs() - cpu;
+  return NULL;
+}
+
+static bool
+openPty(int* master, int* slave)
+{
+  *master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (*master < 0 || grantpt(*master) != 0 || unlockpt(*master) != 0)
+  {
+    return false;
+  }
+  *slave = open(ptsname(*master), O_RDWR | O_NOCTTY);
+  if (*slave < 0)
+  {
+    return false;
+  }
+  //! Raw on both ends, frames are binary
+  struct termios tio;
+  tcgetattr(*slave, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(*slave, TCSANOW, &tio);
+  tcgetattr(*master, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(*master, TCSANOW, &tio);
+  fcntl(*master, F_SETFL, fcntl(*master, F_GETFL) | O_NONBLOCK);
+  return true;
+}
+
+static void
+runReader(bool waiting, int frames, int periodMs)
+{
+  int master, slave;
+  if (!openPty(&master, &slave))
+  {
+    perror("pty");
+    exit(1);
+  }
+
+  //! The protocol owns and deletes the driver
+  TimestampProtocol protocol(new PtyDriver(master));
+  ReaderArg         arg;
+  arg.protocol  = &protocol;
+  arg.waiting   = waiting;
+  arg.cpuMs     = 0;
+  pthread_t reader;
+  readerRunning = true;
+  pthread_create(&reader, NULL, readerThread, &arg);
+
+  for (int i = 0; i < frames; i++)
+  {
+    usleep(periodMs * 1000);
+    TimestampFrame frame;
+    frame.head   = FRAME_HEAD;
+    frame.sendUs = nowUs();
+    frame.tail   = FRAME_TAIL;
+    if (write(slave, &frame, sizeof(frame)) != sizeof(frame))
+    {
+      perror("write");
+      break;
+    }
+  }
+  usleep(periodMs * 1000);
+  readerRunning = false;
+  pthread_join(reader, NULL);
+  close(slave);
+  close(master);
+
+  std::vector<double>& lat = arg.latencyUs;
+  std::sort(lat.begin(), lat.end());
+  double wallMs = (frames + 1) * periodMs;
+  printf("%-8s frames %4zu  cpu %7.1f ms (%5.2f%% of wall)  "
+         "latency p50 %6.1f us  p99 %6.1f us\n",
+         waiting ? "wait" : "polling", lat.size(), arg.cpuMs,
+         100.0 * arg.cpuMs / wallMs,
+         lat.empty() ? 0.0 : lat[lat.size() / 2],
+         lat.empty() ? 0.0 : lat[lat.size() * 99 / 100]);
+}
+
+int
+main(int argc, char** argv)
+{
+  int frames   = argc > 1 ? atoi(argv[1]) : 100;
+  int periodMs = argc > 2 ? atoi(argv[2]) : 33;
+  if (frames <= 0 || periodMs <= 0)
+  {
+    printf("usage: %s [frames] [period ms]\n", argv[0]);
+    return 1;
+  }
+
+  printf("%d frames, one every %d ms\n", frames, periodMs);
+  runReader(false, frames, periodMs);
+  runReader(true, frames, periodMs);
+  return 0;
+}
@@ -0,0 +1,189 @@
+/*! @file benchmark/usb_bulk_throughput_benchmark.cpp
+ *  @version 4.0
+ *  @date Oct 2020
+ *
+ *  @brief
+ *  Bulk throughput of the USB HAL with its transfer ring, against one
+ *  synchronous libusb_bulk_transfer() at a time on the same endpoints.
+ *
+ *  Any bulk source/sink device will do. Without hardware, the Linux gadget
+ *  zero on the dummy host controller is a local loopback stand-in:
+ *    sudo modprobe dummy_hcd && sudo modprobe g_zero
+ *    ./usb_bulk_throughput_benchmark 0x0525 0xa4a0 0 0x81 0x01
+ *  Check the endpoint addresses with lsusb -v, they depend on the gadget.
+ *
+ *  @Copyright (c) 2020 DJI
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include "osdkhal_linux.h"
+
+typedef std::chrono::steady_clock BenchClock;
+
+static const uint32_t READ_SIZE  = 64 * 1024;
+//! Fits the HAL tx slots, larger sends go out synchronously
+static const uint32_t WRITE_SIZE = 4 * 1024;
+
+struct BenchArgs
+{
+  uint16_t vid;
+  uint16_t pid;
+  uint16_t interfaceNum;
+  uint16_t epIn;
+  uint16_t epOut;
+  double   seconds;
+};
+
+static double
+elapsedS(BenchClock::time_point start)
+{
+  return std::chrono::duration<double>(BenchClock::now() - start).count();
+}
+
+static void
+report(const char* name, const char* dir, uint64_t bytes, long errors,
+       double seconds)
+{
+  printf("%-5s %-3s %8.2f MB/s  %10llu bytes  %ld errors\n", name, dir,
+         bytes / seconds / 1e6, (unsigned long long)bytes, errors);
+}
+
+//! One transfer at a time, like the HAL with USB_BULK_ASYNC_ENABLE 0
+static bool
+runSync(const BenchArgs& a)
+{
+  if (libusb_init(NULL) < 0)
+  {
+    return false;
+  }
+  libusb_device_handle* handle =
+    libusb_open_device_with_vid_pid(NULL, a.vid, a.pid);
+  if (!handle || libusb_claim_interface(handle, a.interfaceNum) != 0)
+  {
+    if (handle)
+      libusb_close(handle);
+    return false;
+  }
+
+  std::vector<uint8_t> buf(READ_SIZE);
+  uint64_t             bytes  = 0;
+  long                 errors = 0;
+  BenchClock::time_point start = BenchClock::now();
+  while (elapsedS(start) < a.seconds)
+  {
+    int len = 0;
+    if (libusb_bulk_transfer(handle, a.epIn, &buf[0], READ_SIZE, &len, 1000))
+      errors++;
+    bytes += len;
+  }
+  report("sync", "in", bytes, errors, elapsedS(start));
+
+  bytes  = 0;
+  errors = 0;
+  start  = BenchClock::now();
+  while (elapsedS(start) < a.seconds)
+  {
+    int len = 0;
+    if (libusb_bulk_transfer(handle, a.epOut, &buf[0], WRITE_SIZE, &len, 1000))
+      errors++;
+    bytes += len;
+  }
+  report("sync", "out", bytes, errors, elapsedS(start));
+
+  libusb_release_interface(handle, a.interfaceNum);
+  libusb_close(handle);
+  return true;
+}
+
+static bool
+runRing(const BenchArgs& a)
+{
+  T_HalObj obj;
+  memset(&obj, 0, sizeof(obj));
+  if (OsdkLinux_USBBulkInit(a.pid, a.vid, a.interfaceNum, a.epIn, a.epOut,
+                            &obj) != OSDK_STAT_OK)
+  {
+    return false;
+  }
+
+  std::vector<uint8_t> buf(READ_SIZE);
+  uint64_t             bytes  = 0;
+  long                 errors = 0;
+  BenchClock::time_point start = BenchClock::now();
+  while (elapsedS(start) < a.seconds)
+  {
+    uint32_t len = READ_SIZE;
+    if (OsdkLinux_USBBulkReadData(&obj, &buf[0], &len) != OSDK_STAT_OK)
+      errors++;
+    else
+      bytes += len;
+  }
+  report("ring", "in", bytes, errors, elapsedS(start));
+
+  //! A send returns once it is queued, the bytes are counted as queued
+  bytes  = 0;
+  errors = 0;
+  start  = BenchClock::now();
+  while (elapsedS(start) < a.seconds)
+  {
+    if (OsdkLinux_USBBulkSendData(&obj, &buf[0], WRITE_SIZE) != OSDK_STAT_OK)
+      errors++;
+    else
+      bytes += WRITE_SIZE;
+  }
+  report("ring", "out", bytes, errors, elapsedS(start));
+
+  //! Cancels and drains the transfers still on the bus
+  OsdkLinux_USBBulkClose(&obj);
+  return true;
+}
+
+int
+main(int argc, char** argv)
+{
+  BenchArgs a;
+  a.vid          = argc > 1 ? strtoul(argv[1], NULL, 0) : 0x0525;
+  a.pid          = argc > 2 ? strtoul(argv[2], NULL, 0) : 0xa4a0;
+  a.interfaceNum = argc > 3 ? strtoul(argv[3], NULL, 0) : 0;
+  a.epIn         = argc > 4 ? strtoul(argv[4], NULL, 0) : 0x81;
+  a.epOut        = argc > 5 ? strtoul(argv[5], NULL, 0) : 0x01;
+  a.seconds      = argc > 6 ? atof(argv[6]) : 5;
+  if (a.seconds <= 0)
+  {
+    printf("usage: %s [vid] [pid] [interface] [ep in] [ep out] [seconds]\n",
+           argv[0]);
+    return 1;
+  }
+
+  printf("device %04x:%04x interface %u, in 0x%02x out 0x%02x, %.1f s each\n",
+         a.vid, a.pid, a.interfaceNum, a.epIn, a.epOut, a.seconds);
+  if (!runSync(a) || !runRing(a))
+  {
+    printf("Failed to open the device, see the usage in the file header\n");
+    return 1;
+  }
+  return 0;
+}
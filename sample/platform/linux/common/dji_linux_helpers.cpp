@@ -64,6 +64,9 @@ LinuxSetup::~LinuxSetup()
 void
 LinuxSetup::setupEnvironment(int argc, char** argv)
 {
+  /*! To keep logging off the calling threads, call
+   *  DJI::OSDK::Log::instance().enableAsyncLogging() and use
+   *  DJI::OSDK::AsyncLog::consoleFunc as the console function here. */
   static T_OsdkLoggerConsole printConsole = {
       .consoleLevel = OSDK_LOGGER_CONSOLE_LOG_LEVEL_INFO,
       .func = OsdkUser_Console,
@@ -124,6 +127,14 @@ LinuxSetup::setupEnvironment(int argc, char** argv)
     throw std::runtime_error("Osal handler register fail");
   }
 
+  /*! Task names, affinity and priority come from the policy table, e.g.
+   *  DJI_SET_TASK_POLICY(OSDK_TASK_CLASS_CONTROL, 0x1, 50) pins the control
+   *  path to cpu 0, it has to be set before the vehicle is created. */
+  DJI_REG_TASK_ATTR_HANDLER(OsdkLinux_TaskSetAttr);
+
+  /*! Monotonic ns clock behind DJI_GET_TIME_NS and the FC time mapping */
+  DJI_REG_TIME_NS_HANDLER(OsdkLinux_GetTimeNs);
+
   // Config file loading
   const char* acm_dev_prefix = "/dev/ttyACM";
   std::string config_file_path;
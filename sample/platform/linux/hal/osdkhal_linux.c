@@ -163,6 +163,316 @@ E_OsdkStat OsdkLinux_UartInit(const char *port, const int baudrate,
 
 #ifdef ADVANCED_SENSING
 
+/* Private constants ---------------------------------------------------------*/
+/* Keep several bulk transfers submitted, so the bus is never idle between two
+ * reads or two writes. Set USB_BULK_ASYNC_ENABLE to 0 for the synchronous
+ * libusb_bulk_transfer() calls. */
+#define USB_BULK_ASYNC_ENABLE       1
+#define USB_BULK_CHANNEL_MAX        4
+#define USB_BULK_TRANSFER_NUM       8
+#define USB_BULK_RX_BUFFER_SIZE     (64 * 1024)
+#define USB_BULK_TX_BUFFER_SIZE     (4 * 1024)
+#define USB_BULK_TX_TIMEOUT_MS      150
+#define USB_BULK_WAIT_SLICE_MS      100
+
+/* Private types -------------------------------------------------------------*/
+typedef struct UsbBulkAsync T_UsbBulkAsync;
+
+typedef struct {
+  T_UsbBulkAsync *owner;
+  int index;
+  struct libusb_transfer *transfer;
+  uint8_t *buffer;
+  /* bytes of a completed rx transfer already handed to the reader */
+  uint32_t offset;
+} T_UsbBulkSlot;
+
+struct UsbBulkAsync {
+  struct libusb_device_handle *handle;
+  pthread_mutex_t mutex;
+  /* rx transfers completed and not consumed yet, in completion order */
+  T_UsbBulkSlot rx[USB_BULK_TRANSFER_NUM];
+  int rxDone[USB_BULK_TRANSFER_NUM];
+  uint32_t rxHead;
+  uint32_t rxCount;
+  int rxCompleted;
+  /* rx slots a transfer error took off the bus, resubmitted by the reader */
+  int rxIdle[USB_BULK_TRANSFER_NUM];
+  uint32_t rxIdleCount;
+  int rxHalted;
+  uint64_t rxRetryMs;
+  uint32_t rxErrCnt;
+  /* tx slots not submitted */
+  T_UsbBulkSlot tx[USB_BULK_TRANSFER_NUM];
+  int txFree[USB_BULK_TRANSFER_NUM];
+  uint32_t txFreeCount;
+  int txCompleted;
+  uint32_t txErrCnt;
+  /* transfers submitted and not completed, for close */
+  uint32_t inFlight;
+  /* the device is gone, nothing can be submitted any more */
+  int error;
+  /* set by close, the readers and senders return at once */
+  int closing;
+  /* readers and senders inside the channel, under s_usbBulkAsyncMutex */
+  uint32_t users;
+};
+
+/* Private variables ---------------------------------------------------------*/
+#if USB_BULK_ASYNC_ENABLE
+static T_UsbBulkAsync *s_usbBulkAsync[USB_BULK_CHANNEL_MAX];
+static pthread_mutex_t s_usbBulkAsyncMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_usbBulkAsyncIdle = PTHREAD_COND_INITIALIZER;
+#endif
+
+/* Private functions definition-----------------------------------------------*/
+#if USB_BULK_ASYNC_ENABLE
+/* The channel stays allocated until OsdkLinux_USBBulkPutAsync, close waits
+ * for all the users to leave before it frees it. */
+static T_UsbBulkAsync *OsdkLinux_USBBulkGetAsync(const T_HalObj *obj) {
+  T_UsbBulkAsync *async = NULL;
+
+  pthread_mutex_lock(&s_usbBulkAsyncMutex);
+  for (int i = 0; i < USB_BULK_CHANNEL_MAX; i++) {
+    if (s_usbBulkAsync[i] && s_usbBulkAsync[i]->handle == obj->bulkObject.handle) {
+      async = s_usbBulkAsync[i];
+      async->users++;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&s_usbBulkAsyncMutex);
+
+  return async;
+}
+
+static void OsdkLinux_USBBulkPutAsync(T_UsbBulkAsync *async) {
+  pthread_mutex_lock(&s_usbBulkAsyncMutex);
+  if (--async->users == 0) {
+    pthread_cond_broadcast(&s_usbBulkAsyncIdle);
+  }
+  pthread_mutex_unlock(&s_usbBulkAsyncMutex);
+}
+
+static uint64_t OsdkLinux_USBBulkGetTimeMs(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Called with async->mutex held */
+static int OsdkLinux_USBBulkSubmit(T_UsbBulkAsync *async, T_UsbBulkSlot *slot) {
+  int ret;
+
+  if (async->closing) {
+    return LIBUSB_ERROR_INTERRUPTED;
+  }
+  ret = libusb_submit_transfer(slot->transfer);
+  if (ret == LIBUSB_SUCCESS) {
+    async->inFlight++;
+  }
+  return ret;
+}
+
+/* Called with async->mutex held. Only a missing device is final, a slot
+ * that could not be submitted otherwise waits for the next retry. */
+static void OsdkLinux_USBBulkRxSubmit(T_UsbBulkAsync *async, T_UsbBulkSlot *slot) {
+  int ret = OsdkLinux_USBBulkSubmit(async, slot);
+
+  if (ret == LIBUSB_ERROR_NO_DEVICE) {
+    async->error = 1;
+  } else if (ret != LIBUSB_SUCCESS && !async->closing) {
+    async->rxIdle[async->rxIdleCount++] = slot->index;
+  }
+}
+
+static void LIBUSB_CALL OsdkLinux_USBBulkRxCallback(struct libusb_transfer *transfer) {
+  T_UsbBulkSlot *slot = (T_UsbBulkSlot *) transfer->user_data;
+  T_UsbBulkAsync *async = slot->owner;
+
+  pthread_mutex_lock(&async->mutex);
+  async->inFlight--;
+  if (transfer->status == LIBUSB_TRANSFER_COMPLETED && transfer->actual_length == 0) {
+    /* nothing to hand over, resubmit at once */
+    OsdkLinux_USBBulkRxSubmit(async, slot);
+  } else if (transfer->status == LIBUSB_TRANSFER_COMPLETED) {
+    slot->offset = 0;
+    async->rxDone[(async->rxHead + async->rxCount) % USB_BULK_TRANSFER_NUM] = slot->index;
+    async->rxCount++;
+  } else if (transfer->status == LIBUSB_TRANSFER_NO_DEVICE) {
+    async->error = 1;
+  } else if (transfer->status != LIBUSB_TRANSFER_CANCELLED) {
+    /* timeout, stall, overflow or a bus error: the reader resubmits it
+     * after a pause, so a persistent error does not spin */
+    async->rxErrCnt++;
+    if (transfer->status == LIBUSB_TRANSFER_STALL) {
+      async->rxHalted = 1;
+    }
+    if (!async->closing) {
+      async->rxIdle[async->rxIdleCount++] = slot->index;
+    }
+  }
+  async->rxCompleted = 1;
+  pthread_mutex_unlock(&async->mutex);
+}
+
+static void LIBUSB_CALL OsdkLinux_USBBulkTxCallback(struct libusb_transfer *transfer) {
+  T_UsbBulkSlot *slot = (T_UsbBulkSlot *) transfer->user_data;
+  T_UsbBulkAsync *async = slot->owner;
+
+  pthread_mutex_lock(&async->mutex);
+  async->inFlight--;
+  if (transfer->status != LIBUSB_TRANSFER_COMPLETED &&
+      transfer->status != LIBUSB_TRANSFER_CANCELLED) {
+    /* the sender already returned, the error can only be counted */
+    async->txErrCnt++;
+  }
+  async->txFree[async->txFreeCount++] = slot->index;
+  async->txCompleted = 1;
+  pthread_mutex_unlock(&async->mutex);
+}
+
+/* Wait in the libusb event handling until *completed is set or the slice
+ * elapsed. Whichever thread waits handles the events of all the channels. */
+static void OsdkLinux_USBBulkHandleEvents(T_UsbBulkAsync *async, int *completed, uint32_t timeMs) {
+  struct timeval tv;
+
+  tv.tv_sec = timeMs / 1000;
+  tv.tv_usec = (timeMs % 1000) * 1000;
+  pthread_mutex_unlock(&async->mutex);
+  libusb_handle_events_timeout_completed(NULL, &tv, completed);
+  pthread_mutex_lock(&async->mutex);
+}
+
+/* Called with async->mutex held, by the reader once per wait slice at most */
+static void OsdkLinux_USBBulkRxRetry(T_UsbBulkAsync *async) {
+  int idle[USB_BULK_TRANSFER_NUM];
+  uint32_t idleCount;
+  uint64_t now;
+
+  if (async->rxIdleCount == 0 || async->error || async->closing) {
+    return;
+  }
+  now = OsdkLinux_USBBulkGetTimeMs();
+  if (now - async->rxRetryMs < USB_BULK_WAIT_SLICE_MS) {
+    return;
+  }
+  async->rxRetryMs = now;
+
+  if (async->rxHalted) {
+    /* synchronous, it handles events itself and the callbacks lock */
+    async->rxHalted = 0;
+    pthread_mutex_unlock(&async->mutex);
+    libusb_clear_halt(async->handle, async->rx[0].transfer->endpoint);
+    pthread_mutex_lock(&async->mutex);
+  }
+
+  idleCount = async->rxIdleCount;
+  memcpy(idle, async->rxIdle, idleCount * sizeof(idle[0]));
+  async->rxIdleCount = 0;
+  for (uint32_t i = 0; i < idleCount; i++) {
+    OsdkLinux_USBBulkRxSubmit(async, &async->rx[idle[i]]);
+  }
+}
+
+static void OsdkLinux_USBBulkFreeAsync(T_UsbBulkAsync *async) {
+  for (int i = 0; i < USB_BULK_TRANSFER_NUM; i++) {
+    libusb_free_transfer(async->rx[i].transfer);
+    libusb_free_transfer(async->tx[i].transfer);
+    free(async->rx[i].buffer);
+    free(async->tx[i].buffer);
+  }
+  pthread_mutex_destroy(&async->mutex);
+  free(async);
+}
+
+/* The channel is already out of s_usbBulkAsync, so no new user finds it */
+static void OsdkLinux_USBBulkStopAsync(T_UsbBulkAsync *async) {
+  pthread_mutex_lock(&async->mutex);
+  async->closing = 1;
+  for (int i = 0; i < USB_BULK_TRANSFER_NUM; i++) {
+    libusb_cancel_transfer(async->rx[i].transfer);
+    libusb_cancel_transfer(async->tx[i].transfer);
+  }
+  /* the buffers may only be freed once libusb gave all the transfers back */
+  while (async->inFlight > 0) {
+    int done = 0;
+    OsdkLinux_USBBulkHandleEvents(async, &done, USB_BULK_WAIT_SLICE_MS);
+  }
+  pthread_mutex_unlock(&async->mutex);
+
+  /* a reader or sender may still be in the event handling, the cancelled
+   * transfers woke it up and it sees closing */
+  pthread_mutex_lock(&s_usbBulkAsyncMutex);
+  while (async->users > 0) {
+    pthread_cond_wait(&s_usbBulkAsyncIdle, &s_usbBulkAsyncMutex);
+  }
+  pthread_mutex_unlock(&s_usbBulkAsyncMutex);
+
+  OsdkLinux_USBBulkFreeAsync(async);
+}
+
+static E_OsdkStat OsdkLinux_USBBulkStartAsync(struct libusb_device_handle *handle,
+                                              uint16_t epIn, uint16_t epOut) {
+  T_UsbBulkAsync *async = (T_UsbBulkAsync *) calloc(1, sizeof(T_UsbBulkAsync));
+  int slot = -1;
+
+  if (!async) {
+    return OSDK_STAT_ERR_ALLOC;
+  }
+  async->handle = handle;
+  pthread_mutex_init(&async->mutex, NULL);
+
+  /* Everything is allocated here once, the transfers only reuse it */
+  for (int i = 0; i < USB_BULK_TRANSFER_NUM; i++) {
+    async->rx[i].owner = async;
+    async->rx[i].index = i;
+    async->rx[i].transfer = libusb_alloc_transfer(0);
+    async->rx[i].buffer = (uint8_t *) malloc(USB_BULK_RX_BUFFER_SIZE);
+    async->tx[i].owner = async;
+    async->tx[i].index = i;
+    async->tx[i].transfer = libusb_alloc_transfer(0);
+    async->tx[i].buffer = (uint8_t *) malloc(USB_BULK_TX_BUFFER_SIZE);
+    if (!async->rx[i].transfer || !async->rx[i].buffer ||
+        !async->tx[i].transfer || !async->tx[i].buffer) {
+      OsdkLinux_USBBulkFreeAsync(async);
+      return OSDK_STAT_ERR_ALLOC;
+    }
+    libusb_fill_bulk_transfer(async->rx[i].transfer, handle, epIn, async->rx[i].buffer,
+                              USB_BULK_RX_BUFFER_SIZE, OsdkLinux_USBBulkRxCallback,
+                              &async->rx[i], 0);
+    libusb_fill_bulk_transfer(async->tx[i].transfer, handle, epOut, async->tx[i].buffer,
+                              0, OsdkLinux_USBBulkTxCallback,
+                              &async->tx[i], USB_BULK_TX_TIMEOUT_MS);
+    async->txFree[async->txFreeCount++] = i;
+  }
+
+  pthread_mutex_lock(&s_usbBulkAsyncMutex);
+  for (int i = 0; i < USB_BULK_CHANNEL_MAX; i++) {
+    if (!s_usbBulkAsync[i]) {
+      s_usbBulkAsync[i] = async;
+      slot = i;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&s_usbBulkAsyncMutex);
+  if (slot < 0) {
+    OsdkLinux_USBBulkFreeAsync(async);
+    return OSDK_STAT_ERR_OUT_OF_RANGE;
+  }
+
+  pthread_mutex_lock(&async->mutex);
+  for (int i = 0; i < USB_BULK_TRANSFER_NUM; i++) {
+    OsdkLinux_USBBulkRxSubmit(async, &async->rx[i]);
+  }
+  pthread_mutex_unlock(&async->mutex);
+
+  return OSDK_STAT_OK;
+}
+#endif
+
+/* Exported functions definition ---------------------------------------------*/
+
 /**
  * @brief USBBulk interface init function.
  * @param pid: USBBulk product id.
@@ -198,6 +508,11 @@ E_OsdkStat OsdkLinux_USBBulkInit(uint16_t pid, uint16_t vid, uint16_t num, uint1
   obj->bulkObject.epIn = epIn;
   obj->bulkObject.epOut = epOut;
 
+#if USB_BULK_ASYNC_ENABLE
+  /* Without the transfer ring the channel still works synchronously */
+  OsdkLinux_USBBulkStartAsync(handle, epIn, epOut);
+#endif
+
   return OSDK_STAT_OK;
 }
 
@@ -213,6 +528,46 @@ E_OsdkStat OsdkLinux_USBBulkSendData(const T_HalObj *obj, const uint8_t *pBuf,
 
   handle = (struct libusb_device_handle *)obj->bulkObject.handle;
 
+#if USB_BULK_ASYNC_ENABLE
+  T_UsbBulkAsync *async = OsdkLinux_USBBulkGetAsync(obj);
+  if (async && bufLen > USB_BULK_TX_BUFFER_SIZE) {
+    OsdkLinux_USBBulkPutAsync(async);
+    async = NULL;
+  }
+  if (async) {
+    E_OsdkStat stat = OSDK_STAT_OK;
+    uint64_t deadline = OsdkLinux_USBBulkGetTimeMs() + USB_BULK_TX_TIMEOUT_MS;
+
+    pthread_mutex_lock(&async->mutex);
+    /* Only wait when all the slots are still on the bus. Other completions
+     * wake the event handling as well, so wait until the deadline. */
+    while (async->txFreeCount == 0 && !async->closing) {
+      uint64_t now = OsdkLinux_USBBulkGetTimeMs();
+      if (now >= deadline) {
+        break;
+      }
+      async->txCompleted = 0;
+      OsdkLinux_USBBulkHandleEvents(async, &async->txCompleted, (uint32_t) (deadline - now));
+    }
+    if (async->closing) {
+      stat = OSDK_STAT_ERR;
+    } else if (async->txFreeCount == 0) {
+      stat = OSDK_STAT_ERR_TIMEOUT;
+    } else {
+      T_UsbBulkSlot *slot = &async->tx[async->txFree[--async->txFreeCount]];
+      memcpy(slot->buffer, pBuf, bufLen);
+      slot->transfer->length = bufLen;
+      if (OsdkLinux_USBBulkSubmit(async, slot) != LIBUSB_SUCCESS) {
+        async->txFree[async->txFreeCount++] = slot->index;
+        stat = OSDK_STAT_ERR;
+      }
+    }
+    pthread_mutex_unlock(&async->mutex);
+    OsdkLinux_USBBulkPutAsync(async);
+    return stat;
+  }
+#endif
+
   for(int try = 0; try < 3; try++) {
     ret = libusb_bulk_transfer(handle, obj->bulkObject.epOut,
                                (uint8_t *)pBuf, bufLen,
@@ -234,6 +589,45 @@ E_OsdkStat OsdkLinux_USBBulkReadData(const T_HalObj *obj, uint8_t *pBuf,
   }
 
   handle = (struct libusb_device_handle *)obj->bulkObject.handle;
+
+#if USB_BULK_ASYNC_ENABLE
+  T_UsbBulkAsync *async = OsdkLinux_USBBulkGetAsync(obj);
+  if (async) {
+    E_OsdkStat stat = OSDK_STAT_OK;
+
+    pthread_mutex_lock(&async->mutex);
+    /* Blocks like the synchronous read with its infinite timeout, until the
+     * device is gone or the channel is closed */
+    while (async->rxCount == 0 && !async->error && !async->closing) {
+      OsdkLinux_USBBulkRxRetry(async);
+      async->rxCompleted = 0;
+      OsdkLinux_USBBulkHandleEvents(async, &async->rxCompleted, USB_BULK_WAIT_SLICE_MS);
+    }
+    if (async->rxCount == 0) {
+      *bufLen = 0;
+      stat = OSDK_STAT_ERR;
+    } else {
+      /* A completed buffer larger than the caller's is handed out in parts,
+       * it goes back to the bus once it has been read completely. */
+      T_UsbBulkSlot *slot = &async->rx[async->rxDone[async->rxHead]];
+      uint32_t left = slot->transfer->actual_length - slot->offset;
+      uint32_t len = (*bufLen < left) ? *bufLen : left;
+
+      memcpy(pBuf, slot->buffer + slot->offset, len);
+      slot->offset += len;
+      *bufLen = len;
+      if (slot->offset >= (uint32_t) slot->transfer->actual_length) {
+        async->rxHead = (async->rxHead + 1) % USB_BULK_TRANSFER_NUM;
+        async->rxCount--;
+        OsdkLinux_USBBulkRxSubmit(async, slot);
+      }
+    }
+    pthread_mutex_unlock(&async->mutex);
+    OsdkLinux_USBBulkPutAsync(async);
+    return stat;
+  }
+#endif
+
   ret = libusb_bulk_transfer(handle, obj->bulkObject.epIn,
                              pBuf, *bufLen, bufLen, (unsigned int)(-1));
   if (ret != 0) {
@@ -258,6 +652,23 @@ E_OsdkStat OsdkLinux_USBBulkClose(T_HalObj *obj) {
   }
 
   handle = (struct libusb_device_handle *)obj->bulkObject.handle;
+
+#if USB_BULK_ASYNC_ENABLE
+  T_UsbBulkAsync *async = NULL;
+  pthread_mutex_lock(&s_usbBulkAsyncMutex);
+  for (int i = 0; i < USB_BULK_CHANNEL_MAX; i++) {
+    if (s_usbBulkAsync[i] && s_usbBulkAsync[i]->handle == handle) {
+      async = s_usbBulkAsync[i];
+      s_usbBulkAsync[i] = NULL;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&s_usbBulkAsyncMutex);
+  if (async) {
+    OsdkLinux_USBBulkStopAsync(async);
+  }
+#endif
+
   libusb_close(handle);
   return OSDK_STAT_OK;
 }
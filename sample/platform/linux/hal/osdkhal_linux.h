@@ -44,6 +44,9 @@
 #include "osdk_platform.h"
 
 #ifdef ADVANCED_SENSING
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
 #include <libusb-1.0/libusb.h>
 #endif
 
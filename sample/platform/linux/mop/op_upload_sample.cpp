@@ -34,12 +34,15 @@
 #include <stdio.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "mop_sample_simple_protocol.hpp"
 #include <openssl/md5.h>
 using namespace DJI::OSDK;
 
 #define TEST_OP_PIPELINE_ID 49153
-#define READ_ONCE_BUFFER_SIZE (2 * 1024 * 1024)
+/*! The peer only answers with short acks and results */
+#define READ_ACK_BUFFER_SIZE (1024)
 #define SEND_ONCE_BUFFER_SIZE (100 * 1024)
 #define TEST_SEND_FILE_NAME "../../sample/platform/linux/mop/telemetryLogFile.txt"
 #define EXPORT_SHORT_FILE_NAME "telemetryLogFile.txt"
@@ -80,7 +83,10 @@ static void OPUploadFileTask(MopPipeline *OP_Pipeline) {
   if (!OP_Pipeline)std::runtime_error("Error param");
   MopErrCode mopRet;
   OPUploadSampleState uploadState = REQUEST_FILE_UPLOAD;
-  uint8_t recvBuf[READ_ONCE_BUFFER_SIZE] = {0};
+  uint8_t recvBuf[READ_ACK_BUFFER_SIZE] = {0};
+  /*! The file is mapped and sent from the mapping, no staging buffer */
+  uint8_t *uploadData = NULL;
+  uint32_t uploadSize = 0;
   while(uploadState != UPLOAD_TASK_FINISH) {
     switch (uploadState) {
       case REQUEST_FILE_UPLOAD: {
@@ -95,7 +101,7 @@ static void OPUploadFileTask(MopPipeline *OP_Pipeline) {
       }
       case RECV_FILE_UPLOAD_ACK: {
         /*! Step 2 : receive the ack of the file upload request */
-        MopPipeline::DataPackType readPack = {(uint8_t *) recvBuf, READ_ONCE_BUFFER_SIZE};
+        MopPipeline::DataPackType readPack = {(uint8_t *) recvBuf, READ_ACK_BUFFER_SIZE};
         mopRet = OP_Pipeline->recvData(readPack, &readPack.length);
         ASSERT_MOP_RET(mopRet)
         sampleProtocolStruct *ackData = (sampleProtocolStruct *) readPack.data;
@@ -110,15 +116,22 @@ static void OPUploadFileTask(MopPipeline *OP_Pipeline) {
       case SEND_FILE_INFOMATION: {
         /*! Step 3 : send file information */
         MD5_CTX uploadFileMd5Ctx;
-        FILE *uploadFile = NULL;
         MD5_Init(&uploadFileMd5Ctx);
-        int returnCode = 0;
-        uploadFile = fopen(TEST_SEND_FILE_NAME, "rb");
-        uint32_t uploadFileTotalSize = 0;
-        uint32_t uploadWriteLen = 0;
-        uint8_t sendBuf[SEND_ONCE_BUFFER_SIZE] = {0};
         unsigned char md5_out[16];
         DSTATUS("Step 3 : Send file information ...");
+        int fd = open(TEST_SEND_FILE_NAME, O_RDONLY);
+        if (fd < 0) throw std::runtime_error("open file error");
+        uploadSize = get_file_size(TEST_SEND_FILE_NAME);
+        if (uploadSize) {
+          void *addr = mmap(NULL, uploadSize, PROT_READ, MAP_PRIVATE, fd, 0);
+          if (addr == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("mmap file error");
+          }
+          uploadData = (uint8_t *) addr;
+          madvise(uploadData, uploadSize, MADV_SEQUENTIAL);
+        }
+        close(fd);
         sampleProtocolStruct req = {
             .cmd = CMD_FILEINFO,
             .subcmd = 0xFF,
@@ -126,23 +139,10 @@ static void OPUploadFileTask(MopPipeline *OP_Pipeline) {
             .dataLen = sizeof(req.data.info)
         };
         req.data.info.isExist = true;
-        req.data.info.fileLength = get_file_size(TEST_SEND_FILE_NAME);
+        req.data.info.fileLength = uploadSize;
         sprintf(req.data.info.fileName, EXPORT_SHORT_FILE_NAME);
 
-        while (1) {
-            returnCode = fseek(uploadFile, uploadFileTotalSize, SEEK_SET);
-            if (returnCode != 0) {
-                DSTATUS("mop channel fseek file data fail.");
-            }
-            uploadWriteLen = fread(sendBuf, 1, SEND_ONCE_BUFFER_SIZE, uploadFile);
-            if (uploadWriteLen > 0) {
-                uploadFileTotalSize += uploadWriteLen;
-                MD5_Update(&uploadFileMd5Ctx, sendBuf, uploadWriteLen);
-                if (uploadWriteLen < SEND_ONCE_BUFFER_SIZE) {
-                    break;
-                }
-            }
-        }
+        MD5_Update(&uploadFileMd5Ctx, uploadData, uploadSize);
         MD5_Final(md5_out, &uploadFileMd5Ctx);
         memcpy(req.data.info.md5Buf, md5_out, sizeof(md5_out));
 
@@ -154,7 +154,7 @@ static void OPUploadFileTask(MopPipeline *OP_Pipeline) {
       }
       case RECV_FILE_INFO_ACK: {
         /*! Step 4 : receive the ack of the file info pack pushing */
-        MopPipeline::DataPackType readPack = {(uint8_t *) recvBuf, READ_ONCE_BUFFER_SIZE};
+        MopPipeline::DataPackType readPack = {(uint8_t *) recvBuf, READ_ACK_BUFFER_SIZE};
         mopRet = OP_Pipeline->recvData(readPack, &readPack.length);
         ASSERT_MOP_RET(mopRet)
         sampleProtocolStruct *ackData = (sampleProtocolStruct *) readPack.data;
@@ -169,34 +169,39 @@ static void OPUploadFileTask(MopPipeline *OP_Pipeline) {
       case SEND_FILE_RAW_DATA: {
         /*! Step 5 : send file raw data */
         DSTATUS("Step 5 : Send file raw data.");
-        sampleProtocolStruct *filePushingData = (sampleProtocolStruct *) recvBuf;
-        FILE *fp = fopen(TEST_SEND_FILE_NAME, "r");
         uint32_t cnt = 0;
-        auto targetFileSize = get_file_size(TEST_SEND_FILE_NAME);
-        if (fp == NULL) throw std::runtime_error("open file error");
-        int totalSize = 0;
+        uint32_t totalSize = 0;
         do {
-          int ret = fread((uint8_t *) filePushingData->data.fileData, 1, SEND_ONCE_BUFFER_SIZE - RAW_DATA_HEADER_LEN, fp);
-          totalSize += ret;
-          DSTATUS("total read size : %d; pdf read bytes ret = %d", totalSize, ret);
-          filePushingData->cmd = CMD_FILEDATA;
-          filePushingData->subcmd = (totalSize >= targetFileSize) ? END_PACK : NORMAL_PACK;
-          filePushingData->dataLen = ret;
-          MopPipeline::DataPackType fileDataPacket = {(uint8_t *) filePushingData, RAW_DATA_HEADER_LEN + filePushingData->dataLen};
+          uint32_t len = uploadSize - totalSize;
+          if (len > SEND_ONCE_BUFFER_SIZE - RAW_DATA_HEADER_LEN)
+            len = SEND_ONCE_BUFFER_SIZE - RAW_DATA_HEADER_LEN;
+          sampleProtocolStruct header;
+          memset(&header, 0, sizeof(header));
+          header.cmd = CMD_FILEDATA;
+          header.subcmd = (totalSize + len >= uploadSize) ? END_PACK : NORMAL_PACK;
+          header.dataLen = len;
+          /*! The header and the chunk of the mapping go as one message */
+          MopPipeline::DataPackType fileDataPackets[2] = {
+              {.data = (uint8_t *) &header, .length = RAW_DATA_HEADER_LEN},
+              {.data = uploadData + totalSize, .length = len}};
+          uint32_t sentLen = 0;
 
-          DSTATUS("Do sendData to PSDK, size : %d", fileDataPacket.length);
-          mopRet = OP_Pipeline->sendData(fileDataPacket, &fileDataPacket.length);
+          DSTATUS("Do sendData to PSDK, size : %d", RAW_DATA_HEADER_LEN + len);
+          mopRet = OP_Pipeline->sendData(fileDataPackets, 2, &sentLen);
           if (mopRet != MOP_PASSED) {
             DERROR("mop send error,stat:%lld, writePacket.length = %d", mopRet,
-                   fileDataPacket.length);
+                   sentLen);
             break;
           } else {
             DSTATUS("mop send success,stat:%lld, writePacket.length = %d", mopRet,
-                   fileDataPacket.length);
+                   sentLen);
           }
+          totalSize += len;
           cnt++;
           DSTATUS("send cnt %d!", cnt);
-        } while (totalSize < targetFileSize);
+        } while (totalSize < uploadSize);
+        if (uploadData) munmap(uploadData, uploadSize);
+        uploadData = NULL;
         uploadState = RECV_FINAL_RESULT;
         break;
       }
@@ -204,7 +209,7 @@ static void OPUploadFileTask(MopPipeline *OP_Pipeline) {
         DSTATUS("Step 6 : Wait for file upload result .");
 
         /*! Step 6 : get result */
-        MopPipeline::DataPackType readPack = {(uint8_t *) recvBuf, READ_ONCE_BUFFER_SIZE};
+        MopPipeline::DataPackType readPack = {(uint8_t *) recvBuf, READ_ACK_BUFFER_SIZE};
         do {
             mopRet = OP_Pipeline->recvData(readPack, &readPack.length);
         } while(mopRet == MOP_TIMEOUT);
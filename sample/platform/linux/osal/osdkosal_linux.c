@@ -25,7 +25,14 @@
  */
 
 /* Includes ------------------------------------------------------------------*/
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* pthread_setaffinity_np, pthread_setname_np */
+#endif
 #include "osdkosal_linux.h"
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
 
 /* Private constants ---------------------------------------------------------*/
 
@@ -70,6 +77,62 @@ E_OsdkStat OsdkLinux_TaskDestroy(T_OsdkTaskHandle task) {
   return OSDK_STAT_OK;
 }
 
+/**
+ * @brief Apply name, cpu affinity and priority to a created task.
+ * @param task:  pointer to the created task handle.
+ * @param attr:  attributes to apply, zero fields keep the defaults.
+ * @return an enum that represents a status of OSDK
+ */
+E_OsdkStat OsdkLinux_TaskSetAttr(T_OsdkTaskHandle task,
+                                 const T_OsdkTaskAttr *attr) {
+  pthread_t thread;
+  E_OsdkStat osdkStat = OSDK_STAT_OK;
+  int result;
+  int cpu;
+
+  if (task == NULL || attr == NULL) {
+    return OSDK_STAT_ERR_PARAM;
+  }
+  thread = *(pthread_t *)task;
+
+  if (attr->name) {
+    char name[OSDK_TASK_NAME_MAX_LEN];
+    strncpy(name, attr->name, sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+    pthread_setname_np(thread, name);
+  }
+
+  if (attr->cpuMask) {
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (cpu = 0; cpu < 32; cpu++) {
+      if (attr->cpuMask & (1u << cpu)) {
+        CPU_SET(cpu, &cpuSet);
+      }
+    }
+    result = pthread_setaffinity_np(thread, sizeof(cpuSet), &cpuSet);
+    if (result != 0) {
+      printf("Task affinity 0x%x not applied, error %d\n", attr->cpuMask,
+             result);
+      osdkStat = OSDK_STAT_ERR;
+    }
+  }
+
+  /* SCHED_FIFO needs CAP_SYS_NICE or a matching RLIMIT_RTPRIO */
+  if (attr->priority > 0) {
+    struct sched_param param;
+    param.sched_priority = attr->priority;
+    result = pthread_setschedparam(thread, SCHED_FIFO, &param);
+    if (result != 0) {
+      printf("Task priority %d not applied, error %d%s\n", attr->priority,
+             result, (result == EPERM) ? " (permission denied)" : "");
+      osdkStat = OSDK_STAT_ERR;
+    }
+  }
+
+  return osdkStat;
+}
+
 /**
  * @brief Task sleep function.
  * @param time_ms: task sleep time. unit: millisecond.
@@ -206,20 +269,32 @@ E_OsdkStat OsdkLinux_SemaphoreTimedWait(T_OsdkSemHandle semaphore,
                                         uint32_t waitTime) {
   int result;
   struct timespec semaphoreWaitTime;
-  struct timeval systemTime;
+  /*! sem_clockwait (glibc 2.30) keeps the timeout right across wall clock
+   *  jumps, older systems can only wait on CLOCK_REALTIME. */
+#if defined(__GLIBC__) && \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 30))
+  clockid_t clock = CLOCK_MONOTONIC;
+#else
+  clockid_t clock = CLOCK_REALTIME;
+#endif
 
-  gettimeofday(&systemTime, NULL);
+  clock_gettime(clock, &semaphoreWaitTime);
 
-  systemTime.tv_usec += waitTime * 1000;
-  if (systemTime.tv_usec >= 1000000) {
-    systemTime.tv_sec += systemTime.tv_usec / 1000000;
-    systemTime.tv_usec %= 1000000;
+  semaphoreWaitTime.tv_sec += waitTime / 1000;
+  semaphoreWaitTime.tv_nsec += (long)(waitTime % 1000) * 1000000;
+  if (semaphoreWaitTime.tv_nsec >= 1000000000) {
+    semaphoreWaitTime.tv_sec += 1;
+    semaphoreWaitTime.tv_nsec -= 1000000000;
   }
 
-  semaphoreWaitTime.tv_sec = systemTime.tv_sec;
-  semaphoreWaitTime.tv_nsec = systemTime.tv_usec * 1000;
-
-  result = sem_timedwait(semaphore, &semaphoreWaitTime);
+  do {
+#if defined(__GLIBC__) && \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 30))
+    result = sem_clockwait(semaphore, clock, &semaphoreWaitTime);
+#else
+    result = sem_timedwait(semaphore, &semaphoreWaitTime);
+#endif
+  } while (result != 0 && errno == EINTR);
   if (result != 0) {
     return OSDK_STAT_ERR;
   }
@@ -244,15 +319,33 @@ E_OsdkStat OsdkLinux_SemaphorePost(T_OsdkSemHandle semaphore) {
 }
 
 /**
- * @brief Get the system time for ms.
- * @param us: time of system, uint:ms
+ * @brief Get the system time for ms. The time is monotonic, so the timeouts
+ * based on it are not affected by NTP or GPS time corrections.
+ * @param ms: time of system, uint:ms
  * @return an enum that represents a status of OSDK
  */
 E_OsdkStat OsdkLinux_GetTimeMs(uint32_t *ms) {
-  struct timeval time;
+  uint64_t ns = 0;
+  E_OsdkStat stat = OsdkLinux_GetTimeNs(&ns);
+
+  *ms = (uint32_t)(ns / 1000000);
 
-  gettimeofday(&time, NULL);
-  *ms = (time.tv_sec * 1000 + time.tv_usec / 1000);
+  return stat;
+}
+
+/**
+ * @brief Get the monotonic time for ns, not stepped by NTP. It is the same
+ * clock as OsdkLinux_GetTimeMs and the semaphore timeouts.
+ * @param ns: time since boot, uint:ns
+ * @return an enum that represents a status of OSDK
+ */
+E_OsdkStat OsdkLinux_GetTimeNs(uint64_t *ns) {
+  struct timespec time;
+
+  if (clock_gettime(CLOCK_MONOTONIC, &time) != 0) {
+    return OSDK_STAT_ERR;
+  }
+  *ns = (uint64_t)time.tv_sec * 1000000000 + time.tv_nsec;
 
   return OSDK_STAT_OK;
 }
@@ -264,12 +357,12 @@ E_OsdkStat OsdkLinux_GetTimeMs(uint32_t *ms) {
  */
 #ifdef OS_DEBUG
 E_OsdkStat OsdkLinux_GetTimeUs(uint64_t *us) {
-  struct timeval time;
+  uint64_t ns = 0;
+  E_OsdkStat stat = OsdkLinux_GetTimeNs(&ns);
 
-  gettimeofday(&time, NULL);
-  *us = (time.tv_sec * 1000000 + time.tv_usec);
+  *us = ns / 1000;
 
-  return OSDK_STAT_OK;
+  return stat;
 }
 #endif
 
@@ -40,6 +40,7 @@
 
 #include "osdk_typedef.h"
 #include "osdk_platform.h"
+#include "dji_task_attr.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -54,6 +55,8 @@ extern "C" {
 E_OsdkStat OsdkLinux_TaskCreate(T_OsdkTaskHandle *task, void *(*taskFunc)(void *),
                                 uint32_t stackSize, void *arg);
 E_OsdkStat OsdkLinux_TaskDestroy(T_OsdkTaskHandle task);
+E_OsdkStat OsdkLinux_TaskSetAttr(T_OsdkTaskHandle task,
+                                 const T_OsdkTaskAttr *attr);
 E_OsdkStat OsdkLinux_TaskSleepMs(uint32_t time_ms);
 
 E_OsdkStat OsdkLinux_MutexCreate(T_OsdkMutexHandle *mutex);
@@ -70,6 +73,7 @@ E_OsdkStat OsdkLinux_SemaphoreTimedWait(T_OsdkSemHandle semaphore,
 E_OsdkStat OsdkLinux_SemaphorePost(T_OsdkSemHandle semaphore);
 
 E_OsdkStat OsdkLinux_GetTimeMs(uint32_t *ms);
+E_OsdkStat OsdkLinux_GetTimeNs(uint64_t *ns);
 
 #ifdef OS_DEBUG
 E_OsdkStat OsdkLinux_GetTimeUs(uint64_t *us);